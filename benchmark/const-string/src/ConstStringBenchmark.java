@@ -1059,6 +1059,27 @@ public class ConstStringBenchmark {
         }
     }
 
+    // Same as above, but with every thread resolving the same conflicting strings, so that each
+    // const-string goes to the intern table at the same time.
+    public void timeConstStringsWithConflictMultiThreaded(final int count) throws Exception {
+        Thread[] threads = new Thread[NUM_THREADS];
+        for (int t = 0; t < NUM_THREADS; ++t) {
+            threads[t] = new Thread() {
+                public void run() {
+                    timeConstStringsWithConflict(count);
+                }
+            };
+        }
+        for (Thread thread : threads) {
+            thread.start();
+        }
+        for (Thread thread : threads) {
+            thread.join();
+        }
+    }
+
+    static final int NUM_THREADS = 4;
+
     static void $noinline$foo(String s) {
         if (doThrow) { throw new Error(); }
     }
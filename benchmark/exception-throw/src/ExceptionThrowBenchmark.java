@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class ExceptionThrowBenchmark {
+    // Thrown over and over, so that the benchmarks measure delivery rather than
+    // filling in stack traces.
+    public static final IllegalStateException PREALLOCATED = new IllegalStateException();
+
+    public void timeCatchInSameFrame(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            try {
+                if (count >= 0) {
+                    throw PREALLOCATED;
+                }
+            } catch (IllegalStateException e) {
+                sum++;
+            }
+        }
+        check(sum, count);
+    }
+
+    public void timeCatchInCaller(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            try {
+                $noinline$throwAtDepth(0);
+            } catch (IllegalStateException e) {
+                sum++;
+            }
+        }
+        check(sum, count);
+    }
+
+    public void timeCatchAtDepth10(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            try {
+                $noinline$throwAtDepth(10);
+            } catch (IllegalStateException e) {
+                sum++;
+            }
+        }
+        check(sum, count);
+    }
+
+    public void timeCatchAfterSeveralHandlers(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            try {
+                $noinline$throwAtDepth(0);
+            } catch (ArithmeticException e) {
+                sum--;
+            } catch (IndexOutOfBoundsException e) {
+                sum--;
+            } catch (UnsupportedOperationException e) {
+                sum--;
+            } catch (IllegalStateException e) {
+                sum++;
+            }
+        }
+        check(sum, count);
+    }
+
+    public void timeCatchNewException(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            try {
+                $noinline$throwNew();
+            } catch (IllegalStateException e) {
+                sum++;
+            }
+        }
+        check(sum, count);
+    }
+
+    private static void $noinline$throwAtDepth(int depth) {
+        if (depth == 0) {
+            throw PREALLOCATED;
+        }
+        $noinline$throwAtDepth(depth - 1);
+    }
+
+    private static void $noinline$throwNew() {
+        throw new IllegalStateException();
+    }
+
+    private static void check(int sum, int count) {
+        if (sum != count) {
+            throw new AssertionError();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class GcSweepBenchmark {
+    public static final int OBJECTS = 200000;
+
+    private Object[] survivors;
+
+    // Every other object dies, so most runs are swept but none becomes empty.
+    public void timeSweepInterleaved(int count) {
+        for (int i = 0; i < count; ++i) {
+            survivors = $noinline$allocate(OBJECTS, 2);
+            Runtime.getRuntime().gc();
+        }
+    }
+
+    // Nearly every object dies, so most runs become empty and their pages are freed.
+    public void timeSweepMostlyDead(int count) {
+        for (int i = 0; i < count; ++i) {
+            survivors = $noinline$allocate(OBJECTS, 64);
+            Runtime.getRuntime().gc();
+        }
+    }
+
+    // Allocates objects of several size brackets and keeps every `keepEvery`-th one.
+    private static Object[] $noinline$allocate(int n, int keepEvery) {
+        Object[] kept = new Object[n / keepEvery + 1];
+        for (int i = 0; i < n; ++i) {
+            Object o;
+            switch (i & 3) {
+                case 0: o = new Object(); break;
+                case 1: o = new int[4]; break;
+                case 2: o = new long[16]; break;
+                default: o = new byte[200]; break;
+            }
+            if (i % keepEvery == 0) {
+                kept[i / keepEvery] = o;
+            }
+        }
+        return kept;
+    }
+}
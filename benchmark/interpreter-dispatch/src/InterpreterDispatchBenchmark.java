@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class InterpreterDispatchBenchmark {
+    public static final int ITERATIONS = 1000;
+
+    private final int[] array = new int[64];
+    private int field;
+
+    // Short arithmetic instructions, where dispatch dominates.
+    public void timeArithmetic(int count) {
+        int result = 0;
+        for (int i = 0; i < count; ++i) {
+            result += $noinline$arithmetic(ITERATIONS);
+        }
+        if (result == 42) {
+            throw new AssertionError();
+        }
+    }
+
+    // A mix of array, field and branch instructions.
+    public void timeMixed(int count) {
+        int result = 0;
+        for (int i = 0; i < count; ++i) {
+            result += $noinline$mixed(ITERATIONS);
+        }
+        if (result == 42) {
+            throw new AssertionError();
+        }
+    }
+
+    private static int $noinline$arithmetic(int n) {
+        int a = 1;
+        int b = 2;
+        long c = 3;
+        for (int i = 0; i < n; ++i) {
+            a = a * 31 + i;
+            b ^= a >>> 3;
+            c += (long) a - b;
+            a = (a & 0xffff) | (b << 16);
+        }
+        return a + b + (int) c;
+    }
+
+    private int $noinline$mixed(int n) {
+        int[] values = array;
+        for (int i = 0; i < n; ++i) {
+            int index = i & (values.length - 1);
+            if ((i & 1) == 0) {
+                values[index] += field;
+            } else {
+                field += values[index] - i;
+            }
+        }
+        return field;
+    }
+}
@@ -34,6 +34,15 @@ extern "C" JNIEXPORT void JNICALL Java_JniPerfBenchmark_perfSOAUncheckedCall(JNI
   ScopedObjectAccessUnchecked soa(Thread::Current());
 }
 
+extern "C" JNIEXPORT void JNICALL Java_JniPerfBenchmark_perfStringUTFRoundTrip(JNIEnv* env,
+                                                                               jobject,
+                                                                               jstring str) {
+  const char* chars = env->GetStringUTFChars(str, nullptr);
+  jstring copy = env->NewStringUTF(chars);
+  env->ReleaseStringUTFChars(str, chars);
+  env->DeleteLocalRef(copy);
+}
+
 }  // namespace
 
 }  // namespace art
@@ -16,10 +16,15 @@
 
 public class JniPerfBenchmark {
   private static final String MSG = "ABCDE";
+  private static final String ASCII_STRING =
+      "Lcom/example/benchmark/SomeRatherLongClassNameForJni$InnerClass;";
+  private static final String NON_ASCII_STRING =
+      "Lcom/example/benchmark/SomeRatherLongClassNameForJni$InnerClass\u00e9;";
 
   native void perfJniEmptyCall();
   native void perfSOACall();
   native void perfSOAUncheckedCall();
+  native void perfStringUTFRoundTrip(String str);
 
   public void timeFastJNI(int N) {
     // TODO: This might be an intrinsic.
@@ -46,6 +51,18 @@ public class JniPerfBenchmark {
     }
   }
 
+  public void timeStringUTFAscii(int N) {
+    for (long i = 0; i < N; i++) {
+      perfStringUTFRoundTrip(ASCII_STRING);
+    }
+  }
+
+  public void timeStringUTFNonAscii(int N) {
+    for (long i = 0; i < N; i++) {
+      perfStringUTFRoundTrip(NON_ASCII_STRING);
+    }
+  }
+
   {
     System.loadLibrary("artbenchmark");
   }
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class StackWalkBenchmark {
+    public static final int SHALLOW_DEPTH = 10;
+    public static final int DEEP_DEPTH = 200;
+
+    public void timeGetStackTraceShallow(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += $noinline$recurseA(SHALLOW_DEPTH, /* doThrow= */ false);
+        }
+        if (sum < count * SHALLOW_DEPTH) {
+            throw new AssertionError();
+        }
+    }
+
+    public void timeGetStackTraceDeep(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += $noinline$recurseA(DEEP_DEPTH, /* doThrow= */ false);
+        }
+        if (sum < count * DEEP_DEPTH) {
+            throw new AssertionError();
+        }
+    }
+
+    public void timeThrowCatchDeep(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            try {
+                $noinline$recurseA(DEEP_DEPTH, /* doThrow= */ true);
+            } catch (IllegalStateException e) {
+                sum += e.getStackTrace().length;
+            }
+        }
+        if (sum < count * DEEP_DEPTH) {
+            throw new AssertionError();
+        }
+    }
+
+    // Alternate between a few methods so that the walk sees several method headers and call sites.
+    private static int $noinline$recurseA(int depth, boolean doThrow) {
+        if (depth == 0) {
+            return $noinline$bottom(doThrow);
+        }
+        return $noinline$recurseB(depth - 1, doThrow);
+    }
+
+    private static int $noinline$recurseB(int depth, boolean doThrow) {
+        if (depth == 0) {
+            return $noinline$bottom(doThrow);
+        }
+        return $noinline$recurseC(depth - 1, doThrow);
+    }
+
+    private static int $noinline$recurseC(int depth, boolean doThrow) {
+        if (depth == 0) {
+            return $noinline$bottom(doThrow);
+        }
+        return $noinline$recurseA(depth - 1, doThrow);
+    }
+
+    private static int $noinline$bottom(boolean doThrow) {
+        if (doThrow) {
+            throw new IllegalStateException();
+        }
+        return Thread.currentThread().getStackTrace().length;
+    }
+}
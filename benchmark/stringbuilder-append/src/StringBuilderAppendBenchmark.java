@@ -19,6 +19,11 @@ public class StringBuilderAppendBenchmark {
     public static String string2 = "s2";
     public static String longString1 = "This is a long string 1";
     public static String longString2 = "This is a long string 2";
+    public static String veryLongString1 =
+        "This is a very long string 1 that takes several vector blocks to copy";
+    public static String veryLongString2 =
+        "This is a very long string 2 that takes several vector blocks to copy";
+    public static String nonAsciiString = "This string is not compressible: \u00e9";
     public static int int1 = 42;
 
     public void timeAppendStrings(int count) {
@@ -47,6 +52,32 @@ public class StringBuilderAppendBenchmark {
         }
     }
 
+    public void timeAppendVeryLongStrings(int count) {
+        String s1 = veryLongString1;
+        String s2 = veryLongString2;
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            String result = s1 + s2;
+            sum += result.length();  // Make sure the append is not optimized away.
+        }
+        if (sum != count * (s1.length() + s2.length())) {
+            throw new AssertionError();
+        }
+    }
+
+    public void timeAppendVeryLongAndNonAsciiStrings(int count) {
+        String s1 = veryLongString1;
+        String s2 = nonAsciiString;
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            String result = s1 + s2;
+            sum += result.length();  // Make sure the append is not optimized away.
+        }
+        if (sum != count * (s1.length() + s2.length())) {
+            throw new AssertionError();
+        }
+    }
+
     public void timeAppendStringAndInt(int count) {
         String s1 = string1;
         int i1 = int1;
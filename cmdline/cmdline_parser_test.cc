@@ -236,6 +236,17 @@ TEST_F(CmdlineParserTest, TestSimpleSuccesses) {
   EXPECT_SINGLE_PARSE_VALUE(false, "-XX:DisableHSpaceCompactForOOM", M::EnableHSpaceCompactForOOM);
   EXPECT_SINGLE_PARSE_VALUE(0.5, "-XX:HeapTargetUtilization=0.5", M::HeapTargetUtilization);
   EXPECT_SINGLE_PARSE_VALUE(5u, "-XX:ParallelGCThreads=5", M::ParallelGCThreads);
+  EXPECT_SINGLE_PARSE_VALUE(0.05, "-XX:GcTargetCpuFraction=0.05", M::GcTargetCpuFraction);
+  EXPECT_SINGLE_PARSE_VALUE(0.01, "-XX:GcTargetPauseFraction=0.01", M::GcTargetPauseFraction);
+  EXPECT_SINGLE_PARSE_VALUE(0.25,
+                            "-XX:LargeObjectSpaceCompactionThreshold=0.25",
+                            M::LargeObjectSpaceCompactionThreshold);
+  EXPECT_SINGLE_PARSE_VALUE(2u,
+                            "-Xstartup-class-preload-threads:2",
+                            M::StartupClassPreloadThreads);
+  EXPECT_SINGLE_PARSE_EXISTS("-Xmethod-trace-compress", M::MethodTraceCompression);
+  EXPECT_SINGLE_PARSE_VALUE_STR("/tmp/cpu.pb", "-Xcpu-profile:/tmp/cpu.pb", M::CpuProfileFile);
+  EXPECT_SINGLE_PARSE_VALUE(1000u, "-Xcpu-profile-interval:1000", M::CpuProfileInterval);
 }  // TEST_F
 
 TEST_F(CmdlineParserTest, TestSimpleFailures) {
@@ -249,6 +260,10 @@ TEST_F(CmdlineParserTest, TestSimpleFailures) {
   EXPECT_SINGLE_PARSE_FAIL("-XX:HeapTargetUtilization=0.0", CmdlineResult::kOutOfRange);  // toosmal
   EXPECT_SINGLE_PARSE_FAIL("-XX:HeapTargetUtilization=2.0", CmdlineResult::kOutOfRange);  // toolarg
   EXPECT_SINGLE_PARSE_FAIL("-XX:ParallelGCThreads=-5", CmdlineResult::kOutOfRange);  // too small
+  EXPECT_SINGLE_PARSE_FAIL("-XX:GcTargetCpuFraction=0.9", CmdlineResult::kOutOfRange);  // toolarg
+  EXPECT_SINGLE_PARSE_FAIL("-XX:LargeObjectSpaceCompactionThreshold=1.5",
+                           CmdlineResult::kOutOfRange);  // toolarg
+  EXPECT_SINGLE_PARSE_FAIL("-Xcpu-profile-interval:0", CmdlineResult::kOutOfRange);  // toosmall
   EXPECT_SINGLE_PARSE_FAIL("-Xgc:blablabla", CmdlineResult::kUsage);  // not a valid suboption
 }  // TEST_F
 
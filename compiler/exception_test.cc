@@ -23,6 +23,7 @@
 #include "base/enums.h"
 #include "base/leb128.h"
 #include "base/malloc_arena_pool.h"
+#include "catch_handler_cache.h"
 #include "class_linker.h"
 #include "common_runtime_test.h"
 #include "dex/code_item_accessors-inl.h"
@@ -162,6 +163,56 @@ TEST_F(ExceptionTest, FindCatchHandler) {
   }
 }
 
+TEST_F(ExceptionTest, FindCatchBlockCached) {
+  ScopedObjectAccess soa(Thread::Current());
+  CodeItemDataAccessor accessor(*dex_, method_f_->GetCodeItem());
+  CatchHandlerIterator first_try(accessor, 4 /* Dex PC in the first try block */);
+  const uint32_t io_handler = first_try.GetHandlerAddress();
+  first_try.Next();
+  const uint32_t exception_handler = first_try.GetHandlerAddress();
+
+  StackHandleScope<4> hs(soa.Self());
+  Handle<mirror::Class> io_exception =
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "Ljava/io/IOException;"));
+  Handle<mirror::Class> exception =
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Exception;"));
+  Handle<mirror::Class> runtime_exception =
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/RuntimeException;"));
+  Handle<mirror::Class> error =
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Error;"));
+  struct {
+    uint32_t dex_pc;
+    Handle<mirror::Class> exception_type;
+    uint32_t expected_handler;
+  } cases[] = {
+    { 4u, io_exception, io_handler },
+    { 4u, exception, exception_handler },
+    { 4u, runtime_exception, exception_handler },
+    { 4u, error, dex::kDexNoIndex },
+    { 11u /* Dex PC not in any try block */, io_exception, dex::kDexNoIndex },
+  };
+  bool first_has_no_move_exception[arraysize(cases)] = {};
+  // The second lookup is served from the cache, the third one after invalidating it.
+  for (size_t pass = 0; pass != 3; ++pass) {
+    if (pass == 2) {
+      CatchHandlerCache::InvalidateAll();
+    }
+    for (size_t i = 0; i != arraysize(cases); ++i) {
+      const auto& c = cases[i];
+      bool has_no_move_exception = false;
+      uint32_t handler =
+          method_f_->FindCatchBlock(c.exception_type, c.dex_pc, &has_no_move_exception);
+      EXPECT_EQ(c.expected_handler, handler) << c.dex_pc << " " << c.exception_type->PrettyClass();
+      if (pass == 0) {
+        first_has_no_move_exception[i] = has_no_move_exception;
+      } else {
+        EXPECT_EQ(first_has_no_move_exception[i], has_no_move_exception);
+      }
+    }
+  }
+  EXPECT_FALSE(soa.Self()->IsExceptionPending());
+}
+
 TEST_F(ExceptionTest, StackTraceElement) {
   Thread* thread = Thread::Current();
   thread->TransitionFromSuspendedToRunnable();
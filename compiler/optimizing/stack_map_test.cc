@@ -19,6 +19,8 @@
 #include "art_method.h"
 #include "base/arena_bit_vector.h"
 #include "base/malloc_arena_pool.h"
+#include "oat_quick_method_header.h"
+#include "stack_map_cache.h"
 #include "stack_map_stream.h"
 
 #include "gtest/gtest.h"
@@ -768,4 +770,56 @@ TEST(StackMapTest, TestDedupeBitTables) {
   ASSERT_GT(memory.size() * 2, out.size());
 }
 
+TEST(StackMapTest, TestStackMapCache) {
+  MallocArenaPool pool;
+  ArenaStack arena_stack(&pool);
+  ScopedArenaAllocator allocator(&arena_stack);
+  // Encode a method with stack maps at `first_pc`, `first_pc` + 8, ... (in instructions).
+  auto encode = [&allocator](uint32_t first_pc, uint32_t num_stack_maps) {
+    StackMapStream stream(&allocator, kRuntimeISA);
+    stream.BeginMethod(32, 0, 0, 0);
+    for (uint32_t i = 0; i != num_stack_maps; ++i) {
+      stream.BeginStackMapEntry(i, (first_pc + 8 * i) * kPcAlign);
+      stream.EndStackMapEntry();
+    }
+    stream.EndMethod((first_pc + 8 * num_stack_maps) * kPcAlign);
+    return stream.Encode();
+  };
+
+  // Lay out the CodeInfo followed by the method header, as in compiled code.
+  std::vector<uint8_t> code(1 * KB);
+  const size_t header_offset = RoundUp(code.size() / 2, alignof(OatQuickMethodHeader));
+  auto install = [&code, header_offset](const ScopedArenaVector<uint8_t>& code_info_data) {
+    CHECK_LE(code_info_data.size(), header_offset);
+    std::copy(code_info_data.begin(), code_info_data.end(), code.begin());
+    uint32_t code_info_offset = header_offset + sizeof(OatQuickMethodHeader);
+    return new (code.data() + header_offset) OatQuickMethodHeader(code_info_offset);
+  };
+
+  StackMapCache cache;
+  const OatQuickMethodHeader* header = install(encode(16, 4));
+  for (size_t pass = 0; pass != 2; ++pass) {  // The second pass hits in the cache.
+    CodeInfo code_info = cache.GetCodeInfo(header);
+    ASSERT_EQ(4u, code_info.GetNumberOfStackMaps());
+    for (uint32_t i = 0; i != 4; ++i) {
+      uint32_t native_pc_offset = (16 + 8 * i) * kPcAlign;
+      StackMap stack_map = cache.GetStackMapForNativePcOffset(header, code_info, native_pc_offset);
+      ASSERT_TRUE(stack_map.IsValid());
+      ASSERT_TRUE(stack_map.Equals(code_info.GetStackMapForNativePcOffset(native_pc_offset)));
+      ASSERT_EQ(i, stack_map.GetDexPc());
+    }
+    ASSERT_FALSE(cache.GetStackMapForNativePcOffset(header, code_info, 12 * kPcAlign).IsValid());
+  }
+
+  // Replace the code at the same address, as the JIT code cache may do after freeing it.
+  header = install(encode(8, 2));
+  StackMapCache::InvalidateAll();
+  CodeInfo code_info = cache.GetCodeInfo(header);
+  ASSERT_EQ(2u, code_info.GetNumberOfStackMaps());
+  StackMap stack_map = cache.GetStackMapForNativePcOffset(header, code_info, 16 * kPcAlign);
+  ASSERT_TRUE(stack_map.IsValid());
+  ASSERT_EQ(1u, stack_map.GetDexPc());
+  ASSERT_FALSE(cache.GetStackMapForNativePcOffset(header, code_info, 24 * kPcAlign).IsValid());
+}
+
 }  // namespace art
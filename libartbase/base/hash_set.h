@@ -633,6 +633,21 @@ class HashSet {
     return num_buckets_;
   }
 
+  // Visit the elements stored in buckets [begin, end). The visitor may update an element in place
+  // as long as its hash does not change, but must not insert or erase. Disjoint ranges may be
+  // visited by different threads, which lets callers split a pass over a large set.
+  template <typename Visitor>
+  void VisitBucketRange(size_t begin, size_t end, Visitor&& visitor) {
+    DCHECK_LE(begin, end);
+    DCHECK_LE(end, NumBuckets());
+    for (size_t i = begin; i != end; ++i) {
+      T& element = ElementForIndex(i);
+      if (!emptyfn_.IsEmpty(element)) {
+        visitor(element);
+      }
+    }
+  }
+
  private:
   T& ElementForIndex(size_t index) {
     DCHECK_LT(index, NumBuckets());
@@ -16,8 +16,10 @@
 
 #include "hash_set.h"
 
+#include <algorithm>
 #include <forward_list>
 #include <map>
+#include <set>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -441,6 +443,28 @@ class StatefulPred {
   const std::vector<std::string>* strings_;
 };
 
+TEST_F(HashSetTest, VisitBucketRange) {
+  HashSet<std::string, IsEmptyFnString> hash_set;
+  std::vector<std::string> strings;
+  for (size_t i = 0; i < 1000; ++i) {
+    strings.push_back(RandomString(10));
+    hash_set.insert(strings.back());
+  }
+  // Visiting the buckets in a few disjoint ranges sees every element exactly once.
+  const size_t num_buckets = hash_set.NumBuckets();
+  const size_t range = num_buckets / 3 + 1;
+  std::multiset<std::string> visited;
+  for (size_t begin = 0; begin < num_buckets; begin += range) {
+    hash_set.VisitBucketRange(begin,
+                              std::min(begin + range, num_buckets),
+                              [&](const std::string& element) { visited.insert(element); });
+  }
+  ASSERT_EQ(visited.size(), strings.size());
+  for (const std::string& str : strings) {
+    EXPECT_EQ(visited.count(str), 1u) << str;
+  }
+}
+
 TEST_F(HashSetTest, StatefulHashSet) {
   std::vector<std::string> strings{
       "duplicate",
@@ -55,7 +55,18 @@
   METRIC(YoungGcThroughput, MetricsHistogram, 15, 0, 10'000)            \
   METRIC(FullGcThroughput, MetricsHistogram, 15, 0, 10'000)             \
   METRIC(YoungGcTracingThroughput, MetricsHistogram, 15, 0, 10'000)     \
-  METRIC(FullGcTracingThroughput, MetricsHistogram, 15, 0, 10'000)
+  METRIC(FullGcTracingThroughput, MetricsHistogram, 15, 0, 10'000)      \
+  METRIC(SuspendAllCount, MetricsCounter)                               \
+  METRIC(SlowSafepointCount, MetricsCounter)                            \
+  METRIC(TimeToSafepoint, MetricsHistogram, 15, 0, 10'000)              \
+  METRIC(SuspendAllPauseTime, MetricsHistogram, 15, 0, 100'000)         \
+  METRIC(TimeToCheckpoint, MetricsHistogram, 15, 0, 10'000)             \
+  METRIC(StartupClassPreloadCount, MetricsCounter)                      \
+  METRIC(StartupClassPreloadUsedCount, MetricsCounter)                  \
+  METRIC(StartupClassPreloadTimeSaved, MetricsCounter)                  \
+  METRIC(InterpreterCacheMissCount, MetricsCounter)                     \
+  METRIC(InterpreterCacheSecondLevelHitCount, MetricsCounter)           \
+  METRIC(InterpreterCacheResizeCount, MetricsCounter)
 
 // A lot of the metrics implementation code is generated by passing one-off macros into ART_COUNTERS
 // and ART_HISTOGRAMS. This means metrics.h and metrics.cc are very #define-heavy, which can be
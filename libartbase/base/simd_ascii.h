@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_LIBARTBASE_BASE_SIMD_ASCII_H_
+#define ART_LIBARTBASE_BASE_SIMD_ASCII_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "macros.h"
+
+namespace art {
+
+// Kernels for the ASCII fast paths of string conversions. Each kernel handles a block of
+// `kAsciiBlockSize` bytes or chars; the `...Blocks()` helpers run them over the longest prefix of
+// whole blocks that qualifies and return its length, leaving the rest (from the first block with a
+// non-ASCII element, plus any partial block) to the caller's scalar code. The remaining helpers
+// at the end of the file process a whole range, including its tail.
+//
+// None of the kernels require any alignment.
+
+// Number of bytes or chars handled by each call to the block kernels below.
+static constexpr size_t kAsciiBlockSize = 16;
+
+// Whether the kernels below are vectorized on this target. When they are not, the `...Blocks()`
+// helpers do nothing and callers use their scalar loops, which are at least as fast as a scalar
+// block test.
+#if defined(__SSE2__) || defined(__aarch64__)
+static constexpr bool kHasVectorAscii = true;
+#else
+static constexpr bool kHasVectorAscii = false;
+#endif
+
+// Return true iff none of the `kAsciiBlockSize` bytes at `p` has its high bit set.
+ALWAYS_INLINE inline bool IsAsciiBlock(const uint8_t* p) {
+#if defined(__SSE2__)
+  return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) == 0;
+#elif defined(__aarch64__)
+  return vmaxvq_u8(vld1q_u8(p)) < 0x80u;
+#else
+  uint8_t bits = 0u;
+  for (size_t i = 0; i < kAsciiBlockSize; ++i) {
+    bits |= p[i];
+  }
+  return bits < 0x80u;
+#endif
+}
+
+// Return true iff all `kAsciiBlockSize` bytes at `p` are in the range [1, 0x7f].
+ALWAYS_INLINE inline bool IsNonZeroAsciiBlock(const uint8_t* p) {
+#if defined(__SSE2__)
+  // Zero bytes become 0xff, so the sign bits catch both zeros and non-ASCII bytes.
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  return _mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, _mm_setzero_si128()))) == 0;
+#elif defined(__aarch64__)
+  return vmaxvq_u8(vsubq_u8(vld1q_u8(p), vdupq_n_u8(1u))) < 0x7fu;
+#else
+  for (size_t i = 0; i < kAsciiBlockSize; ++i) {
+    if (static_cast<uint8_t>(p[i] - 1u) >= 0x7fu) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+// Return true iff all `kAsciiBlockSize` chars at `p` are in the range [1, 0x7f], i.e. those that
+// Modified UTF-8 and compressed strings store in a single byte.
+ALWAYS_INLINE inline bool IsNonZeroAsciiBlock(const uint16_t* p) {
+#if defined(__SSE2__)
+  // `c - 1` wraps around for 0, so `c - 1 <= 0x7e` holds exactly for 1 <= c <= 0x7f. The
+  // saturating subtraction of 0x7e leaves zero only for those chars.
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i limit = _mm_set1_epi16(0x7e);
+  const __m128i* vp = reinterpret_cast<const __m128i*>(p);
+  const __m128i v =
+      _mm_or_si128(_mm_subs_epu16(_mm_sub_epi16(_mm_loadu_si128(vp), ones), limit),
+                   _mm_subs_epu16(_mm_sub_epi16(_mm_loadu_si128(vp + 1), ones), limit));
+  return _mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_setzero_si128())) == 0xffff;
+#elif defined(__aarch64__)
+  const uint16x8_t ones = vdupq_n_u16(1u);
+  const uint16x8_t v =
+      vmaxq_u16(vsubq_u16(vld1q_u16(p), ones), vsubq_u16(vld1q_u16(p + 8), ones));
+  return vmaxvq_u16(v) < 0x7fu;
+#else
+  for (size_t i = 0; i < kAsciiBlockSize; ++i) {
+    if (static_cast<uint16_t>(p[i] - 1u) >= 0x7fu) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+// Return true iff all `kAsciiBlockSize` chars at `p` are below `limit`, which must not be 0.
+ALWAYS_INLINE inline bool IsCharBlockBelow(const uint16_t* p, uint16_t limit) {
+#if defined(__SSE2__)
+  // The saturating subtraction of `limit - 1` leaves zero only for chars below `limit`.
+  const __m128i max = _mm_set1_epi16(static_cast<int16_t>(limit - 1u));
+  const __m128i* vp = reinterpret_cast<const __m128i*>(p);
+  const __m128i v = _mm_or_si128(_mm_subs_epu16(_mm_loadu_si128(vp), max),
+                                 _mm_subs_epu16(_mm_loadu_si128(vp + 1), max));
+  return _mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_setzero_si128())) == 0xffff;
+#elif defined(__aarch64__)
+  return vmaxvq_u16(vmaxq_u16(vld1q_u16(p), vld1q_u16(p + 8))) < limit;
+#else
+  for (size_t i = 0; i < kAsciiBlockSize; ++i) {
+    if (p[i] >= limit) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+// Zero-extend the `kAsciiBlockSize` bytes at `in` to chars at `out`.
+ALWAYS_INLINE inline void WidenBlock(const uint8_t* in, uint16_t* out) {
+#if defined(__SSE2__)
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+  __m128i* vout = reinterpret_cast<__m128i*>(out);
+  _mm_storeu_si128(vout, _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+  _mm_storeu_si128(vout + 1, _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+#elif defined(__aarch64__)
+  const uint8x16_t v = vld1q_u8(in);
+  vst1q_u16(out, vmovl_u8(vget_low_u8(v)));
+  vst1q_u16(out + 8, vmovl_high_u8(v));
+#else
+  for (size_t i = 0; i < kAsciiBlockSize; ++i) {
+    out[i] = in[i];
+  }
+#endif
+}
+
+// Store the low bytes of the `kAsciiBlockSize` chars at `in` to `out`. All chars must be below
+// 0x100.
+ALWAYS_INLINE inline void NarrowBlock(const uint16_t* in, uint8_t* out) {
+#if defined(__SSE2__)
+  // The saturation of `packus` does not matter for chars below 0x100.
+  const __m128i* vin = reinterpret_cast<const __m128i*>(in);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                   _mm_packus_epi16(_mm_loadu_si128(vin), _mm_loadu_si128(vin + 1)));
+#elif defined(__aarch64__)
+  vst1q_u8(out, vcombine_u8(vmovn_u16(vld1q_u16(in)), vmovn_u16(vld1q_u16(in + 8))));
+#else
+  for (size_t i = 0; i < kAsciiBlockSize; ++i) {
+    out[i] = static_cast<uint8_t>(in[i]);
+  }
+#endif
+}
+
+// Return the length of the longest prefix of whole blocks of `data[0, length)` with only ASCII
+// bytes.
+ALWAYS_INLINE inline size_t CountAsciiBlocks(const uint8_t* data, size_t length) {
+  size_t i = 0;
+  if (kHasVectorAscii) {
+    while (length - i >= kAsciiBlockSize && IsAsciiBlock(data + i)) {
+      i += kAsciiBlockSize;
+    }
+  }
+  return i;
+}
+
+// Return the length of the longest prefix of whole blocks of `data[0, length)` with only chars in
+// the range [1, 0x7f].
+ALWAYS_INLINE inline size_t CountNonZeroAsciiBlocks(const uint16_t* data, size_t length) {
+  size_t i = 0;
+  if (kHasVectorAscii) {
+    while (length - i >= kAsciiBlockSize && IsNonZeroAsciiBlock(data + i)) {
+      i += kAsciiBlockSize;
+    }
+  }
+  return i;
+}
+
+// Zero-extend the longest prefix of whole blocks of `in[0, length)` with only ASCII bytes to
+// `out` and return its length.
+ALWAYS_INLINE inline size_t WidenAsciiBlocks(const uint8_t* in, uint16_t* out, size_t length) {
+  size_t i = 0;
+  if (kHasVectorAscii) {
+    while (length - i >= kAsciiBlockSize && IsAsciiBlock(in + i)) {
+      WidenBlock(in + i, out + i);
+      i += kAsciiBlockSize;
+    }
+  }
+  return i;
+}
+
+// Narrow the longest prefix of whole blocks of `in[0, length)` with only chars in the range
+// [1, 0x7f] to `out` and return its length.
+ALWAYS_INLINE inline size_t NarrowNonZeroAsciiBlocks(const uint16_t* in,
+                                                     uint8_t* out,
+                                                     size_t length) {
+  size_t i = 0;
+  if (kHasVectorAscii) {
+    while (length - i >= kAsciiBlockSize && IsNonZeroAsciiBlock(in + i)) {
+      NarrowBlock(in + i, out + i);
+      i += kAsciiBlockSize;
+    }
+  }
+  return i;
+}
+
+// Return true iff all of `data[0, length)` is in the range [1, 0x7f], i.e. the elements can be
+// stored in a compressed string.
+template <typename CharType>
+ALWAYS_INLINE inline bool AllNonZeroAscii(const CharType* data, size_t length) {
+  static_assert(sizeof(CharType) == 1u || sizeof(CharType) == 2u, "Unexpected char type");
+  using UnsignedType = std::conditional_t<sizeof(CharType) == 1u, uint8_t, uint16_t>;
+  const UnsignedType* p = reinterpret_cast<const UnsignedType*>(data);
+  size_t i = 0;
+  if (kHasVectorAscii) {
+    for (; length - i >= kAsciiBlockSize; i += kAsciiBlockSize) {
+      if (!IsNonZeroAsciiBlock(p + i)) {
+        return false;
+      }
+    }
+  }
+  for (; i != length; ++i) {
+    if (static_cast<UnsignedType>(p[i] - 1u) >= 0x7fu) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Zero-extend all of `in[0, length)` to `out`.
+ALWAYS_INLINE inline void WidenChars(const uint8_t* in, uint16_t* out, size_t length) {
+  size_t i = 0;
+  if (kHasVectorAscii) {
+    for (; length - i >= kAsciiBlockSize; i += kAsciiBlockSize) {
+      WidenBlock(in + i, out + i);
+    }
+  }
+  for (; i != length; ++i) {
+    out[i] = in[i];
+  }
+}
+
+// Store the low bytes of all of `in[0, length)` to `out`. All chars must be below 0x100.
+ALWAYS_INLINE inline void NarrowChars(const uint16_t* in, uint8_t* out, size_t length) {
+  size_t i = 0;
+  if (kHasVectorAscii) {
+    for (; length - i >= kAsciiBlockSize; i += kAsciiBlockSize) {
+      NarrowBlock(in + i, out + i);
+    }
+  }
+  for (; i != length; ++i) {
+    out[i] = static_cast<uint8_t>(in[i]);
+  }
+}
+
+}  // namespace art
+
+#endif  // ART_LIBARTBASE_BASE_SIMD_ASCII_H_
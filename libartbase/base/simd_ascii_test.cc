@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "simd_ascii.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+// Lengths covering empty input, partial blocks, whole blocks and both together.
+static constexpr size_t kMaxTestLength = 3u * kAsciiBlockSize + 5u;
+
+TEST(SimdAscii, AllNonZeroAscii) {
+  for (size_t length = 0; length <= kMaxTestLength; ++length) {
+    std::vector<uint8_t> bytes(length, 'a');
+    std::vector<uint16_t> chars(length, 'a');
+    EXPECT_TRUE(AllNonZeroAscii(bytes.data(), length)) << length;
+    EXPECT_TRUE(AllNonZeroAscii(chars.data(), length)) << length;
+    // A single char outside [1, 0x7f] anywhere must be found, in a block or in the tail.
+    for (size_t pos = 0; pos != length; ++pos) {
+      for (uint16_t c : {0x00u, 0x80u, 0xffu}) {
+        bytes[pos] = static_cast<uint8_t>(c);
+        EXPECT_FALSE(AllNonZeroAscii(bytes.data(), length)) << length << " " << pos << " " << c;
+        bytes[pos] = 'a';
+      }
+      for (uint16_t c : {0x0000u, 0x0080u, 0x00ffu, 0x0100u, 0x7fffu, 0x8001u, 0xffffu}) {
+        chars[pos] = c;
+        EXPECT_FALSE(AllNonZeroAscii(chars.data(), length)) << length << " " << pos << " " << c;
+        chars[pos] = 'a';
+      }
+      bytes[pos] = 0x7fu;
+      chars[pos] = 0x7fu;
+      EXPECT_TRUE(AllNonZeroAscii(bytes.data(), length)) << length << " " << pos;
+      EXPECT_TRUE(AllNonZeroAscii(chars.data(), length)) << length << " " << pos;
+      bytes[pos] = 1u;
+      chars[pos] = 1u;
+      EXPECT_TRUE(AllNonZeroAscii(bytes.data(), length)) << length << " " << pos;
+      EXPECT_TRUE(AllNonZeroAscii(chars.data(), length)) << length << " " << pos;
+    }
+  }
+}
+
+TEST(SimdAscii, IsCharBlockBelow) {
+  for (uint16_t limit : {0x80u, 0x100u}) {
+    uint16_t chars[kAsciiBlockSize];
+    std::fill_n(chars, kAsciiBlockSize, 0u);
+    EXPECT_TRUE(IsCharBlockBelow(chars, limit));
+    for (size_t pos = 0; pos != kAsciiBlockSize; ++pos) {
+      chars[pos] = limit - 1u;
+      EXPECT_TRUE(IsCharBlockBelow(chars, limit)) << limit << " " << pos;
+      for (uint32_t c : {limit + 0u, limit + 1u, 0x8000u, 0xffffu}) {
+        chars[pos] = static_cast<uint16_t>(c);
+        EXPECT_FALSE(IsCharBlockBelow(chars, limit)) << limit << " " << pos << " " << c;
+      }
+      chars[pos] = 0u;
+    }
+  }
+}
+
+TEST(SimdAscii, WidenAndNarrowChars) {
+  for (size_t length = 0; length <= kMaxTestLength; ++length) {
+    // Use all byte values, including those that are not ASCII, and an unaligned destination.
+    std::vector<uint8_t> bytes(length);
+    for (size_t i = 0; i != length; ++i) {
+      bytes[i] = static_cast<uint8_t>(i * 37u + 0x70u);
+    }
+    std::vector<uint16_t> chars(length + 2u, 0xffffu);
+    WidenChars(bytes.data(), chars.data() + 1u, length);
+    EXPECT_EQ(chars[0], 0xffffu);
+    EXPECT_EQ(chars[length + 1u], 0xffffu);
+    for (size_t i = 0; i != length; ++i) {
+      EXPECT_EQ(chars[i + 1u], bytes[i]) << length << " " << i;
+    }
+
+    std::vector<uint8_t> narrowed(length + 2u, 0xffu);
+    NarrowChars(chars.data() + 1u, narrowed.data() + 1u, length);
+    EXPECT_EQ(narrowed[0], 0xffu);
+    EXPECT_EQ(narrowed[length + 1u], 0xffu);
+    for (size_t i = 0; i != length; ++i) {
+      EXPECT_EQ(narrowed[i + 1u], bytes[i]) << length << " " << i;
+    }
+  }
+}
+
+}  // namespace art
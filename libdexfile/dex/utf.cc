@@ -16,17 +16,30 @@
 
 #include "utf.h"
 
+#include <array>
+
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 
 #include "base/casts.h"
+#include "base/simd_ascii.h"
 #include "utf-inl.h"
 
 namespace art {
 
 using android::base::StringAppendF;
 
+// `kPowersOf31[i]` is 31^i, modulo 2^32.
+static constexpr std::array<uint32_t, kAsciiBlockSize + 1u> kPowersOf31 = []() {
+  std::array<uint32_t, kAsciiBlockSize + 1u> powers = {};
+  powers[0] = 1u;
+  for (size_t i = 1; i != powers.size(); ++i) {
+    powers[i] = powers[i - 1u] * 31u;
+  }
+  return powers;
+}();
+
 // This is used only from debugger and test code.
 size_t CountModifiedUtf8Chars(const char* utf8) {
   return CountModifiedUtf8Chars(utf8, strlen(utf8));
@@ -49,9 +62,10 @@ size_t CountModifiedUtf8Chars(const char* utf8) {
  */
 size_t CountModifiedUtf8Chars(const char* utf8, size_t byte_count) {
   DCHECK_LE(byte_count, strlen(utf8));
-  size_t len = 0;
+  // Leading ASCII bytes are one char each.
+  size_t len = CountAsciiBlocks(reinterpret_cast<const uint8_t*>(utf8), byte_count);
   const char* end = utf8 + byte_count;
-  for (; utf8 < end; ++utf8) {
+  for (utf8 += len; utf8 < end; ++utf8) {
     int ic = *utf8;
     len++;
     if (LIKELY((ic & 0x80) == 0)) {
@@ -94,9 +108,13 @@ void ConvertModifiedUtf8ToUtf16(uint16_t* utf16_data_out, const char* utf8_data_
 
 void ConvertModifiedUtf8ToUtf16(uint16_t* utf16_data_out, size_t out_chars,
                                 const char* utf8_data_in, size_t in_bytes) {
-  const char *in_start = utf8_data_in;
+  // Convert leading ASCII bytes a block at a time. If all characters are ASCII, this leaves at
+  // most a partial block.
+  size_t ascii_count = WidenAsciiBlocks(
+      reinterpret_cast<const uint8_t*>(utf8_data_in), utf16_data_out, in_bytes);
+  const char *in_start = utf8_data_in + ascii_count;
   const char *in_end = utf8_data_in + in_bytes;
-  uint16_t *out_p = utf16_data_out;
+  uint16_t *out_p = utf16_data_out + ascii_count;
 
   if (LIKELY(out_chars == in_bytes)) {
     // Common case where all characters are ASCII.
@@ -123,6 +141,15 @@ void ConvertModifiedUtf8ToUtf16(uint16_t* utf16_data_out, size_t out_chars,
 
 void ConvertUtf16ToModifiedUtf8(char* utf8_out, size_t byte_count,
                                 const uint16_t* utf16_in, size_t char_count) {
+  // Convert leading one-byte characters a block at a time. If all characters are ASCII, this
+  // leaves at most a partial block.
+  size_t ascii_count =
+      NarrowNonZeroAsciiBlocks(utf16_in, reinterpret_cast<uint8_t*>(utf8_out), char_count);
+  utf8_out += ascii_count;
+  utf16_in += ascii_count;
+  byte_count -= ascii_count;
+  char_count -= ascii_count;
+
   if (LIKELY(byte_count == char_count)) {
     // Common case where all characters are ASCII.
     const uint16_t *utf16_end = utf16_in + char_count;
@@ -176,6 +203,22 @@ void ConvertUtf16ToModifiedUtf8(char* utf8_out, size_t byte_count,
 
 int32_t ComputeUtf16HashFromModifiedUtf8(const char* utf8, size_t utf16_length) {
   uint32_t hash = 0;
+  // Hash leading ASCII bytes a block at a time, with the multiplications by powers of 31
+  // independent of each other. Each char takes at least one byte, so the blocks stay within the
+  // string.
+  if (kHasVectorAscii) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(utf8);
+    while (utf16_length >= kAsciiBlockSize && IsAsciiBlock(bytes)) {
+      uint32_t block_hash = 0u;
+      for (size_t i = 0; i != kAsciiBlockSize; ++i) {
+        block_hash += bytes[i] * kPowersOf31[kAsciiBlockSize - 1u - i];
+      }
+      hash = hash * kPowersOf31[kAsciiBlockSize] + block_hash;
+      bytes += kAsciiBlockSize;
+      utf16_length -= kAsciiBlockSize;
+    }
+    utf8 = reinterpret_cast<const char*>(bytes);
+  }
   while (utf16_length != 0u) {
     const uint32_t pair = GetUtf16FromUtf8(&utf8);
     const uint16_t first = GetLeadingUtf16Char(pair);
@@ -237,8 +280,10 @@ int CompareModifiedUtf8ToUtf16AsCodePointValues(const char* utf8, const uint16_t
 }
 
 size_t CountUtf8Bytes(const uint16_t* chars, size_t char_count) {
-  size_t result = 0;
+  // Leading one-byte characters take one byte each.
+  size_t result = CountNonZeroAsciiBlocks(chars, char_count);
   const uint16_t *end = chars + char_count;
+  chars += result;
   while (chars < end) {
     const uint16_t ch = *chars++;
     if (LIKELY(ch != 0 && ch < 0x80)) {
@@ -380,6 +380,38 @@ TEST_F(UtfTest, ExhaustiveBidirectionalCodePointCheck) {
   }
 }
 
+// The conversions handle leading ASCII characters in blocks. Check them with one non-ASCII
+// character at each position of strings longer than a few blocks.
+TEST_F(UtfTest, AsciiBlocksWithNonAsciiCharacter) {
+  static constexpr size_t kLength = 70;
+  for (uint16_t non_ascii : {0x0000, 0x0080, 0x07ff, 0x0800, 0xd800, 0xdc00, 0xffff}) {
+    for (size_t pos = 0; pos <= kLength; ++pos) {
+      std::vector<uint16_t> chars(kLength);
+      for (size_t i = 0; i != kLength; ++i) {
+        chars[i] = 'a' + (i % 26);
+      }
+      if (pos != kLength) {
+        chars[pos] = non_ascii;
+      }
+
+      size_t byte_count = CountUtf8Bytes(chars.data(), kLength);
+      ASSERT_EQ(CountUtf8Bytes_reference(chars.data(), kLength), byte_count);
+      std::vector<char> bytes(byte_count + 1u, '\0');
+      std::vector<char> bytes_reference(byte_count + 1u, '\0');
+      ConvertUtf16ToModifiedUtf8(bytes.data(), byte_count, chars.data(), kLength);
+      ConvertUtf16ToModifiedUtf8_reference(bytes_reference.data(), chars.data(), kLength);
+      ASSERT_EQ(bytes_reference, bytes);
+
+      ASSERT_EQ(kLength, CountModifiedUtf8Chars(bytes.data(), byte_count));
+      std::vector<uint16_t> chars_out(kLength);
+      ConvertModifiedUtf8ToUtf16(chars_out.data(), kLength, bytes.data(), byte_count);
+      EXPECT_EQ(chars, chars_out);
+      EXPECT_EQ(ComputeUtf16Hash(chars.data(), kLength),
+                ComputeUtf16HashFromModifiedUtf8(bytes.data(), kLength));
+    }
+  }
+}
+
 TEST_F(UtfTest, NonAscii) {
   const char kNonAsciiCharacter = '\x80';
   const char input[] = { kNonAsciiCharacter, '\0' };
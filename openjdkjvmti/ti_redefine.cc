@@ -59,6 +59,7 @@
 #include "base/locks.h"
 #include "base/stl_util.h"
 #include "base/utils.h"
+#include "catch_handler_cache.h"
 #include "class_linker-inl.h"
 #include "class_linker.h"
 #include "class_root-inl.h"
@@ -2515,6 +2516,9 @@ jvmtiError Redefiner::Run() {
       }
       redef.UpdateClass(data);
     }
+    // Both in-place and structural redefinition change the code items, and so the catch handlers,
+    // of the methods. Drop any handler lookups cached for them.
+    art::CatchHandlerCache::InvalidateAll();
     RestoreObsoleteMethodMapsIfUnneeded(holder);
     // TODO We should check for if any of the redefined methods are intrinsic methods here and, if
     // any are, force a full-world deoptimization before finishing redefinition. If we don't do this
@@ -25,6 +25,7 @@
 #include "art_method-inl.h"
 #include "base/enums.h"
 #include "base/stl_util.h"
+#include "catch_handler_cache.h"
 #include "class_linker-inl.h"
 #include "class_root-inl.h"
 #include "debugger.h"
@@ -266,14 +267,25 @@ uint32_t ArtMethod::FindDexMethodIndexInOtherDexFile(const DexFile& other_dexfil
 
 uint32_t ArtMethod::FindCatchBlock(Handle<mirror::Class> exception_type,
                                    uint32_t dex_pc, bool* has_no_move_exception) {
-  // Set aside the exception while we resolve its type.
   Thread* self = Thread::Current();
+  CatchHandlerCache* cache = self->GetCatchHandlerCache();
+  uint32_t cached_dex_pc;
+  bool cached_has_no_move_exception;
+  if (cache->Get(
+          this, dex_pc, exception_type.Get(), &cached_dex_pc, &cached_has_no_move_exception)) {
+    if (cached_dex_pc != dex::kDexNoIndex) {
+      *has_no_move_exception = cached_has_no_move_exception;
+    }
+    return cached_dex_pc;
+  }
+  // Set aside the exception while we resolve its type.
   StackHandleScope<1> hs(self);
   Handle<mirror::Throwable> exception(hs.NewHandle(self->GetException()));
   self->ClearException();
   // Default to handler not found.
   uint32_t found_dex_pc = dex::kDexNoIndex;
   // Iterate over the catch handlers associated with dex_pc.
+  bool cacheable = true;
   CodeItemDataAccessor accessor(DexInstructionData());
   for (CatchHandlerIterator it(accessor, dex_pc); it.HasNext(); it.Next()) {
     dex::TypeIndex iter_type_idx = it.GetHandlerTypeIndex();
@@ -289,6 +301,7 @@ uint32_t ArtMethod::FindCatchBlock(Handle<mirror::Class> exception_type,
       // removed by a pro-guard like tool.
       // Note: this is not RI behavior. RI would have failed when loading the class.
       self->ClearException();
+      cacheable = false;  // Keep warning on each throw, the class may also become resolvable.
       // Delete any long jump context as this routine is called during a stack walk which will
       // release its in use context at the end.
       delete self->GetLongJumpContext();
@@ -303,6 +316,13 @@ uint32_t ArtMethod::FindCatchBlock(Handle<mirror::Class> exception_type,
     const Instruction& first_catch_instr = accessor.InstructionAt(found_dex_pc);
     *has_no_move_exception = (first_catch_instr.Opcode() != Instruction::MOVE_EXCEPTION);
   }
+  if (cacheable) {
+    cache->Set(this,
+               dex_pc,
+               exception_type.Get(),
+               found_dex_pc,
+               found_dex_pc != dex::kDexNoIndex && *has_no_move_exception);
+  }
   // Put the exception back.
   if (exception != nullptr) {
     self->SetException(exception.Get());
@@ -122,16 +122,18 @@ static void BackOff(uint32_t i) {
 // short time interval, on the order of kernel context-switch time, passes.
 // Return true if the predicate test succeeded, false if we timed out.
 template<typename Pred>
-static inline bool WaitBrieflyFor(AtomicInteger* testLoc, Thread* self, Pred pred) {
+static inline bool WaitBrieflyFor(AtomicInteger* testLoc,
+                                  Thread* self,
+                                  Pred pred,
+                                  uint32_t max_iters = Mutex::kDefaultSpinWaitIters) {
   // TODO: Tune these parameters correctly. BackOff(3) should take on the order of 100 cycles. So
   // this should result in retrying <= 10 times, usually waiting around 100 cycles each. The
   // maximum delay should be significantly less than the expected futex() context switch time, so
   // there should be little danger of this worsening things appreciably. If the lock was only
   // held briefly by a running thread, this should help immensely.
   static constexpr uint32_t kMaxBackOff = 3;  // Should probably be <= kSpinMax above.
-  static constexpr uint32_t kMaxIters = 50;
   JNIEnvExt* const env = self == nullptr ? nullptr : self->GetJniEnv();
-  for (uint32_t i = 1; i <= kMaxIters; ++i) {
+  for (uint32_t i = 1; i <= max_iters; ++i) {
     BackOff(std::min(i, kMaxBackOff));
     if (pred(testLoc->load(std::memory_order_relaxed))) {
       return true;
@@ -600,7 +602,7 @@ bool Mutex::ExclusiveTryLock(Thread* self) {
   return true;
 }
 
-bool Mutex::ExclusiveTryLockWithSpinning(Thread* self) {
+bool Mutex::ExclusiveTryLockWithSpinning(Thread* self, uint32_t max_wait_iters) {
   // Spin a small number of times, since this affects our ability to respond to suspension
   // requests. We spin repeatedly only if the mutex repeatedly becomes available and unavailable
   // in rapid succession, and then we will typically not spin for the maximal period.
@@ -611,9 +613,11 @@ bool Mutex::ExclusiveTryLockWithSpinning(Thread* self) {
     }
 #if ART_USE_FUTEXES
     if (!WaitBrieflyFor(&state_and_contenders_, self,
-            [](int32_t v) { return (v & kHeldMask) == 0; })) {
+            [](int32_t v) { return (v & kHeldMask) == 0; }, max_wait_iters)) {
       return false;
     }
+#else
+    UNUSED(max_wait_iters);
 #endif
   }
   return ExclusiveTryLock(self);
@@ -183,8 +183,15 @@ class LOCKABLE Mutex : public BaseMutex {
   // Returns true if acquires exclusive access, false otherwise.
   bool ExclusiveTryLock(Thread* self) TRY_ACQUIRE(true);
   bool TryLock(Thread* self) TRY_ACQUIRE(true) { return ExclusiveTryLock(self); }
-  // Equivalent to ExclusiveTryLock, but retry for a short period before giving up.
-  bool ExclusiveTryLockWithSpinning(Thread* self) TRY_ACQUIRE(true);
+  // Default number of back-off iterations for which a spinning thread waits for the mutex to be
+  // released before giving up.
+  static constexpr uint32_t kDefaultSpinWaitIters = 50;
+
+  // Equivalent to ExclusiveTryLock, but retry for a short period before giving up. Each time the
+  // mutex is found held, wait for up to `max_wait_iters` back-off iterations for it to be released.
+  bool ExclusiveTryLockWithSpinning(Thread* self,
+                                    uint32_t max_wait_iters = kDefaultSpinWaitIters)
+      TRY_ACQUIRE(true);
 
   // Release exclusive access.
   void ExclusiveUnlock(Thread* self) RELEASE();
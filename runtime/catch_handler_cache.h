@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CATCH_HANDLER_CACHE_H_
+#define ART_RUNTIME_CATCH_HANDLER_CACHE_H_
+
+#include <array>
+#include <atomic>
+
+#include "base/bit_utils.h"
+#include "base/macros.h"
+
+namespace art {
+
+class ArtMethod;
+
+namespace mirror {
+class Class;
+}  // namespace mirror
+
+// Small thread-local cache of ArtMethod::FindCatchBlock() results, keyed by method, dex pc and
+// exception class. Finding a catch block decodes the try/catch tables of the method and resolves
+// and checks each catch type in turn; code that uses exceptions for control flow does that for
+// the same few frames on every throw. Misses (no handler in the frame) are cached too, since most
+// frames an exception unwinds through have no handler for it.
+//
+// All operations must be done from the owning thread.
+//
+// The exception class is only used as a key and is not a GC root. Classes can move or be unloaded
+// (and methods freed) by a GC, and code items can change with class redefinition or dex file
+// unloading, so InvalidateAll() must be called at those points; each cache then drops its
+// entries on its next lookup.
+class CatchHandlerCache {
+ public:
+  static constexpr size_t kSize = 64;
+
+  CatchHandlerCache() : generation_(global_generation_.load(std::memory_order_acquire)) {
+    data_.fill(Entry{});
+  }
+
+  // Look up the result of FindCatchBlock(). Returns false if it is not cached.
+  ALWAYS_INLINE bool Get(ArtMethod* method,
+                         uint32_t dex_pc,
+                         const mirror::Class* exception_class,
+                         /*out*/ uint32_t* handler_dex_pc,
+                         /*out*/ bool* has_no_move_exception) {
+    uint32_t generation = global_generation_.load(std::memory_order_acquire);
+    if (UNLIKELY(generation != generation_)) {
+      Clear(generation);
+      return false;
+    }
+    const Entry& entry = data_[IndexOf(method, dex_pc, exception_class)];
+    if (entry.method != method ||
+        entry.exception_class != exception_class ||
+        entry.dex_pc != dex_pc) {
+      return false;
+    }
+    *handler_dex_pc = entry.handler_dex_pc;
+    *has_no_move_exception = entry.has_no_move_exception;
+    return true;
+  }
+
+  ALWAYS_INLINE void Set(ArtMethod* method,
+                         uint32_t dex_pc,
+                         const mirror::Class* exception_class,
+                         uint32_t handler_dex_pc,
+                         bool has_no_move_exception) {
+    data_[IndexOf(method, dex_pc, exception_class)] =
+        Entry{method, exception_class, dex_pc, handler_dex_pc, has_no_move_exception};
+  }
+
+  // Invalidate the entries of all caches.
+  static void InvalidateAll() {
+    global_generation_.fetch_add(1u, std::memory_order_release);
+  }
+
+ private:
+  struct Entry {
+    ArtMethod* method = nullptr;
+    const mirror::Class* exception_class = nullptr;
+    uint32_t dex_pc = 0u;
+    uint32_t handler_dex_pc = 0u;
+    bool has_no_move_exception = false;
+  };
+
+  NO_INLINE void Clear(uint32_t generation);
+
+  static ALWAYS_INLINE size_t IndexOf(ArtMethod* method,
+                                      uint32_t dex_pc,
+                                      const mirror::Class* exception_class) {
+    static_assert(IsPowerOfTwo(kSize), "Size must be power of two");
+    return ((reinterpret_cast<uintptr_t>(method) >> 3) ^
+            (reinterpret_cast<uintptr_t>(exception_class) >> 3) ^
+            dex_pc) & (kSize - 1);
+  }
+
+  static std::atomic<uint32_t> global_generation_;
+
+  // Value of global_generation_ when the entries were last cleared.
+  uint32_t generation_;
+  std::array<Entry, kSize> data_;
+
+  DISALLOW_COPY_AND_ASSIGN(CatchHandlerCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CATCH_HANDLER_CACHE_H_
@@ -29,10 +29,14 @@
 namespace art {
 
 inline uint32_t ClassTable::ClassDescriptorHash::operator()(const TableSlot& slot) const {
-  std::string temp;
-  // No read barrier needed, we're reading a chain of constant references for comparison
-  // with null and retrieval of constant primitive data. See ReadBarrierOption.
-  return ComputeModifiedUtf8Hash(slot.Read<kWithoutReadBarrier>()->GetDescriptor(&temp));
+  if (kIsDebugBuild) {
+    std::string temp;
+    // No read barrier needed, we're reading a chain of constant references for comparison
+    // with null and retrieval of constant primitive data. See ReadBarrierOption.
+    DCHECK_EQ(ComputeModifiedUtf8Hash(slot.Read<kWithoutReadBarrier>()->GetDescriptor(&temp)),
+              slot.Hash());
+  }
+  return slot.Hash();
 }
 
 inline uint32_t ClassTable::ClassDescriptorHash::operator()(const DescriptorHashPair& pair) const {
@@ -59,7 +63,7 @@ inline bool ClassTable::ClassDescriptorEquals::operator()(const TableSlot& a,
                                                           const DescriptorHashPair& b) const {
   // No read barrier needed, we're reading a chain of constant references for comparison
   // with null and retrieval of constant primitive data. See ReadBarrierOption.
-  if (!a.MaskedHashEquals(b.second)) {
+  if (a.Hash() != b.second) {
     DCHECK(!a.Read<kWithoutReadBarrier>()->DescriptorEquals(b.first));
     return false;
   }
@@ -141,7 +145,7 @@ inline ObjPtr<mirror::Class> ClassTable::TableSlot::Read() const {
   if (kReadBarrierOption != kWithoutReadBarrier && before_ptr != after_ptr) {
     // If another thread raced and updated the reference, do not store the read barrier updated
     // one.
-    data_.CompareAndSetStrongRelease(before, Encode(after_ptr, MaskHash(before)));
+    data_.CompareAndSetStrongRelease(before, Encode(after_ptr));
   }
   return after_ptr;
 }
@@ -156,21 +160,20 @@ inline void ClassTable::TableSlot::VisitRoot(const Visitor& visitor) const {
   if (before_ptr != after_ptr) {
     // If another thread raced and updated the reference, do not store the read barrier updated
     // one.
-    data_.CompareAndSetStrongRelease(before, Encode(after_ptr, MaskHash(before)));
+    data_.CompareAndSetStrongRelease(before, Encode(after_ptr));
   }
 }
 
 inline ObjPtr<mirror::Class> ClassTable::TableSlot::ExtractPtr(uint32_t data) {
-  return reinterpret_cast<mirror::Class*>(data & ~kHashMask);
+  return reinterpret_cast<mirror::Class*>(data);
 }
 
-inline uint32_t ClassTable::TableSlot::Encode(ObjPtr<mirror::Class> klass, uint32_t hash_bits) {
-  DCHECK_LE(hash_bits, kHashMask);
-  return reinterpret_cast<uintptr_t>(klass.Ptr()) | hash_bits;
+inline uint32_t ClassTable::TableSlot::Encode(ObjPtr<mirror::Class> klass) {
+  return reinterpret_cast<uintptr_t>(klass.Ptr());
 }
 
 inline ClassTable::TableSlot::TableSlot(ObjPtr<mirror::Class> klass, uint32_t descriptor_hash)
-    : data_(Encode(klass, MaskHash(descriptor_hash))) {
+    : data_(Encode(klass)), hash_(descriptor_hash) {
   DCHECK_EQ(descriptor_hash, HashDescriptor(klass));
 }
 
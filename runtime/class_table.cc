@@ -22,7 +22,8 @@
 
 namespace art {
 
-ClassTable::ClassTable() : lock_("Class loader classes", kClassLoaderClassesLock) {
+ClassTable::ClassTable()
+    : lock_("Class loader classes", kClassLoaderClassesLock), frozen_sets_(nullptr) {
   Runtime* const runtime = Runtime::Current();
   classes_.push_back(ClassSet(runtime->GetHashTableMinLoadFactor(),
                               runtime->GetHashTableMaxLoadFactor()));
@@ -31,6 +32,20 @@ ClassTable::ClassTable() : lock_("Class loader classes", kClassLoaderClassesLock
 void ClassTable::FreezeSnapshot() {
   WriterMutexLock mu(Thread::Current(), lock_);
   classes_.push_back(ClassSet());
+  PublishFrozenSets();
+}
+
+void ClassTable::PublishFrozenSets() {
+  auto frozen_sets = std::make_unique<FrozenSets>();
+  frozen_sets->reserve(classes_.size() - 1u);
+  for (size_t i = 0; i + 1u < classes_.size(); ++i) {
+    if (!classes_[i].empty()) {
+      frozen_sets->push_back(&classes_[i]);
+    }
+  }
+  // Release so that lock-free readers see the contents of the newly frozen sets.
+  frozen_sets_.store(frozen_sets.get(), std::memory_order_release);
+  published_frozen_sets_.push_back(std::move(frozen_sets));
 }
 
 ObjPtr<mirror::Class> ClassTable::UpdateClass(const char* descriptor,
@@ -101,7 +116,24 @@ size_t ClassTable::NumReferencedNonZygoteClasses() const {
 
 ObjPtr<mirror::Class> ClassTable::Lookup(const char* descriptor, size_t hash) {
   DescriptorHashPair pair(descriptor, hash);
+  // The frozen sets are only modified under the lock before a new snapshot is published, so they
+  // can be searched without it.
+  const FrozenSets* searched_frozen_sets = frozen_sets_.load(std::memory_order_acquire);
+  if (searched_frozen_sets != nullptr) {
+    for (const ClassSet* class_set : *searched_frozen_sets) {
+      auto it = class_set->FindWithHash(pair, hash);
+      if (it != class_set->end()) {
+        return it->Read();
+      }
+    }
+  }
   ReaderMutexLock mu(Thread::Current(), lock_);
+  if (searched_frozen_sets == frozen_sets_.load(std::memory_order_relaxed)) {
+    // Nothing was frozen or removed since the search above, only the last set is left.
+    ClassSet& class_set = classes_.back();
+    auto it = class_set.FindWithHash(pair, hash);
+    return (it != class_set.end()) ? it->Read() : nullptr;
+  }
   for (ClassSet& class_set : classes_) {
     auto it = class_set.FindWithHash(pair, hash);
     if (it != class_set.end()) {
@@ -127,6 +159,12 @@ bool ClassTable::Remove(const char* descriptor) {
     auto it = class_set.find(pair);
     if (it != class_set.end()) {
       class_set.erase(it);
+      if (&class_set != &classes_.back()) {
+        // Removing from a frozen set can shift a class that a concurrent Lookup() is probing
+        // for behind its lock-free search. Lookup() only trusts that search while the snapshot
+        // is unchanged, so republishing makes it search every set again under the lock.
+        PublishFrozenSets();
+      }
       return true;
     }
   }
@@ -176,7 +214,8 @@ size_t ClassTable::ReadFromMemory(uint8_t* ptr) {
 
 void ClassTable::AddClassSet(ClassSet&& set) {
   WriterMutexLock mu(Thread::Current(), lock_);
-  classes_.insert(classes_.begin(), std::move(set));
+  classes_.push_front(std::move(set));
+  PublishFrozenSets();
 }
 
 void ClassTable::ClearStrongRoots() {
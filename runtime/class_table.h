@@ -17,6 +17,9 @@
 #ifndef ART_RUNTIME_CLASS_TABLE_H_
 #define ART_RUNTIME_CLASS_TABLE_H_
 
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -51,9 +54,10 @@ class ClassTable {
  public:
   class TableSlot {
    public:
-    TableSlot() : data_(0u) {}
+    TableSlot() : data_(0u), hash_(0u) {}
 
-    TableSlot(const TableSlot& copy) : data_(copy.data_.load(std::memory_order_relaxed)) {}
+    TableSlot(const TableSlot& copy)
+        : data_(copy.data_.load(std::memory_order_relaxed)), hash_(copy.hash_) {}
 
     explicit TableSlot(ObjPtr<mirror::Class> klass);
 
@@ -61,21 +65,15 @@ class ClassTable {
 
     TableSlot& operator=(const TableSlot& copy) {
       data_.store(copy.data_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      hash_ = copy.hash_;
       return *this;
     }
 
     bool IsNull() const REQUIRES_SHARED(Locks::mutator_lock_);
 
+    // The descriptor hash of the class.
     uint32_t Hash() const {
-      return MaskHash(data_.load(std::memory_order_relaxed));
-    }
-
-    static uint32_t MaskHash(uint32_t hash) {
-      return hash & kHashMask;
-    }
-
-    bool MaskedHashEquals(uint32_t other) const {
-      return MaskHash(other) == Hash();
+      return hash_;
     }
 
     static uint32_t HashDescriptor(ObjPtr<mirror::Class> klass)
@@ -93,12 +91,14 @@ class ClassTable {
     static ObjPtr<mirror::Class> ExtractPtr(uint32_t data)
         REQUIRES_SHARED(Locks::mutator_lock_);
 
-    static uint32_t Encode(ObjPtr<mirror::Class> klass, uint32_t hash_bits)
+    static uint32_t Encode(ObjPtr<mirror::Class> klass)
         REQUIRES_SHARED(Locks::mutator_lock_);
 
-    // Data contains the class pointer GcRoot as well as the low bits of the descriptor hash.
+    // Data contains the class pointer GcRoot.
     mutable Atomic<uint32_t> data_;
-    static const uint32_t kHashMask = kObjectAlignment - 1;
+    // The full descriptor hash, so that rehashing never reads the class and lookups only compare
+    // descriptors when the hashes match.
+    uint32_t hash_;
   };
 
   using DescriptorHashPair = std::pair<const char*, uint32_t>;
@@ -198,7 +198,8 @@ class ClassTable {
       REQUIRES(!lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
-  // Return the first class that matches the descriptor. Returns null if there are none.
+  // Return the first class that matches the descriptor. Returns null if there are none. Classes
+  // in frozen sets are found without taking `lock_`.
   ObjPtr<mirror::Class> Lookup(const char* descriptor, size_t hash)
       REQUIRES(!lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -268,10 +269,24 @@ class ClassTable {
       REQUIRES(lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Publish a new snapshot of the frozen class sets.
+  void PublishFrozenSets() REQUIRES(lock_);
+
+  // Sets of `classes_` other than the last one, which are no longer inserted into, in search
+  // order. Never modified once published.
+  using FrozenSets = std::vector<const ClassSet*>;
+
   // Lock to guard inserting and removing.
   mutable ReaderWriterMutex lock_;
-  // We have a vector to help prevent dirty pages after the zygote forks by calling FreezeSnapshot.
-  std::vector<ClassSet> classes_ GUARDED_BY(lock_);
+  // We have a deque to help prevent dirty pages after the zygote forks by calling FreezeSnapshot.
+  // Unlike a vector, it does not move the sets referenced by the frozen snapshots.
+  std::deque<ClassSet> classes_ GUARDED_BY(lock_);
+  // The current snapshot of the frozen sets for lock-free lookups, or null if there are none.
+  // Republished whenever a set is added or a frozen set is modified.
+  std::atomic<const FrozenSets*> frozen_sets_;
+  // All snapshots published so far. Lock-free readers may still be using old ones, and sets are
+  // added rarely, so they are only freed with the table.
+  std::vector<std::unique_ptr<const FrozenSets>> published_frozen_sets_ GUARDED_BY(lock_);
   // Extra strong roots that can be either dex files or dex caches. Dex files used by the class
   // loader which may not be owned by the class loader must be held strongly live. Also dex caches
   // are held live to prevent them being unloading once they have classes in them.
@@ -85,6 +85,9 @@ TEST_F(ClassTableTest, ClassTable) {
   EXPECT_EQ(table.NumZygoteClasses(class_loader.Get()), 0u);
   EXPECT_EQ(table.NumNonZygoteClasses(class_loader.Get()), 0u);
 
+  // Slots cache the whole descriptor hash.
+  EXPECT_EQ(ClassTable::TableSlot(h_X.Get()).Hash(), ComputeModifiedUtf8Hash(descriptor_x));
+
   // Add h_X to the class table.
   table.Insert(h_X.Get());
   EXPECT_OBJ_PTR_EQ(table.LookupByDescriptor(h_X.Get()), h_X.Get());
@@ -137,9 +140,10 @@ TEST_F(ClassTableTest, ClassTable) {
   });
   EXPECT_EQ(classes.size(), 1u);
 
-  // Test remove.
+  // Test remove. h_X is in the frozen snapshot.
   table.Remove(descriptor_x);
   EXPECT_TRUE(table.LookupByDescriptor(h_X.Get()) == nullptr);
+  EXPECT_OBJ_PTR_EQ(table.LookupByDescriptor(h_Y.Get()), h_Y.Get());
 
   // Test that reading a class set from memory works.
   table.Insert(h_X.Get());
@@ -24,6 +24,7 @@
 #include "base/atomic.h"
 #include "base/bit_utils.h"
 #include "base/mem_map.h"
+#include "simd_scan.h"
 #include "space_bitmap.h"
 
 namespace art {
@@ -86,6 +87,13 @@ inline size_t CardTable::Scan(ContinuousSpaceBitmap* bitmap,
     uintptr_t* word_end = reinterpret_cast<uintptr_t*>(aligned_end);
     for (uintptr_t* word_cur = reinterpret_cast<uintptr_t*>(card_cur); word_cur < word_end;
         ++word_cur) {
+      if (kHasVectorScan && *word_cur == 0) {
+        word_cur = reinterpret_cast<uintptr_t*>(
+            SkipCleanCards(reinterpret_cast<uint8_t*>(word_cur), aligned_end));
+        if (UNLIKELY(word_cur >= word_end)) {
+          goto exit_for;
+        }
+      }
       while (LIKELY(*word_cur == 0)) {
         ++word_cur;
         if (UNLIKELY(word_cur >= word_end)) {
@@ -184,6 +192,13 @@ inline void CardTable::ModifyCardsAtomic(uint8_t* scan_begin,
 
   // TODO: Parallelize.
   while (word_cur < word_end) {
+    if (kHasVectorScan && *word_cur == 0) {
+      word_cur = reinterpret_cast<uintptr_t*>(
+          SkipCleanCards(reinterpret_cast<uint8_t*>(word_cur), card_end));
+      if (UNLIKELY(word_cur >= word_end)) {
+        break;
+      }
+    }
     while (true) {
       expected_word = *word_cur;
       static_assert(kCardClean == 0);
@@ -209,6 +224,15 @@ inline void CardTable::ModifyCardsAtomic(uint8_t* scan_begin,
   }
 }
 
+inline uint8_t* CardTable::SkipCleanCards(uint8_t* card_cur, uint8_t* card_end) {
+  static_assert(kCardClean == 0);
+  static_assert(IsAligned<sizeof(uintptr_t)>(kScanBlockSize));
+  while (card_cur + kScanBlockSize <= card_end && IsZeroBlock(card_cur)) {
+    card_cur += kScanBlockSize;
+  }
+  return card_cur;
+}
+
 inline void* CardTable::AddrFromCard(const uint8_t *card_addr) const {
   DCHECK(IsValidCard(card_addr))
     << " card_addr: " << reinterpret_cast<const void*>(card_addr)
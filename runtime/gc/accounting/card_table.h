@@ -145,6 +145,11 @@ class CardTable {
  private:
   CardTable(MemMap&& mem_map, uint8_t* biased_begin, size_t offset);
 
+  // Returns the first card in [card_cur, card_end) that is not in a block of `kScanBlockSize`
+  // clean cards, or a card less than `kScanBlockSize` away from `card_end`. Clean blocks are
+  // tested with vector instructions where available, i.e. 32 or 64 cards per instruction.
+  static uint8_t* SkipCleanCards(uint8_t* card_cur, uint8_t* card_end) ALWAYS_INLINE;
+
   // Returns true iff the card table address is within the bounds of the card table.
   bool IsValidCard(const uint8_t* card_addr) const ALWAYS_INLINE;
 
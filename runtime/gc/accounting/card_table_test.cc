@@ -16,15 +16,19 @@
 
 #include "card_table-inl.h"
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "base/atomic.h"
+#include "base/mutex.h"
 #include "base/utils.h"
 #include "common_runtime_test.h"
 #include "handle_scope-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/string-inl.h"  // Strings are easiest to allocate
 #include "scoped_thread_state_change-inl.h"
+#include "space_bitmap-inl.h"
 #include "thread_pool.h"
 
 namespace art {
@@ -145,7 +149,57 @@ TEST_F(CardTableTest, TestModifyCardsAtomic) {
   }
 }
 
-// TODO: Add test for CardTable::Scan.
+// Card indices, relative to the heap begin, that are dirtied in the sparse tests. They sit
+// around the boundaries of the blocks of clean cards that are skipped at once.
+static constexpr size_t kSparseCards[] = { 0, 63, 64, 65, 127, 500, 1024, 1025, 2047 };
+
+TEST_F(CardTableTest, TestModifyCardsAtomicSparse) {
+  CommonSetup();
+  for (size_t card : kSparseCards) {
+    card_table_->MarkCard(HeapBegin() + card * CardTable::kCardSize);
+  }
+  std::vector<uint8_t*> modified_cards;
+  auto modified = [&modified_cards](uint8_t* card, uint8_t expected_value, uint8_t new_value) {
+    EXPECT_EQ(expected_value, CardTable::kCardDirty);
+    EXPECT_EQ(new_value, CardTable::kCardAged);
+    modified_cards.push_back(card);
+  };
+  card_table_->ModifyCardsAtomic(HeapBegin(), HeapLimit(), AgeCardVisitor(), modified);
+  std::sort(modified_cards.begin(), modified_cards.end());
+  ASSERT_EQ(modified_cards.size(), arraysize(kSparseCards));
+  for (size_t i = 0; i < arraysize(kSparseCards); ++i) {
+    uint8_t* addr = HeapBegin() + kSparseCards[i] * CardTable::kCardSize;
+    EXPECT_EQ(modified_cards[i], card_table_->CardFromAddr(addr));
+    EXPECT_EQ(*modified_cards[i], CardTable::kCardAged);
+  }
+}
+
+TEST_F(CardTableTest, TestScanSparse) {
+  CommonSetup();
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+  ContinuousSpaceBitmap bitmap(
+      ContinuousSpaceBitmap::Create("test bitmap", HeapBegin(), HeapLimit() - HeapBegin()));
+  ASSERT_TRUE(bitmap.IsValid());
+  // One object per card; only the objects on dirty cards must be visited.
+  for (uint8_t* addr = HeapBegin(); addr < HeapLimit(); addr += CardTable::kCardSize) {
+    bitmap.Set(reinterpret_cast<mirror::Object*>(addr + kObjectAlignment));
+  }
+  std::vector<mirror::Object*> expected;
+  for (size_t card : kSparseCards) {
+    uint8_t* addr = HeapBegin() + card * CardTable::kCardSize;
+    card_table_->MarkCard(addr);
+    expected.push_back(reinterpret_cast<mirror::Object*>(addr + kObjectAlignment));
+  }
+  std::vector<mirror::Object*> visited;
+  auto visitor = [&visited](mirror::Object* obj) { visited.push_back(obj); };
+  size_t scanned =
+      card_table_->Scan</*kClearCard=*/ false>(&bitmap, HeapBegin(), HeapLimit(), visitor);
+  EXPECT_EQ(scanned, arraysize(kSparseCards));
+  EXPECT_EQ(visited, expected);
+}
+
 }  // namespace accounting
 }  // namespace gc
 }  // namespace art
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ACCOUNTING_SEGMENTED_STACK_H_
+#define ART_RUNTIME_GC_ACCOUNTING_SEGMENTED_STACK_H_
+
+#include <sys/mman.h>  // For the PROT_* and MAP_* constants.
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <android-base/logging.h>
+
+#include "base/globals.h"
+#include "base/locks.h"
+#include "base/macros.h"
+#include "base/mem_map.h"
+#include "stack_reference.h"
+
+// This implements an unbounded LIFO stack made of fixed-size chunks. Unlike AtomicStack it never
+// overflows: when the top chunk fills up, the next chunk is taken from the pool (or mapped if the
+// pool is empty) and nothing already pushed is moved. Popped chunks go back to the pool and stay
+// mapped, so a stack that is reset between GC cycles reuses the same memory.
+//
+// All calls must be made by a single thread at a time; callers that share a stack between threads
+// serialize with their own lock.
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+// Internal representation is StackReference<T>, so this only works with mirror::Object or its
+// subclasses.
+template <typename T>
+class SegmentedStack {
+ public:
+  // Size of each chunk in bytes.
+  static constexpr size_t kChunkSize = 64 * KB;
+  // Number of elements in each chunk.
+  static constexpr size_t kChunkCapacity = kChunkSize / sizeof(StackReference<T>);
+
+  explicit SegmentedStack(const std::string& name)
+      : name_(name),
+        num_active_chunks_(0),
+        max_active_chunks_(0),
+        base_(nullptr),
+        top_(nullptr),
+        limit_(nullptr) {}
+
+  ~SegmentedStack() {}
+
+  // Empty the stack. The first chunk stays resident; the pages of any other chunk used since the
+  // last reset are released, but all chunks stay mapped for reuse.
+  void Reset() {
+    for (size_t i = 1; i < max_active_chunks_; ++i) {
+      chunks_[i].MadviseDontNeedAndZero();
+    }
+    num_active_chunks_ = 0;
+    max_active_chunks_ = 0;
+    base_ = nullptr;
+    top_ = nullptr;
+    limit_ = nullptr;
+  }
+
+  void PushBack(T* value) REQUIRES_SHARED(Locks::mutator_lock_) {
+    if (UNLIKELY(top_ == limit_)) {
+      PushChunk();
+    }
+    top_->Assign(value);
+    ++top_;
+  }
+
+  T* PopBack() REQUIRES_SHARED(Locks::mutator_lock_) {
+    DCHECK(!IsEmpty());
+    if (UNLIKELY(top_ == base_)) {
+      PopChunk();
+    }
+    --top_;
+    return top_->AsMirrorPtr();
+  }
+
+  // Pop up to `max_count` elements into `out` and return how many were popped. The elements are
+  // copied in chunk order, which is not necessarily the order PopBack() would return them in.
+  size_t PopBackInto(size_t max_count, StackReference<T>* out) {
+    size_t count = 0;
+    while (count != max_count && !IsEmpty()) {
+      if (top_ == base_) {
+        PopChunk();
+      }
+      const size_t n = std::min(max_count - count, static_cast<size_t>(top_ - base_));
+      top_ -= n;
+      std::copy(top_, top_ + n, out + count);
+      count += n;
+    }
+    return count;
+  }
+
+  bool IsEmpty() const {
+    return top_ == base_ && num_active_chunks_ <= 1;
+  }
+
+  size_t Size() const {
+    if (num_active_chunks_ == 0) {
+      return 0;
+    }
+    return (num_active_chunks_ - 1) * kChunkCapacity + static_cast<size_t>(top_ - base_);
+  }
+
+  // Number of chunks mapped by this stack, whether in use or pooled.
+  size_t NumChunks() const {
+    return chunks_.size();
+  }
+
+  bool Contains(const T* value) const REQUIRES_SHARED(Locks::mutator_lock_) {
+    for (size_t i = 0; i < num_active_chunks_; ++i) {
+      const StackReference<T>* begin = ChunkBegin(i);
+      const StackReference<T>* end = (i + 1 == num_active_chunks_) ? top_ : begin + kChunkCapacity;
+      for (const StackReference<T>* cur = begin; cur != end; ++cur) {
+        if (cur->AsMirrorPtr() == value) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+ private:
+  StackReference<T>* ChunkBegin(size_t index) const {
+    return reinterpret_cast<StackReference<T>*>(chunks_[index].Begin());
+  }
+
+  // Make the next chunk the top of the stack, mapping a new one if all chunks are in use.
+  NO_INLINE void PushChunk() {
+    if (num_active_chunks_ == chunks_.size()) {
+      std::string error_msg;
+      MemMap chunk = MemMap::MapAnonymous(name_.c_str(),
+                                          kChunkSize,
+                                          PROT_READ | PROT_WRITE,
+                                          /*low_4gb=*/ false,
+                                          &error_msg);
+      CHECK(chunk.IsValid()) << "couldn't allocate mark stack chunk.\n" << error_msg;
+      chunks_.push_back(std::move(chunk));
+    }
+    base_ = ChunkBegin(num_active_chunks_);
+    top_ = base_;
+    limit_ = base_ + kChunkCapacity;
+    ++num_active_chunks_;
+    max_active_chunks_ = std::max(max_active_chunks_, num_active_chunks_);
+  }
+
+  // Return the empty top chunk to the pool and make the full chunk below it the top.
+  void PopChunk() {
+    DCHECK_GT(num_active_chunks_, 1u);
+    DCHECK_EQ(top_, base_);
+    --num_active_chunks_;
+    base_ = ChunkBegin(num_active_chunks_ - 1);
+    limit_ = base_ + kChunkCapacity;
+    top_ = limit_;
+  }
+
+  // Name of the stack, used to name the chunk mappings.
+  const std::string name_;
+  // Chunks backing the stack. The first `num_active_chunks_` hold elements, the rest are pooled.
+  std::vector<MemMap> chunks_;
+  // Number of chunks holding elements. All but the last one are full.
+  size_t num_active_chunks_;
+  // High-water mark of `num_active_chunks_` since the last Reset().
+  size_t max_active_chunks_;
+  // Bounds of the top chunk and the slot after the last element pushed.
+  StackReference<T>* base_;
+  StackReference<T>* top_;
+  StackReference<T>* limit_;
+
+  DISALLOW_COPY_AND_ASSIGN(SegmentedStack);
+};
+
+typedef SegmentedStack<mirror::Object> SegmentedObjectStack;
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ACCOUNTING_SEGMENTED_STACK_H_
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "segmented_stack.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "common_runtime_test.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+class SegmentedStackTest : public CommonRuntimeTest {
+ protected:
+  static mirror::Object* FakeObject(size_t i) {
+    return reinterpret_cast<mirror::Object*>(0x10000000 + i * kObjectAlignment);
+  }
+};
+
+TEST_F(SegmentedStackTest, PushPopAcrossChunks) {
+  ScopedObjectAccess soa(Thread::Current());
+  SegmentedObjectStack stack("test stack");
+  EXPECT_TRUE(stack.IsEmpty());
+  EXPECT_EQ(stack.Size(), 0u);
+  const size_t count = 3 * SegmentedObjectStack::kChunkCapacity + 17;
+  for (size_t i = 0; i < count; ++i) {
+    stack.PushBack(FakeObject(i));
+    EXPECT_EQ(stack.Size(), i + 1);
+  }
+  EXPECT_EQ(stack.NumChunks(), 4u);
+  EXPECT_TRUE(stack.Contains(FakeObject(0)));
+  EXPECT_TRUE(stack.Contains(FakeObject(count - 1)));
+  EXPECT_FALSE(stack.Contains(FakeObject(count)));
+  for (size_t i = count; i != 0; --i) {
+    ASSERT_FALSE(stack.IsEmpty());
+    EXPECT_EQ(stack.PopBack(), FakeObject(i - 1));
+  }
+  EXPECT_TRUE(stack.IsEmpty());
+  EXPECT_EQ(stack.Size(), 0u);
+}
+
+TEST_F(SegmentedStackTest, PushPopAtChunkBoundary) {
+  ScopedObjectAccess soa(Thread::Current());
+  SegmentedObjectStack stack("test stack");
+  const size_t capacity = SegmentedObjectStack::kChunkCapacity;
+  for (size_t i = 0; i < capacity; ++i) {
+    stack.PushBack(FakeObject(i));
+  }
+  // Alternating across the boundary should keep reusing the second chunk.
+  for (size_t i = 0; i < 10; ++i) {
+    stack.PushBack(FakeObject(capacity));
+    EXPECT_EQ(stack.PopBack(), FakeObject(capacity));
+    EXPECT_EQ(stack.PopBack(), FakeObject(capacity - 1));
+    stack.PushBack(FakeObject(capacity - 1));
+  }
+  EXPECT_EQ(stack.NumChunks(), 2u);
+  EXPECT_EQ(stack.Size(), capacity);
+}
+
+TEST_F(SegmentedStackTest, ResetReusesChunks) {
+  ScopedObjectAccess soa(Thread::Current());
+  SegmentedObjectStack stack("test stack");
+  const size_t count = 2 * SegmentedObjectStack::kChunkCapacity + 1;
+  for (size_t cycle = 0; cycle < 3; ++cycle) {
+    for (size_t i = 0; i < count; ++i) {
+      stack.PushBack(FakeObject(i));
+    }
+    EXPECT_EQ(stack.Size(), count);
+    stack.Reset();
+    EXPECT_TRUE(stack.IsEmpty());
+    EXPECT_EQ(stack.NumChunks(), 3u);
+  }
+}
+
+TEST_F(SegmentedStackTest, PopBackInto) {
+  ScopedObjectAccess soa(Thread::Current());
+  SegmentedObjectStack stack("test stack");
+  const size_t count = 2 * SegmentedObjectStack::kChunkCapacity + 100;
+  for (size_t i = 0; i < count; ++i) {
+    stack.PushBack(FakeObject(i));
+  }
+  // Pop in batches that straddle chunk boundaries and check every element comes out once.
+  const size_t batch = SegmentedObjectStack::kChunkCapacity / 3 + 1;
+  std::vector<StackReference<mirror::Object>> buffer(batch);
+  std::vector<mirror::Object*> popped;
+  while (!stack.IsEmpty()) {
+    const size_t n = stack.PopBackInto(batch, buffer.data());
+    ASSERT_NE(n, 0u);
+    ASSERT_LE(n, batch);
+    for (size_t i = 0; i < n; ++i) {
+      popped.push_back(buffer[i].AsMirrorPtr());
+    }
+  }
+  EXPECT_EQ(stack.PopBackInto(batch, buffer.data()), 0u);
+  ASSERT_EQ(popped.size(), count);
+  std::sort(popped.begin(), popped.end());
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(popped[i], FakeObject(i));
+  }
+}
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ACCOUNTING_SIMD_SCAN_H_
+#define ART_RUNTIME_GC_ACCOUNTING_SIMD_SCAN_H_
+
+#include <stdint.h>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "base/macros.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+// Helpers used to skip over empty stretches of GC side tables (mark bitmaps, card tables) one
+// cache line at a time. The kernels only answer "is this block empty"; callers fall back to
+// their scalar loops to decode the first non-empty block.
+//
+// The loads are racy with respect to concurrent writers in the same way as the relaxed scalar
+// loads they replace: a block that becomes non-empty after it was tested is simply treated as
+// empty by this scan.
+
+// Number of bytes tested by each call to the kernels below.
+static constexpr size_t kScanBlockSize = 64;
+
+// Whether the kernels below are vectorized on this target. When they are not, callers should
+// stick to their scalar loops, which are at least as fast as a scalar block test.
+#if defined(__SSE2__) || defined(__aarch64__)
+static constexpr bool kHasVectorScan = true;
+#else
+static constexpr bool kHasVectorScan = false;
+#endif
+
+// Return true iff all `kScanBlockSize` bytes at `p` are zero. `p` need not be aligned.
+ALWAYS_INLINE inline bool IsZeroBlock(const uint8_t* p) {
+#if defined(__AVX2__)
+  const __m256i v = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)));
+  return _mm256_testz_si256(v, v) != 0;
+#elif defined(__SSE2__)
+  const __m128i* vp = reinterpret_cast<const __m128i*>(p);
+  const __m128i v = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(vp), _mm_loadu_si128(vp + 1)),
+                                 _mm_or_si128(_mm_loadu_si128(vp + 2), _mm_loadu_si128(vp + 3)));
+#if defined(__SSE4_1__)
+  return _mm_testz_si128(v, v) != 0;
+#else
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xffff;
+#endif
+#elif defined(__aarch64__)
+  const uint8x16_t v = vorrq_u8(vorrq_u8(vld1q_u8(p), vld1q_u8(p + 16)),
+                                vorrq_u8(vld1q_u8(p + 32), vld1q_u8(p + 48)));
+  return vmaxvq_u8(v) == 0;
+#else
+  for (size_t i = 0; i < kScanBlockSize; ++i) {
+    if (p[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+// Return true iff `a[i] & ~b[i]` is zero for all `kScanBlockSize` bytes at `a` and `b`.
+ALWAYS_INLINE inline bool IsAndNotZeroBlock(const uint8_t* a, const uint8_t* b) {
+#if defined(__AVX2__)
+  const __m256i* ap = reinterpret_cast<const __m256i*>(a);
+  const __m256i* bp = reinterpret_cast<const __m256i*>(b);
+  const __m256i v = _mm256_or_si256(
+      _mm256_andnot_si256(_mm256_loadu_si256(bp), _mm256_loadu_si256(ap)),
+      _mm256_andnot_si256(_mm256_loadu_si256(bp + 1), _mm256_loadu_si256(ap + 1)));
+  return _mm256_testz_si256(v, v) != 0;
+#elif defined(__SSE2__)
+  const __m128i* ap = reinterpret_cast<const __m128i*>(a);
+  const __m128i* bp = reinterpret_cast<const __m128i*>(b);
+  const __m128i v = _mm_or_si128(
+      _mm_or_si128(_mm_andnot_si128(_mm_loadu_si128(bp), _mm_loadu_si128(ap)),
+                   _mm_andnot_si128(_mm_loadu_si128(bp + 1), _mm_loadu_si128(ap + 1))),
+      _mm_or_si128(_mm_andnot_si128(_mm_loadu_si128(bp + 2), _mm_loadu_si128(ap + 2)),
+                   _mm_andnot_si128(_mm_loadu_si128(bp + 3), _mm_loadu_si128(ap + 3))));
+#if defined(__SSE4_1__)
+  return _mm_testz_si128(v, v) != 0;
+#else
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xffff;
+#endif
+#elif defined(__aarch64__)
+  const uint8x16_t v = vorrq_u8(
+      vorrq_u8(vbicq_u8(vld1q_u8(a), vld1q_u8(b)),
+               vbicq_u8(vld1q_u8(a + 16), vld1q_u8(b + 16))),
+      vorrq_u8(vbicq_u8(vld1q_u8(a + 32), vld1q_u8(b + 32)),
+               vbicq_u8(vld1q_u8(a + 48), vld1q_u8(b + 48))));
+  return vmaxvq_u8(v) == 0;
+#else
+  for (size_t i = 0; i < kScanBlockSize; ++i) {
+    if ((a[i] & ~b[i]) != 0) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ACCOUNTING_SIMD_SCAN_H_
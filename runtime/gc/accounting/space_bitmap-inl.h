@@ -25,6 +25,7 @@
 
 #include "base/atomic.h"
 #include "base/bit_utils.h"
+#include "simd_scan.h"
 
 namespace art {
 namespace gc {
@@ -63,6 +64,78 @@ inline bool SpaceBitmap<kAlignment>::Test(const mirror::Object* obj) const {
   return (bitmap_begin_[index].load(std::memory_order_relaxed) & OffsetToMask(offset)) != 0;
 }
 
+template<size_t kAlignment>
+inline size_t SpaceBitmap<kAlignment>::FindNonZeroWord(const Atomic<uintptr_t>* words,
+                                                       size_t begin,
+                                                       size_t end) {
+  static constexpr size_t kWordsPerBlock = kScanBlockSize / sizeof(uintptr_t);
+  // In dense bitmaps the next word is usually non-zero; check it before trying to skip.
+  if (begin >= end || words[begin].load(std::memory_order_relaxed) != 0) {
+    return begin;
+  }
+  ++begin;
+  if (kHasVectorScan) {
+    const uint8_t* raw = reinterpret_cast<const uint8_t*>(words);
+    while (begin + kWordsPerBlock <= end && IsZeroBlock(raw + begin * sizeof(uintptr_t))) {
+      begin += kWordsPerBlock;
+    }
+  }
+  while (begin < end && words[begin].load(std::memory_order_relaxed) == 0) {
+    ++begin;
+  }
+  return begin;
+}
+
+template<size_t kAlignment>
+inline size_t SpaceBitmap<kAlignment>::FindGarbageWord(const Atomic<uintptr_t>* live,
+                                                       const Atomic<uintptr_t>* mark,
+                                                       size_t begin,
+                                                       size_t end) {
+  static constexpr size_t kWordsPerBlock = kScanBlockSize / sizeof(uintptr_t);
+  auto is_garbage = [live, mark](size_t i) {
+    return (live[i].load(std::memory_order_relaxed) &
+            ~mark[i].load(std::memory_order_relaxed)) != 0;
+  };
+  if (begin >= end || is_garbage(begin)) {
+    return begin;
+  }
+  ++begin;
+  if (kHasVectorScan) {
+    const uint8_t* raw_live = reinterpret_cast<const uint8_t*>(live);
+    const uint8_t* raw_mark = reinterpret_cast<const uint8_t*>(mark);
+    while (begin + kWordsPerBlock <= end &&
+           IsAndNotZeroBlock(raw_live + begin * sizeof(uintptr_t),
+                             raw_mark + begin * sizeof(uintptr_t))) {
+      begin += kWordsPerBlock;
+    }
+  }
+  while (begin < end && !is_garbage(begin)) {
+    ++begin;
+  }
+  return begin;
+}
+
+template<size_t kAlignment>
+template<typename Visitor>
+inline void SpaceBitmap<kAlignment>::VisitWord(uintptr_t word,
+                                               uintptr_t ptr_base,
+                                               Visitor&& visitor) {
+  // Decode the whole word first so that the loads of the object headers, which nearly all
+  // visitors perform, overlap with each other instead of being serialized behind the visitor.
+  mirror::Object* objs[kBitsPerIntPtrT];
+  size_t count = 0;
+  while (word != 0) {
+    const size_t shift = CTZ(word);
+    mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
+    __builtin_prefetch(obj);
+    objs[count++] = obj;
+    word ^= (static_cast<uintptr_t>(1)) << shift;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    visitor(objs[i]);
+  }
+}
+
 template<size_t kAlignment>
 template<typename Visitor>
 inline void SpaceBitmap<kAlignment>::VisitMarkedRange(uintptr_t visit_begin,
@@ -109,28 +182,16 @@ inline void SpaceBitmap<kAlignment>::VisitMarkedRange(uintptr_t visit_begin,
 
     // Traverse left edge.
     if (left_edge != 0) {
-      const uintptr_t ptr_base = IndexToOffset(index_start) + heap_begin_;
-      do {
-        const size_t shift = CTZ(left_edge);
-        mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-        visitor(obj);
-        left_edge ^= (static_cast<uintptr_t>(1)) << shift;
-      } while (left_edge != 0);
+      VisitWord(left_edge, IndexToOffset(index_start) + heap_begin_, visitor);
     }
 
-    // Traverse the middle, full part.
-    for (size_t i = index_start + 1; i < index_end; ++i) {
+    // Traverse the middle, full part, skipping over empty stretches of the bitmap.
+    for (size_t i = FindNonZeroWord(bitmap_begin_, index_start + 1, index_end);
+         i < index_end;
+         i = FindNonZeroWord(bitmap_begin_, i + 1, index_end)) {
       uintptr_t w = bitmap_begin_[i].load(std::memory_order_relaxed);
-      if (w != 0) {
-        const uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
-        // Iterate on the bits set in word `w`, from the least to the most significant bit.
-        do {
-          const size_t shift = CTZ(w);
-          mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-          visitor(obj);
-          w ^= (static_cast<uintptr_t>(1)) << shift;
-        } while (w != 0);
-      }
+      // Iterate on the bits set in word `w`, from the least to the most significant bit.
+      VisitWord(w, IndexToOffset(i) + heap_begin_, visitor);
     }
 
     // Right edge is unique.
@@ -149,14 +210,8 @@ inline void SpaceBitmap<kAlignment>::VisitMarkedRange(uintptr_t visit_begin,
   // Right edge handling.
   right_edge &= ((static_cast<uintptr_t>(1) << bit_end) - 1);
   if (right_edge != 0) {
-    const uintptr_t ptr_base = IndexToOffset(index_end) + heap_begin_;
     // Iterate on the bits set in word `right_edge`, from the least to the most significant bit.
-    do {
-      const size_t shift = CTZ(right_edge);
-      mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-      visitor(obj);
-      right_edge ^= (static_cast<uintptr_t>(1)) << shift;
-    } while (right_edge != 0);
+    VisitWord(right_edge, IndexToOffset(index_end) + heap_begin_, visitor);
   }
 #endif
 }
@@ -168,17 +223,11 @@ void SpaceBitmap<kAlignment>::Walk(Visitor&& visitor) {
 
   uintptr_t end = OffsetToIndex(HeapLimit() - heap_begin_ - 1);
   Atomic<uintptr_t>* bitmap_begin = bitmap_begin_;
-  for (uintptr_t i = 0; i <= end; ++i) {
+  for (uintptr_t i = FindNonZeroWord(bitmap_begin, 0, end + 1);
+       i <= end;
+       i = FindNonZeroWord(bitmap_begin, i + 1, end + 1)) {
     uintptr_t w = bitmap_begin[i].load(std::memory_order_relaxed);
-    if (w != 0) {
-      uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
-      do {
-        const size_t shift = CTZ(w);
-        mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-        visitor(obj);
-        w ^= (static_cast<uintptr_t>(1)) << shift;
-      } while (w != 0);
-    }
+    VisitWord(w, IndexToOffset(i) + heap_begin_, visitor);
   }
 }
 
@@ -190,22 +190,24 @@ void SpaceBitmap<kAlignment>::SweepWalk(const SpaceBitmap<kAlignment>& live_bitm
   mirror::Object** cur_pointer = &pointer_buf[0];
   mirror::Object** pointer_end = cur_pointer + (buffer_size - kBitsPerIntPtrT);
 
-  for (size_t i = start; i <= end; i++) {
+  // Skip over the stretches where every live object is also marked, which is most of the
+  // bitmap for sticky and partial collections.
+  for (size_t i = FindGarbageWord(live, mark, start, end + 1);
+       i <= end;
+       i = FindGarbageWord(live, mark, i + 1, end + 1)) {
     uintptr_t garbage =
         live[i].load(std::memory_order_relaxed) & ~mark[i].load(std::memory_order_relaxed);
-    if (UNLIKELY(garbage != 0)) {
-      uintptr_t ptr_base = IndexToOffset(i) + live_bitmap.heap_begin_;
-      do {
-        const size_t shift = CTZ(garbage);
-        garbage ^= (static_cast<uintptr_t>(1)) << shift;
-        *cur_pointer++ = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-      } while (garbage != 0);
-      // Make sure that there are always enough slots available for an
-      // entire word of one bits.
-      if (cur_pointer >= pointer_end) {
-        (*callback)(cur_pointer - &pointer_buf[0], &pointer_buf[0], arg);
-        cur_pointer  = &pointer_buf[0];
-      }
+    uintptr_t ptr_base = IndexToOffset(i) + live_bitmap.heap_begin_;
+    while (garbage != 0) {
+      const size_t shift = CTZ(garbage);
+      garbage ^= (static_cast<uintptr_t>(1)) << shift;
+      *cur_pointer++ = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
+    }
+    // Make sure that there are always enough slots available for an
+    // entire word of one bits.
+    if (cur_pointer >= pointer_end) {
+      (*callback)(cur_pointer - &pointer_buf[0], &pointer_buf[0], arg);
+      cur_pointer  = &pointer_buf[0];
     }
   }
   if (cur_pointer > &pointer_buf[0]) {
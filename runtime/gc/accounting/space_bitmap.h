@@ -241,6 +241,24 @@ class SpaceBitmap {
   template<bool kSetBit>
   bool Modify(const mirror::Object* obj);
 
+  // Return the index of the first non-zero word in [begin, end), or `end` if there is none.
+  // Empty stretches of the bitmap are skipped a cache line at a time.
+  static size_t FindNonZeroWord(const Atomic<uintptr_t>* words, size_t begin, size_t end)
+      ALWAYS_INLINE;
+
+  // Return the index of the first word in [begin, end) for which `live & ~mark` is non-zero,
+  // or `end` if there is none.
+  static size_t FindGarbageWord(const Atomic<uintptr_t>* live,
+                                const Atomic<uintptr_t>* mark,
+                                size_t begin,
+                                size_t end) ALWAYS_INLINE;
+
+  // Visit the objects corresponding to the bits set in `word`, in increasing address order.
+  // `ptr_base` is the address corresponding to the least significant bit of `word`. The bits are
+  // decoded in one batch, and the object headers prefetched, before the visitor is called.
+  template <typename Visitor>
+  static void VisitWord(uintptr_t word, uintptr_t ptr_base, Visitor&& visitor) ALWAYS_INLINE;
+
   // Backing storage for bitmap.
   MemMap mem_map_;
 
@@ -22,6 +22,7 @@
 #include "base/mutex.h"
 #include "common_runtime_test.h"
 #include "runtime_globals.h"
+#include "simd_scan.h"
 #include "space_bitmap-inl.h"
 
 namespace art {
@@ -257,6 +258,105 @@ TEST_F(SpaceBitmapTest, OrderPageAlignment) {
   RunTestOrder<kPageSize>();
 }
 
+// Object offsets, in units of kObjectAlignment, that exercise the skipping of empty stretches of
+// the bitmap: isolated bits far apart, and bits right around scan block boundaries.
+static std::vector<size_t> SparseBitIndices() {
+  static constexpr size_t kBitsPerBlock = kScanBlockSize * kBitsPerByte;
+  std::vector<size_t> indices;
+  for (size_t block : {1u, 2u, 7u, 100u, 101u, 4000u}) {
+    indices.push_back(block * kBitsPerBlock - 1);
+    indices.push_back(block * kBitsPerBlock);
+    indices.push_back(block * kBitsPerBlock + kBitsPerIntPtrT + 3);
+  }
+  indices.push_back(4090u * kBitsPerBlock + 17);
+  return indices;
+}
+
+TEST_F(SpaceBitmapTest, VisitSparse) {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  size_t heap_capacity = 16 * MB;
+  ContinuousSpaceBitmap space_bitmap(
+      ContinuousSpaceBitmap::Create("test bitmap", heap_begin, heap_capacity));
+  ASSERT_TRUE(space_bitmap.IsValid());
+
+  std::vector<mirror::Object*> expected;
+  for (size_t index : SparseBitIndices()) {
+    mirror::Object* obj = reinterpret_cast<mirror::Object*>(heap_begin + index * kObjectAlignment);
+    ASSERT_TRUE(space_bitmap.HasAddress(obj));
+    space_bitmap.Set(obj);
+    expected.push_back(obj);
+  }
+
+  std::vector<mirror::Object*> visited;
+  auto collect = [&visited](mirror::Object* obj) { visited.push_back(obj); };
+  space_bitmap.VisitAllMarked(collect);
+  EXPECT_EQ(expected, visited);
+
+  // Ranges starting and ending right next to the set bits.
+  for (mirror::Object* begin : expected) {
+    for (mirror::Object* end : expected) {
+      for (size_t delta : {0u, 1u}) {
+        uintptr_t range_begin = reinterpret_cast<uintptr_t>(begin) + delta * kObjectAlignment;
+        uintptr_t range_end = reinterpret_cast<uintptr_t>(end) + delta * kObjectAlignment;
+        if (range_begin > range_end) {
+          continue;
+        }
+        visited.clear();
+        space_bitmap.VisitMarkedRange(range_begin, range_end, collect);
+        std::vector<mirror::Object*> expected_range;
+        for (mirror::Object* obj : expected) {
+          if (reinterpret_cast<uintptr_t>(obj) >= range_begin &&
+              reinterpret_cast<uintptr_t>(obj) < range_end) {
+            expected_range.push_back(obj);
+          }
+        }
+        EXPECT_EQ(expected_range, visited);
+      }
+    }
+  }
+}
+
+TEST_F(SpaceBitmapTest, SweepWalkSparse) {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  size_t heap_capacity = 16 * MB;
+  ContinuousSpaceBitmap live_bitmap(
+      ContinuousSpaceBitmap::Create("live bitmap", heap_begin, heap_capacity));
+  ContinuousSpaceBitmap mark_bitmap(
+      ContinuousSpaceBitmap::Create("mark bitmap", heap_begin, heap_capacity));
+  ASSERT_TRUE(live_bitmap.IsValid());
+  ASSERT_TRUE(mark_bitmap.IsValid());
+
+  // Mark every other live object, and fill the surrounding words of the mark bitmap so that
+  // garbage is only found where the live bitmap has bits the mark bitmap lacks.
+  std::vector<mirror::Object*> expected;
+  bool marked = false;
+  for (size_t index : SparseBitIndices()) {
+    mirror::Object* obj = reinterpret_cast<mirror::Object*>(heap_begin + index * kObjectAlignment);
+    live_bitmap.Set(obj);
+    if (marked) {
+      mark_bitmap.Set(obj);
+    } else {
+      expected.push_back(obj);
+      mark_bitmap.Set(reinterpret_cast<mirror::Object*>(
+          reinterpret_cast<uintptr_t>(obj) + kObjectAlignment));
+    }
+    marked = !marked;
+  }
+
+  std::vector<mirror::Object*> swept;
+  auto callback = [](size_t ptr_count, mirror::Object** ptrs, void* arg) {
+    std::vector<mirror::Object*>* out = reinterpret_cast<std::vector<mirror::Object*>*>(arg);
+    out->insert(out->end(), ptrs, ptrs + ptr_count);
+  };
+  ContinuousSpaceBitmap::SweepWalk(live_bitmap,
+                                   mark_bitmap,
+                                   reinterpret_cast<uintptr_t>(heap_begin),
+                                   reinterpret_cast<uintptr_t>(heap_begin) + heap_capacity,
+                                   callback,
+                                   &swept);
+  EXPECT_EQ(expected, swept);
+}
+
 }  // namespace accounting
 }  // namespace gc
 }  // namespace art
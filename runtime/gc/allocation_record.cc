@@ -56,16 +56,15 @@ void AllocRecordObjectMap::VisitRoots(RootVisitor* visitor) {
   size_t count = recent_record_max_;
   // Only visit the last recent_record_max_ number of allocation records in entries_ and mark the
   // klass_ fields as strong roots.
-  for (auto it = entries_.rbegin(), end = entries_.rend(); it != end; ++it) {
-    AllocRecord& record = it->second;
-    if (count > 0) {
-      buffered_visitor.VisitRootIfNonNull(record.GetClassGcRoot());
-      --count;
-    }
-    // Visit all of the stack frames to make sure no methods in the stack traces get unloaded by
-    // class unloading.
-    for (size_t i = 0, depth = record.GetDepth(); i < depth; ++i) {
-      const AllocRecordStackTraceElement& element = record.StackElement(i);
+  for (auto it = entries_.rbegin(), end = entries_.rend(); it != end && count > 0; ++it) {
+    buffered_visitor.VisitRootIfNonNull(it->second.GetClassGcRoot());
+    --count;
+  }
+  // Visit all of the stack frames to make sure no methods in the stack traces get unloaded by
+  // class unloading. Records share their traces, so this is done once per distinct trace.
+  for (const AllocRecordStackTrace* trace : stack_traces_) {
+    for (size_t i = 0, depth = trace->GetDepth(); i < depth; ++i) {
+      const AllocRecordStackTraceElement& element = trace->GetStackElement(i);
       DCHECK(element.GetMethod() != nullptr);
       element.GetMethod()->VisitRoots(buffered_visitor, kRuntimePointerSize);
     }
@@ -94,7 +93,9 @@ void AllocRecordObjectMap::SweepAllocationRecords(IsMarkedVisitor* visitor) {
   size_t count_deleted = 0, count_moved = 0, count = 0;
   // Only the first (size - recent_record_max_) number of records can be deleted.
   const size_t delete_bound = std::max(entries_.size(), recent_record_max_) - recent_record_max_;
-  for (auto it = entries_.begin(), end = entries_.end(); it != end;) {
+  // Surviving records are compacted towards the front in a single pass.
+  auto out = entries_.begin();
+  for (auto it = entries_.begin(), end = entries_.end(); it != end; ++it) {
     ++count;
     // This does not need a read barrier because this is called by GC.
     mirror::Object* old_object = it->first.Read<kWithoutReadBarrier>();
@@ -104,10 +105,10 @@ void AllocRecordObjectMap::SweepAllocationRecords(IsMarkedVisitor* visitor) {
       if (count > delete_bound) {
         it->first = GcRoot<mirror::Object>(nullptr);
         SweepClassObject(&record, visitor);
-        ++it;
       } else {
-        it = entries_.erase(it);
+        ReleaseStackTrace(record.GetStackTrace());
         ++count_deleted;
+        continue;
       }
     } else {
       if (old_object != new_object) {
@@ -115,9 +116,13 @@ void AllocRecordObjectMap::SweepAllocationRecords(IsMarkedVisitor* visitor) {
         ++count_moved;
       }
       SweepClassObject(&record, visitor);
-      ++it;
     }
+    if (out != it) {
+      *out = std::move(*it);
+    }
+    ++out;
   }
+  entries_.erase(out, entries_.end());
   VLOG(heap) << "Deleted " << count_deleted << " allocation records";
   VLOG(heap) << "Updated " << count_moved << " allocation records";
 }
@@ -153,11 +158,14 @@ void AllocRecordObjectMap::SetAllocTrackingEnabled(bool enable) {
       }
       CHECK(records != nullptr);
       records->SetMaxStackDepth(heap->GetAllocTrackerStackDepth());
+      records->SetSamplingInterval(android::base::GetUintProperty<size_t>(
+          "dalvik.vm.allocTrackerSampleInterval", records->GetSamplingInterval()));
       size_t sz = sizeof(AllocRecordStackTraceElement) * records->max_stack_depth_ +
                   sizeof(AllocRecord) + sizeof(AllocRecordStackTrace);
       LOG(INFO) << "Enabling alloc tracker (" << records->alloc_record_max_ << " entries of "
                 << records->max_stack_depth_ << " frames, taking up to "
-                << PrettySize(sz * records->alloc_record_max_) << ")";
+                << PrettySize(sz * records->alloc_record_max_) << ", sampling every "
+                << records->GetSamplingInterval() << " bytes)";
     }
     Runtime::Current()->GetInstrumentation()->InstrumentQuickAllocEntryPoints();
     {
@@ -182,26 +190,44 @@ void AllocRecordObjectMap::SetAllocTrackingEnabled(bool enable) {
   }
 }
 
+// Count down the bytes allocated by the calling thread and return whether an allocation of
+// `byte_count` bytes crosses the next sampling point.
+static bool ShouldSampleAllocation(size_t byte_count, size_t interval) {
+  thread_local size_t bytes_until_sample = 0;
+  if (byte_count < bytes_until_sample) {
+    bytes_until_sample -= byte_count;
+    return false;
+  }
+  bytes_until_sample = interval - (byte_count - bytes_until_sample) % interval;
+  return true;
+}
+
 void AllocRecordObjectMap::RecordAllocation(Thread* self,
                                             ObjPtr<mirror::Object>* obj,
                                             size_t byte_count) {
+  const size_t sample_interval = GetSamplingInterval();
+  if (sample_interval != 0u && !ShouldSampleAllocation(byte_count, sample_interval)) {
+    return;
+  }
   // Get stack trace outside of lock in case there are allocations during the stack walk.
-  // b/27858645.
-  AllocRecordStackTrace trace;
+  // b/27858645. The frames are collected on the stack and only copied to the heap the first
+  // time a given trace is seen.
+  AllocRecordStackTraceElement frames[kMaxSupportedStackDepth];
+  size_t depth = 0;
   {
     StackHandleScope<1> hs(self);
     auto obj_wrapper = hs.NewHandleWrapper(obj);
 
     StackVisitor::WalkStack(
         [&](const art::StackVisitor* stack_visitor) REQUIRES_SHARED(Locks::mutator_lock_) {
-          if (trace.GetDepth() >= max_stack_depth_) {
+          if (depth >= max_stack_depth_) {
             return false;
           }
           ArtMethod* m = stack_visitor->GetMethod();
           // m may be null if we have inlined methods of unresolved classes. b/27858645
           if (m != nullptr && !m->IsRuntimeMethod()) {
             m = m->GetInterfaceMethodIfProxy(kRuntimePointerSize);
-            trace.AddStackElement(AllocRecordStackTraceElement(m, stack_visitor->GetDexPc()));
+            frames[depth++] = AllocRecordStackTraceElement(m, stack_visitor->GetDexPc());
           }
           return true;
         },
@@ -238,16 +264,45 @@ void AllocRecordObjectMap::RecordAllocation(Thread* self,
 
   DCHECK_LE(Size(), alloc_record_max_);
 
-  // Erase extra unfilled elements.
-  trace.SetTid(self->GetTid());
-
   // Add the record.
-  Put(obj->Ptr(), AllocRecord(byte_count, (*obj)->GetClass(), std::move(trace)));
+  const AllocRecordStackTrace* trace =
+      InternStackTrace(AllocRecordStackTraceKey{self->GetTid(), frames, depth});
+  Put(obj->Ptr(), AllocRecord(byte_count, (*obj)->GetClass(), trace));
   DCHECK_LE(Size(), alloc_record_max_);
 }
 
+const AllocRecordStackTrace* AllocRecordObjectMap::InternStackTrace(
+    const AllocRecordStackTraceKey& key) {
+  const size_t hash = StackTraceHash()(key);
+  auto it = stack_traces_.FindWithHash(key, hash);
+  AllocRecordStackTrace* trace;
+  if (it != stack_traces_.end()) {
+    trace = *it;
+  } else {
+    trace = new AllocRecordStackTrace(key.tid, key.frames, key.depth);
+    stack_traces_.InsertWithHash(trace, hash);
+  }
+  ++trace->use_count_;
+  return trace;
+}
+
+void AllocRecordObjectMap::ReleaseStackTrace(const AllocRecordStackTrace* trace) {
+  DCHECK_GT(trace->use_count_, 0u);
+  AllocRecordStackTrace* interned = const_cast<AllocRecordStackTrace*>(trace);
+  if (--interned->use_count_ == 0u) {
+    auto it = stack_traces_.find(interned);
+    DCHECK(it != stack_traces_.end());
+    stack_traces_.erase(it);
+    delete interned;
+  }
+}
+
 void AllocRecordObjectMap::Clear() {
   entries_.clear();
+  for (AllocRecordStackTrace* trace : stack_traces_) {
+    delete trace;
+  }
+  stack_traces_.clear();
 }
 
 AllocRecordObjectMap::AllocRecordObjectMap()
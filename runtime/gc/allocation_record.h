@@ -17,9 +17,13 @@
 #ifndef ART_RUNTIME_GC_ALLOCATION_RECORD_H_
 #define ART_RUNTIME_GC_ALLOCATION_RECORD_H_
 
-#include <list>
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <vector>
 
+#include "base/hash_set.h"
 #include "base/mutex.h"
 #include "gc_root.h"
 #include "obj_ptr.h"
@@ -85,6 +89,10 @@ class AllocRecordStackTrace {
       : tid_(r.tid_),
         stack_(r.stack_) {}
 
+  AllocRecordStackTrace(pid_t tid, const AllocRecordStackTraceElement* frames, size_t depth)
+      : tid_(tid),
+        stack_(frames, frames + depth) {}
+
   pid_t GetTid() const {
     return tid_;
   }
@@ -120,6 +128,18 @@ class AllocRecordStackTrace {
  private:
   pid_t tid_ = 0;
   std::vector<AllocRecordStackTraceElement> stack_;
+  // Number of records using this trace once it is interned by an AllocRecordObjectMap.
+  size_t use_count_ = 0;
+
+  friend class AllocRecordObjectMap;
+};
+
+// A stack trace that is looked up in the interned traces of an AllocRecordObjectMap without
+// first being copied into an AllocRecordStackTrace.
+struct AllocRecordStackTraceKey {
+  pid_t tid;
+  const AllocRecordStackTraceElement* frames;
+  size_t depth;
 };
 
 struct HashAllocRecordTypes {
@@ -136,6 +156,15 @@ struct HashAllocRecordTypes {
     }
     return result;
   }
+
+  // Must match the hash of the equivalent AllocRecordStackTrace.
+  size_t operator()(const AllocRecordStackTraceKey& key) const {
+    size_t result = key.tid * AllocRecordStackTrace::kHashMultiplier + key.depth;
+    for (size_t i = 0; i < key.depth; ++i) {
+      result = result * AllocRecordStackTrace::kHashMultiplier + (*this)(key.frames[i]);
+    }
+    return result;
+  }
 };
 
 template <typename T> struct HashAllocRecordTypesPtr {
@@ -156,15 +185,15 @@ template <typename T> struct EqAllocRecordTypesPtr {
 class AllocRecord {
  public:
   // All instances of AllocRecord should be managed by an instance of AllocRecordObjectMap.
-  AllocRecord(size_t count, mirror::Class* klass, AllocRecordStackTrace&& trace)
-      : byte_count_(count), klass_(klass), trace_(std::move(trace)) {}
+  AllocRecord(size_t count, mirror::Class* klass, const AllocRecordStackTrace* trace)
+      : byte_count_(count), klass_(klass), trace_(trace) {}
 
   size_t GetDepth() const {
-    return trace_.GetDepth();
+    return trace_->GetDepth();
   }
 
   const AllocRecordStackTrace* GetStackTrace() const {
-    return &trace_;
+    return trace_;
   }
 
   size_t ByteCount() const {
@@ -172,7 +201,7 @@ class AllocRecord {
   }
 
   pid_t GetTid() const {
-    return trace_.GetTid();
+    return trace_->GetTid();
   }
 
   mirror::Class* GetClass() const REQUIRES_SHARED(Locks::mutator_lock_) {
@@ -187,15 +216,15 @@ class AllocRecord {
   }
 
   const AllocRecordStackTraceElement& StackElement(size_t index) const {
-    return trace_.GetStackElement(index);
+    return trace_->GetStackElement(index);
   }
 
  private:
-  const size_t byte_count_;
+  size_t byte_count_;
   // The klass_ could be a strong or weak root for GC
   GcRoot<mirror::Class> klass_;
-  // TODO: Share between alloc records with identical stack traces.
-  AllocRecordStackTrace trace_;
+  // Interned by the AllocRecordObjectMap, shared between records with identical stack traces.
+  const AllocRecordStackTrace* trace_;
 };
 
 class AllocRecordObjectMap {
@@ -211,10 +240,11 @@ class AllocRecordObjectMap {
   // recent allocation tracking, but GcRoot<mirror::Object> pointers in these pairs can become null.
   // Both types of pointers need read barriers, do not directly access them.
   using EntryPair = std::pair<GcRoot<mirror::Object>, AllocRecord>;
-  typedef std::list<EntryPair> EntryList;
+  typedef std::deque<EntryPair> EntryList;
 
   // Caller needs to check that it is enabled before calling since we read the stack trace before
-  // checking the enabled boolean.
+  // checking the enabled boolean. When sampling, allocations that are not sampled return without
+  // walking the stack.
   void RecordAllocation(Thread* self,
                         ObjPtr<mirror::Object>* obj,
                         size_t byte_count)
@@ -230,11 +260,31 @@ class AllocRecordObjectMap {
       REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(Locks::alloc_tracker_lock_) {
     if (entries_.size() == alloc_record_max_) {
+      ReleaseStackTrace(entries_.front().second.GetStackTrace());
       entries_.pop_front();
     }
     entries_.push_back(EntryPair(GcRoot<mirror::Object>(obj), std::move(record)));
   }
 
+  // Return the interned copy of the given stack trace, creating it if needed. The trace is
+  // referenced by one more record.
+  const AllocRecordStackTrace* InternStackTrace(const AllocRecordStackTraceKey& key)
+      REQUIRES(Locks::alloc_tracker_lock_);
+
+  size_t NumStackTraces() const REQUIRES_SHARED(Locks::alloc_tracker_lock_) {
+    return stack_traces_.size();
+  }
+
+  // Record only about one allocation every `interval` bytes allocated by each thread, or every
+  // allocation if `interval` is 0.
+  void SetSamplingInterval(size_t interval) {
+    sample_interval_.store(interval, std::memory_order_relaxed);
+  }
+
+  size_t GetSamplingInterval() const {
+    return sample_interval_.load(std::memory_order_relaxed);
+  }
+
   size_t Size() const REQUIRES_SHARED(Locks::alloc_tracker_lock_) {
     return entries_.size();
   }
@@ -296,15 +346,49 @@ class AllocRecordObjectMap {
   void Clear() REQUIRES(Locks::alloc_tracker_lock_);
 
  private:
+  struct StackTraceHash {
+    size_t operator()(const AllocRecordStackTrace* trace) const {
+      return HashAllocRecordTypes()(*trace);
+    }
+    size_t operator()(const AllocRecordStackTraceKey& key) const {
+      return HashAllocRecordTypes()(key);
+    }
+  };
+
+  struct StackTraceEquals {
+    bool operator()(const AllocRecordStackTrace* a, const AllocRecordStackTrace* b) const {
+      return *a == *b;
+    }
+    bool operator()(const AllocRecordStackTrace* trace, const AllocRecordStackTraceKey& key) const {
+      return trace->GetTid() == key.tid &&
+          trace->GetDepth() == key.depth &&
+          std::equal(trace->stack_.begin(), trace->stack_.end(), key.frames);
+    }
+  };
+
+  using StackTraceSet = HashSet<AllocRecordStackTrace*,
+                                DefaultEmptyFn<AllocRecordStackTrace*>,
+                                StackTraceHash,
+                                StackTraceEquals>;
+
+  // Drop a reference to an interned trace, deleting it once no record uses it.
+  void ReleaseStackTrace(const AllocRecordStackTrace* trace) REQUIRES(Locks::alloc_tracker_lock_);
+
   size_t alloc_record_max_ GUARDED_BY(Locks::alloc_tracker_lock_) = kDefaultNumAllocRecords;
   size_t recent_record_max_ GUARDED_BY(Locks::alloc_tracker_lock_) = kDefaultNumRecentRecords;
   size_t max_stack_depth_ = kDefaultAllocStackDepth;
+  // Read without the lock by RecordAllocation() to skip the stack walk of unsampled allocations.
+  std::atomic<size_t> sample_interval_{0u};
   bool allow_new_record_ GUARDED_BY(Locks::alloc_tracker_lock_) = true;
   ConditionVariable new_record_condition_ GUARDED_BY(Locks::alloc_tracker_lock_);
   // see the comment in typedef of EntryList
   EntryList entries_ GUARDED_BY(Locks::alloc_tracker_lock_);
+  // Stack traces of the records in entries_, one copy per distinct trace.
+  StackTraceSet stack_traces_ GUARDED_BY(Locks::alloc_tracker_lock_);
 
   void SetMaxStackDepth(size_t max_stack_depth) REQUIRES(Locks::alloc_tracker_lock_);
+
+  friend class AllocRecordObjectMapTest;
 };
 
 }  // namespace gc
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_record.h"
+
+#include <map>
+#include <memory>
+#include <set>
+
+#include "art_method-inl.h"
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "gc/heap.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/string-alloc-inl.h"
+#include "object_callbacks.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+namespace gc {
+
+class AllocRecordObjectMapTest : public CommonRuntimeTest {
+ protected:
+  static void SetRecordLimits(AllocRecordObjectMap* records, size_t max, size_t recent_max)
+      REQUIRES(Locks::alloc_tracker_lock_) {
+    records->alloc_record_max_ = max;
+    records->recent_record_max_ = recent_max;
+  }
+
+  void GetMethods(ScopedObjectAccess& soa, ArtMethod** first, ArtMethod** second)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    ObjPtr<mirror::Class> klass = class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+    ASSERT_TRUE(klass != nullptr);
+    *first = klass->FindClassMethod("hashCode", "()I", kRuntimePointerSize);
+    *second = klass->FindClassMethod("toString", "()Ljava/lang/String;", kRuntimePointerSize);
+    ASSERT_TRUE(*first != nullptr);
+    ASSERT_TRUE(*second != nullptr);
+  }
+};
+
+// Reports the objects in `dead` as unmarked and those in `forwarded` as moved.
+class FakeIsMarkedVisitor : public IsMarkedVisitor {
+ public:
+  mirror::Object* IsMarked(mirror::Object* obj) override {
+    if (dead.find(obj) != dead.end()) {
+      return nullptr;
+    }
+    auto it = forwarded.find(obj);
+    return (it != forwarded.end()) ? it->second : obj;
+  }
+
+  std::set<mirror::Object*> dead;
+  std::map<mirror::Object*, mirror::Object*> forwarded;
+};
+
+TEST_F(AllocRecordObjectMapTest, InternsStackTraces) {
+  ScopedObjectAccess soa(Thread::Current());
+  ArtMethod* m1;
+  ArtMethod* m2;
+  GetMethods(soa, &m1, &m2);
+
+  MutexLock mu(soa.Self(), *Locks::alloc_tracker_lock_);
+  std::unique_ptr<AllocRecordObjectMap> records(new AllocRecordObjectMap());
+  const AllocRecordStackTraceElement frames[] = {
+      AllocRecordStackTraceElement(m1, 1u), AllocRecordStackTraceElement(m2, 2u)};
+  const AllocRecordStackTrace* trace = records->InternStackTrace({1, frames, 2u});
+  EXPECT_EQ(records->NumStackTraces(), 1u);
+  EXPECT_EQ(trace->GetTid(), 1);
+  ASSERT_EQ(trace->GetDepth(), 2u);
+  EXPECT_EQ(trace->GetStackElement(0), frames[0]);
+  EXPECT_EQ(trace->GetStackElement(1), frames[1]);
+
+  // An identical trace is shared; a different thread, depth or frame is not.
+  EXPECT_EQ(records->InternStackTrace({1, frames, 2u}), trace);
+  EXPECT_EQ(records->NumStackTraces(), 1u);
+  const AllocRecordStackTraceElement other_frames[] = {
+      AllocRecordStackTraceElement(m1, 1u), AllocRecordStackTraceElement(m2, 3u)};
+  EXPECT_NE(records->InternStackTrace({2, frames, 2u}), trace);
+  EXPECT_NE(records->InternStackTrace({1, frames, 1u}), trace);
+  EXPECT_NE(records->InternStackTrace({1, other_frames, 2u}), trace);
+  EXPECT_EQ(records->NumStackTraces(), 4u);
+
+  records->Clear();
+  EXPECT_EQ(records->NumStackTraces(), 0u);
+}
+
+TEST_F(AllocRecordObjectMapTest, EvictionReleasesStackTraces) {
+  ScopedObjectAccess soa(Thread::Current());
+  ArtMethod* m1;
+  ArtMethod* m2;
+  GetMethods(soa, &m1, &m2);
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::String> str = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "a"));
+  ASSERT_TRUE(str != nullptr);
+
+  MutexLock mu(soa.Self(), *Locks::alloc_tracker_lock_);
+  std::unique_ptr<AllocRecordObjectMap> records(new AllocRecordObjectMap());
+  SetRecordLimits(records.get(), /*max=*/ 2u, /*recent_max=*/ 1u);
+  const AllocRecordStackTraceElement frames[] = {
+      AllocRecordStackTraceElement(m1, 1u), AllocRecordStackTraceElement(m2, 2u)};
+  auto put = [&](size_t depth)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::alloc_tracker_lock_) {
+    const AllocRecordStackTrace* trace = records->InternStackTrace({1, frames, depth});
+    records->Put(str.Get(), AllocRecord(16u, str->GetClass(), trace));
+  };
+  put(2u);
+  put(2u);
+  EXPECT_EQ(records->Size(), 2u);
+  EXPECT_EQ(records->NumStackTraces(), 1u);
+  // Evicting one of two records using a trace keeps the trace.
+  put(1u);
+  EXPECT_EQ(records->Size(), 2u);
+  EXPECT_EQ(records->NumStackTraces(), 2u);
+  // Evicting the last record using a trace frees it.
+  put(1u);
+  EXPECT_EQ(records->Size(), 2u);
+  EXPECT_EQ(records->NumStackTraces(), 1u);
+}
+
+TEST_F(AllocRecordObjectMapTest, SweepUpdatesMovedAndDeletesDeadRecords) {
+  ScopedObjectAccess soa(Thread::Current());
+  ArtMethod* m1;
+  ArtMethod* m2;
+  GetMethods(soa, &m1, &m2);
+  StackHandleScope<4> hs(soa.Self());
+  Handle<mirror::String> dead =
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "a"));
+  Handle<mirror::String> from =
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "b"));
+  Handle<mirror::String> to =
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "c"));
+  Handle<mirror::String> recent_dead =
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "d"));
+  mirror::Class* string_class = dead->GetClass();
+
+  MutexLock mu(soa.Self(), *Locks::alloc_tracker_lock_);
+  std::unique_ptr<AllocRecordObjectMap> records(new AllocRecordObjectMap());
+  SetRecordLimits(records.get(), /*max=*/ 8u, /*recent_max=*/ 1u);
+  const AllocRecordStackTraceElement frames[] = {
+      AllocRecordStackTraceElement(m1, 1u), AllocRecordStackTraceElement(m2, 2u)};
+  // The dead record is the only one using the trace of depth 1.
+  records->Put(dead.Get(),
+               AllocRecord(16u, string_class, records->InternStackTrace({1, frames, 1u})));
+  records->Put(from.Get(),
+               AllocRecord(16u, string_class, records->InternStackTrace({1, frames, 2u})));
+  records->Put(recent_dead.Get(),
+               AllocRecord(16u, string_class, records->InternStackTrace({1, frames, 2u})));
+  EXPECT_EQ(records->NumStackTraces(), 2u);
+
+  FakeIsMarkedVisitor visitor;
+  visitor.dead.insert(dead.Get());
+  visitor.dead.insert(recent_dead.Get());
+  visitor.forwarded[from.Get()] = to.Get();
+  records->SweepAllocationRecords(&visitor);
+
+  // The dead record is deleted with its trace, the moved one points to the new address and the
+  // most recent one is kept for recent allocation tracking, without its object.
+  ASSERT_EQ(records->Size(), 2u);
+  EXPECT_EQ(records->NumStackTraces(), 1u);
+  auto it = records->Begin();
+  EXPECT_EQ(it->first.Read<kWithoutReadBarrier>(), to.Get());
+  EXPECT_EQ(it->second.GetDepth(), 2u);
+  ++it;
+  EXPECT_TRUE(it->first.IsNull());
+  EXPECT_EQ(it->second.GetClass(), string_class);
+}
+
+TEST_F(AllocRecordObjectMapTest, SamplesAllocations) {
+  ScopedObjectAccess soa(Thread::Current());
+  {
+    ScopedThreadSuspension sts(soa.Self(), ThreadState::kSuspended);
+    AllocRecordObjectMap::SetAllocTrackingEnabled(true);
+  }
+  Heap* heap = Runtime::Current()->GetHeap();
+  auto num_records = [&]() {
+    MutexLock mu(soa.Self(), *Locks::alloc_tracker_lock_);
+    return heap->GetAllocationRecords()->Size();
+  };
+  auto set_interval = [&](size_t interval) {
+    MutexLock mu(soa.Self(), *Locks::alloc_tracker_lock_);
+    heap->GetAllocationRecords()->SetSamplingInterval(interval);
+  };
+  static constexpr size_t kNumAllocations = 100;
+
+  // Without sampling every allocation is recorded.
+  set_interval(0u);
+  size_t before = num_records();
+  for (size_t i = 0; i != kNumAllocations; ++i) {
+    ASSERT_TRUE(mirror::String::AllocFromModifiedUtf8(soa.Self(), "x") != nullptr);
+  }
+  EXPECT_GE(num_records() - before, kNumAllocations);
+
+  // The small strings add up to far less than the interval, so at most one is sampled.
+  set_interval(1u * MB);
+  before = num_records();
+  for (size_t i = 0; i != kNumAllocations; ++i) {
+    ASSERT_TRUE(mirror::String::AllocFromModifiedUtf8(soa.Self(), "x") != nullptr);
+  }
+  EXPECT_LE(num_records() - before, 1u);
+
+  {
+    ScopedThreadSuspension sts(soa.Self(), ThreadState::kSuspended);
+    AllocRecordObjectMap::SetAllocTrackingEnabled(false);
+  }
+}
+
+}  // namespace gc
+}  // namespace art
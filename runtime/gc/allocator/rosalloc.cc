@@ -16,6 +16,7 @@
 
 #include "rosalloc-inl.h"
 
+#include <algorithm>
 #include <list>
 #include <map>
 #include <sstream>
@@ -1016,6 +1017,13 @@ void RosAlloc::Run::InspectAllSlots(void (*handler)(void* start, void* end, size
 // the page map entry won't change.
 static constexpr bool kReadPageMapEntryWithoutLockInBulkFree = true;
 
+// How far ahead of the current pointer BulkFree() prefetches the page map entry.
+static constexpr size_t kBulkFreePrefetchLookAhead = 8;
+
+// How many runs BulkFree() merges per size bracket lock acquisition, so that allocating threads
+// waiting for the lock are not held up by a whole sweep batch.
+static constexpr size_t kBulkFreeMaxRunsPerBracketLock = 64;
+
 size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
   size_t freed_bytes = 0;
   if ((false)) {
@@ -1035,13 +1043,26 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
 #else
   std::unordered_set<Run*, hash_run, eq_run> runs;
 #endif
+  // The sweep hands us pointers in address order, so consecutive pointers usually land in the
+  // same run. Remember the last run to skip the page map lookup and, for multi-page runs, the
+  // backward scan for the first page. The run cannot go away while we hold bulk_free_lock_
+  // since it still holds the objects being freed.
+  Run* last_run = nullptr;
+  uint8_t* last_run_end = nullptr;
   for (size_t i = 0; i < num_ptrs; i++) {
     void* ptr = ptrs[i];
     DCHECK_LE(base_, ptr);
     DCHECK_LT(ptr, base_ + footprint_);
+    if (i + kBulkFreePrefetchLookAhead < num_ptrs) {
+      size_t ahead_pm_idx = RoundDownToPageMapIndex(ptrs[i + kBulkFreePrefetchLookAhead]);
+      __builtin_prefetch(const_cast<uint8_t*>(&page_map_[ahead_pm_idx]));
+    }
     size_t pm_idx = RoundDownToPageMapIndex(ptr);
     Run* run = nullptr;
-    if (kReadPageMapEntryWithoutLockInBulkFree) {
+    if (reinterpret_cast<uint8_t*>(ptr) >= reinterpret_cast<uint8_t*>(last_run) &&
+        reinterpret_cast<uint8_t*>(ptr) < last_run_end) {
+      run = last_run;
+    } else if (kReadPageMapEntryWithoutLockInBulkFree) {
       // Read the page map entries without locking the lock.
       uint8_t page_map_entry = page_map_[pm_idx];
       if (kTraceRosAlloc) {
@@ -1105,6 +1126,10 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
     }
     DCHECK(run != nullptr);
     DCHECK_EQ(run->magic_num_, kMagicNum);
+    if (run != last_run) {
+      last_run = run;
+      last_run_end = reinterpret_cast<uint8_t*>(run->End());
+    }
     // Set the bit in the bulk free bit map.
     // marvin start
     // freed_bytes += run->AddToBulkFreeList(ptr);
@@ -1125,111 +1150,141 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
   // Now, iterate over the affected runs and update the alloc bit map
   // based on the bulk free bit map (for non-thread-local runs) and
   // union the bulk free bit map into the thread-local free bit map
-  // (for thread-local runs.)
-  for (Run* run : runs) {
+  // (for thread-local runs.) The runs are sorted by size bracket so
+  // that each bracket lock is taken once per batch of up to
+  // kBulkFreeMaxRunsPerBracketLock runs rather than once per run, and
+  // by address within a bracket to walk the run headers in order. The
+  // pages of runs that became free are released after the bracket
+  // lock, since such runs are no longer reachable by allocators.
 #ifdef ART_TARGET_ANDROID
-    DCHECK(run->to_be_bulk_freed_);
-    run->to_be_bulk_freed_ = false;
+  std::vector<Run*>& sorted_runs = runs;
+#else
+  std::vector<Run*> sorted_runs(runs.begin(), runs.end());
 #endif
-    size_t idx = run->size_bracket_idx_;
+  std::sort(sorted_runs.begin(), sorted_runs.end(), [](Run* lhs, Run* rhs) {
+    return lhs->size_bracket_idx_ != rhs->size_bracket_idx_
+        ? lhs->size_bracket_idx_ < rhs->size_bracket_idx_
+        : lhs < rhs;
+  });
+  std::vector<Run*> free_runs;
+  for (size_t begin = 0, end; begin != sorted_runs.size(); begin = end) {
+    const size_t idx = sorted_runs[begin]->size_bracket_idx_;
+    for (end = begin + 1;
+         end != sorted_runs.size() &&
+             end - begin != kBulkFreeMaxRunsPerBracketLock &&
+             sorted_runs[end]->size_bracket_idx_ == idx;
+         ++end) {
+    }
     MutexLock brackets_mu(self, *size_bracket_locks_[idx]);
-    if (run->IsThreadLocal()) {
-      DCHECK_LT(run->size_bracket_idx_, kNumThreadLocalSizeBrackets);
-      DCHECK(non_full_runs_[idx].find(run) == non_full_runs_[idx].end());
-      DCHECK(full_runs_[idx].find(run) == full_runs_[idx].end());
-      run->MergeBulkFreeListToThreadLocalFreeList();
-      if (kTraceRosAlloc) {
-        LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a thread local run 0x"
-                  << std::hex << reinterpret_cast<intptr_t>(run);
-      }
-      DCHECK(run->IsThreadLocal());
-      // A thread local run will be kept as a thread local even if
-      // it's become all free.
-    } else {
-      bool run_was_full = run->IsFull();
-      run->MergeBulkFreeListToFreeList();
-      if (kTraceRosAlloc) {
-        LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a run 0x" << std::hex
-                  << reinterpret_cast<intptr_t>(run);
-      }
-      // Check if the run should be moved to non_full_runs_ or
-      // free_page_runs_.
-      auto* non_full_runs = &non_full_runs_[idx];
-      auto* full_runs = kIsDebugBuild ? &full_runs_[idx] : nullptr;
-      if (run->IsAllFree()) {
-        // It has just become completely free. Free the pages of the
-        // run.
-        bool run_was_current = run == current_runs_[idx];
-        if (run_was_current) {
-          DCHECK(full_runs->find(run) == full_runs->end());
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-          // If it was a current run, reuse it.
-        } else if (run_was_full) {
-          // If it was full, remove it from the full run set (debug
-          // only.)
-          if (kIsDebugBuild) {
-            std::unordered_set<Run*, hash_run, eq_run>::iterator pos = full_runs->find(run);
-            DCHECK(pos != full_runs->end());
-            full_runs->erase(pos);
+    for (size_t i = begin; i != end; ++i) {
+      Run* run = sorted_runs[i];
+#ifdef ART_TARGET_ANDROID
+      DCHECK(run->to_be_bulk_freed_);
+      run->to_be_bulk_freed_ = false;
+#endif
+      if (run->IsThreadLocal()) {
+        DCHECK_LT(run->size_bracket_idx_, kNumThreadLocalSizeBrackets);
+        DCHECK(non_full_runs_[idx].find(run) == non_full_runs_[idx].end());
+        DCHECK(full_runs_[idx].find(run) == full_runs_[idx].end());
+        run->MergeBulkFreeListToThreadLocalFreeList();
+        if (kTraceRosAlloc) {
+          LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a thread local run 0x"
+                    << std::hex << reinterpret_cast<intptr_t>(run);
+        }
+        DCHECK(run->IsThreadLocal());
+        // A thread local run will be kept as a thread local even if
+        // it's become all free.
+      } else {
+        bool run_was_full = run->IsFull();
+        run->MergeBulkFreeListToFreeList();
+        if (kTraceRosAlloc) {
+          LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a run 0x" << std::hex
+                    << reinterpret_cast<intptr_t>(run);
+        }
+        // Check if the run should be moved to non_full_runs_ or
+        // free_page_runs_.
+        auto* non_full_runs = &non_full_runs_[idx];
+        auto* full_runs = kIsDebugBuild ? &full_runs_[idx] : nullptr;
+        if (run->IsAllFree()) {
+          // It has just become completely free. Free the pages of the
+          // run.
+          bool run_was_current = run == current_runs_[idx];
+          if (run_was_current) {
+            DCHECK(full_runs->find(run) == full_runs->end());
+            DCHECK(non_full_runs->find(run) == non_full_runs->end());
+            // If it was a current run, reuse it.
+          } else if (run_was_full) {
+            // If it was full, remove it from the full run set (debug
+            // only.)
+            if (kIsDebugBuild) {
+              std::unordered_set<Run*, hash_run, eq_run>::iterator pos = full_runs->find(run);
+              DCHECK(pos != full_runs->end());
+              full_runs->erase(pos);
+              if (kTraceRosAlloc) {
+                LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
+                          << reinterpret_cast<intptr_t>(run)
+                          << " from full_runs_";
+              }
+              DCHECK(full_runs->find(run) == full_runs->end());
+            }
+          } else {
+            // If it was in a non full run set, remove it from the set.
+            DCHECK(full_runs->find(run) == full_runs->end());
+            DCHECK(non_full_runs->find(run) != non_full_runs->end());
+            non_full_runs->erase(run);
             if (kTraceRosAlloc) {
               LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
                         << reinterpret_cast<intptr_t>(run)
-                        << " from full_runs_";
+                        << " from non_full_runs_";
             }
-            DCHECK(full_runs->find(run) == full_runs->end());
+            DCHECK(non_full_runs->find(run) == non_full_runs->end());
           }
-        } else {
-          // If it was in a non full run set, remove it from the set.
-          DCHECK(full_runs->find(run) == full_runs->end());
-          DCHECK(non_full_runs->find(run) != non_full_runs->end());
-          non_full_runs->erase(run);
-          if (kTraceRosAlloc) {
-            LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
-                      << reinterpret_cast<intptr_t>(run)
-                      << " from non_full_runs_";
+          if (!run_was_current) {
+            run->ZeroHeaderAndSlotHeaders();
+            free_runs.push_back(run);
           }
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-        }
-        if (!run_was_current) {
-          run->ZeroHeaderAndSlotHeaders();
-          MutexLock lock_mu(self, lock_);
-          FreePages(self, run, true);
-        }
-      } else {
-        // It is not completely free. If it wasn't the current run or
-        // already in the non-full run set (i.e., it was full) insert
-        // it into the non-full run set.
-        if (run == current_runs_[idx]) {
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-          DCHECK(full_runs->find(run) == full_runs->end());
-          // If it was a current run, keep it.
-        } else if (run_was_full) {
-          // If it was full, remove it from the full run set (debug
-          // only) and insert into the non-full run set.
-          DCHECK(full_runs->find(run) != full_runs->end());
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-          if (kIsDebugBuild) {
-            full_runs->erase(run);
+        } else {
+          // It is not completely free. If it wasn't the current run or
+          // already in the non-full run set (i.e., it was full) insert
+          // it into the non-full run set.
+          if (run == current_runs_[idx]) {
+            DCHECK(non_full_runs->find(run) == non_full_runs->end());
+            DCHECK(full_runs->find(run) == full_runs->end());
+            // If it was a current run, keep it.
+          } else if (run_was_full) {
+            // If it was full, remove it from the full run set (debug
+            // only) and insert into the non-full run set.
+            DCHECK(full_runs->find(run) != full_runs->end());
+            DCHECK(non_full_runs->find(run) == non_full_runs->end());
+            if (kIsDebugBuild) {
+              full_runs->erase(run);
+              if (kTraceRosAlloc) {
+                LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
+                          << reinterpret_cast<intptr_t>(run)
+                          << " from full_runs_";
+              }
+            }
+            non_full_runs->insert(run);
             if (kTraceRosAlloc) {
-              LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
+              LOG(INFO) << "RosAlloc::BulkFree() : Inserted run 0x" << std::hex
                         << reinterpret_cast<intptr_t>(run)
-                        << " from full_runs_";
+                        << " into non_full_runs_[" << std::dec << idx;
             }
+          } else {
+            // If it was not full, so leave it in the non full run set.
+            DCHECK(full_runs->find(run) == full_runs->end());
+            DCHECK(non_full_runs->find(run) != non_full_runs->end());
           }
-          non_full_runs->insert(run);
-          if (kTraceRosAlloc) {
-            LOG(INFO) << "RosAlloc::BulkFree() : Inserted run 0x" << std::hex
-                      << reinterpret_cast<intptr_t>(run)
-                      << " into non_full_runs_[" << std::dec << idx;
-          }
-        } else {
-          // If it was not full, so leave it in the non full run set.
-          DCHECK(full_runs->find(run) == full_runs->end());
-          DCHECK(non_full_runs->find(run) != non_full_runs->end());
         }
       }
     }
   }
+  if (!free_runs.empty()) {
+    MutexLock lock_mu(self, lock_);
+    for (Run* run : free_runs) {
+      FreePages(self, run, true);
+    }
+  }
   return freed_bytes;
 }
 
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rosalloc-inl.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "common_runtime_test.h"
+#include "gc/heap.h"
+#include "gc/space/rosalloc_space.h"
+#include "runtime.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread_list.h"
+
+namespace art {
+namespace gc {
+namespace allocator {
+
+class RosAllocTest : public CommonRuntimeTest {
+ protected:
+  static size_t NumOfSlots(size_t size) {
+    return RosAlloc::numOfSlots[RosAlloc::SizeToIndex(size)];
+  }
+
+  static size_t NumOfPages(size_t size) {
+    return RosAlloc::numOfPages[RosAlloc::SizeToIndex(size)];
+  }
+
+  static uint8_t PageMapEntry(RosAlloc* rosalloc, const void* ptr) {
+    return rosalloc->page_map_[rosalloc->RoundDownToPageMapIndex(ptr)];
+  }
+
+  // Returns the run holding `ptr` by scanning back to the first page of the run.
+  static RosAlloc::Run* RunOf(RosAlloc* rosalloc, const void* ptr) {
+    size_t pm_idx = rosalloc->RoundDownToPageMapIndex(ptr);
+    while (rosalloc->page_map_[pm_idx] == RosAlloc::kPageMapRunPart) {
+      --pm_idx;
+    }
+    CHECK_EQ(rosalloc->page_map_[pm_idx], RosAlloc::kPageMapRun);
+    return reinterpret_cast<RosAlloc::Run*>(rosalloc->base_ + pm_idx * kPageSize);
+  }
+
+  static bool IsFreeSlot(RosAlloc::Run* run, const void* ptr) {
+    for (RosAlloc::Slot* slot = run->free_list_.Head(); slot != nullptr; slot = slot->Next()) {
+      if (slot == ptr) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static size_t NumberOfFreeSlots(RosAlloc::Run* run) {
+    return run->NumberOfFreeSlots();
+  }
+
+  static bool IsBulkFreeListEmpty(RosAlloc::Run* run) {
+    return run->IsBulkFreeListEmpty();
+  }
+
+  static bool IsCurrentRun(RosAlloc* rosalloc, RosAlloc::Run* run) {
+    return rosalloc->current_runs_[run->size_bracket_idx_] == run;
+  }
+
+  static bool IsFreeRun(RosAlloc* rosalloc, const void* run_begin, size_t size) {
+    size_t pm_idx = rosalloc->RoundDownToPageMapIndex(run_begin);
+    for (size_t i = 0; i != NumOfPages(size); ++i) {
+      if (!rosalloc->IsFreePage(pm_idx + i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void BulkFreeAcrossRunsAndBrackets() REQUIRES(Locks::mutator_lock_);
+
+  space::RosAllocSpace* space_ = nullptr;
+};
+
+void RosAllocTest::BulkFreeAcrossRunsAndBrackets() {
+  // The smallest bracket gets more runs than BulkFree() merges under one bracket lock.
+  static constexpr size_t kSizes[] = { 16, 128, 512, 2048 };
+  static constexpr size_t kNumRuns[] = { 70, 5, 5, 5 };
+  Thread* const self = Thread::Current();
+  RosAlloc* const rosalloc = space_->GetRosAlloc();
+
+  // Allocate round-robin so that the runs of the brackets interleave in memory. The last run of
+  // each bracket is left with a free slot and stays the current run.
+  std::vector<std::vector<void*>> ptrs(arraysize(kSizes));
+  for (bool done = false; !done; ) {
+    done = true;
+    for (size_t i = 0; i != arraysize(kSizes); ++i) {
+      if (ptrs[i].size() + 1 < kNumRuns[i] * NumOfSlots(kSizes[i])) {
+        size_t bytes_allocated;
+        size_t usable_size;
+        size_t bytes_tl_bulk_allocated;
+        void* ptr = rosalloc->Alloc</*kThreadSafe=*/ false>(
+            self, kSizes[i], &bytes_allocated, &usable_size, &bytes_tl_bulk_allocated);
+        ASSERT_TRUE(ptr != nullptr);
+        ptrs[i].push_back(ptr);
+        done = false;
+      }
+    }
+  }
+
+  // Empty every third run of each bracket that is not the current run, and free every other
+  // slot of the remaining runs.
+  std::vector<void*> to_free;
+  std::vector<void*> survivors;
+  std::vector<std::pair<void*, RosAlloc::Run*>> freed_in_kept_runs;
+  std::set<RosAlloc::Run*> emptied_runs;
+  std::map<RosAlloc::Run*, size_t> run_sizes;
+  size_t expected_freed_bytes = 0;
+  for (size_t i = 0; i != arraysize(kSizes); ++i) {
+    std::map<RosAlloc::Run*, std::vector<void*>> runs;
+    for (void* ptr : ptrs[i]) {
+      runs[RunOf(rosalloc, ptr)].push_back(ptr);
+    }
+    ASSERT_EQ(runs.size(), kNumRuns[i]);
+    size_t run_index = 0;
+    for (auto& [run, run_ptrs] : runs) {
+      run_sizes.emplace(run, kSizes[i]);
+      bool empty_run = !IsCurrentRun(rosalloc, run) && run_index % 3 == 0;
+      if (empty_run) {
+        ASSERT_EQ(run_ptrs.size(), NumOfSlots(kSizes[i]));
+        emptied_runs.insert(run);
+      }
+      for (size_t j = 0; j != run_ptrs.size(); ++j) {
+        if (empty_run || j % 2 == 0) {
+          to_free.push_back(run_ptrs[j]);
+          if (!empty_run) {
+            freed_in_kept_runs.emplace_back(run_ptrs[j], run);
+          }
+          expected_freed_bytes += rosalloc->UsableSize(kSizes[i]);
+        } else {
+          survivors.push_back(run_ptrs[j]);
+        }
+      }
+      ++run_index;
+    }
+  }
+  ASSERT_GT(emptied_runs.size(), arraysize(kSizes));
+
+  // Free half of the pointers in address order like a sweep does, and the other half in a
+  // random order so that nearly every pointer lands in a different run than the previous one.
+  std::sort(to_free.begin(), to_free.end());
+  std::vector<void*> in_order;
+  std::vector<void*> shuffled;
+  for (size_t i = 0; i != to_free.size(); ++i) {
+    (i % 2 == 0 ? in_order : shuffled).push_back(to_free[i]);
+  }
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+  size_t freed_bytes = rosalloc->BulkFree(self, in_order.data(), in_order.size());
+  freed_bytes += rosalloc->BulkFree(self, shuffled.data(), shuffled.size());
+  EXPECT_EQ(freed_bytes, expected_freed_bytes);
+
+  // The pages of the emptied runs are free, the other runs have exactly their freed slots back
+  // in the free list.
+  std::map<RosAlloc::Run*, size_t> live_slots;
+  for (void* ptr : survivors) {
+    RosAlloc::Run* run = RunOf(rosalloc, ptr);
+    EXPECT_FALSE(IsFreeSlot(run, ptr));
+    ++live_slots[run];
+  }
+  for (const auto& [ptr, run] : freed_in_kept_runs) {
+    EXPECT_TRUE(IsFreeSlot(run, ptr));
+  }
+  for (const auto& [run, size] : run_sizes) {
+    if (emptied_runs.count(run) != 0u) {
+      EXPECT_TRUE(IsFreeRun(rosalloc, run, size));
+      EXPECT_EQ(live_slots.count(run), 0u);
+    } else {
+      EXPECT_EQ(PageMapEntry(rosalloc, run), RosAlloc::kPageMapRun);
+      EXPECT_TRUE(IsBulkFreeListEmpty(run));
+      EXPECT_EQ(NumberOfFreeSlots(run), NumOfSlots(size) - live_slots[run]);
+    }
+  }
+
+  // Freeing the survivors empties the remaining runs. Only the current runs keep their pages.
+  std::sort(survivors.begin(), survivors.end());
+  rosalloc->BulkFree(self, survivors.data(), survivors.size());
+  for (const auto& [run, size] : run_sizes) {
+    if (emptied_runs.count(run) == 0u && IsCurrentRun(rosalloc, run)) {
+      EXPECT_EQ(NumberOfFreeSlots(run), NumOfSlots(size));
+    } else {
+      EXPECT_TRUE(IsFreeRun(rosalloc, run, size));
+    }
+  }
+}
+
+TEST_F(RosAllocTest, BulkFree) {
+  Thread* const self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  space_ = space::RosAllocSpace::Create("test space",
+                                        4 * MB,
+                                        16 * MB,
+                                        16 * MB,
+                                        /*low_memory_mode=*/ false,
+                                        /*can_move_objects=*/ false);
+  ASSERT_TRUE(space_ != nullptr);
+  Heap* const heap = Runtime::Current()->GetHeap();
+  // The thread-unsafe allocation path avoids the thread-local runs, which belong to the heap's
+  // own RosAlloc. Growing the space needs it to be known to the heap.
+  ScopedThreadSuspension sts(self, kSuspended);
+  ScopedSuspendAll ssa("RosAllocTest");
+  heap->AddSpace(space_);
+  BulkFreeAcrossRunsAndBrackets();
+  heap->RemoveSpace(space_);
+  delete space_;
+}
+
+}  // namespace allocator
+}  // namespace gc
+}  // namespace art
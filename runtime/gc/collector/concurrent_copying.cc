@@ -30,6 +30,7 @@
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/mod_union_table-inl.h"
 #include "gc/accounting/read_barrier_table.h"
+#include "gc/accounting/segmented_stack.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/gc_pause_listener.h"
 #include "gc/reference_processor.h"
@@ -42,6 +43,7 @@
 #include "mirror/object-inl.h"
 #include "mirror/object-refvisitor-inl.h"
 #include "mirror/object_reference.h"
+#include "monitor.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread-inl.h"
 #include "thread_list.h"
@@ -56,7 +58,6 @@ namespace art {
 namespace gc {
 namespace collector {
 
-static constexpr size_t kDefaultGcMarkStackSize = 2 * MB;
 // If kFilterModUnionCards then we attempt to filter cards that don't need to be dirty in the mod
 // union table. Disabled since it does not seem to help the pause much.
 static constexpr bool kFilterModUnionCards = kIsDebugBuild;
@@ -82,9 +83,7 @@ ConcurrentCopying::ConcurrentCopying(Heap* heap,
                        "concurrent copying"),
       region_space_(nullptr),
       gc_barrier_(new Barrier(0)),
-      gc_mark_stack_(accounting::ObjectStack::Create("concurrent copying gc mark stack",
-                                                     kDefaultGcMarkStackSize,
-                                                     kDefaultGcMarkStackSize)),
+      gc_mark_stack_(new accounting::SegmentedObjectStack("concurrent copying gc mark stack")),
       use_generational_cc_(use_generational_cc),
       young_gen_(young_gen),
       rb_mark_bit_stack_(accounting::ObjectStack::Create("rb copying gc mark stack",
@@ -566,6 +565,12 @@ class ConcurrentCopying::FlipCallback : public Closure {
     }
     CHECK_EQ(thread, self);
     Locks::mutator_lock_->AssertExclusiveHeld(self);
+    {
+      // Deflate idle monitors while mutators are suspended anyway. No object has moved yet, so
+      // their lock words can be rewritten as in a plain suspend all.
+      TimingLogger::ScopedTiming split2("(Paused)DeflateIdleMonitors", cc->GetTimings());
+      Runtime::Current()->GetMonitorList()->MaybeDeflateIdleMonitors();
+    }
     space::RegionSpace::EvacMode evac_mode = space::RegionSpace::kEvacModeLivePercentNewlyAllocated;
     if (cc->young_gen_) {
       CHECK(!cc->force_evacuate_all_);
@@ -1380,9 +1385,6 @@ void ConcurrentCopying::PushOntoLocalMarkStack(mirror::Object* ref) {
     DCHECK(self->GetThreadLocalMarkStack() == nullptr);
   }
   DCHECK_EQ(mark_stack_mode_.load(std::memory_order_relaxed), kMarkStackModeThreadLocal);
-  if (UNLIKELY(gc_mark_stack_->IsFull())) {
-    ExpandGcMarkStack();
-  }
   gc_mark_stack_->PushBack(ref);
 }
 
@@ -1915,18 +1917,6 @@ void ConcurrentCopying::IssueEmptyCheckpoint() {
   Locks::mutator_lock_->SharedLock(self);
 }
 
-void ConcurrentCopying::ExpandGcMarkStack() {
-  DCHECK(gc_mark_stack_->IsFull());
-  const size_t new_size = gc_mark_stack_->Capacity() * 2;
-  std::vector<StackReference<mirror::Object>> temp(gc_mark_stack_->Begin(),
-                                                   gc_mark_stack_->End());
-  gc_mark_stack_->Resize(new_size);
-  for (auto& ref : temp) {
-    gc_mark_stack_->PushBack(ref.AsMirrorPtr());
-  }
-  DCHECK(!gc_mark_stack_->IsFull());
-}
-
 void ConcurrentCopying::PushOntoMarkStack(Thread* const self, mirror::Object* to_ref) {
   CHECK_EQ(is_mark_stack_push_disallowed_.load(std::memory_order_relaxed), 0)
       << " " << to_ref << " " << mirror::Object::PrettyTypeOf(to_ref);
@@ -1936,9 +1926,6 @@ void ConcurrentCopying::PushOntoMarkStack(Thread* const self, mirror::Object* to
     if (LIKELY(self == thread_running_gc_)) {
       // If GC-running thread, use the GC mark stack instead of a thread-local mark stack.
       CHECK(self->GetThreadLocalMarkStack() == nullptr);
-      if (UNLIKELY(gc_mark_stack_->IsFull())) {
-        ExpandGcMarkStack();
-      }
       gc_mark_stack_->PushBack(to_ref);
     } else {
       // Otherwise, use a thread-local mark stack.
@@ -1972,9 +1959,6 @@ void ConcurrentCopying::PushOntoMarkStack(Thread* const self, mirror::Object* to
   } else if (mark_stack_mode == kMarkStackModeShared) {
     // Access the shared GC mark stack with a lock.
     MutexLock mu(self, mark_stack_lock_);
-    if (UNLIKELY(gc_mark_stack_->IsFull())) {
-      ExpandGcMarkStack();
-    }
     gc_mark_stack_->PushBack(to_ref);
   } else {
     CHECK_EQ(static_cast<uint32_t>(mark_stack_mode),
@@ -1986,9 +1970,6 @@ void ConcurrentCopying::PushOntoMarkStack(Thread* const self, mirror::Object* to
         << "Only GC-running thread should access the mark stack "
         << "in the GC exclusive mark stack mode";
     // Access the GC mark stack without a lock.
-    if (UNLIKELY(gc_mark_stack_->IsFull())) {
-      ExpandGcMarkStack();
-    }
     gc_mark_stack_->PushBack(to_ref);
   }
 }
@@ -2250,9 +2231,8 @@ bool ConcurrentCopying::ProcessMarkStackOnce() {
         if (gc_mark_stack_->IsEmpty()) {
           break;
         }
-        for (StackReference<mirror::Object>* p = gc_mark_stack_->Begin();
-             p != gc_mark_stack_->End(); ++p) {
-          refs.push_back(p->AsMirrorPtr());
+        while (!gc_mark_stack_->IsEmpty()) {
+          refs.push_back(gc_mark_stack_->PopBack());
         }
         gc_mark_stack_->Reset();
       }
@@ -2581,7 +2561,14 @@ void ConcurrentCopying::CheckEmptyMarkStack() {
 void ConcurrentCopying::SweepSystemWeaks(Thread* self) {
   TimingLogger::ScopedTiming split("SweepSystemWeaks", GetTimings());
   ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-  Runtime::Current()->SweepSystemWeaks(this);
+  // IsMarked() only reads GC state, so the holders can be swept by several threads. Mutators
+  // that access weaks are blocked until the sweep is done, so size it like a pause unless the
+  // app is in the background.
+  Runtime* const runtime = Runtime::Current();
+  const size_t num_workers = runtime->InJankPerceptibleProcessState()
+      ? heap_->GetParallelGCThreadCount() + 1
+      : 1;
+  runtime->SweepSystemWeaks(this, num_workers);
 }
 
 void ConcurrentCopying::Sweep(bool swap_bitmaps) {
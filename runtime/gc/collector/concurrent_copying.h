@@ -50,6 +50,8 @@ namespace gc {
 namespace accounting {
 template<typename T> class AtomicStack;
 typedef AtomicStack<mirror::Object> ObjectStack;
+template<typename T> class SegmentedStack;
+typedef SegmentedStack<mirror::Object> SegmentedObjectStack;
 template <size_t kAlignment> class SpaceBitmap;
 typedef SpaceBitmap<kObjectAlignment> ContinuousSpaceBitmap;
 class HeapBitmap;
@@ -307,7 +309,6 @@ class ConcurrentCopying : public GarbageCollector {
   void ReenableWeakRefAccess(Thread* self) REQUIRES_SHARED(Locks::mutator_lock_);
   void DisableMarking() REQUIRES_SHARED(Locks::mutator_lock_);
   void IssueDisableMarkingCheckpoint() REQUIRES_SHARED(Locks::mutator_lock_);
-  void ExpandGcMarkStack() REQUIRES_SHARED(Locks::mutator_lock_);
   mirror::Object* MarkNonMoving(Thread* const self,
                                 mirror::Object* from_ref,
                                 mirror::Object* holder = nullptr,
@@ -350,7 +351,7 @@ class ConcurrentCopying : public GarbageCollector {
 
   space::RegionSpace* region_space_;      // The underlying region space.
   std::unique_ptr<Barrier> gc_barrier_;
-  std::unique_ptr<accounting::ObjectStack> gc_mark_stack_;
+  std::unique_ptr<accounting::SegmentedObjectStack> gc_mark_stack_;
 
   // If true, enable generational collection when using the Concurrent Copying
   // (CC) collector, i.e. use sticky-bit CC for minor collections and (full) CC
@@ -34,6 +34,7 @@
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/mod_union_table.h"
+#include "gc/accounting/segmented_stack.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/heap.h"
 #include "gc/reference_processor.h"
@@ -41,6 +42,7 @@
 #include "gc/space/space-inl.h"
 #include "mark_sweep-inl.h"
 #include "mirror/object-inl.h"
+#include "monitor.h"
 #include "runtime.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread-current-inl.h"
@@ -218,6 +220,11 @@ void MarkSweep::PausePhase() {
     RevokeAllThreadLocalAllocationStacks(self);
   }
   heap_->PreSweepingGcVerification(this);
+  {
+    // Deflate idle monitors while mutators are suspended anyway, the sweep below frees them.
+    TimingLogger::ScopedTiming t2("DeflateIdleMonitors", GetTimings());
+    Runtime::Current()->GetMonitorList()->MaybeDeflateIdleMonitors();
+  }
   // Disallow new system weaks to prevent a race which occurs when someone adds a new system
   // weak before we sweep them. Since this new system weak may not be marked, the GC may
   // incorrectly sweep it. This also fixes a race where interning may attempt to return a strong
@@ -392,24 +399,6 @@ void MarkSweep::FindDefaultSpaceBitmap() {
       << heap_->DumpSpaces();
 }
 
-void MarkSweep::ExpandMarkStack() {
-  ResizeMarkStack(mark_stack_->Capacity() * 2);
-}
-
-void MarkSweep::ResizeMarkStack(size_t new_size) {
-  // Rare case, no need to have Thread::Current be a parameter.
-  if (UNLIKELY(mark_stack_->Size() < mark_stack_->Capacity())) {
-    // Someone else acquired the lock and expanded the mark stack before us.
-    return;
-  }
-  std::vector<StackReference<mirror::Object>> temp(mark_stack_->Begin(), mark_stack_->End());
-  CHECK_LE(mark_stack_->Size(), new_size);
-  mark_stack_->Resize(new_size);
-  for (auto& obj : temp) {
-    mark_stack_->PushBack(obj.AsMirrorPtr());
-  }
-}
-
 mirror::Object* MarkSweep::MarkObject(mirror::Object* obj) {
   MarkObject(obj, nullptr, MemberOffset(0));
   return obj;
@@ -419,9 +408,6 @@ inline void MarkSweep::MarkObjectNonNullParallel(mirror::Object* obj) {
   DCHECK(obj != nullptr);
   if (MarkObjectParallel(obj)) {
     MutexLock mu(Thread::Current(), mark_stack_lock_);
-    if (UNLIKELY(mark_stack_->Size() >= mark_stack_->Capacity())) {
-      ExpandMarkStack();
-    }
     // The object must be pushed on to the mark stack.
     mark_stack_->PushBack(obj);
   }
@@ -540,11 +526,6 @@ inline void MarkSweep::MarkObjectNonNull(mirror::Object* obj,
 }
 
 inline void MarkSweep::PushOnMarkStack(mirror::Object* obj) {
-  if (UNLIKELY(mark_stack_->Size() >= mark_stack_->Capacity())) {
-    // Lock is not needed but is here anyways to please annotalysis.
-    MutexLock mu(Thread::Current(), mark_stack_lock_);
-    ExpandMarkStack();
-  }
   // The object must be pushed on to the mark stack.
   mark_stack_->PushBack(obj);
 }
@@ -901,14 +882,14 @@ void MarkSweep::ScanGrayObjects(bool paused, uint8_t minimum_age) {
     TimingLogger::ScopedTiming t(paused ? "(Paused)ScanGrayObjects" : __FUNCTION__,
         GetTimings());
     // Try to take some of the mark stack since we can pass this off to the worker tasks.
-    StackReference<mirror::Object>* mark_stack_begin = mark_stack_->Begin();
-    StackReference<mirror::Object>* mark_stack_end = mark_stack_->End();
-    const size_t mark_stack_size = mark_stack_end - mark_stack_begin;
+    const size_t mark_stack_size = mark_stack_->Size();
     // Estimated number of work tasks we will create.
     const size_t mark_stack_tasks = GetHeap()->GetContinuousSpaces().size() * thread_count;
     DCHECK_NE(mark_stack_tasks, 0U);
     const size_t mark_stack_delta = std::min(CardScanTask::kMaxSize / 2,
                                              mark_stack_size / mark_stack_tasks + 1);
+    // The tasks copy their share of the mark stack in their constructor, so one buffer will do.
+    std::vector<StackReference<mirror::Object>> mark_stack_buffer(mark_stack_delta);
     for (const auto& space : GetHeap()->GetContinuousSpaces()) {
       if (space->GetMarkBitmap() == nullptr) {
         continue;
@@ -936,11 +917,8 @@ void MarkSweep::ScanGrayObjects(bool paused, uint8_t minimum_age) {
         size_t addr_remaining = card_end - card_begin;
         size_t card_increment = std::min(card_delta, addr_remaining);
         // Take from the back of the mark stack.
-        size_t mark_stack_remaining = mark_stack_end - mark_stack_begin;
-        size_t mark_stack_increment = std::min(mark_stack_delta, mark_stack_remaining);
-        mark_stack_end -= mark_stack_increment;
-        mark_stack_->PopBackCount(static_cast<int32_t>(mark_stack_increment));
-        DCHECK_EQ(mark_stack_end, mark_stack_->End());
+        size_t mark_stack_increment =
+            mark_stack_->PopBackInto(mark_stack_delta, mark_stack_buffer.data());
         // Add the new task to the thread pool.
         auto* task = new CardScanTask(thread_pool,
                                       this,
@@ -949,7 +927,7 @@ void MarkSweep::ScanGrayObjects(bool paused, uint8_t minimum_age) {
                                       card_begin + card_increment,
                                       minimum_age,
                                       mark_stack_increment,
-                                      mark_stack_end,
+                                      mark_stack_buffer.data(),
                                       clear_card);
         thread_pool->AddTask(self, task);
         card_begin += card_increment;
@@ -1113,7 +1091,7 @@ void MarkSweep::ReMarkRoots() {
 void MarkSweep::SweepSystemWeaks(Thread* self) {
   TimingLogger::ScopedTiming t(__FUNCTION__, GetTimings());
   ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-  Runtime::Current()->SweepSystemWeaks(this);
+  Runtime::Current()->SweepSystemWeaks(this, GetThreadCount(/* paused= */ false));
 }
 
 class MarkSweep::VerifySystemWeakVisitor : public IsMarkedVisitor {
@@ -1407,11 +1385,12 @@ void MarkSweep::ProcessMarkStackParallel(size_t thread_count) {
   const size_t chunk_size = std::min(mark_stack_->Size() / thread_count + 1,
                                      static_cast<size_t>(MarkStackTask<false>::kMaxSize));
   CHECK_GT(chunk_size, 0U);
-  // Split the current mark stack up into work tasks.
-  for (auto* it = mark_stack_->Begin(), *end = mark_stack_->End(); it < end; ) {
-    const size_t delta = std::min(static_cast<size_t>(end - it), chunk_size);
-    thread_pool->AddTask(self, new MarkStackTask<false>(thread_pool, this, delta, it));
-    it += delta;
+  // Split the current mark stack up into work tasks. The tasks copy their share of the mark stack
+  // in their constructor, so one buffer will do.
+  std::vector<StackReference<mirror::Object>> buffer(chunk_size);
+  while (!mark_stack_->IsEmpty()) {
+    const size_t delta = mark_stack_->PopBackInto(chunk_size, buffer.data());
+    thread_pool->AddTask(self, new MarkStackTask<false>(thread_pool, this, delta, buffer.data()));
   }
   thread_pool->SetMaxActiveWorkers(thread_count - 1);
   thread_pool->StartWorkers(self);
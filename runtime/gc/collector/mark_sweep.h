@@ -47,6 +47,8 @@ class Heap;
 namespace accounting {
 template<typename T> class AtomicStack;
 typedef AtomicStack<mirror::Object> ObjectStack;
+template<typename T> class SegmentedStack;
+typedef SegmentedStack<mirror::Object> SegmentedObjectStack;
 }  // namespace accounting
 
 namespace collector {
@@ -254,15 +256,6 @@ class MarkSweep : public GarbageCollector {
   void VerifySuspendedThreadRoots(std::ostream& os)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
-  // Expand mark stack to 2x its current size.
-  void ExpandMarkStack()
-      REQUIRES(mark_stack_lock_)
-      REQUIRES_SHARED(Locks::mutator_lock_);
-
-  void ResizeMarkStack(size_t new_size)
-      REQUIRES(mark_stack_lock_)
-      REQUIRES_SHARED(Locks::mutator_lock_);
-
   // Returns how many threads we should use for the current GC phase based on if we are paused,
   // whether or not we care about pauses.
   size_t GetThreadCount(bool paused) const;
@@ -312,7 +305,7 @@ class MarkSweep : public GarbageCollector {
   // Cache the heap's mark bitmap to prevent having to do 2 loads during slow path marking.
   accounting::HeapBitmap* mark_bitmap_;
 
-  accounting::ObjectStack* mark_stack_;
+  accounting::SegmentedObjectStack* mark_stack_;
 
   // Every object inside the immune spaces is assumed to be marked. Immune spaces that aren't in the
   // immune region are handled by the normal marking logic.
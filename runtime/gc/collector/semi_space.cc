@@ -29,6 +29,7 @@
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/mod_union_table.h"
 #include "gc/accounting/remembered_set.h"
+#include "gc/accounting/segmented_stack.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/heap.h"
 #include "gc/reference_processor.h"
@@ -367,19 +368,7 @@ void SemiSpace::ReclaimPhase() {
   }
 }
 
-void SemiSpace::ResizeMarkStack(size_t new_size) {
-  std::vector<StackReference<Object>> temp(mark_stack_->Begin(), mark_stack_->End());
-  CHECK_LE(mark_stack_->Size(), new_size);
-  mark_stack_->Resize(new_size);
-  for (auto& obj : temp) {
-    mark_stack_->PushBack(obj.AsMirrorPtr());
-  }
-}
-
 inline void SemiSpace::MarkStackPush(Object* obj) {
-  if (UNLIKELY(mark_stack_->Size() >= mark_stack_->Capacity())) {
-    ResizeMarkStack(mark_stack_->Capacity() * 2);
-  }
   // The object must be pushed on to the mark stack.
   mark_stack_->PushBack(obj);
 }
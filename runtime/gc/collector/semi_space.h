@@ -45,6 +45,8 @@ class Heap;
 namespace accounting {
 template <typename T> class AtomicStack;
 typedef AtomicStack<mirror::Object> ObjectStack;
+template <typename T> class SegmentedStack;
+typedef SegmentedStack<mirror::Object> SegmentedObjectStack;
 }  // namespace accounting
 
 namespace space {
@@ -178,9 +180,6 @@ class SemiSpace : public GarbageCollector {
       REQUIRES(Locks::heap_bitmap_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
-  // Expand mark stack to 2x its current size.
-  void ResizeMarkStack(size_t new_size) REQUIRES_SHARED(Locks::mutator_lock_);
-
   // Returns true if we should sweep the space.
   virtual bool ShouldSweepSpace(space::ContinuousSpace* space) const;
 
@@ -203,7 +202,7 @@ class SemiSpace : public GarbageCollector {
 
   // Current space, we check this space first to avoid searching for the appropriate space for an
   // object.
-  accounting::ObjectStack* mark_stack_;
+  accounting::SegmentedObjectStack* mark_stack_;
 
   // Every object inside the immune spaces is assumed to be marked.
   ImmuneSpaces immune_spaces_;
@@ -59,6 +59,8 @@ enum CollectorType {
   kCollectorTypeGetObjectsAllocated,
   // Fake collector type for ScopedGCCriticalSection
   kCollectorTypeCriticalSection,
+  // Sliding compaction of the large object space, run after background transitions.
+  kCollectorTypeLargeObjectSpaceCompaction,
 };
 std::ostream& operator<<(std::ostream& os, CollectorType collector_type);
 
@@ -64,6 +64,8 @@ enum GcCause {
   kGcCauseProfileSaver,
   // GC cause for running an empty checkpoint.
   kGcCauseRunEmptyCheckpoint,
+  // Compaction of a fragmented large object space, after a background transition.
+  kGcCauseLargeObjectSpaceCompaction,
 };
 
 const char* PrettyCause(GcCause cause);
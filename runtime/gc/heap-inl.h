@@ -98,6 +98,10 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self,
       obj = AllocLargeObject<kInstrumented, PreFenceVisitor>(self, &klass, byte_count,
                                                              pre_fence_visitor);
       if (obj != nullptr) {
+        if (allocator == kAllocatorTypeNonMoving && IsLargeObjectSpaceCompactionEnabled()) {
+          // Callers of the non-moving allocator rely on the address, e.g. VMRuntime.addressOf().
+          down_cast<space::FreeListSpace*>(large_object_space_)->PinObject(self, obj.Ptr());
+        }
       // marvin start
       // Added by Niel: we avoid swapping out LOS objects created by the zygote because
       // they might be referenced from the zygote space, and there's no easy way of
@@ -19,6 +19,9 @@
 
 #include "heap.h"
 
+#include <functional>
+#include <vector>
+
 #include "base/mutex-inl.h"
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/space/bump_pointer_space-walk-inl.h"
@@ -108,6 +111,15 @@ inline void Heap::VisitObjectsInternal(Visitor&& visitor) {
     // Visit objects in bump pointer space.
     bump_pointer_space_->Walk(visitor);
   }
+  VisitAllocationStack(visitor);
+  {
+    ReaderMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
+    GetLiveBitmap()->Visit<Visitor>(visitor);
+  }
+}
+
+template <typename Visitor>
+inline void Heap::VisitAllocationStack(Visitor&& visitor) {
   // TODO: Switch to standard begin and end to use ranged a based loop.
   for (auto* it = allocation_stack_->Begin(), *end = allocation_stack_->End(); it < end; ++it) {
     mirror::Object* const obj = it->AsMirrorPtr();
@@ -157,10 +169,108 @@ inline void Heap::VisitObjectsInternal(Visitor&& visitor) {
       visitor(obj);
     }
   }
-  {
-    ReaderMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
-    GetLiveBitmap()->Visit<Visitor>(visitor);
+}
+
+template <typename Visitor>
+inline void Heap::VisitObjectsParallel(Visitor&& visitor) {
+  Thread* self = Thread::Current();
+  Locks::mutator_lock_->AssertSharedHeld(self);
+  DCHECK(!Locks::mutator_lock_->IsExclusiveHeld(self))
+      << "Call VisitObjectsPausedParallel() instead";
+  if (IsGcConcurrentAndMoving()) {
+    // See VisitObjects(). Once threads are suspended and moving GC is disabled, nothing else
+    // uses the thread pool.
+    IncrementDisableMovingGC(self);
+    {
+      ScopedThreadSuspension sts(self, kWaitingForVisitObjects);
+      ScopedSuspendAll ssa(__FUNCTION__);
+      VisitObjectsInternalParallel(visitor);
+    }
+    DecrementDisableMovingGC(self);
+  } else {
+    // A concurrent collection may be using the thread pool, so visit on this thread only.
+    VisitObjects([&visitor](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+      visitor(/* worker_index= */ 0u, obj);
+    });
+  }
+}
+
+template <typename Visitor>
+inline void Heap::VisitObjectsPausedParallel(Visitor&& visitor) {
+  Thread* self = Thread::Current();
+  Locks::mutator_lock_->AssertExclusiveHeld(self);
+  VisitObjectsInternalParallel(visitor);
+}
+
+// Split the heap into chunks and visit them on the thread pool. The region space is split in
+// groups of regions and the live bitmaps in address ranges; the bump pointer space and the
+// allocation stack are walked sequentially and make up a single chunk.
+template <typename Visitor>
+inline void Heap::VisitObjectsInternalParallel(Visitor&& visitor) {
+  Thread* self = Thread::Current();
+  Locks::mutator_lock_->AssertExclusiveHeld(self);
+  const size_t num_workers = GetParallelVisitWorkerCount();
+  if (num_workers <= 1) {
+    auto serial_visitor = [&visitor](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+      visitor(/* worker_index= */ 0u, obj);
+    };
+    VisitObjectsInternalRegionSpace(serial_visitor);
+    VisitObjectsInternal(serial_visitor);
+    return;
+  }
+  // A few chunks per worker so that a worker stuck with a dense chunk does not hold up the rest.
+  static constexpr size_t kChunksPerWorker = 4;
+  const size_t num_chunks = num_workers * kChunksPerWorker;
+  std::vector<std::function<void(size_t)>> chunks;
+  if (region_space_ != nullptr) {
+    // Same requirements as VisitObjectsInternalRegionSpace().
+    DCHECK(IsGcConcurrentAndMoving());
+    const size_t num_regions = region_space_->GetNumRegions();
+    const size_t regions_per_chunk = (num_regions + num_chunks - 1) / num_chunks;
+    for (size_t begin = 0; begin < num_regions; begin += regions_per_chunk) {
+      const size_t end = std::min(begin + regions_per_chunk, num_regions);
+      chunks.push_back([this, &visitor, begin, end](size_t worker_index)
+                           NO_THREAD_SAFETY_ANALYSIS {
+        region_space_->WalkRegions(begin, end, [&](mirror::Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+          visitor(worker_index, obj);
+        });
+      });
+    }
+  }
+  chunks.push_back([this, &visitor](size_t worker_index) NO_THREAD_SAFETY_ANALYSIS {
+    auto chunk_visitor = [&](mirror::Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+      visitor(worker_index, obj);
+    };
+    if (bump_pointer_space_ != nullptr) {
+      bump_pointer_space_->Walk(chunk_visitor);
+    }
+    VisitAllocationStack(chunk_visitor);
+  });
+  ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+  auto add_bitmap_chunks = [&](auto* bitmap) {
+    const uintptr_t heap_begin = bitmap->HeapBegin();
+    const uintptr_t heap_limit = bitmap->HeapLimit();
+    // Chunk boundaries only need to be object aligned, VisitMarkedRange() handles partial words.
+    const uintptr_t chunk_size =
+        RoundUp((heap_limit - heap_begin + num_chunks - 1) / num_chunks, kPageSize);
+    for (uintptr_t begin = heap_begin; begin < heap_limit; begin += chunk_size) {
+      const uintptr_t end = std::min(begin + chunk_size, heap_limit);
+      chunks.push_back([bitmap, &visitor, begin, end](size_t worker_index)
+                           NO_THREAD_SAFETY_ANALYSIS {
+        bitmap->VisitMarkedRange(begin, end, [&](mirror::Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+          visitor(worker_index, obj);
+        });
+      });
+    }
+  };
+  accounting::HeapBitmap* live_bitmap = GetLiveBitmap();
+  for (accounting::ContinuousSpaceBitmap* bitmap : live_bitmap->continuous_space_bitmaps_) {
+    add_bitmap_chunks(bitmap);
+  }
+  for (accounting::LargeObjectBitmap* bitmap : live_bitmap->large_object_bitmaps_) {
+    add_bitmap_chunks(bitmap);
   }
+  RunParallelChunks(self, num_workers, chunks);
 }
 
 // jiacheng start
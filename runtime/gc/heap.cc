@@ -22,6 +22,7 @@
 #include <malloc.h>  // For mallinfo()
 #endif
 #include <memory>
+#include <numeric>
 #include <vector>
 
 #include "android-base/stringprintf.h"
@@ -52,6 +53,7 @@
 #include "gc/accounting/mod_union_table-inl.h"
 #include "gc/accounting/read_barrier_table.h"
 #include "gc/accounting/remembered_set.h"
+#include "gc/accounting/segmented_stack.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/collector/concurrent_copying.h"
 #include "gc/collector/mark_sweep.h"
@@ -100,12 +102,14 @@
 #include "javaheapprof/javaheapsampler.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "verify_object-inl.h"
 #include "well_known_classes.h"
 
 // marvin start
 #include "niel_instrumentation.h"
 #include "niel_scoped_timer.h"
+#include "niel_stub.h"
 // marvin end
 
 namespace art {
@@ -158,8 +162,6 @@ static constexpr bool kCompactZygote = kMovingCollector;
 // How many reserve entries are at the end of the allocation stack, these are only needed if the
 // allocation stack overflows.
 static constexpr size_t kAllocationStackReserveSize = 1024;
-// Default mark stack size in bytes.
-static const size_t kDefaultMarkStackSize = 64 * KB;
 // Define space name.
 static const char* kDlMallocSpaceName[2] = {"main dlmalloc space", "main dlmalloc space 1"};
 static const char* kRosAllocSpaceName[2] = {"main rosalloc space", "main rosalloc space 1"};
@@ -256,6 +258,8 @@ Heap::Heap(size_t initial_size,
            size_t max_free,
            double target_utilization,
            double foreground_heap_growth_multiplier,
+           double gc_target_cpu_fraction,
+           double gc_target_pause_fraction,
            size_t stop_for_native_allocs,
            size_t capacity,
            size_t non_moving_space_capacity,
@@ -267,6 +271,7 @@ Heap::Heap(size_t initial_size,
            CollectorType background_collector_type,
            space::LargeObjectSpaceType large_object_space_type,
            size_t large_object_threshold,
+           double large_object_space_compaction_threshold,
            size_t parallel_gc_threads,
            size_t conc_gc_threads,
            bool low_memory_mode,
@@ -312,6 +317,7 @@ Heap::Heap(size_t initial_size,
       zygote_creation_lock_("zygote creation lock", kZygoteCreationLock),
       zygote_space_(nullptr),
       large_object_threshold_(large_object_threshold),
+      large_object_space_compaction_threshold_(large_object_space_compaction_threshold),
       disable_thread_flip_count_(0),
       thread_flip_running_(false),
       collector_type_running_(kCollectorTypeNone),
@@ -326,6 +332,16 @@ Heap::Heap(size_t initial_size,
       // this one.
       process_state_update_lock_("process state update lock", kPostMonitorLock),
       min_foreground_target_footprint_(0),
+      gc_target_cpu_fraction_(gc_target_cpu_fraction),
+      gc_target_pause_fraction_(gc_target_pause_fraction),
+      growth_alloc_rate_(0.0),
+      growth_gc_cost_ns_(0.0),
+      growth_pause_ns_(0.0),
+      has_growth_alloc_rate_(false),
+      last_growth_update_ns_(0u),
+      last_growth_update_bytes_(0u),
+      growth_predicted_free_(0u),
+      growth_default_free_(0u),
       concurrent_start_bytes_(std::numeric_limits<size_t>::max()),
       total_bytes_freed_ever_(0),
       total_objects_freed_ever_(0),
@@ -649,6 +665,12 @@ Heap::Heap(size_t initial_size,
     large_object_threshold_ = std::numeric_limits<size_t>::max();
     large_object_space_ = nullptr;
   }
+  if (IsLargeObjectSpaceCompactionEnabled() &&
+      large_object_space_type != space::LargeObjectSpaceType::kFreeList) {
+    // Only the free list space can move its objects.
+    VLOG(heap) << "Large object space compaction needs the free list large object space";
+    large_object_space_compaction_threshold_ = 0.0;
+  }
   if (large_object_space_ != nullptr) {
     AddSpace(large_object_space_);
   }
@@ -696,8 +718,7 @@ Heap::Heap(size_t initial_size,
   }
   // TODO: Count objects in the image space here?
   num_bytes_allocated_.store(0, std::memory_order_relaxed);
-  mark_stack_.reset(accounting::ObjectStack::Create("mark stack", kDefaultMarkStackSize,
-                                                    kDefaultMarkStackSize));
+  mark_stack_.reset(new accounting::SegmentedObjectStack("mark stack"));
   const size_t alloc_stack_capacity = max_allocation_stack_size_ + kAllocationStackReserveSize;
   allocation_stack_.reset(accounting::ObjectStack::Create(
       "allocation stack", max_allocation_stack_size_, alloc_stack_capacity));
@@ -1117,6 +1138,63 @@ void Heap::DeleteThreadPool() {
   thread_pool_.reset(nullptr);
 }
 
+size_t Heap::GetParallelVisitWorkerCount() const {
+  if (thread_pool_ == nullptr) {
+    return 1;
+  }
+  // The visit runs with all mutators suspended, so size it like a GC pause.
+  return std::min(parallel_gc_threads_, thread_pool_->GetThreadCount()) + 1;
+}
+
+// Claims chunks from a shared cursor until there are none left. Each task is run by a single
+// thread at a time, so its index is a valid worker index for the chunks it runs.
+class ParallelChunkTask : public SelfDeletingTask {
+ public:
+  ParallelChunkTask(const std::vector<std::function<void(size_t)>>* chunks,
+                    Atomic<size_t>* next_chunk,
+                    size_t worker_index)
+      : chunks_(chunks), next_chunk_(next_chunk), worker_index_(worker_index) {}
+
+  void Run(Thread* self ATTRIBUTE_UNUSED) override {
+    for (size_t i = next_chunk_->fetch_add(1u, std::memory_order_relaxed);
+         i < chunks_->size();
+         i = next_chunk_->fetch_add(1u, std::memory_order_relaxed)) {
+      (*chunks_)[i](worker_index_);
+    }
+  }
+
+ private:
+  const std::vector<std::function<void(size_t)>>* const chunks_;
+  Atomic<size_t>* const next_chunk_;
+  const size_t worker_index_;
+};
+
+void Heap::RunParallelChunks(Thread* self,
+                             size_t num_workers,
+                             const std::vector<std::function<void(size_t)>>& chunks) {
+  ThreadPool* thread_pool = GetThreadPool();
+  if (thread_pool != nullptr) {
+    num_workers = std::min(num_workers, thread_pool->GetThreadCount() + 1);
+  } else {
+    num_workers = 1;
+  }
+  num_workers = std::min(num_workers, chunks.size());
+  if (num_workers <= 1) {
+    for (const std::function<void(size_t)>& chunk : chunks) {
+      chunk(/* worker_index= */ 0u);
+    }
+    return;
+  }
+  Atomic<size_t> next_chunk(0u);
+  for (size_t i = 0; i < num_workers; ++i) {
+    thread_pool->AddTask(self, new ParallelChunkTask(&chunks, &next_chunk, i));
+  }
+  thread_pool->SetMaxActiveWorkers(num_workers - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, /* do_work= */ true, /* may_hold_locks= */ true);
+  thread_pool->StopWorkers(self);
+}
+
 void Heap::AddSpace(space::Space* space) {
   CHECK(space != nullptr);
   // marvin start
@@ -1290,6 +1368,16 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
     rosalloc_space_->DumpStats(os);
   }
 
+  if (large_object_space_ != nullptr) {
+    std::ostringstream los_fragmentation;
+    large_object_space_->DumpFragmentation(los_fragmentation);
+    if (!los_fragmentation.str().empty()) {
+      os << "Large object space: " << los_fragmentation.str() << "\n";
+    }
+  }
+
+  DumpTlabSizingStats(os);
+
   os << "Native bytes total: " << GetNativeBytes()
      << " registered: " << native_bytes_registered_.load(std::memory_order_relaxed) << "\n";
 
@@ -1487,23 +1575,22 @@ void Heap::ThrowOutOfMemoryError(Thread* self, size_t byte_count, AllocatorType
     } else if (allocator_type == kAllocatorTypeRegion ||
                allocator_type == kAllocatorTypeRegionTLAB) {
       space = region_space_;
+    } else if (allocator_type == kAllocatorTypeLOS) {
+      space = large_object_space_;
     }
 
-    // There is no fragmentation info to log for large-object space.
-    if (allocator_type != kAllocatorTypeLOS) {
-      CHECK(space != nullptr) << "allocator_type:" << allocator_type
-                              << " byte_count:" << byte_count
-                              << " total_bytes_free:" << total_bytes_free;
-      // LogFragmentationAllocFailure returns true if byte_count is greater than
-      // the largest free contiguous chunk in the space. Return value false
-      // means that we are throwing OOME because the amount of free heap after
-      // GC is less than kMinFreeHeapAfterGcForAlloc in proportion of the heap-size.
-      // Log an appropriate message in that case.
-      if (!space->LogFragmentationAllocFailure(oss, byte_count)) {
-        oss << "; giving up on allocation because <"
-            << kMinFreeHeapAfterGcForAlloc * 100
-            << "% of heap free after GC.";
-      }
+    CHECK(space != nullptr) << "allocator_type:" << allocator_type
+                            << " byte_count:" << byte_count
+                            << " total_bytes_free:" << total_bytes_free;
+    // LogFragmentationAllocFailure returns true if byte_count is greater than
+    // the largest free contiguous chunk in the space. Return value false
+    // means that we are throwing OOME because the amount of free heap after
+    // GC is less than kMinFreeHeapAfterGcForAlloc in proportion of the heap-size.
+    // Log an appropriate message in that case.
+    if (!space->LogFragmentationAllocFailure(oss, byte_count)) {
+      oss << "; giving up on allocation because <"
+          << kMinFreeHeapAfterGcForAlloc * 100
+          << "% of heap free after GC.";
     }
   }
   self->ThrowOutOfMemoryError(oss.str().c_str());
@@ -1515,6 +1602,7 @@ void Heap::DoPendingCollectorTransition() {
   if (desired_collector_type == kCollectorTypeHomogeneousSpaceCompact) {
     if (!CareAboutPauseTimes()) {
       PerformHomogeneousSpaceCompact();
+      CompactLargeObjectSpace(Thread::Current());
     } else {
       VLOG(gc) << "Homogeneous compaction ignored due to jank perceptible process state";
     }
@@ -1525,6 +1613,7 @@ void Heap::DoPendingCollectorTransition() {
       CollectGarbageInternal(collector::kGcTypeFull,
                              kGcCauseCollectorTransition,
                              /*clear_soft_references=*/false, GC_NUM_ANY);
+      CompactLargeObjectSpace(Thread::Current());
       // jiacheng start
       LOG(INFO) << "jiacheng debug heap.cc 1443 DoPendingCollectorTransition()";
       niel::swap::CreateStubsAndSwapOut();
@@ -2080,14 +2169,21 @@ static bool MatchesClass(mirror::Object* obj,
 void Heap::CountInstances(const std::vector<Handle<mirror::Class>>& classes,
                           bool use_is_assignable_from,
                           uint64_t* counts) {
-  auto instance_counter = [&](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+  // One row of counts per worker, summed once the visit is done.
+  std::vector<uint64_t> worker_counts(GetParallelVisitWorkerCount() * classes.size(), 0u);
+  auto instance_counter = [&](size_t worker_index, mirror::Object* obj)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    uint64_t* row = &worker_counts[worker_index * classes.size()];
     for (size_t i = 0; i < classes.size(); ++i) {
       if (MatchesClass(obj, classes[i], use_is_assignable_from)) {
-        ++counts[i];
+        ++row[i];
       }
     }
   };
-  VisitObjects(instance_counter);
+  VisitObjectsParallel(instance_counter);
+  for (size_t i = 0; i < worker_counts.size(); ++i) {
+    counts[i % classes.size()] += worker_counts[i];
+  }
 }
 
 void Heap::CollectGarbage(bool clear_soft_references, GcCause cause) {
@@ -2181,6 +2277,181 @@ HomogeneousSpaceCompactResult Heap::PerformHomogeneousSpaceCompact() {
   return HomogeneousSpaceCompactResult::kSuccess;
 }
 
+// Forwards references to the large objects moved by Heap::CompactLargeObjectSpace(). Forwarding
+// a reference twice is harmless, see FreeListSpace::ComputeCompaction().
+class LargeObjectForwardingVisitor : public RootVisitor, public IsMarkedVisitor {
+ public:
+  explicit LargeObjectForwardingVisitor(const space::FreeListSpace::ForwardingTable& forwarding)
+      : forwarding_(forwarding) {}
+
+  mirror::Object* Forward(mirror::Object* obj) const {
+    mirror::Object* new_obj = space::FreeListSpace::GetForwardingAddress(forwarding_, obj);
+    return new_obj != nullptr ? new_obj : obj;
+  }
+
+  void UpdateRoot(mirror::CompressedReference<mirror::Object>* root) const
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    mirror::Object* ref = root->AsMirrorPtr();
+    mirror::Object* new_ref = Forward(ref);
+    if (new_ref != ref) {
+      root->Assign(new_ref);
+    }
+  }
+
+  void VisitRoots(mirror::Object*** roots, size_t count, const RootInfo& info ATTRIBUTE_UNUSED)
+      override REQUIRES_SHARED(Locks::mutator_lock_) {
+    for (size_t i = 0; i < count; ++i) {
+      *roots[i] = Forward(*roots[i]);
+    }
+  }
+
+  void VisitRoots(mirror::CompressedReference<mirror::Object>** roots,
+                  size_t count,
+                  const RootInfo& info ATTRIBUTE_UNUSED)
+      override REQUIRES_SHARED(Locks::mutator_lock_) {
+    for (size_t i = 0; i < count; ++i) {
+      UpdateRoot(roots[i]);
+    }
+  }
+
+  mirror::Object* IsMarked(mirror::Object* obj) override {
+    return Forward(obj);
+  }
+
+ private:
+  const space::FreeListSpace::ForwardingTable& forwarding_;
+};
+
+// Updates the reference fields and native roots of an object for the moved large objects.
+class LargeObjectReferenceFieldVisitor {
+ public:
+  explicit LargeObjectReferenceFieldVisitor(const LargeObjectForwardingVisitor* forwarding)
+      : forwarding_(forwarding) {}
+
+  void operator()(ObjPtr<mirror::Object> obj,
+                  MemberOffset offset,
+                  bool is_static ATTRIBUTE_UNUSED) const REQUIRES_SHARED(Locks::mutator_lock_) {
+    mirror::HeapReference<mirror::Object>* field =
+        obj->GetFieldObjectReferenceAddr<kVerifyNone>(offset);
+    mirror::Object* ref = field->AsMirrorPtr();
+    mirror::Object* new_ref = forwarding_->Forward(ref);
+    if (new_ref != ref) {
+      field->Assign(new_ref);
+      WriteBarrier::ForFieldWrite(obj, offset, new_ref);
+    }
+  }
+
+  void operator()(ObjPtr<mirror::Class> klass ATTRIBUTE_UNUSED,
+                  ObjPtr<mirror::Reference> ref) const REQUIRES_SHARED(Locks::mutator_lock_) {
+    (*this)(ref, mirror::Reference::ReferentOffset(), /*is_static=*/ false);
+  }
+
+  void VisitRootIfNonNull(mirror::CompressedReference<mirror::Object>* root) const
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    if (!root->IsNull()) {
+      VisitRoot(root);
+    }
+  }
+
+  void VisitRoot(mirror::CompressedReference<mirror::Object>* root) const
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    forwarding_->UpdateRoot(root);
+  }
+
+ private:
+  const LargeObjectForwardingVisitor* const forwarding_;
+};
+
+bool Heap::CompactLargeObjectSpace(Thread* self) {
+  if (!IsLargeObjectSpaceCompactionEnabled()) {
+    return false;
+  }
+  space::FreeListSpace* const los = down_cast<space::FreeListSpace*>(large_object_space_);
+  const size_t hole_bytes = los->GetHoleBytes();
+  if (hole_bytes < kMinLargeObjectSpaceCompactionBytes ||
+      hole_bytes < large_object_space_compaction_threshold_ * los->GetUsedExtent()) {
+    return false;
+  }
+  ScopedTrace trace(__FUNCTION__);
+  ScopedThreadStateChange tsc(self, kWaitingPerformingGc);
+  ScopedGCCriticalSection gcs(self,
+                              kGcCauseLargeObjectSpaceCompaction,
+                              kCollectorTypeLargeObjectSpaceCompaction);
+  if (Runtime::Current()->IsShuttingDown(self)) {
+    return false;
+  }
+  // JNI critical sections hold raw pointers into movable objects, see jni_internal.cc. With read
+  // barriers they block thread flips, otherwise they disable moving GC.
+  if (kUseReadBarrier) {
+    ThreadFlipBegin(self);
+  } else {
+    MutexLock mu(self, *gc_complete_lock_);
+    if (disable_moving_gc_count_ != 0) {
+      return false;
+    }
+  }
+  const uint64_t start_time = NanoTime();
+  size_t moved_objects;
+  {
+    ScopedSuspendAll ssa(__FUNCTION__);
+    space::FreeListSpace::ForwardingTable forwarding = los->ComputeCompaction();
+    if (!forwarding.empty()) {
+      UpdateLargeObjectReferences(self, forwarding);
+      los->Compact(self, forwarding);
+    }
+    moved_objects = forwarding.size();
+  }
+  if (kUseReadBarrier) {
+    ThreadFlipEnd(self);
+  }
+  if (VLOG_IS_ON(gc)) {
+    std::ostringstream fragmentation;
+    los->DumpFragmentation(fragmentation);
+    LOG(INFO) << "Large object space compaction moved " << moved_objects << " objects, "
+              << PrettySize(hole_bytes) << " in holes before, paused "
+              << PrettyDuration(NanoTime() - start_time) << ", " << fragmentation.str();
+  }
+  return moved_objects != 0;
+}
+
+void Heap::UpdateLargeObjectReferences(Thread* self,
+                                       const space::FreeListSpace::ForwardingTable& forwarding) {
+  // Thread local allocation stacks are ranges of allocation_stack_, give them back so that all of
+  // allocation_stack_ can be updated.
+  RevokeAllThreadLocalAllocationStacks(self);
+  LargeObjectForwardingVisitor forwarding_visitor(forwarding);
+  LargeObjectReferenceFieldVisitor field_visitor(&forwarding_visitor);
+  VisitObjectsPaused([&](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+    if (obj->GetStubFlag()) {
+      // Stubs of swapped out objects keep their references outside of any object field.
+      niel::swap::Stub* stub = reinterpret_cast<niel::swap::Stub*>(obj);
+      for (int i = 0; i < stub->GetNumRefs(); ++i) {
+        mirror::Object* ref = stub->GetReference(i);
+        mirror::Object* new_ref = forwarding_visitor.Forward(ref);
+        if (new_ref != ref) {
+          stub->SetReference(i, new_ref);
+        }
+      }
+    } else {
+      obj->VisitReferences</*kVisitNativeRoots=*/ true, kVerifyNone, kWithoutReadBarrier>(
+          field_visitor, field_visitor);
+    }
+  });
+  Runtime* const runtime = Runtime::Current();
+  runtime->VisitRoots(&forwarding_visitor);
+  runtime->SweepSystemWeaks(&forwarding_visitor);
+  for (accounting::ObjectStack* stack : { allocation_stack_.get(), live_stack_.get() }) {
+    for (StackReference<mirror::Object>* it = stack->Begin(); it != stack->End(); ++it) {
+      forwarding_visitor.UpdateRoot(it);
+    }
+  }
+  // Let the swap bookkeeping follow the objects, the same way the copying collectors do.
+  for (const auto& [from, to] : forwarding) {
+    niel::swap::RecordForwardedObject(self, from, to);
+  }
+  niel::swap::ConcurrentCopyingUpdateDataStructures(self);
+}
+
 void Heap::ChangeCollector(CollectorType collector_type) {
   // TODO: Only do this with all mutators suspended to avoid races.
   if (collector_type != collector_type_) {
@@ -2805,11 +3076,33 @@ void Heap::LogGC(GcCause gc_cause, collector::GarbageCollector* collector) {
               << PrettySize(current_gc_iteration_.GetFreedLargeObjectBytes()) << ") LOS objects, "
               << percent_free << "% free, " << PrettySize(current_heap_size) << "/"
               << PrettySize(total_memory) << ", " << "paused " << pause_string.str()
-              << " total " << PrettyDuration((duration / 1000) * 1000);
+              << " total " << PrettyDuration((duration / 1000) * 1000)
+              << GetGrowthPredictionString();
     VLOG(heap) << Dumpable<TimingLogger>(*current_gc_iteration_.GetTimings());
   }
 }
 
+std::string Heap::GetGrowthPredictionString() {
+  if (!UsePredictiveGrowth()) {
+    return "";
+  }
+  MutexLock mu(Thread::Current(), process_state_update_lock_);
+  if (growth_predicted_free_ == 0u) {
+    return "";
+  }
+  std::ostringstream oss;
+  oss << ", predicted free " << PrettySize(growth_predicted_free_)
+      << " (default " << PrettySize(growth_default_free_) << ")";
+  if (has_growth_alloc_rate_) {
+    oss << " for " << PrettySize(static_cast<uint64_t>(growth_alloc_rate_ * 1e9)) << "/s"
+        << ", GC " << PrettyDuration(static_cast<uint64_t>(growth_gc_cost_ns_))
+        << ", paused " << PrettyDuration(static_cast<uint64_t>(growth_pause_ns_));
+  } else {
+    oss << " without an allocation rate";
+  }
+  return oss.str();
+}
+
 void Heap::FinishGC(Thread* self, collector::GcType gc_type) {
   MutexLock mu(self, *gc_complete_lock_);
   collector_type_running_ = kCollectorTypeNone;
@@ -3139,14 +3432,22 @@ size_t Heap::VerifyHeapReferences(bool verify_referents) {
   // Since we sorted the allocation stack content, need to revoke all
   // thread-local allocation stacks.
   RevokeAllThreadLocalAllocationStacks(self);
-  size_t fail_count = 0;
-  VerifyObjectVisitor visitor(self, this, &fail_count, verify_referents);
   // Verify objects in the allocation stack since these will be objects which were:
   // 1. Allocated prior to the GC (pre GC verification).
   // 2. Allocated during the GC (pre sweep GC verification).
   // We don't want to verify the objects in the live stack since they themselves may be
   // pointing to dead objects if they are not reachable.
-  VisitObjectsPaused(visitor);
+  // The failure count of a visitor is private to its thread, so give each worker its own.
+  std::vector<size_t> worker_fail_counts(GetParallelVisitWorkerCount(), 0u);
+  VisitObjectsPausedParallel([&](size_t worker_index, mirror::Object* obj)
+                                 REQUIRES_SHARED(Locks::mutator_lock_) {
+    VerifyObjectVisitor worker_visitor(
+        Thread::Current(), this, &worker_fail_counts[worker_index], verify_referents);
+    worker_visitor(obj);
+  });
+  size_t fail_count = std::accumulate(
+      worker_fail_counts.begin(), worker_fail_counts.end(), static_cast<size_t>(0u));
+  VerifyObjectVisitor visitor(self, this, &fail_count, verify_referents);
   // Verify the roots:
   visitor.VerifyRoots();
   if (visitor.GetFailureCount() > 0) {
@@ -3578,9 +3879,11 @@ bool Heap::IsMovableObject(ObjPtr<mirror::Object> obj) const {
   if (kMovingCollector) {
     space::Space* space = FindContinuousSpaceFromObject(obj.Ptr(), true);
     if (space != nullptr) {
-      // TODO: Check large object?
       return space->CanMoveObjects();
     }
+    if (IsLargeObjectSpaceCompactionEnabled() && large_object_space_->Contains(obj.Ptr())) {
+      return !down_cast<space::FreeListSpace*>(large_object_space_)->IsPinnedObject(obj.Ptr());
+    }
   }
   return false;
 }
@@ -3613,8 +3916,13 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran,
   uint64_t target_size, grow_bytes;
   collector::GcType gc_type = collector_ran->GetGcType();
   MutexLock mu(Thread::Current(), process_state_update_lock_);
+  if (UsePredictiveGrowth()) {
+    UpdateGrowthEstimates(bytes_allocated, bytes_allocated_before_gc);
+    // Only non sticky GCs predict, don't let LogGC() report an older prediction.
+    growth_predicted_free_ = 0u;
+  }
   // Use the multiplier to grow more for foreground.
-  const double multiplier = HeapGrowthMultiplier();
+  double multiplier = HeapGrowthMultiplier();
   if (gc_type != collector::kGcTypeSticky) {
     // Grow the heap for non sticky GC.
     uint64_t delta = bytes_allocated * (1.0 / GetTargetHeapUtilization() - 1.0);
@@ -3622,6 +3930,12 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran,
         << " target_utilization_=" << target_utilization_;
     grow_bytes = std::min(delta, static_cast<uint64_t>(max_free_));
     grow_bytes = std::max(grow_bytes, static_cast<uint64_t>(min_free_));
+    if (UsePredictiveGrowth()) {
+      // The controller accounts for the allocation rate itself, which is what the foreground
+      // multiplier approximates.
+      grow_bytes = PredictGrowBytes(static_cast<size_t>(grow_bytes * multiplier));
+      multiplier = 1.0;
+    }
     target_size = bytes_allocated + static_cast<uint64_t>(grow_bytes * multiplier);
     next_gc_type_ = collector::kGcTypeSticky;
   } else {
@@ -3670,7 +3984,7 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran,
     // target_size = 0 ensures that target_footprint_ is not updated on
     // process-state switch.
     min_foreground_target_footprint_ =
-        (multiplier <= 1.0 && grow_bytes > 0)
+        (multiplier <= 1.0 && grow_bytes > 0 && !UsePredictiveGrowth())
         ? bytes_allocated + static_cast<size_t>(grow_bytes * foreground_heap_growth_multiplier_)
         : 0;
 
@@ -3704,6 +4018,70 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran,
   }
 }
 
+void Heap::UpdateGrowthEstimates(size_t bytes_allocated, size_t bytes_allocated_before_gc) {
+  const uint64_t now = NanoTime();
+  const uint64_t gc_duration = current_gc_iteration_.GetDurationNs();
+  uint64_t pause_time = 0;
+  for (uint64_t pause : current_gc_iteration_.GetPauseTimes()) {
+    pause_time += pause;
+  }
+  // Rising estimates are taken as is so that a burst of allocation is accounted for by the very
+  // next GC, falling ones decay so that a single quiet period does not shrink the heap at once.
+  auto update = [](double estimate, double sample) {
+    return sample >= estimate ? sample : (estimate + sample) / 2.0;
+  };
+  const uint64_t gc_start = now - std::min(now, gc_duration);
+  if (last_growth_update_ns_ != 0u &&
+      gc_start > last_growth_update_ns_ &&
+      bytes_allocated_before_gc >= last_growth_update_bytes_) {
+    const double rate = static_cast<double>(bytes_allocated_before_gc - last_growth_update_bytes_) /
+        (gc_start - last_growth_update_ns_);
+    growth_alloc_rate_ = has_growth_alloc_rate_ ? update(growth_alloc_rate_, rate) : rate;
+    has_growth_alloc_rate_ = true;
+  }
+  growth_gc_cost_ns_ = update(growth_gc_cost_ns_, gc_duration);
+  growth_pause_ns_ = update(growth_pause_ns_, pause_time);
+  last_growth_update_ns_ = now;
+  last_growth_update_bytes_ = bytes_allocated;
+}
+
+size_t Heap::PredictGrowBytes(size_t default_grow_bytes) {
+  growth_default_free_ = default_grow_bytes;
+  // The first GC has nothing to measure the allocation rate against.
+  growth_predicted_free_ = !has_growth_alloc_rate_
+      ? default_grow_bytes
+      : ComputePredictiveGrowBytes(growth_alloc_rate_,
+                                   growth_gc_cost_ns_,
+                                   growth_pause_ns_,
+                                   gc_target_cpu_fraction_,
+                                   gc_target_pause_fraction_,
+                                   min_free_,
+                                   capacity_);
+  return growth_predicted_free_;
+}
+
+size_t Heap::ComputePredictiveGrowBytes(double alloc_rate,
+                                        double gc_cost_ns,
+                                        double pause_ns,
+                                        double target_cpu_fraction,
+                                        double target_pause_fraction,
+                                        size_t min_free,
+                                        size_t max_free) {
+  // With F free bytes after a GC, GCs are F / rate apart. Each one costs gc_cost_ns of collector
+  // time and pause_ns of pauses, so keeping their share of wall time under the targets requires
+  // F >= cost * rate / target.
+  double free_bytes = 0.0;
+  if (target_cpu_fraction > 0.0) {
+    free_bytes = gc_cost_ns * alloc_rate / target_cpu_fraction;
+  }
+  if (target_pause_fraction > 0.0) {
+    free_bytes = std::max(free_bytes, pause_ns * alloc_rate / target_pause_fraction);
+  }
+  // Never leave less than min_free, and let SetIdealFootprint() clamp to the growth limit.
+  return std::max(static_cast<size_t>(std::min(free_bytes, static_cast<double>(max_free))),
+                  min_free);
+}
+
 void Heap::ClampGrowthLimit() {
   // Use heap bitmap lock to guard against races with BindLiveToMarkBitmap.
   ScopedObjectAccess soa(Thread::Current());
@@ -4362,6 +4740,76 @@ void Heap::RemoveGcPauseListener() {
   gc_pause_listener_.store(nullptr, std::memory_order_relaxed);
 }
 
+size_t Heap::NextTlabSize(Thread* self) {
+  static_assert(IsPowerOfTwo(kMinAdaptiveTlabSize) && IsPowerOfTwo(kMaxAdaptiveTlabSize),
+                "TLAB sizes are doubled and rounded to a power of two");
+  static_assert(kMaxAdaptiveTlabSize <= space::RegionSpace::kRegionSize,
+                "A region TLAB cannot be larger than a region");
+  Thread::TlabSizingStats* stats = self->GetTlabSizingStats();
+  const uint32_t gc_num = GetCurrentGcNum();
+  if (stats->tlab_size == 0u) {
+    stats->tlab_size = kPartialTlabSize;
+    stats->gc_num = gc_num;
+  } else if (stats->gc_num != gc_num) {
+    // One or more GCs completed since the last refill. What the thread allocated per cycle in
+    // the meantime estimates its allocation rate times the GC cycle length.
+    const size_t cycles = gc_num - stats->gc_num;
+    const size_t bytes_per_refill = stats->cycle_bytes / cycles / kTargetTlabRefillsPerGc;
+    stats->tlab_size = std::clamp(RoundUpToPowerOfTwo(std::max<size_t>(bytes_per_refill, 1u)),
+                                  kMinAdaptiveTlabSize,
+                                  kMaxAdaptiveTlabSize);
+    stats->gc_num = gc_num;
+    stats->cycle_bytes = 0u;
+    stats->cycle_refills = 0u;
+  } else if (stats->cycle_refills >= kTargetTlabRefillsPerGc &&
+             stats->tlab_size < kMaxAdaptiveTlabSize) {
+    // Allocating faster than during the last cycle.
+    stats->tlab_size *= 2;
+    stats->cycle_refills = 0u;
+  }
+  return stats->tlab_size;
+}
+
+void Heap::RecordTlabRefill(Thread* self, size_t granted_bytes) {
+  Thread::TlabSizingStats* stats = self->GetTlabSizingStats();
+  ++stats->cycle_refills;
+  ++stats->total_refills;
+  stats->cycle_bytes += granted_bytes;
+  stats->total_bytes += granted_bytes;
+}
+
+void Heap::DumpTlabSizingStats(std::ostream& os) {
+  if (region_space_ == nullptr || !kUsePartialTlabs) {
+    return;
+  }
+  size_t num_threads = 0;
+  uint64_t total_refills = 0;
+  uint64_t total_bytes = 0;
+  std::ostringstream per_thread;
+  {
+    MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
+    Runtime::Current()->GetThreadList()->ForEach([&](Thread* thread) {
+      const Thread::TlabSizingStats* stats = thread->GetTlabSizingStats();
+      if (stats->total_refills == 0u) {
+        return;
+      }
+      ++num_threads;
+      total_refills += stats->total_refills;
+      total_bytes += stats->total_bytes;
+      per_thread << "  tid=" << thread->GetTid()
+                 << " tlab size=" << PrettySize(stats->tlab_size)
+                 << " refills=" << stats->total_refills
+                 << " bytes=" << PrettySize(stats->total_bytes) << "\n";
+    });
+  }
+  if (num_threads == 0u) {
+    return;
+  }
+  os << "TLAB sizing: " << num_threads << " threads, " << total_refills << " refills, "
+     << "mean refill " << PrettySize(total_bytes / total_refills) << "\n"
+     << per_thread.str();
+}
+
 mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
                                        AllocatorType allocator_type,
                                        size_t alloc_size,
@@ -4379,7 +4827,7 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
     // TLAB bytes.
     const size_t min_expand_size = alloc_size - self->TlabSize();
     size_t next_tlab_size = JHPCalculateNextTlabSize(self,
-                                                     kPartialTlabSize,
+                                                     NextTlabSize(self),
                                                      alloc_size,
                                                      &take_sample,
                                                      &bytes_until_sample);
@@ -4391,6 +4839,7 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
     }
     *bytes_tl_bulk_allocated = expand_bytes;
     self->ExpandTlab(expand_bytes);
+    RecordTlabRefill(self, expand_bytes);
     DCHECK_LE(alloc_size, self->TlabSize());
   } else if (allocator_type == kAllocatorTypeTLAB) {
     DCHECK(bump_pointer_space_ != nullptr);
@@ -4421,7 +4870,7 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
                                             space::RegionSpace::kRegionSize,
                                             grow))) {
         size_t def_pr_tlab_size = kUsePartialTlabs
-                                      ? kPartialTlabSize
+                                      ? NextTlabSize(self)
                                       : gc::space::RegionSpace::kRegionSize;
         size_t next_pr_tlab_size = JHPCalculateNextTlabSize(self,
                                                             def_pr_tlab_size,
@@ -4441,6 +4890,9 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
           JHPCheckNonTlabSampleAllocation(self, ret, alloc_size);
           return ret;
         }
+        if (kUsePartialTlabs) {
+          RecordTlabRefill(self, self->TlabSize());
+        }
         // Fall-through to using the TLAB below.
       } else {
         // Check OOME for a non-tlab allocation.
@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_GC_HEAP_H_
 #define ART_RUNTIME_GC_HEAP_H_
 
+#include <functional>
 #include <iosfwd>
 #include <string>
 #include <unordered_set>
@@ -77,6 +78,8 @@ class Verification;
 namespace accounting {
 template <typename T> class AtomicStack;
 typedef AtomicStack<mirror::Object> ObjectStack;
+template <typename T> class SegmentedStack;
+typedef SegmentedStack<mirror::Object> SegmentedObjectStack;
 class CardTable;
 class HeapBitmap;
 class ModUnionTable;
@@ -132,6 +135,11 @@ class Heap {
   // How much we grow the TLAB if we can do it.
   static constexpr size_t kPartialTlabSize = 16 * KB;
   static constexpr bool kUsePartialTlabs = true;
+  // Bounds of the adaptive region TLAB size, see NextTlabSize().
+  static constexpr size_t kMinAdaptiveTlabSize = 4 * KB;
+  static constexpr size_t kMaxAdaptiveTlabSize = 256 * KB;
+  // Number of TLAB refills a thread should need between two GCs.
+  static constexpr size_t kTargetTlabRefillsPerGc = 8;
 
   // marvin start
   std::vector<space::Space*> nielinst_spaces_;
@@ -152,9 +160,16 @@ class Heap {
   static constexpr size_t kDefaultTLABSize = 32 * KB;
   static constexpr double kDefaultTargetUtilization = 0.75;
   static constexpr double kDefaultHeapGrowthMultiplier = 2.0;
+  // Predictive heap growth is off unless a GC CPU or pause time target is set.
+  static constexpr double kDefaultGcTargetCpuFraction = 0.0;
+  static constexpr double kDefaultGcTargetPauseFraction = 0.0;
   // Primitive arrays larger than this size are put in the large object space.
   static constexpr size_t kMinLargeObjectThreshold = 3 * kPageSize;
   static constexpr size_t kDefaultLargeObjectThreshold = kMinLargeObjectThreshold;
+  // Compaction of the free list large object space is off unless a threshold is set.
+  static constexpr double kDefaultLargeObjectSpaceCompactionThreshold = 0.0;
+  // Do not compact the large object space for less than this many bytes in holes.
+  static constexpr size_t kMinLargeObjectSpaceCompactionBytes = 1 * MB;
   // Whether or not parallel GC is enabled. If not, then we never create the thread pool.
   static constexpr bool kDefaultEnableParallelGC = false;
   static uint8_t* const kPreferredAllocSpaceBegin;
@@ -202,6 +217,8 @@ class Heap {
        size_t max_free,
        double target_utilization,
        double foreground_heap_growth_multiplier,
+       double gc_target_cpu_fraction,
+       double gc_target_pause_fraction,
        size_t stop_for_native_allocs,
        size_t capacity,
        size_t non_moving_space_capacity,
@@ -213,6 +230,7 @@ class Heap {
        CollectorType background_collector_type,
        space::LargeObjectSpaceType large_object_space_type,
        size_t large_object_threshold,
+       double large_object_space_compaction_threshold,
        size_t parallel_gc_threads,
        size_t conc_gc_threads,
        bool low_memory_mode,
@@ -312,6 +330,30 @@ class Heap {
   ALWAYS_INLINE void VisitObjectsPaused(Visitor&& visitor)
       REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
 
+  // Visit all of the live objects in the heap using the heap thread pool. The visitor is called
+  // as `visitor(worker_index, obj)` concurrently from several threads, in no particular order;
+  // `worker_index` is below GetParallelVisitWorkerCount() and no two threads use the same index
+  // at the same time, so it can be used to select per-worker state without locking. Only
+  // heaps with a concurrent moving collector, which already suspend all threads for the visit,
+  // are walked in parallel; others are walked serially on the calling thread as worker 0.
+  template <typename Visitor>
+  void VisitObjectsParallel(Visitor&& visitor)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!Locks::heap_bitmap_lock_, !*gc_complete_lock_);
+  template <typename Visitor>
+  void VisitObjectsPausedParallel(Visitor&& visitor)
+      REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
+
+  // Upper bound (exclusive) of the worker indices passed by VisitObjectsParallel().
+  size_t GetParallelVisitWorkerCount() const;
+
+  // Run `chunks` on the heap thread pool with up to `num_workers` threads, counting the calling
+  // thread, and pass each chunk the index of the worker running it. Only the thread running the
+  // GC (or a thread that has suspended it) may use the thread pool.
+  void RunParallelChunks(Thread* self,
+                         size_t num_workers,
+                         const std::vector<std::function<void(size_t)>>& chunks);
+
   void VisitReflectiveTargets(ReflectiveValueVisitor* visitor)
       REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
 
@@ -640,7 +682,7 @@ class Heap {
   std::string DumpSpaceNameFromAddress(const void* addr) const
       REQUIRES_SHARED(Locks::mutator_lock_);
 
-  void DumpForSigQuit(std::ostream& os) REQUIRES(!*gc_complete_lock_);
+  void DumpForSigQuit(std::ostream& os) REQUIRES(!*gc_complete_lock_, !Locks::thread_list_lock_);
 
   // Do a pending collector transition.
   void DoPendingCollectorTransition()
@@ -765,7 +807,7 @@ class Heap {
 
   // GC performance measuring
   void DumpGcPerformanceInfo(std::ostream& os)
-      REQUIRES(!*gc_complete_lock_);
+      REQUIRES(!*gc_complete_lock_, !Locks::thread_list_lock_);
   void ResetGcPerformanceInfo() REQUIRES(!*gc_complete_lock_);
 
   // Thread pool.
@@ -956,6 +998,10 @@ class Heap {
   // Create a new alloc space and compact default alloc space to it.
   HomogeneousSpaceCompactResult PerformHomogeneousSpaceCompact()
       REQUIRES(!*gc_complete_lock_, !process_state_update_lock_);
+  // Slide the large objects together if enough of the large object space is lost to holes
+  // between them, see -XX:LargeObjectSpaceCompactionThreshold. Returns true if objects moved.
+  bool CompactLargeObjectSpace(Thread* self)
+      REQUIRES(!*gc_complete_lock_, !Locks::mutator_lock_, !*thread_flip_lock_);
   bool SupportHomogeneousSpaceCompactAndCollectorTransitions() const;
 
   // Install an allocation listener.
@@ -994,7 +1040,8 @@ class Heap {
                                        GcCause gc_cause)
       REQUIRES(Locks::mutator_lock_);
 
-  void LogGC(GcCause gc_cause, collector::GarbageCollector* collector);
+  void LogGC(GcCause gc_cause, collector::GarbageCollector* collector)
+      REQUIRES(!process_state_update_lock_);
   void StartGC(Thread* self, GcCause cause, CollectorType collector_type)
       REQUIRES(!*gc_complete_lock_);
   void FinishGC(Thread* self, collector::GcType gc_type) REQUIRES(!*gc_complete_lock_);
@@ -1042,8 +1089,16 @@ class Heap {
         collector_type == kCollectorTypeCC ||
         collector_type == kCollectorTypeSS ||
         collector_type == kCollectorTypeCCBackground ||
-        collector_type == kCollectorTypeHomogeneousSpaceCompact;
+        collector_type == kCollectorTypeHomogeneousSpaceCompact ||
+        collector_type == kCollectorTypeLargeObjectSpaceCompaction;
   }
+  bool IsLargeObjectSpaceCompactionEnabled() const {
+    return large_object_space_compaction_threshold_ > 0.0;
+  }
+  // Update all references to the large objects moved by CompactLargeObjectSpace().
+  void UpdateLargeObjectReferences(Thread* self,
+                                   const space::FreeListSpace::ForwardingTable& forwarding)
+      REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
   bool ShouldAllocLargeObject(ObjPtr<mirror::Class> c, size_t byte_count) const
       REQUIRES_SHARED(Locks::mutator_lock_);
 
@@ -1053,7 +1108,7 @@ class Heap {
   void CheckGCForNative(Thread* self)
       REQUIRES(!*pending_task_lock_, !*gc_complete_lock_, !process_state_update_lock_);
 
-  accounting::ObjectStack* GetMarkStack() {
+  accounting::SegmentedObjectStack* GetMarkStack() {
     return mark_stack_.get();
   }
 
@@ -1105,6 +1160,15 @@ class Heap {
                                               size_t* bytes_tl_bulk_allocated)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Return the size of the next region TLAB (or TLAB expansion) for `self`. The size is picked
+  // so that a thread allocating as much as during the last GC cycle refills its TLAB about
+  // kTargetTlabRefillsPerGc times per cycle, and is doubled when the thread refills faster.
+  // Does not count the refill, callers may clamp the size or fail to get a TLAB.
+  size_t NextTlabSize(Thread* self);
+  // Account a successful TLAB refill (or expansion) of `granted_bytes` for the sizing above.
+  void RecordTlabRefill(Thread* self, size_t granted_bytes);
+  void DumpTlabSizingStats(std::ostream& os) REQUIRES(!Locks::thread_list_lock_);
+
   mirror::Object* AllocWithNewTLAB(Thread* self,
                                    AllocatorType allocator_type,
                                    size_t alloc_size,
@@ -1197,6 +1261,29 @@ class Heap {
                           size_t bytes_allocated_before_gc = 0)
       REQUIRES(!process_state_update_lock_);
 
+  // Update the allocation rate, GC cost and pause estimates of the predictive growth controller
+  // with the GC that just completed.
+  void UpdateGrowthEstimates(size_t bytes_allocated, size_t bytes_allocated_before_gc)
+      REQUIRES(process_state_update_lock_);
+  // Return the free bytes to leave after a non sticky GC so that, at the estimated allocation
+  // rate, GCs take at most the target fraction of CPU and pause time. Returns
+  // `default_grow_bytes` until the allocation rate has been measured.
+  size_t PredictGrowBytes(size_t default_grow_bytes) REQUIRES(process_state_update_lock_);
+  // The formula behind PredictGrowBytes(), with the rate in bytes per ns, clamped to
+  // [min_free, max_free] with min_free taking precedence.
+  static size_t ComputePredictiveGrowBytes(double alloc_rate,
+                                           double gc_cost_ns,
+                                           double pause_ns,
+                                           double target_cpu_fraction,
+                                           double target_pause_fraction,
+                                           size_t min_free,
+                                           size_t max_free);
+  bool UsePredictiveGrowth() const {
+    return gc_target_cpu_fraction_ > 0.0 || gc_target_pause_fraction_ > 0.0;
+  }
+  // The last prediction and the inputs behind it, appended to the LogGC() line.
+  std::string GetGrowthPredictionString() REQUIRES(!process_state_update_lock_);
+
   size_t GetPercentFree();
 
   // Swap the allocation stack with the live stack.
@@ -1246,6 +1333,12 @@ class Heap {
   template <typename Visitor>
   ALWAYS_INLINE void VisitObjectsInternalRegionSpace(Visitor&& visitor)
       REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
+  template <typename Visitor>
+  void VisitObjectsInternalParallel(Visitor&& visitor)
+      REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
+  template <typename Visitor>
+  ALWAYS_INLINE void VisitAllocationStack(Visitor&& visitor)
+      REQUIRES_SHARED(Locks::mutator_lock_);
 
   void UpdateGcCountRateHistograms() REQUIRES(gc_complete_lock_);
 
@@ -1382,6 +1475,10 @@ class Heap {
   // Minimum allocation size of large object.
   size_t large_object_threshold_;
 
+  // Fraction of the used large object space that has to be in holes before it is compacted, zero
+  // if it is never compacted.
+  double large_object_space_compaction_threshold_;
+
   // Guards access to the state of GC, associated conditional variable is used to signal when a GC
   // completes.
   Mutex* gc_complete_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
@@ -1433,6 +1530,25 @@ class Heap {
   Mutex process_state_update_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   size_t min_foreground_target_footprint_ GUARDED_BY(process_state_update_lock_);
 
+  // Targets of the predictive growth controller, as fractions of wall time spent collecting and
+  // paused. When either is set it replaces the min/max free and growth multiplier policy.
+  const double gc_target_cpu_fraction_;
+  const double gc_target_pause_fraction_;
+  // Smoothed estimates used by the predictive growth controller: mutator allocation rate in
+  // bytes per ns, and GC duration and total pause time per GC in ns.
+  double growth_alloc_rate_ GUARDED_BY(process_state_update_lock_);
+  double growth_gc_cost_ns_ GUARDED_BY(process_state_update_lock_);
+  double growth_pause_ns_ GUARDED_BY(process_state_update_lock_);
+  // Whether growth_alloc_rate_ holds a measurement, which takes two GCs.
+  bool has_growth_alloc_rate_ GUARDED_BY(process_state_update_lock_);
+  // Time and bytes allocated at the end of the last GC, used to measure the allocation rate.
+  uint64_t last_growth_update_ns_ GUARDED_BY(process_state_update_lock_);
+  size_t last_growth_update_bytes_ GUARDED_BY(process_state_update_lock_);
+  // Free bytes chosen by the last PredictGrowBytes() and the default it replaced, for LogGC().
+  // Zero after a GC that did not predict.
+  size_t growth_predicted_free_ GUARDED_BY(process_state_update_lock_);
+  size_t growth_default_free_ GUARDED_BY(process_state_update_lock_);
+
   // When num_bytes_allocated_ exceeds this amount then a concurrent GC should be requested so that
   // it completes ahead of an allocation failing.
   // A multiple of this is also used to determine when to trigger a GC in response to native
@@ -1518,7 +1634,7 @@ class Heap {
   std::unique_ptr<accounting::HeapBitmap> mark_bitmap_ GUARDED_BY(Locks::heap_bitmap_lock_);
 
   // Mark stack that we reuse to avoid re-allocating the mark stack.
-  std::unique_ptr<accounting::ObjectStack> mark_stack_;
+  std::unique_ptr<accounting::SegmentedObjectStack> mark_stack_;
 
   // Allocation stack, new allocations go here so that we can do sticky mark bits. This enables us
   // to use the live bitmap as the old mark bitmap.
@@ -1695,6 +1811,7 @@ class Heap {
   friend class collector::MarkSweep;
   friend class collector::SemiSpace;
   friend class GCCriticalSection;
+  friend class HeapTest;
   friend class ReferenceQueue;
   friend class ScopedGCCriticalSection;
   friend class ScopedInterruptibleGCCriticalSection;
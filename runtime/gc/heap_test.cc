@@ -15,10 +15,14 @@
  */
 
 #include "class_linker-inl.h"
+#include "class_root-inl.h"
 #include "common_runtime_test.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/space_bitmap-inl.h"
+#include "gc/heap-visit-objects-inl.h"
+#include "gc/space/large_object_space.h"
 #include "handle_scope-inl.h"
+#include "mirror/array-alloc-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-alloc-inl.h"
@@ -46,6 +50,29 @@ class HeapTest : public CommonRuntimeTest {
     CommonRuntimeTest::SetUp();
   }
 
+ protected:
+  static size_t NextTlabSize(Heap* heap, Thread* self) {
+    return heap->NextTlabSize(self);
+  }
+
+  static void RecordTlabRefill(Heap* heap, Thread* self, size_t granted_bytes) {
+    heap->RecordTlabRefill(self, granted_bytes);
+  }
+
+  static size_t ComputePredictiveGrowBytes(double alloc_rate,
+                                           double gc_cost_ns,
+                                           double pause_ns,
+                                           double target_cpu_fraction,
+                                           double target_pause_fraction) {
+    return Heap::ComputePredictiveGrowBytes(alloc_rate,
+                                            gc_cost_ns,
+                                            pause_ns,
+                                            target_cpu_fraction,
+                                            target_pause_fraction,
+                                            /*min_free=*/ 1 * MB,
+                                            /*max_free=*/ 512 * MB);
+  }
+
  private:
   MemMap reserved_;
 };
@@ -99,6 +126,160 @@ TEST_F(HeapTest, DumpGCPerformanceOnShutdown) {
   Runtime::Current()->SetDumpGCPerformanceOnShutdown(true);
 }
 
+TEST_F(HeapTest, VisitObjectsParallel) {
+  ScopedObjectAccess soa(Thread::Current());
+  Heap* heap = Runtime::Current()->GetHeap();
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> c(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;")));
+  Handle<mirror::ObjectArray<mirror::Object>> array(
+      hs.NewHandle(mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c.Get(), 4096)));
+  for (size_t i = 0; i < 4096; ++i) {
+    array->Set<false>(i, mirror::String::AllocFromModifiedUtf8(soa.Self(), "hello, world!"));
+  }
+  // Free the garbage up front so that no collection changes the heap between the two visits.
+  heap->CollectGarbage(/* clear_soft_references= */ false);
+  size_t serial_count = 0;
+  heap->VisitObjects([&](mirror::Object* obj ATTRIBUTE_UNUSED) { ++serial_count; });
+  const size_t num_workers = heap->GetParallelVisitWorkerCount();
+  std::vector<size_t> worker_counts(num_workers, 0u);
+  heap->VisitObjectsParallel([&](size_t worker_index, mirror::Object* obj ATTRIBUTE_UNUSED) {
+    ASSERT_LT(worker_index, num_workers);
+    ++worker_counts[worker_index];
+  });
+  size_t parallel_count = 0;
+  for (size_t count : worker_counts) {
+    parallel_count += count;
+  }
+  EXPECT_GE(serial_count, 4096u);
+  EXPECT_EQ(serial_count, parallel_count);
+
+  std::vector<Handle<mirror::Class>> classes = { c };
+  uint64_t instances = 0;
+  heap->CountInstances(classes, /* use_is_assignable_from= */ false, &instances);
+  EXPECT_GE(instances, 1u);
+}
+
+TEST_F(HeapTest, TlabSizingCountsGrantedRefills) {
+  Heap* heap = Runtime::Current()->GetHeap();
+  Thread* self = Thread::Current();
+  Thread::TlabSizingStats* stats = self->GetTlabSizingStats();
+  *stats = Thread::TlabSizingStats();
+
+  const size_t tlab_size = NextTlabSize(heap, self);
+  EXPECT_EQ(tlab_size, Heap::kPartialTlabSize);
+  // Sizing a refill that then fails is not counted and does not grow the TLAB.
+  for (size_t i = 0; i != 2 * Heap::kTargetTlabRefillsPerGc; ++i) {
+    EXPECT_EQ(NextTlabSize(heap, self), tlab_size);
+  }
+  EXPECT_EQ(stats->total_refills, 0u);
+  EXPECT_EQ(stats->total_bytes, 0u);
+
+  // A refill is counted with the size it was granted, not the one that was asked for.
+  RecordTlabRefill(heap, self, tlab_size / 2);
+  EXPECT_EQ(stats->total_refills, 1u);
+  EXPECT_EQ(stats->total_bytes, tlab_size / 2);
+  EXPECT_EQ(stats->cycle_bytes, tlab_size / 2);
+
+  // Only successful refills make the TLAB grow within a cycle.
+  for (size_t i = 1; i != Heap::kTargetTlabRefillsPerGc; ++i) {
+    EXPECT_EQ(NextTlabSize(heap, self), tlab_size);
+    RecordTlabRefill(heap, self, tlab_size);
+  }
+  EXPECT_EQ(NextTlabSize(heap, self), 2 * tlab_size);
+  EXPECT_EQ(stats->total_refills, Heap::kTargetTlabRefillsPerGc);
+  *stats = Thread::TlabSizingStats();
+}
+
+TEST_F(HeapTest, PredictiveGrowth) {
+  // The targets are powers of two and the costs integers, so every product and quotient below
+  // is exact in a double and the truncation to size_t cannot round down.
+  // 1 byte per ns is about 1GB/s. A 12.5ms GC every 100MB keeps the collector at 1/8 of the time.
+  EXPECT_EQ(ComputePredictiveGrowBytes(1.0, 12.5e6, 1e6, 0.125, 0.0), 100u * 1000 * 1000);
+  // Twice the rate or half the target needs twice the free bytes.
+  EXPECT_EQ(ComputePredictiveGrowBytes(2.0, 12.5e6, 1e6, 0.125, 0.0), 200u * 1000 * 1000);
+  EXPECT_EQ(ComputePredictiveGrowBytes(1.0, 12.5e6, 1e6, 0.0625, 0.0), 200u * 1000 * 1000);
+  // The pause target alone, and the larger requirement when both are set.
+  EXPECT_EQ(ComputePredictiveGrowBytes(1.0, 12.5e6, 1e6, 0.0, 0.015625), 64u * 1000 * 1000);
+  EXPECT_EQ(ComputePredictiveGrowBytes(1.0, 12.5e6, 1e6, 0.125, 0.0078125), 128u * 1000 * 1000);
+  EXPECT_EQ(ComputePredictiveGrowBytes(1.0, 12.5e6, 1e6, 0.0625, 0.015625), 200u * 1000 * 1000);
+  // Clamped to [min_free, max_free].
+  EXPECT_EQ(ComputePredictiveGrowBytes(0.0, 12.5e6, 1e6, 0.125, 0.015625), 1u * MB);
+  EXPECT_EQ(ComputePredictiveGrowBytes(0x1p-20, 12.5e6, 1e6, 0.125, 0.015625), 1u * MB);
+  EXPECT_EQ(ComputePredictiveGrowBytes(64.0, 12.5e6, 1e6, 0.125, 0.015625), 512u * MB);
+}
+
+class LargeObjectSpaceCompactionTest : public HeapTest {
+  void SetUpRuntimeOptions(RuntimeOptions* options) override {
+    HeapTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-XX:LargeObjectSpace=freelist", nullptr));
+    options->push_back(std::make_pair("-XX:LargeObjectSpaceCompactionThreshold=0.1", nullptr));
+  }
+};
+
+TEST_F(LargeObjectSpaceCompactionTest, SlidesMovableObjects) {
+  // Freeing every other one of six 512 KiB arrays leaves 1.5 MiB in holes.
+  static constexpr size_t kNumArrays = 6;
+  static constexpr int32_t kArrayLength = 512 * KB;
+  Thread* const self = Thread::Current();
+  Heap* const heap = Runtime::Current()->GetHeap();
+  space::LargeObjectSpace* const los = heap->GetLargeObjectsSpace();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<kNumArrays / 2 + 3> hs(self);
+  Handle<mirror::Class> c(
+      hs.NewHandle(class_linker_->FindSystemClass(self, "[Ljava/lang/Object;")));
+  Handle<mirror::ObjectArray<mirror::Object>> holder(
+      hs.NewHandle(mirror::ObjectArray<mirror::Object>::Alloc(self, c.Get(), kNumArrays / 2)));
+  ASSERT_TRUE(holder != nullptr);
+  std::vector<Handle<mirror::ByteArray>> kept;
+  std::vector<mirror::Object*> old_addresses;
+  for (size_t i = 0; i != kNumArrays; ++i) {
+    ObjPtr<mirror::ByteArray> array = mirror::ByteArray::Alloc(self, kArrayLength);
+    ASSERT_TRUE(array != nullptr);
+    ASSERT_TRUE(los->Contains(array.Ptr()));
+    memset(array->GetData(), static_cast<int>(i), kArrayLength);
+    if (i % 2 == 1) {
+      holder->Set</*kTransactionActive=*/ false>(i / 2, array);
+      old_addresses.push_back(array.Ptr());
+      kept.push_back(hs.NewHandle(array));
+    }
+  }
+  // Arrays from the non-moving allocator are pinned, the arrays before it can still slide.
+  Handle<mirror::ByteArray> pinned(hs.NewHandle(ObjPtr<mirror::ByteArray>::DownCast(
+      mirror::Array::Alloc(self,
+                           GetClassRoot<mirror::ByteArray>(),
+                           kArrayLength,
+                           GetClassRoot<mirror::ByteArray>()->GetComponentSizeShift(),
+                           heap->GetCurrentNonMovingAllocator()))));
+  ASSERT_TRUE(pinned != nullptr);
+  ASSERT_TRUE(los->Contains(pinned.Get()));
+  mirror::Object* const pinned_address = pinned.Get();
+  EXPECT_FALSE(heap->IsMovableObject(pinned.Get()));
+  EXPECT_TRUE(heap->IsMovableObject(kept[0].Get()));
+
+  {
+    ScopedThreadSuspension sts(self, kSuspended);
+    heap->CollectGarbage(/* clear_soft_references= */ false);
+    EXPECT_TRUE(heap->CompactLargeObjectSpace(self));
+    // Everything before the pinned array is packed now.
+    EXPECT_FALSE(heap->CompactLargeObjectSpace(self));
+  }
+
+  for (size_t i = 0; i != kept.size(); ++i) {
+    mirror::ByteArray* array = kept[i].Get();
+    EXPECT_LT(reinterpret_cast<uintptr_t>(array), reinterpret_cast<uintptr_t>(old_addresses[i]));
+    // Both the handle, a root, and the element of `holder`, a heap reference, are updated.
+    EXPECT_EQ(holder->Get(i).Ptr(), array);
+    EXPECT_TRUE(los->GetLiveBitmap()->Test(array));
+    EXPECT_FALSE(los->GetLiveBitmap()->Test(old_addresses[i]));
+    const int8_t expected = static_cast<int8_t>(2 * i + 1);
+    EXPECT_EQ(array->Get(0), expected);
+    EXPECT_EQ(array->Get(kArrayLength - 1), expected);
+  }
+  EXPECT_EQ(pinned.Get(), pinned_address);
+  EXPECT_TRUE(los->GetLiveBitmap()->Test(pinned.Get()));
+}
+
 class ZygoteHeapTest : public CommonRuntimeTest {
   void SetUpRuntimeOptions(RuntimeOptions* options) override {
     CommonRuntimeTest::SetUpRuntimeOptions(options);
@@ -22,6 +22,7 @@
 #include "base/utils.h"
 #include "class_root-inl.h"
 #include "collector/garbage_collector.h"
+#include "heap.h"
 #include "jni/java_vm_ext.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
@@ -189,9 +190,20 @@ void ReferenceProcessor::ProcessReferences(bool concurrent,
       StopPreservingReferences(self);
     }
   }
-  // Clear all remaining soft and weak references with white referents.
-  soft_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  weak_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
+  ThreadPool* thread_pool = nullptr;
+  size_t thread_count = GetThreadCount(concurrent, &thread_pool);
+  size_t soft_cleared = 0;
+  size_t weak_cleared = 0;
+  size_t phantom_cleared = 0;
+  {
+    TimingLogger::ScopedTiming t2(concurrent ? "ClearWhiteReferences" :
+        "(Paused)ClearWhiteReferences", timings);
+    // Clear all remaining soft and weak references with white referents.
+    soft_cleared += soft_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+    weak_cleared += weak_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+  }
   {
     TimingLogger::ScopedTiming t2(concurrent ? "EnqueueFinalizerReferences" :
         "(Paused)EnqueueFinalizerReferences", timings);
@@ -205,11 +217,25 @@ void ReferenceProcessor::ProcessReferences(bool concurrent,
       StopPreservingReferences(self);
     }
   }
-  // Clear all finalizer referent reachable soft and weak references with white referents.
-  soft_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  weak_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  // Clear all phantom references with white referents.
-  phantom_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
+  {
+    TimingLogger::ScopedTiming t2(concurrent ? "ClearFinalizerReachableReferences" :
+        "(Paused)ClearFinalizerReachableReferences", timings);
+    // Clear all finalizer referent reachable soft and weak references with white referents.
+    soft_cleared += soft_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+    weak_cleared += weak_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+  }
+  {
+    TimingLogger::ScopedTiming t2(concurrent ? "ClearPhantomReferences" :
+        "(Paused)ClearPhantomReferences", timings);
+    // Clear all phantom references with white referents.
+    phantom_cleared = phantom_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+  }
+  VLOG(gc) << "Reference processing cleared " << soft_cleared << " soft, " << weak_cleared
+           << " weak and " << phantom_cleared << " phantom references using " << thread_count
+           << " thread(s)";
   // At this point all reference queues other than the cleared references should be empty.
   DCHECK(soft_reference_queue_.IsEmpty());
   DCHECK(weak_reference_queue_.IsEmpty());
@@ -229,6 +255,17 @@ void ReferenceProcessor::ProcessReferences(bool concurrent,
   }
 }
 
+size_t ReferenceProcessor::GetThreadCount(bool concurrent, ThreadPool** thread_pool) const {
+  Heap* heap = Runtime::Current()->GetHeap();
+  *thread_pool = heap->GetThreadPool();
+  // Like the collectors, leave the other cores alone when we are in the background.
+  if (*thread_pool == nullptr || !Runtime::Current()->InJankPerceptibleProcessState()) {
+    *thread_pool = nullptr;
+    return 1;
+  }
+  return (concurrent ? heap->GetConcGCThreadCount() : heap->GetParallelGCThreadCount()) + 1;
+}
+
 // Process the "referent" field in a java.lang.ref.Reference.  If the referent has not yet been
 // marked, put it on the appropriate list in the heap for later processing.
 void ReferenceProcessor::DelayReferenceReferent(ObjPtr<mirror::Class> klass,
@@ -89,6 +89,9 @@ class ReferenceProcessor {
   // referents.
   void StartPreservingReferences(Thread* self) REQUIRES(!Locks::reference_processor_lock_);
   void StopPreservingReferences(Thread* self) REQUIRES(!Locks::reference_processor_lock_);
+  // Returns the number of threads, the calling one included, that may be used to clear white
+  // references, and sets `thread_pool` to the pool providing the others (null if there are none).
+  size_t GetThreadCount(bool concurrent, ThreadPool** thread_pool) const;
   // Wait until reference processing is done.
   void WaitUntilDoneProcessingReferences(Thread* self)
       REQUIRES_SHARED(Locks::mutator_lock_)
@@ -130,26 +130,134 @@ size_t ReferenceQueue::GetLength() const {
   return count;
 }
 
-void ReferenceQueue::ClearWhiteReferences(ReferenceQueue* cleared_references,
-                                          collector::GarbageCollector* collector) {
+bool ReferenceQueue::ClearWhiteReference(ObjPtr<mirror::Reference> ref,
+                                         ReferenceQueue* cleared_references,
+                                         collector::GarbageCollector* collector) {
+  bool cleared = false;
+  mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
+  // do_atomic_update is false because this happens during the reference processing phase where
+  // Reference.clear() would block.
+  if (!collector->IsNullOrMarkedHeapReference(referent_addr, /*do_atomic_update=*/false)) {
+    // Referent is white, clear it.
+    if (Runtime::Current()->IsActiveTransaction()) {
+      ref->ClearReferent<true>();
+    } else {
+      ref->ClearReferent<false>();
+    }
+    cleared_references->EnqueueReference(ref);
+    cleared = true;
+  }
+  // Delay disabling the read barrier until here so that the ClearReferent call above in
+  // transaction mode will trigger the read barrier.
+  DisableReadBarrierForReference(ref);
+  return cleared;
+}
+
+// Clears the white referents of a slice of a dequeued reference list. Cleared references are
+// collected in a task-local queue which is spliced into the shared one once all tasks are done.
+class ClearWhiteReferencesTask : public SelfDeletingTask {
+ public:
+  ClearWhiteReferencesTask(mirror::Reference** begin,
+                           mirror::Reference** end,
+                           ReferenceQueue* cleared_references,
+                           collector::GarbageCollector* collector,
+                           Atomic<size_t>* cleared_count)
+      : begin_(begin),
+        end_(end),
+        cleared_references_(cleared_references),
+        collector_(collector),
+        cleared_count_(cleared_count) {}
+
+  // The thread pool workers do not hold the mutator lock, but the thread that started them does
+  // and is waiting for them to finish.
+  void Run(Thread* self ATTRIBUTE_UNUSED) override NO_THREAD_SAFETY_ANALYSIS {
+    size_t cleared = 0;
+    for (mirror::Reference** it = begin_; it != end_; ++it) {
+      if (ReferenceQueue::ClearWhiteReference(*it, cleared_references_, collector_)) {
+        ++cleared;
+      }
+    }
+    cleared_count_->fetch_add(cleared, std::memory_order_relaxed);
+  }
+
+ private:
+  mirror::Reference** const begin_;
+  mirror::Reference** const end_;
+  ReferenceQueue* const cleared_references_;
+  collector::GarbageCollector* const collector_;
+  Atomic<size_t>* const cleared_count_;
+};
+
+size_t ReferenceQueue::ClearWhiteReferences(ReferenceQueue* cleared_references,
+                                            collector::GarbageCollector* collector,
+                                            ThreadPool* thread_pool,
+                                            size_t thread_count) {
+  size_t cleared = 0;
+  // The transaction log is not thread safe, keep transactions serial.
+  if (thread_pool == nullptr ||
+      thread_count <= 1 ||
+      Runtime::Current()->IsActiveTransaction()) {
+    while (!IsEmpty()) {
+      if (ClearWhiteReference(DequeuePendingReference(), cleared_references, collector)) {
+        ++cleared;
+      }
+    }
+    return cleared;
+  }
+  // Unlinking is inherently serial, but it only touches the Reference objects. Checking the
+  // referents, which are scattered all over the heap, is what gets split across threads.
+  std::vector<mirror::Reference*> refs;
   while (!IsEmpty()) {
-    ObjPtr<mirror::Reference> ref = DequeuePendingReference();
-    mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
-    // do_atomic_update is false because this happens during the reference processing phase where
-    // Reference.clear() would block.
-    if (!collector->IsNullOrMarkedHeapReference(referent_addr, /*do_atomic_update=*/false)) {
-      // Referent is white, clear it.
-      if (Runtime::Current()->IsActiveTransaction()) {
-        ref->ClearReferent<true>();
-      } else {
-        ref->ClearReferent<false>();
+    refs.push_back(DequeuePendingReference().Ptr());
+  }
+  if (refs.size() < kMinParallelClearLength) {
+    for (mirror::Reference* ref : refs) {
+      if (ClearWhiteReference(ref, cleared_references, collector)) {
+        ++cleared;
       }
-      cleared_references->EnqueueReference(ref);
     }
-    // Delay disabling the read barrier until here so that the ClearReferent call above in
-    // transaction mode will trigger the read barrier.
-    DisableReadBarrierForReference(ref);
+    return cleared;
+  }
+  Thread* self = Thread::Current();
+  Atomic<size_t> cleared_count(0u);
+  // The task-local queues are only ever appended to by their own task and never use their lock.
+  std::vector<std::unique_ptr<ReferenceQueue>> local_queues;
+  const size_t chunk_size = (refs.size() + thread_count - 1) / thread_count;
+  for (size_t begin = 0; begin < refs.size(); begin += chunk_size) {
+    const size_t end = std::min(begin + chunk_size, refs.size());
+    local_queues.emplace_back(new ReferenceQueue(lock_));
+    thread_pool->AddTask(self, new ClearWhiteReferencesTask(refs.data() + begin,
+                                                            refs.data() + end,
+                                                            local_queues.back().get(),
+                                                            collector,
+                                                            &cleared_count));
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, /* do_work= */ true, /* may_hold_locks= */ true);
+  thread_pool->StopWorkers(self);
+  for (const std::unique_ptr<ReferenceQueue>& local_queue : local_queues) {
+    cleared_references->Splice(local_queue.get());
+  }
+  return cleared_count.load(std::memory_order_relaxed);
+}
+
+void ReferenceQueue::Splice(ReferenceQueue* other) {
+  if (other->IsEmpty()) {
+    return;
+  }
+  if (IsEmpty()) {
+    list_ = other->list_;
+  } else {
+    // Both lists are cycles; cross the links out of their tail elements to join them.
+    ObjPtr<mirror::Reference> head = list_->GetPendingNext<kWithoutReadBarrier>();
+    ObjPtr<mirror::Reference> other_head = other->list_->GetPendingNext<kWithoutReadBarrier>();
+    DCHECK(head != nullptr);
+    DCHECK(other_head != nullptr);
+    list_->SetPendingNext(other_head);
+    other->list_->SetPendingNext(head);
   }
+  other->Clear();
 }
 
 void ReferenceQueue::EnqueueFinalizerReferences(ReferenceQueue* cleared_references,
@@ -91,10 +91,19 @@ class ReferenceQueue {
 
   // Unlink the reference list clearing references objects with white referents. Cleared references
   // registered to a reference queue are scheduled for appending by the heap worker thread.
-  void ClearWhiteReferences(ReferenceQueue* cleared_references,
-                            collector::GarbageCollector* collector)
+  // Returns the number of references that were cleared. If `thread_pool` is not null and the
+  // queue is long enough, the referents are checked and cleared by `thread_count` threads, the
+  // calling thread included.
+  size_t ClearWhiteReferences(ReferenceQueue* cleared_references,
+                              collector::GarbageCollector* collector,
+                              ThreadPool* thread_pool = nullptr,
+                              size_t thread_count = 1)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Move all the references of `other` to this queue, leaving `other` empty.
+  // Not thread safe.
+  void Splice(ReferenceQueue* other) REQUIRES_SHARED(Locks::mutator_lock_);
+
   void Dump(std::ostream& os) const REQUIRES_SHARED(Locks::mutator_lock_);
   size_t GetLength() const REQUIRES_SHARED(Locks::mutator_lock_);
 
@@ -113,6 +122,18 @@ class ReferenceQueue {
       REQUIRES_SHARED(Locks::mutator_lock_);
 
  private:
+  // Minimum queue length for which ClearWhiteReferences uses the thread pool.
+  static constexpr size_t kMinParallelClearLength = 4096;
+
+  // Check the referent of `ref` and clear it if it is white, adding `ref` to `cleared_references`.
+  // Returns true if the referent was cleared.
+  static bool ClearWhiteReference(ObjPtr<mirror::Reference> ref,
+                                  ReferenceQueue* cleared_references,
+                                  collector::GarbageCollector* collector)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  friend class ClearWhiteReferencesTask;
+
   // Lock, used for parallel GC reference enqueuing. It allows for multiple threads simultaneously
   // calling AtomicEnqueueIfNotEnqueued.
   Mutex* const lock_;
@@ -95,5 +95,46 @@ TEST_F(ReferenceQueueTest, Dump) {
   LOG(INFO) << oss.str();
 }
 
+TEST_F(ReferenceQueueTest, Splice) {
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<20> hs(self);
+  Mutex lock("Reference queue lock");
+  ReferenceQueue queue1(&lock);
+  ReferenceQueue queue2(&lock);
+  auto ref_class = hs.NewHandle(
+      Runtime::Current()->GetClassLinker()->FindClass(self, "Ljava/lang/ref/WeakReference;",
+                                                      ScopedNullHandle<mirror::ClassLoader>()));
+  ASSERT_TRUE(ref_class != nullptr);
+  std::set<mirror::Reference*> refs;
+  for (size_t i = 0; i < 5; ++i) {
+    Handle<mirror::Reference> ref(hs.NewHandle(ref_class->AllocObject(self)->AsReference()));
+    ASSERT_TRUE(ref != nullptr);
+    refs.insert(ref.Get());
+    // Two references in the first queue, three in the second.
+    (i < 2 ? queue1 : queue2).EnqueueReference(ref.Get());
+  }
+
+  // Splicing an empty queue is a no-op.
+  ReferenceQueue empty(&lock);
+  queue1.Splice(&empty);
+  ASSERT_EQ(queue1.GetLength(), 2U);
+
+  queue1.Splice(&queue2);
+  ASSERT_TRUE(queue2.IsEmpty());
+  ASSERT_EQ(queue1.GetLength(), 5U);
+
+  // Splicing into an empty queue moves the whole list.
+  empty.Splice(&queue1);
+  ASSERT_TRUE(queue1.IsEmpty());
+  ASSERT_EQ(empty.GetLength(), 5U);
+
+  std::set<mirror::Reference*> dequeued;
+  while (!empty.IsEmpty()) {
+    dequeued.insert(empty.DequeuePendingReference().Ptr());
+  }
+  ASSERT_EQ(refs, dequeued);
+}
+
 }  // namespace gc
 }  // namespace art
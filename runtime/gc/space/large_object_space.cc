@@ -18,6 +18,7 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
 #include <memory>
 
 #include <android-base/logging.h>
@@ -27,6 +28,7 @@
 #include "base/mutex-inl.h"
 #include "base/os.h"
 #include "base/stl_util.h"
+#include "base/utils.h"
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/heap.h"
@@ -315,6 +317,13 @@ class AllocationInfo {
   void SetZygoteObject() {
     alloc_size_ |= kFlagZygote;
   }
+  // Return true if the large object must never be moved.
+  bool IsPinned() const {
+    return (alloc_size_ & kFlagPinned) != 0;
+  }
+  void SetPinned() {
+    alloc_size_ |= kFlagPinned;
+  }
   // Return true if this is a zygote large object.
   // Finds and returns the next non free allocation info after ourself.
   AllocationInfo* GetNextInfo() {
@@ -351,7 +360,9 @@ class AllocationInfo {
  private:
   static constexpr uint32_t kFlagFree = 0x80000000;  // If block is free.
   static constexpr uint32_t kFlagZygote = 0x40000000;  // If the large object is a zygote object.
-  static constexpr uint32_t kFlagsMask = ~(kFlagFree | kFlagZygote);  // Combined flags for masking.
+  static constexpr uint32_t kFlagPinned = 0x20000000;  // If the large object must not move.
+  // Combined flags for masking.
+  static constexpr uint32_t kFlagsMask = ~(kFlagFree | kFlagZygote | kFlagPinned);
   // Contains the size of the previous free block with kAlignment as the unit. If 0 then the
   // allocation before us is not free.
   // These variables are undefined in the middle of allocations / free blocks.
@@ -420,6 +431,8 @@ FreeListSpace::FreeListSpace(const std::string& name,
       mem_map_(std::move(mem_map)) {
   const size_t space_capacity = end - begin;
   free_end_ = space_capacity;
+  cached_free_bytes_.store(space_capacity, std::memory_order_relaxed);
+  cached_largest_free_block_.store(space_capacity, std::memory_order_relaxed);
   CHECK_ALIGNED(space_capacity, kAlignment);
   const size_t alloc_info_size = sizeof(AllocationInfo) * (space_capacity / kAlignment);
   std::string error_msg;
@@ -529,6 +542,7 @@ size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
   --num_objects_allocated_;
   DCHECK_LE(allocation_size, num_bytes_allocated_);
   num_bytes_allocated_ -= allocation_size;
+  UpdateFragmentationLocked();
   // marvin start
   NIEL_INST_RECORD_FREE(self, this, allocation_size, 1);
   // marvin end
@@ -592,6 +606,7 @@ mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* byt
   ++total_objects_allocated_;
   num_bytes_allocated_ += allocation_size;
   total_bytes_allocated_ += allocation_size;
+  UpdateFragmentationLocked();
   mirror::Object* obj = reinterpret_cast<mirror::Object*>(GetAddressForAllocationInfo(new_info));
   // We always put our object at the start of the free block, there cannot be another free block
   // before it.
@@ -631,6 +646,46 @@ void FreeListSpace::Dump(std::ostream& os) const {
     os << "Free block at address: " << reinterpret_cast<const void*>(free_end_start)
        << " of length " << free_end_ << " bytes\n";
   }
+  DumpFragmentationLocked(os);
+  os << "\n";
+}
+
+size_t FreeListSpace::GetLargestFreeBlockSize() const {
+  size_t largest = free_end_;
+  // The free blocks are sorted by size first, see SortByPrevFree.
+  if (!free_blocks_.empty()) {
+    largest = std::max(largest, (*free_blocks_.rbegin())->GetPrevFreeBytes());
+  }
+  return largest;
+}
+
+void FreeListSpace::UpdateFragmentationLocked() {
+  cached_free_bytes_.store(GetFreeBytes(), std::memory_order_relaxed);
+  cached_largest_free_block_.store(GetLargestFreeBlockSize(), std::memory_order_relaxed);
+}
+
+bool FreeListSpace::IsFragmentedFor(size_t num_bytes) const {
+  // The two values may come from different updates. That only affects whether a racing
+  // allocation tries the space first, the allocation itself rechecks under lock_.
+  const size_t allocation_size = RoundUp(num_bytes, kAlignment);
+  return cached_free_bytes_.load(std::memory_order_relaxed) >= allocation_size &&
+         cached_largest_free_block_.load(std::memory_order_relaxed) < allocation_size;
+}
+
+void FreeListSpace::DumpFragmentation(std::ostream& os) const {
+  MutexLock mu(Thread::Current(), lock_);
+  DumpFragmentationLocked(os);
+}
+
+void FreeListSpace::DumpFragmentationLocked(std::ostream& os) const {
+  const size_t free_bytes = GetFreeBytes();
+  const size_t largest = GetLargestFreeBlockSize();
+  os << "free " << PrettySize(free_bytes)
+     << " in " << free_blocks_.size() << " holes and " << PrettySize(free_end_) << " at the end"
+     << ", largest free block " << PrettySize(largest);
+  if (free_bytes != 0) {
+    os << ", fragmentation " << (100 * (free_bytes - largest) / free_bytes) << "%";
+  }
 }
 
 bool FreeListSpace::IsZygoteLargeObject(Thread* self ATTRIBUTE_UNUSED, mirror::Object* obj) const {
@@ -657,6 +712,161 @@ void FreeListSpace::SetAllLargeObjectsAsZygoteObjects(Thread* self, bool set_mar
   }
 }
 
+size_t FreeListSpace::GetHoleBytes() const {
+  MutexLock mu(Thread::Current(), lock_);
+  return GetFreeBytes() - free_end_;
+}
+
+size_t FreeListSpace::GetUsedExtent() const {
+  MutexLock mu(Thread::Current(), lock_);
+  return Size() - free_end_;
+}
+
+void FreeListSpace::PinObject(Thread* self, mirror::Object* obj) {
+  MutexLock mu(self, lock_);
+  AllocationInfo* info = GetAllocationInfoForAddress(reinterpret_cast<uintptr_t>(obj));
+  DCHECK(!info->IsFree());
+  info->SetPinned();
+}
+
+bool FreeListSpace::IsPinnedObject(const mirror::Object* obj) const {
+  const AllocationInfo* info = GetAllocationInfoForAddress(reinterpret_cast<uintptr_t>(obj));
+  DCHECK(!info->IsFree());
+  // Zygote objects may be referenced from the zygote space, which is never updated.
+  return info->IsPinned() || info->IsZygoteObject();
+}
+
+// Moving an object touches all of its pages, so only move objects that are entirely in memory.
+static bool IsResident(uint8_t* begin, size_t size, std::vector<unsigned char>* residency) {
+  DCHECK_ALIGNED(begin, kPageSize);
+  residency->resize(RoundUp(size, kPageSize) / kPageSize);
+  if (mincore(begin, size, residency->data()) != 0) {
+    PLOG(WARNING) << "mincore failed for large object at " << reinterpret_cast<void*>(begin);
+    return false;
+  }
+  return std::all_of(residency->begin(),
+                     residency->end(),
+                     [](unsigned char page) { return (page & 1u) != 0u; });
+}
+
+FreeListSpace::ForwardingTable FreeListSpace::ComputeCompaction() {
+  MutexLock mu(Thread::Current(), lock_);
+  ForwardingTable forwarding;
+  std::vector<unsigned char> residency;
+  const uintptr_t free_end_start = reinterpret_cast<uintptr_t>(end_) - free_end_;
+  uintptr_t cursor = reinterpret_cast<uintptr_t>(Begin());
+  for (AllocationInfo* cur_info = GetAllocationInfoForAddress(cursor),
+      *end_info = GetAllocationInfoForAddress(free_end_start); cur_info < end_info;
+      cur_info = cur_info->GetNextInfo()) {
+    if (cur_info->IsFree()) {
+      continue;
+    }
+    const uintptr_t address = GetAddressForAllocationInfo(cur_info);
+    const size_t size = cur_info->ByteSize();
+    if (cur_info->IsPinned() ||
+        cur_info->IsZygoteObject() ||
+        !IsResident(reinterpret_cast<uint8_t*>(address), size, &residency)) {
+      // Objects that stay where they are bound the sliding of the objects after them.
+      cursor = address + size;
+      continue;
+    }
+    // Never forward an object to the old address of another moved object. Forwarding an
+    // already forwarded reference is then a no-op, so the caller does not need to worry about
+    // visiting some references twice. This costs a page each time it happens.
+    while (GetForwardingAddress(forwarding, reinterpret_cast<mirror::Object*>(cursor)) != nullptr) {
+      cursor += kAlignment;
+    }
+    DCHECK_LE(cursor, address);
+    if (cursor != address) {
+      forwarding.emplace_back(reinterpret_cast<mirror::Object*>(address),
+                              reinterpret_cast<mirror::Object*>(cursor));
+    }
+    cursor += size;
+  }
+  return forwarding;
+}
+
+void FreeListSpace::Compact(Thread* self, const ForwardingTable& forwarding) {
+  MutexLock mu(self, lock_);
+  uint8_t* const begin = Begin();
+  const uintptr_t free_end_start = reinterpret_cast<uintptr_t>(end_) - free_end_;
+  if (kIsDebugBuild) {
+    // Free blocks are read only in debug builds, see Free().
+    CheckedCall(mprotect,
+                __FUNCTION__,
+                begin,
+                free_end_start - reinterpret_cast<uintptr_t>(begin),
+                PROT_READ | PROT_WRITE);
+  }
+  // Record the new layout before moving anything, the allocation info of the objects is
+  // rewritten below.
+  std::vector<std::pair<uintptr_t, AllocationInfo>> objects;
+  for (AllocationInfo* cur_info = GetAllocationInfoForAddress(reinterpret_cast<uintptr_t>(begin)),
+      *end_info = GetAllocationInfoForAddress(free_end_start); cur_info < end_info;
+      cur_info = cur_info->GetNextInfo()) {
+    if (!cur_info->IsFree()) {
+      mirror::Object* obj =
+          reinterpret_cast<mirror::Object*>(GetAddressForAllocationInfo(cur_info));
+      mirror::Object* new_obj = GetForwardingAddress(forwarding, obj);
+      objects.emplace_back(reinterpret_cast<uintptr_t>(new_obj != nullptr ? new_obj : obj),
+                           *cur_info);
+    }
+  }
+  // Objects only move towards Begin(), so moving them in address order never overwrites an
+  // object that has not moved yet. The same goes for their bits in the bitmaps.
+  accounting::LargeObjectBitmap* const bitmaps[] = { GetLiveBitmap(), GetMarkBitmap() };
+  for (const auto& [from, to] : forwarding) {
+    DCHECK_LT(to, from);
+    memmove(to, from, GetAllocationInfoForAddress(reinterpret_cast<uintptr_t>(from))->ByteSize());
+    for (accounting::LargeObjectBitmap* bitmap : bitmaps) {
+      if (bitmap->Test(from)) {
+        bitmap->Clear(from);
+        bitmap->Set(to);
+      }
+    }
+  }
+  // Rebuild the allocation info and the free blocks for the new layout.
+  auto release_pages = [](uintptr_t address, size_t size) {
+    madvise(reinterpret_cast<void*>(address), size, MADV_DONTNEED);
+    if (kIsDebugBuild) {
+      CheckedCall(mprotect, __FUNCTION__, reinterpret_cast<void*>(address), size, PROT_READ);
+    }
+  };
+  free_blocks_.clear();
+  uintptr_t prev_end = reinterpret_cast<uintptr_t>(begin);
+  for (const auto& [address, info] : objects) {
+    DCHECK_GE(address, prev_end);
+    AllocationInfo* new_info = GetAllocationInfoForAddress(address);
+    *new_info = info;
+    const size_t hole_size = address - prev_end;
+    new_info->SetPrevFreeBytes(hole_size);
+    if (hole_size != 0) {
+      AllocationInfo* free_info = GetAllocationInfoForAddress(prev_end);
+      free_info->SetPrevFreeBytes(0);
+      free_info->SetByteSize(hole_size, /*free=*/ true);
+      free_blocks_.insert(new_info);
+      release_pages(prev_end, hole_size);
+    }
+    prev_end = address + info.ByteSize();
+  }
+  if (prev_end < free_end_start) {
+    release_pages(prev_end, free_end_start - prev_end);
+  }
+  free_end_ = reinterpret_cast<uintptr_t>(end_) - prev_end;
+  UpdateFragmentationLocked();
+}
+
+mirror::Object* FreeListSpace::GetForwardingAddress(const ForwardingTable& forwarding,
+                                                    const mirror::Object* obj) {
+  auto it = std::lower_bound(forwarding.begin(),
+                             forwarding.end(),
+                             obj,
+                             [](const auto& entry, const mirror::Object* o) {
+                               return entry.first < o;
+                             });
+  return (it != forwarding.end() && it->first == obj) ? it->second : nullptr;
+}
+
 void LargeObjectSpace::SweepCallback(size_t num_ptrs, mirror::Object** ptrs, void* arg) {
   SweepCallbackContext* context = static_cast<SweepCallbackContext*>(arg);
   space::LargeObjectSpace* space = context->space->AsLargeObjectSpace();
@@ -693,10 +903,16 @@ collector::ObjectBytePair LargeObjectSpace::Sweep(bool swap_bitmaps) {
   return scc.freed;
 }
 
-bool LargeObjectSpace::LogFragmentationAllocFailure(std::ostream& /*os*/,
-                                                    size_t /*failed_alloc_bytes*/) {
-  UNIMPLEMENTED(FATAL);
-  UNREACHABLE();
+bool LargeObjectSpace::LogFragmentationAllocFailure(std::ostream& os,
+                                                    size_t failed_alloc_bytes) {
+  if (!IsFragmentedFor(failed_alloc_bytes)) {
+    // Caller's job to print failed_alloc_bytes.
+    return false;
+  }
+  os << "; failed due to large object space fragmentation (";
+  DumpFragmentation(os);
+  os << ")";
+  return true;
 }
 
 std::pair<uint8_t*, uint8_t*> LargeObjectMapSpace::GetBeginEndAtomic() const {
@@ -24,7 +24,9 @@
 #include "space.h"
 #include "thread-current-inl.h"
 
+#include <atomic>
 #include <set>
+#include <utility>
 #include <vector>
 
 namespace art {
@@ -104,6 +106,14 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
   bool LogFragmentationAllocFailure(std::ostream& os, size_t failed_alloc_bytes) override
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Return true if the space has at least `num_bytes` free, but only in blocks that are too small
+  // for an allocation of that size.
+  virtual bool IsFragmentedFor(size_t num_bytes ATTRIBUTE_UNUSED) const {
+    return false;
+  }
+  // Print a one line summary of the free memory layout of the space, if it has one.
+  virtual void DumpFragmentation(std::ostream& os ATTRIBUTE_UNUSED) const {}
+
   // Return true if the large object is a zygote large object. Potentially slow.
   virtual bool IsZygoteLargeObject(Thread* self, mirror::Object* obj) const = 0;
   // Called when we create the zygote space, mark all existing large objects as zygote large
@@ -209,6 +219,34 @@ class FreeListSpace final : public LargeObjectSpace {
   void Dump(std::ostream& os) const override REQUIRES(!lock_);
   void ForEachMemMap(std::function<void(const MemMap&)> func) const override REQUIRES(!lock_);
   std::pair<uint8_t*, uint8_t*> GetBeginEndAtomic() const override REQUIRES(!lock_);
+  // Lock-free, reads the free memory layout cached by the last allocation or free.
+  bool IsFragmentedFor(size_t num_bytes) const override;
+  void DumpFragmentation(std::ostream& os) const override REQUIRES(!lock_);
+
+  // Free bytes in the holes between objects, i.e. not counting the free space at the end.
+  size_t GetHoleBytes() const REQUIRES(!lock_);
+  // Bytes from Begin() up to the free space at the end, holes included.
+  size_t GetUsedExtent() const REQUIRES(!lock_);
+
+  // Pinned objects are never moved by Compact(). Only called before the object is published, so
+  // that whether a large object can move never changes while JNI code may look at it.
+  void PinObject(Thread* self, mirror::Object* obj) REQUIRES(!lock_);
+  // Lock-free, like IsZygoteLargeObject().
+  bool IsPinnedObject(const mirror::Object* obj) const;
+
+  // Sliding compaction, done with all mutators suspended in two steps so that the caller can
+  // update the references to the moved objects in between. The forwarding table holds
+  // (old address, new address) pairs sorted by old address.
+  using ForwardingTable = std::vector<std::pair<mirror::Object*, mirror::Object*>>;
+  // Slide the movable objects towards Begin(). Pinned and zygote objects, and objects with pages
+  // that are not resident, stay where they are.
+  ForwardingTable ComputeCompaction() REQUIRES(!lock_) REQUIRES(Locks::mutator_lock_);
+  // Move the objects with their live and mark bits and rebuild the free blocks around them.
+  void Compact(Thread* self, const ForwardingTable& forwarding)
+      REQUIRES(!lock_) REQUIRES(Locks::mutator_lock_);
+  // Return the new address of `obj`, or null if it does not move.
+  static mirror::Object* GetForwardingAddress(const ForwardingTable& forwarding,
+                                              const mirror::Object* obj);
 
  protected:
   FreeListSpace(const std::string& name, MemMap&& mem_map, uint8_t* begin, uint8_t* end);
@@ -225,6 +263,15 @@ class FreeListSpace final : public LargeObjectSpace {
   uintptr_t GetAddressForAllocationInfo(const AllocationInfo* info) const {
     return GetAllocationAddressForSlot(GetSlotIndexForAllocationInfo(info));
   }
+  // Size of the largest free block, the free space at the end of the space included.
+  size_t GetLargestFreeBlockSize() const REQUIRES(lock_);
+  // Total number of free bytes, the free space at the end of the space included.
+  size_t GetFreeBytes() const REQUIRES(lock_) {
+    return Size() - num_bytes_allocated_;
+  }
+  void DumpFragmentationLocked(std::ostream& os) const REQUIRES(lock_);
+  // Update the cached free memory layout read by IsFragmentedFor().
+  void UpdateFragmentationLocked() REQUIRES(lock_);
   // Removes header from the free blocks set by finding the corresponding iterator and erasing it.
   void RemoveFreePrev(AllocationInfo* info) REQUIRES(lock_);
   bool IsZygoteLargeObject(Thread* self, mirror::Object* obj) const override;
@@ -249,6 +296,10 @@ class FreeListSpace final : public LargeObjectSpace {
   // Free bytes at the end of the space.
   size_t free_end_ GUARDED_BY(lock_);
   FreeBlocks free_blocks_ GUARDED_BY(lock_);
+  // Copies of GetFreeBytes() and GetLargestFreeBlockSize() for the allocation fast path, which
+  // checks for fragmentation without taking lock_.
+  std::atomic<size_t> cached_free_bytes_;
+  std::atomic<size_t> cached_largest_free_block_;
 };
 
 }  // namespace space
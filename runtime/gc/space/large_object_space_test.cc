@@ -182,6 +182,42 @@ TEST_F(LargeObjectSpaceTest, RaceTest) {
   RaceTest();
 }
 
+TEST_F(LargeObjectSpaceTest, FreeListFragmentation) {
+  Thread* const self = Thread::Current();
+  static constexpr size_t kNumAllocations = 8;
+  const size_t allocation_size = 4 * FreeListSpace::kAlignment;
+  std::unique_ptr<FreeListSpace> los(
+      FreeListSpace::Create("large object space", kNumAllocations * allocation_size));
+  std::vector<mirror::Object*> objs;
+  for (size_t i = 0; i < kNumAllocations; ++i) {
+    size_t bytes_allocated = 0;
+    size_t bytes_tl_bulk_allocated;
+    mirror::Object* obj =
+        los->Alloc(self, allocation_size, &bytes_allocated, nullptr, &bytes_tl_bulk_allocated);
+    ASSERT_TRUE(obj != nullptr);
+    objs.push_back(obj);
+  }
+  EXPECT_FALSE(los->IsFragmentedFor(allocation_size));
+
+  // Free every other object: half of the space is free, but in holes of one allocation each.
+  for (size_t i = 0; i < kNumAllocations; i += 2) {
+    los->Free(self, objs[i]);
+  }
+  EXPECT_FALSE(los->IsFragmentedFor(allocation_size));
+  EXPECT_TRUE(los->IsFragmentedFor(allocation_size + 1));
+  EXPECT_TRUE(los->IsFragmentedFor(2 * allocation_size));
+  // Not enough free memory at all is not fragmentation.
+  EXPECT_FALSE(los->IsFragmentedFor((kNumAllocations / 2 + 1) * allocation_size));
+
+  std::ostringstream oss;
+  los->DumpFragmentation(oss);
+  EXPECT_NE(oss.str().find("fragmentation 75%"), std::string::npos) << oss.str();
+
+  // Freeing a neighbour coalesces the holes.
+  los->Free(self, objs[1]);
+  EXPECT_FALSE(los->IsFragmentedFor(3 * allocation_size));
+}
+
 }  // namespace space
 }  // namespace gc
 }  // namespace art
@@ -228,12 +228,10 @@ inline void RegionSpace::ScanUnevacFromSpace(accounting::ContinuousSpaceBitmap*
 }
 
 template<bool kToSpaceOnly, typename Visitor>
-inline void RegionSpace::WalkInternal(Visitor&& visitor) {
-  // TODO: MutexLock on region_lock_ won't work due to lock order
-  // issues (the classloader classes lock and the monitor lock). We
-  // call this with threads suspended.
-  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
-  for (size_t i = 0; i < num_regions_; ++i) {
+inline void RegionSpace::WalkInternal(size_t begin, size_t end, Visitor&& visitor) {
+  DCHECK_LE(begin, end);
+  DCHECK_LE(end, num_regions_);
+  for (size_t i = begin; i < end; ++i) {
     Region* r = &regions_[i];
     if (r->IsFree() || (kToSpaceOnly && !r->IsInToSpace())) {
       continue;
@@ -308,11 +306,20 @@ inline void RegionSpace::WalkNonLargeRegion(Visitor&& visitor, const Region* r)
 
 template <typename Visitor>
 inline void RegionSpace::Walk(Visitor&& visitor) {
-  WalkInternal</* kToSpaceOnly= */ false>(visitor);
+  // TODO: MutexLock on region_lock_ won't work due to lock order
+  // issues (the classloader classes lock and the monitor lock). We
+  // call this with threads suspended.
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  WalkInternal</* kToSpaceOnly= */ false>(0u, num_regions_, visitor);
 }
 template <typename Visitor>
 inline void RegionSpace::WalkToSpace(Visitor&& visitor) {
-  WalkInternal</* kToSpaceOnly= */ true>(visitor);
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  WalkInternal</* kToSpaceOnly= */ true>(0u, num_regions_, visitor);
+}
+template <typename Visitor>
+inline void RegionSpace::WalkRegions(size_t begin, size_t end, Visitor&& visitor) {
+  WalkInternal</* kToSpaceOnly= */ false>(begin, end, visitor);
 }
 
 inline mirror::Object* RegionSpace::GetNextObject(mirror::Object* obj) {
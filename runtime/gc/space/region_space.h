@@ -218,6 +218,12 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   ALWAYS_INLINE void Walk(Visitor&& visitor) REQUIRES(Locks::mutator_lock_);
   template <typename Visitor>
   ALWAYS_INLINE void WalkToSpace(Visitor&& visitor) REQUIRES(Locks::mutator_lock_);
+  // Like Walk() but only for the regions with index in [begin, end). Does not check the mutator
+  // lock so that it can be called from thread pool workers of a thread that holds it exclusively.
+  // Disjoint ranges may be walked concurrently.
+  template <typename Visitor>
+  ALWAYS_INLINE void WalkRegions(size_t begin, size_t end, Visitor&& visitor)
+      NO_THREAD_SAFETY_ANALYSIS;
 
   // Scans regions and calls visitor for objects in unevac-space corresponding
   // to the bits set in 'bitmap'.
@@ -641,7 +647,8 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   };
 
   template<bool kToSpaceOnly, typename Visitor>
-  ALWAYS_INLINE void WalkInternal(Visitor&& visitor) NO_THREAD_SAFETY_ANALYSIS;
+  ALWAYS_INLINE void WalkInternal(size_t begin, size_t end, Visitor&& visitor)
+      NO_THREAD_SAFETY_ANALYSIS;
 
   // Visitor will be iterating on objects in increasing address order.
   template<typename Visitor>
@@ -16,10 +16,14 @@
 
 #include "intern_table-inl.h"
 
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "dex/utf.h"
 #include "gc/collector/garbage_collector.h"
+#include "gc/heap.h"
 #include "gc/space/image_space.h"
 #include "gc/weak_root_state.h"
 #include "gc_root-inl.h"
@@ -30,11 +34,21 @@
 #include "mirror/object_array-inl.h"
 #include "mirror/string-inl.h"
 #include "object_callbacks.h"
+#include "runtime.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread.h"
 
 namespace art {
 
+// Weak intern tables with fewer entries than this are swept serially.
+static constexpr size_t kMinParallelSweepSize = 16 * KB;
+// Number of bucket ranges per worker when sweeping in parallel, to balance the load.
+static constexpr size_t kSweepChunksPerWorker = 4;
+// The strong table inserted into is frozen once it holds this many strings and at least as many as
+// the table frozen before it, so the number of tables grows logarithmically with the number of
+// strings interned at runtime.
+static constexpr size_t kMinFreezeSize = 1 * KB;
+
 InternTable::InternTable()
     : log_new_roots_(false),
       weak_intern_condition_("New intern condition", *Locks::intern_table_lock_),
@@ -95,8 +109,14 @@ ObjPtr<mirror::String> InternTable::LookupWeak(Thread* self, ObjPtr<mirror::Stri
 }
 
 ObjPtr<mirror::String> InternTable::LookupStrong(Thread* self, ObjPtr<mirror::String> s) {
+  const Table::FrozenSets* searched_frozen_sets;
+  ObjPtr<mirror::String> result =
+      LookupStrongFrozen(GcRoot<mirror::String>(s), &searched_frozen_sets);
+  if (result != nullptr) {
+    return result;
+  }
   MutexLock mu(self, *Locks::intern_table_lock_);
-  return LookupStrongLocked(s);
+  return strong_interns_.Find(s, searched_frozen_sets);
 }
 
 ObjPtr<mirror::String> InternTable::LookupStrong(Thread* self,
@@ -106,8 +126,22 @@ ObjPtr<mirror::String> InternTable::LookupStrong(Thread* self,
   Utf8String string(utf16_length,
                     utf8_data,
                     ComputeUtf16HashFromModifiedUtf8(utf8_data, utf16_length));
+  const Table::FrozenSets* searched_frozen_sets;
+  ObjPtr<mirror::String> result = LookupStrongFrozen(string, &searched_frozen_sets);
+  if (result != nullptr) {
+    return result;
+  }
   MutexLock mu(self, *Locks::intern_table_lock_);
-  return strong_interns_.Find(string);
+  return strong_interns_.Find(string, searched_frozen_sets);
+}
+
+template <typename Key>
+ObjPtr<mirror::String> InternTable::LookupStrongFrozen(
+    const Key& key,
+    const Table::FrozenSets** searched_frozen_sets) const NO_THREAD_SAFETY_ANALYSIS {
+  // `strong_interns_` itself is guarded by the lock, but the frozen tables are only reached
+  // through the published snapshot.
+  return strong_interns_.FindFrozen(key, searched_frozen_sets);
 }
 
 ObjPtr<mirror::String> InternTable::LookupWeakLocked(ObjPtr<mirror::String> s) {
@@ -133,6 +167,10 @@ ObjPtr<mirror::String> InternTable::InsertStrong(ObjPtr<mirror::String> s) {
     new_strong_intern_roots_.push_back(GcRoot<mirror::String>(s));
   }
   strong_interns_.Insert(s);
+  // The image writer expects all the strings it interns in a single table.
+  if (!runtime->IsAotCompiler()) {
+    strong_interns_.MaybeFreezeLastTable();
+  }
   return s;
 }
 
@@ -203,6 +241,13 @@ ObjPtr<mirror::String> InternTable::Insert(ObjPtr<mirror::String> s,
   if (s == nullptr) {
     return nullptr;
   }
+  // Strings in the frozen strong tables are found without taking the lock.
+  const Table::FrozenSets* searched_frozen_sets;
+  ObjPtr<mirror::String> frozen = LookupStrongFrozen(GcRoot<mirror::String>(s),
+                                                     &searched_frozen_sets);
+  if (frozen != nullptr) {
+    return frozen;
+  }
   Thread* const self = Thread::Current();
   MutexLock mu(self, *Locks::intern_table_lock_);
   if (kDebugLocking && !holding_locks) {
@@ -218,7 +263,7 @@ ObjPtr<mirror::String> InternTable::Insert(ObjPtr<mirror::String> s,
       }
     }
     // Check the strong table for a match.
-    ObjPtr<mirror::String> strong = LookupStrongLocked(s);
+    ObjPtr<mirror::String> strong = strong_interns_.Find(s, searched_frozen_sets);
     if (strong != nullptr) {
       return strong;
     }
@@ -302,9 +347,9 @@ bool InternTable::ContainsWeak(ObjPtr<mirror::String> s) {
   return LookupWeak(Thread::Current(), s) == s;
 }
 
-void InternTable::SweepInternTableWeaks(IsMarkedVisitor* visitor) {
+void InternTable::SweepInternTableWeaks(IsMarkedVisitor* visitor, size_t num_workers) {
   MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  weak_interns_.SweepWeaks(visitor);
+  weak_interns_.SweepWeaks(visitor, num_workers);
 }
 
 void InternTable::Table::Remove(ObjPtr<mirror::String> s) {
@@ -312,16 +357,42 @@ void InternTable::Table::Remove(ObjPtr<mirror::String> s) {
     auto it = table.set_.find(GcRoot<mirror::String>(s));
     if (it != table.set_.end()) {
       table.set_.erase(it);
+      if (&table != &tables_.back()) {
+        // Frozen tables lose entries here when the GC moves a logged strong root or a
+        // transaction is rolled back. The erase may move another string out from under a
+        // concurrent FindFrozen(); with a new snapshot, the FindImpl() that follows it no longer
+        // skips the frozen tables.
+        PublishFrozenSets();
+      }
       return;
     }
   }
   LOG(FATAL) << "Attempting to remove non-interned string " << s->ToModifiedUtf8();
 }
 
-ObjPtr<mirror::String> InternTable::Table::Find(ObjPtr<mirror::String> s) {
+ObjPtr<mirror::String> InternTable::Table::Find(ObjPtr<mirror::String> s,
+                                                const FrozenSets* searched_frozen_sets) {
+  return FindImpl(GcRoot<mirror::String>(s), searched_frozen_sets);
+}
+
+ObjPtr<mirror::String> InternTable::Table::Find(const Utf8String& string,
+                                                const FrozenSets* searched_frozen_sets) {
+  return FindImpl(string, searched_frozen_sets);
+}
+
+template <typename Key>
+ObjPtr<mirror::String> InternTable::Table::FindImpl(const Key& key,
+                                                    const FrozenSets* searched_frozen_sets) {
   Locks::intern_table_lock_->AssertHeld(Thread::Current());
+  if (searched_frozen_sets != nullptr &&
+      searched_frozen_sets == frozen_sets_.load(std::memory_order_relaxed)) {
+    // The frozen tables have not changed since they were searched.
+    UnorderedSet& set = tables_.back().set_;
+    auto it = set.find(key);
+    return (it != set.end()) ? it->Read() : nullptr;
+  }
   for (InternalTable& table : tables_) {
-    auto it = table.set_.find(GcRoot<mirror::String>(s));
+    auto it = table.set_.find(key);
     if (it != table.set_.end()) {
       return it->Read();
     }
@@ -329,12 +400,18 @@ ObjPtr<mirror::String> InternTable::Table::Find(ObjPtr<mirror::String> s) {
   return nullptr;
 }
 
-ObjPtr<mirror::String> InternTable::Table::Find(const Utf8String& string) {
-  Locks::intern_table_lock_->AssertHeld(Thread::Current());
-  for (InternalTable& table : tables_) {
-    auto it = table.set_.find(string);
-    if (it != table.set_.end()) {
-      return it->Read();
+template <typename Key>
+ObjPtr<mirror::String> InternTable::Table::FindFrozen(
+    const Key& key,
+    const FrozenSets** searched_frozen_sets) const {
+  const FrozenSets* frozen_sets = frozen_sets_.load(std::memory_order_acquire);
+  *searched_frozen_sets = frozen_sets;
+  if (frozen_sets != nullptr) {
+    for (const UnorderedSet* set : *frozen_sets) {
+      auto it = set->find(key);
+      if (it != set->end()) {
+        return it->Read();
+      }
     }
   }
   return nullptr;
@@ -342,6 +419,34 @@ ObjPtr<mirror::String> InternTable::Table::Find(const Utf8String& string) {
 
 void InternTable::Table::AddNewTable() {
   tables_.push_back(InternalTable());
+  PublishFrozenSets();
+}
+
+void InternTable::Table::MaybeFreezeLastTable() {
+  const size_t size = tables_.back().Size();
+  if (size >= std::max(kMinFreezeSize, last_frozen_size_)) {
+    last_frozen_size_ = size;
+    Runtime* const runtime = Runtime::Current();
+    InternalTable new_table;
+    new_table.set_.SetLoadFactor(runtime->GetHashTableMinLoadFactor(),
+                                 runtime->GetHashTableMaxLoadFactor());
+    tables_.push_back(std::move(new_table));
+    PublishFrozenSets();
+  }
+}
+
+void InternTable::Table::PublishFrozenSets() {
+  DCHECK(!tables_.empty());
+  auto frozen_sets = std::make_unique<FrozenSets>();
+  frozen_sets->reserve(tables_.size() - 1u);
+  for (size_t i = 0; i + 1u < tables_.size(); ++i) {
+    if (!tables_[i].Empty()) {
+      frozen_sets->push_back(&tables_[i].set_);
+    }
+  }
+  // Release so that lock-free readers see the contents of the newly frozen sets.
+  frozen_sets_.store(frozen_sets.get(), std::memory_order_release);
+  published_frozen_sets_.push_back(std::move(frozen_sets));
 }
 
 void InternTable::Table::Insert(ObjPtr<mirror::String> s) {
@@ -361,13 +466,62 @@ void InternTable::Table::VisitRoots(RootVisitor* visitor) {
   }
 }
 
-void InternTable::Table::SweepWeaks(IsMarkedVisitor* visitor) {
+void InternTable::Table::SweepWeaks(IsMarkedVisitor* visitor, size_t num_workers) {
   for (InternalTable& table : tables_) {
-    SweepWeaks(&table.set_, visitor);
+    SweepWeaks(&table.set_, visitor, num_workers);
   }
 }
 
-void InternTable::Table::SweepWeaks(UnorderedSet* set, IsMarkedVisitor* visitor) {
+void InternTable::Table::SweepWeaks(UnorderedSet* set,
+                                    IsMarkedVisitor* visitor,
+                                    size_t num_workers) {
+  if (num_workers > 1 && set->size() >= kMinParallelSweepSize) {
+    // Look up the entries in parallel by bucket range. Live entries are updated in place, which
+    // does not change their hash. Dead entries are erased in a serial pass afterwards since
+    // erasing moves other entries between buckets.
+    const size_t num_buckets = set->NumBuckets();
+    const size_t num_chunks = num_workers * kSweepChunksPerWorker;
+    const size_t chunk_size = (num_buckets + num_chunks - 1) / num_chunks;
+    std::vector<std::vector<mirror::Object*>> worker_dead_objects(num_workers);
+    std::vector<std::function<void(size_t)>> chunks;
+    for (size_t begin = 0; begin < num_buckets; begin += chunk_size) {
+      const size_t end = std::min(begin + chunk_size, num_buckets);
+      chunks.push_back([set, visitor, begin, end, &worker_dead_objects](size_t worker_index)
+          NO_THREAD_SAFETY_ANALYSIS {
+        std::vector<mirror::Object*>* dead_objects = &worker_dead_objects[worker_index];
+        set->VisitBucketRange(begin, end, [&](GcRoot<mirror::String>& root)
+            NO_THREAD_SAFETY_ANALYSIS {
+          // This does not need a read barrier because this is called by GC.
+          mirror::Object* object = root.Read<kWithoutReadBarrier>();
+          mirror::Object* new_object = visitor->IsMarked(object);
+          if (new_object == nullptr) {
+            dead_objects->push_back(object);
+          } else {
+            root = GcRoot<mirror::String>(new_object->AsString());
+          }
+        });
+      });
+    }
+    Runtime::Current()->GetHeap()->RunParallelChunks(Thread::Current(), num_workers, chunks);
+    std::vector<mirror::Object*> dead_objects;
+    for (const std::vector<mirror::Object*>& objects : worker_dead_objects) {
+      dead_objects.insert(dead_objects.end(), objects.begin(), objects.end());
+    }
+    if (dead_objects.empty()) {
+      return;
+    }
+    // No live entry, forwarded or not, can share an address with a dead object.
+    std::sort(dead_objects.begin(), dead_objects.end());
+    for (auto it = set->begin(), end = set->end(); it != end;) {
+      mirror::Object* object = it->Read<kWithoutReadBarrier>();
+      if (std::binary_search(dead_objects.begin(), dead_objects.end(), object)) {
+        it = set->erase(it);
+      } else {
+        ++it;
+      }
+    }
+    return;
+  }
   for (auto it = set->begin(), end = set->end(); it != end;) {
     // This does not need a read barrier because this is called by GC.
     mirror::Object* object = it->Read<kWithoutReadBarrier>();
@@ -403,7 +557,7 @@ void InternTable::ChangeWeakRootStateLocked(gc::WeakRootState new_state) {
   }
 }
 
-InternTable::Table::Table() {
+InternTable::Table::Table() : frozen_sets_(nullptr), last_frozen_size_(0u) {
   Runtime* const runtime = Runtime::Current();
   InternalTable initial_table;
   initial_table.set_.SetLoadFactor(runtime->GetHashTableMinLoadFactor(),
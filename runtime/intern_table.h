@@ -17,6 +17,11 @@
 #ifndef ART_RUNTIME_INTERN_TABLE_H_
 #define ART_RUNTIME_INTERN_TABLE_H_
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
 #include "base/allocator.h"
 #include "base/hash_set.h"
 #include "base/mutex.h"
@@ -141,13 +146,16 @@ class InternTable {
   ObjPtr<mirror::String> InternWeak(ObjPtr<mirror::String> s) REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(!Roles::uninterruptible_);
 
-  void SweepInternTableWeaks(IsMarkedVisitor* visitor) REQUIRES_SHARED(Locks::mutator_lock_)
-      REQUIRES(!Locks::intern_table_lock_);
+  // Sweep the weak interns. Large tables are split between up to `num_workers` threads of the
+  // heap thread pool, so this must be called by the thread running the GC.
+  void SweepInternTableWeaks(IsMarkedVisitor* visitor, size_t num_workers = 1)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!Locks::intern_table_lock_);
 
   bool ContainsWeak(ObjPtr<mirror::String> s) REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(!Locks::intern_table_lock_);
 
-  // Lookup a strong intern, returns null if not found.
+  // Lookup a strong intern, returns null if not found. Strings in the frozen tables are found
+  // without taking the intern table lock.
   ObjPtr<mirror::String> LookupStrong(Thread* self, ObjPtr<mirror::String> s)
       REQUIRES(!Locks::intern_table_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -211,8 +219,15 @@ class InternTable {
  private:
   // Table which holds pre zygote and post zygote interned strings. There is one instance for
   // weak interns and strong interns.
+  //
+  // Only the last internal table is inserted into. The others are frozen and, for the strong
+  // interns, may be searched without holding the intern table lock through a snapshot of their
+  // sets that is republished whenever a table is added or a frozen table is modified.
   class Table {
    public:
+    // Sets of the frozen tables, in search order. Never modified once published.
+    using FrozenSets = std::vector<const UnorderedSet*>;
+
     class InternalTable {
      public:
       InternalTable() = default;
@@ -242,20 +257,31 @@ class InternTable {
     };
 
     Table();
-    ObjPtr<mirror::String> Find(ObjPtr<mirror::String> s) REQUIRES_SHARED(Locks::mutator_lock_)
-        REQUIRES(Locks::intern_table_lock_);
-    ObjPtr<mirror::String> Find(const Utf8String& string) REQUIRES_SHARED(Locks::mutator_lock_)
-        REQUIRES(Locks::intern_table_lock_);
+    // If `searched_frozen_sets` is the current snapshot, the frozen tables are known not to
+    // contain the string and only the last table is searched.
+    ObjPtr<mirror::String> Find(ObjPtr<mirror::String> s,
+                                const FrozenSets* searched_frozen_sets = nullptr)
+        REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+    ObjPtr<mirror::String> Find(const Utf8String& string,
+                                const FrozenSets* searched_frozen_sets = nullptr)
+        REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+    // Search the frozen tables without holding the lock. Returns the snapshot that was searched
+    // in `searched_frozen_sets`.
+    template <typename Key>
+    ObjPtr<mirror::String> FindFrozen(const Key& key, const FrozenSets** searched_frozen_sets) const
+        REQUIRES_SHARED(Locks::mutator_lock_);
     void Insert(ObjPtr<mirror::String> s) REQUIRES_SHARED(Locks::mutator_lock_)
         REQUIRES(Locks::intern_table_lock_);
     void Remove(ObjPtr<mirror::String> s)
         REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
     void VisitRoots(RootVisitor* visitor)
         REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
-    void SweepWeaks(IsMarkedVisitor* visitor)
+    void SweepWeaks(IsMarkedVisitor* visitor, size_t num_workers)
         REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
     // Add a new intern table that will only be inserted into from now on.
     void AddNewTable() REQUIRES(Locks::intern_table_lock_);
+    // Freeze the last table if it has grown enough since the last table was frozen this way.
+    void MaybeFreezeLastTable() REQUIRES(Locks::intern_table_lock_);
     size_t Size() const REQUIRES(Locks::intern_table_lock_);
     // Read and add an intern table from ptr.
     // Tables read are inserted at the front of the table array. Only checks for conflicts in
@@ -266,22 +292,44 @@ class InternTable {
         REQUIRES(!Locks::intern_table_lock_) REQUIRES_SHARED(Locks::mutator_lock_);
 
    private:
-    void SweepWeaks(UnorderedSet* set, IsMarkedVisitor* visitor)
+    void SweepWeaks(UnorderedSet* set, IsMarkedVisitor* visitor, size_t num_workers)
+        REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+
+    template <typename Key>
+    ObjPtr<mirror::String> FindImpl(const Key& key, const FrozenSets* searched_frozen_sets)
         REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
 
+    // Publish a new snapshot of the frozen tables.
+    void PublishFrozenSets() REQUIRES(Locks::intern_table_lock_);
+
     // Add a table to the front of the tables vector.
     void AddInternStrings(UnorderedSet&& intern_strings, bool is_boot_image)
         REQUIRES(Locks::intern_table_lock_) REQUIRES_SHARED(Locks::mutator_lock_);
 
     // We call AddNewTable when we create the zygote to reduce private dirty pages caused by
     // modifying the zygote intern table. The back of table is modified when strings are interned.
-    std::vector<InternalTable> tables_;
+    // A deque keeps the sets referenced by the frozen snapshots in place when tables are added.
+    std::deque<InternalTable> tables_;
+
+    // The current snapshot, or null if there are no frozen tables.
+    std::atomic<const FrozenSets*> frozen_sets_;
+    // All snapshots published so far. Lock-free readers may still be using old snapshots, and
+    // tables are added rarely, so they are only freed with the table.
+    std::vector<std::unique_ptr<const FrozenSets>> published_frozen_sets_;
+    // Size of the last table frozen by MaybeFreezeLastTable().
+    size_t last_frozen_size_;
 
     friend class InternTable;
     friend class linker::ImageWriter;
     ART_FRIEND_TEST(InternTableTest, CrossHash);
   };
 
+  // Lookup a strong intern in the frozen tables without holding the intern table lock.
+  template <typename Key>
+  ObjPtr<mirror::String> LookupStrongFrozen(const Key& key,
+                                            const Table::FrozenSets** searched_frozen_sets) const
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   // Insert if non null, otherwise return null. Must be called holding the mutator lock.
   // If holding_locks is true, then we may also hold other locks. If holding_locks is true, then we
   // require GC is not running since it is not safe to wait while holding locks.
@@ -16,12 +16,19 @@
 
 #include "intern_table-inl.h"
 
+#include <string>
+#include <unordered_set>
+
 #include "base/hash_set.h"
+#include "class_root-inl.h"
 #include "common_runtime_test.h"
 #include "dex/utf.h"
+#include "gc/scoped_gc_critical_section.h"
 #include "gc_root-inl.h"
 #include "handle_scope-inl.h"
 #include "mirror/object.h"
+#include "mirror/object_array-alloc-inl.h"
+#include "mirror/object_array-inl.h"
 #include "mirror/string.h"
 #include "scoped_thread_state_change-inl.h"
 
@@ -144,6 +151,54 @@ TEST_F(InternTableTest, SweepInternTableWeaks) {
   EXPECT_EQ(3U, t.Size());
 }
 
+class SetPredicate : public IsMarkedVisitor {
+ public:
+  explicit SetPredicate(const std::unordered_set<mirror::Object*>* dead) : dead_(dead) {}
+
+  mirror::Object* IsMarked(mirror::Object* s) override REQUIRES_SHARED(Locks::mutator_lock_) {
+    return dead_->find(s) != dead_->end() ? nullptr : s;
+  }
+
+ private:
+  const std::unordered_set<mirror::Object*>* const dead_;
+};
+
+TEST_F(InternTableTest, SweepInternTableWeaksParallel) {
+  ScopedObjectAccess soa(Thread::Current());
+  // The table is not a runtime root, so keep the GC from moving the strings.
+  gc::ScopedGCCriticalSection gcs(soa.Self(), gc::kGcCauseDebugger, gc::kCollectorTypeDebugger);
+  InternTable t;
+  // Enough weak interns to take the parallel path.
+  static constexpr size_t kNumStrings = 20000;
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::ObjectArray<mirror::String>> strings = hs.NewHandle(
+      mirror::ObjectArray<mirror::String>::Alloc(
+          soa.Self(), GetClassRoot<mirror::ObjectArray<mirror::String>>(), kNumStrings));
+  ASSERT_TRUE(strings != nullptr);
+  std::unordered_set<mirror::Object*> dead;
+  for (size_t i = 0; i < kNumStrings; ++i) {
+    std::string str = "weak " + std::to_string(i);
+    ObjPtr<mirror::String> s = mirror::String::AllocFromModifiedUtf8(soa.Self(), str.c_str());
+    ASSERT_TRUE(s != nullptr);
+    strings->Set(i, t.InternWeak(s));
+  }
+  for (size_t i = 0; i < kNumStrings; i += 2) {
+    dead.insert(strings->Get(i).Ptr());
+  }
+  EXPECT_EQ(kNumStrings, t.Size());
+
+  SetPredicate p(&dead);
+  {
+    ReaderMutexLock mu(soa.Self(), *Locks::heap_bitmap_lock_);
+    t.SweepInternTableWeaks(&p, /* num_workers= */ 4);
+  }
+
+  EXPECT_EQ(kNumStrings / 2, t.Size());
+  for (size_t i = 0; i < kNumStrings; ++i) {
+    EXPECT_EQ(i % 2 != 0, t.ContainsWeak(strings->Get(i))) << i;
+  }
+}
+
 TEST_F(InternTableTest, ContainsWeak) {
   ScopedObjectAccess soa(Thread::Current());
   {
@@ -234,4 +289,29 @@ TEST_F(InternTableTest, LookupStrong) {
   EXPECT_TRUE(lookup_foobbS == nullptr);
 }
 
+TEST_F(InternTableTest, LookupStrongFrozen) {
+  ScopedObjectAccess soa(Thread::Current());
+  InternTable intern_table;
+  StackHandleScope<3> hs(soa.Self());
+  Handle<mirror::String> foo(hs.NewHandle(intern_table.InternStrong(3, "foo")));
+  // Freeze the table holding "foo", later strings go to a new table.
+  intern_table.AddNewTable();
+  Handle<mirror::String> bar(hs.NewHandle(intern_table.InternStrong(3, "bar")));
+  ASSERT_TRUE(foo != nullptr);
+  ASSERT_TRUE(bar != nullptr);
+  EXPECT_OBJ_PTR_EQ(intern_table.LookupStrong(soa.Self(), 3, "foo"), foo.Get());
+  EXPECT_OBJ_PTR_EQ(intern_table.LookupStrong(soa.Self(), 3, "bar"), bar.Get());
+  EXPECT_OBJ_PTR_EQ(intern_table.InternStrong(3, "foo"), foo.Get());
+  Handle<mirror::String> foo_copy(
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "foo")));
+  EXPECT_OBJ_PTR_EQ(intern_table.LookupStrong(soa.Self(), foo_copy.Get()), foo.Get());
+  EXPECT_OBJ_PTR_EQ(intern_table.InternStrong(foo_copy.Get()), foo.Get());
+  EXPECT_EQ(2u, intern_table.StrongSize());
+  // Freezing "bar" as well must neither lose nor duplicate it.
+  intern_table.AddNewTable();
+  EXPECT_OBJ_PTR_EQ(intern_table.InternStrong(3, "bar"), bar.Get());
+  EXPECT_TRUE(intern_table.LookupStrong(soa.Self(), 3, "baz") == nullptr);
+  EXPECT_EQ(2u, intern_table.StrongSize());
+}
+
 }  // namespace art
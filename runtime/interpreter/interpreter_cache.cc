@@ -15,14 +15,115 @@
  */
 
 #include "interpreter_cache.h"
+
+#include <algorithm>
+
+#include "dex/dex_instruction.h"
+#include "runtime.h"
 #include "thread-inl.h"
 
 namespace art {
 
+// Whether the value cached for the instruction at `key` is a heap object, which the GC needs to
+// visit. See Thread::SweepInterpreterCache().
+static bool HasObjectValue(const void* key) {
+  switch (reinterpret_cast<const Instruction*>(key)->Opcode()) {
+    case Instruction::NEW_INSTANCE:
+    case Instruction::CHECK_CAST:
+    case Instruction::INSTANCE_OF:
+    case Instruction::NEW_ARRAY:
+    case Instruction::CONST_CLASS:
+    case Instruction::CONST_STRING:
+    case Instruction::CONST_STRING_JUMBO:
+      return true;
+    default:
+      return false;
+  }
+}
+
 void InterpreterCache::Clear(Thread* owning_thread) {
   DCHECK(owning_thread->GetInterpreterCache() == this);
   DCHECK(owning_thread == Thread::Current() || owning_thread->IsSuspended());
   data_.fill(Entry{});
+  std::fill_n(second_level_.get(), GetSecondLevelSize(), Entry{});
+  // The misses that follow say nothing about the working set before the clearing.
+  num_misses_ = 0u;
+  num_conflicts_ = 0u;
+  num_second_level_hits_ = 0u;
+}
+
+void InterpreterCache::Set(const void* key, size_t value) {
+  DCHECK(IsCalledFromOwningThread());
+  Entry& entry = data_[IndexOf(key)];
+  if (entry.first != nullptr && entry.first != key) {
+    ++num_conflicts_;
+    if (second_level_ != nullptr) {
+      InsertIntoSecondLevel(entry);
+    }
+  }
+  entry = Entry{key, value};
+  if (UNLIKELY(++num_misses_ == kAdaptInterval)) {
+    Adapt();
+  }
+}
+
+bool InterpreterCache::GetFromSecondLevel(const void* key, /* out */ size_t* value) {
+  DCHECK(second_level_ != nullptr);
+  ArrayRef<Entry> set = GetSecondLevelSet(key);
+  auto it = std::find_if(set.begin(), set.end(), [=](const Entry& e) { return e.first == key; });
+  if (it == set.end()) {
+    return false;
+  }
+  ++num_second_level_hits_;
+  *value = it->second;
+  // Move the entry to the first level. Its slot gets the entry it replaces there, unless that
+  // one has an object value, which only the first level may hold.
+  Entry& entry = data_[IndexOf(key)];
+  *it = (entry.first != nullptr && !HasObjectValue(entry.first)) ? entry : Entry{};
+  entry = Entry{key, *value};
+  return true;
+}
+
+void InterpreterCache::InsertIntoSecondLevel(const Entry& entry) {
+  if (HasObjectValue(entry.first)) {
+    return;
+  }
+  // Sets are ordered from most to least recently inserted; the last entry gets evicted.
+  ArrayRef<Entry> set = GetSecondLevelSet(entry.first);
+  std::copy_backward(set.begin(), set.end() - 1, set.end());
+  set[0] = entry;
+}
+
+void InterpreterCache::Adapt() {
+  metrics::ArtMetrics* metrics =
+      Runtime::Current() != nullptr ? Runtime::Current()->GetMetrics() : nullptr;
+  if (metrics != nullptr) {
+    metrics->InterpreterCacheMissCount()->Add(num_misses_);
+    metrics->InterpreterCacheSecondLevelHitCount()->Add(num_second_level_hits_);
+  }
+  if (num_conflicts_ * 2 > num_misses_) {
+    // Most misses are conflicts: the working set does not fit.
+    if (num_second_level_sets_ < kMaxSecondLevelSets) {
+      ResizeSecondLevel(std::max(num_second_level_sets_ * 2, kMinSecondLevelSets));
+    }
+  } else if (num_second_level_sets_ != 0u && num_second_level_hits_ * 16 < num_misses_) {
+    // The second level rarely saves a miss: give memory back.
+    size_t num_sets = num_second_level_sets_ / 2;
+    ResizeSecondLevel(num_sets < kMinSecondLevelSets ? 0u : num_sets);
+  }
+  num_misses_ = 0u;
+  num_conflicts_ = 0u;
+  num_second_level_hits_ = 0u;
+}
+
+void InterpreterCache::ResizeSecondLevel(size_t num_sets) {
+  DCHECK(num_sets == 0u || IsPowerOfTwo(num_sets));
+  // Start empty rather than rehashing; the entries are refilled on the next misses.
+  second_level_.reset(num_sets != 0u ? new Entry[num_sets * kSecondLevelWays]() : nullptr);
+  num_second_level_sets_ = num_sets;
+  if (Runtime::Current() != nullptr) {
+    Runtime::Current()->GetMetrics()->InterpreterCacheResizeCount()->AddOne();
+  }
 }
 
 bool InterpreterCache::IsCalledFromOwningThread() {
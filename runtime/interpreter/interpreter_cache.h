@@ -19,7 +19,9 @@
 
 #include <array>
 #include <atomic>
+#include <memory>
 
+#include "base/array_ref.h"
 #include "base/bit_utils.h"
 #include "base/macros.h"
 
@@ -42,6 +44,15 @@ class Thread;
 // We ensure consistency of the cache by clearing it
 // whenever any dex file is unloaded.
 //
+// The cache has two levels. The first level is the direct-mapped array that
+// the assembly interpreters read directly; its layout is fixed. Entries that
+// it evicts on conflicts move to a set-associative second level, which is only
+// looked up from C++ after a first level miss, before resolving again. The
+// second level is allocated, grown and shrunk per thread depending on how many
+// of the misses are conflicts and how many of them the second level catches.
+// It never holds entries whose value is a heap object (classes, strings), so
+// the GC does not need to sweep it.
+//
 // Aligned to 16-bytes to make it easier to get the address of the cache
 // from assembly (it ensures that the offset is valid immediate value).
 class ALIGNED(16) InterpreterCache {
@@ -53,13 +64,24 @@ class ALIGNED(16) InterpreterCache {
   // Value of 256 has around 75% cache hit rate.
   static constexpr size_t kSize = 256;
 
+  // Associativity and bounds of the number of sets of the second level.
+  static constexpr size_t kSecondLevelWays = 4;
+  static constexpr size_t kMinSecondLevelSets = 64;
+  static constexpr size_t kMaxSecondLevelSets = 1024;
+
+  // Number of misses between decisions to resize the second level.
+  static constexpr size_t kAdaptInterval = 4096;
+
   InterpreterCache() {
+    // The assembly interpreters index the first level from the start of the cache.
+    static_assert(OFFSETOF_MEMBER(InterpreterCache, data_) == 0, "First level must be first");
     // We can not use the Clear() method since the constructor will not
     // be called from the owning thread.
     data_.fill(Entry{});
   }
 
-  // Clear the whole cache. It requires the owning thread for DCHECKs.
+  // Clear the whole cache and start a new adaptation interval.
+  // It requires the owning thread for DCHECKs.
   void Clear(Thread* owning_thread);
 
   ALWAYS_INLINE bool Get(const void* key, /* out */ size_t* value) {
@@ -69,21 +91,40 @@ class ALIGNED(16) InterpreterCache {
       *value = entry.second;
       return true;
     }
-    return false;
+    return second_level_ != nullptr && GetFromSecondLevel(key, value);
   }
 
-  ALWAYS_INLINE void Set(const void* key, size_t value) {
-    DCHECK(IsCalledFromOwningThread());
-    data_[IndexOf(key)] = Entry{key, value};
-  }
+  // Record the value of `key` after a miss.
+  void Set(const void* key, size_t value);
 
   std::array<Entry, kSize>& GetArray() {
     return data_;
   }
 
+  // Number of entries of the second level, zero if it is not allocated.
+  size_t GetSecondLevelSize() const {
+    return num_second_level_sets_ * kSecondLevelWays;
+  }
+
  private:
   bool IsCalledFromOwningThread();
 
+  // Look `key` up in the second level and, if found, swap it with the first level entry.
+  NO_INLINE bool GetFromSecondLevel(const void* key, /* out */ size_t* value);
+
+  void InsertIntoSecondLevel(const Entry& entry);
+
+  ArrayRef<Entry> GetSecondLevelSet(const void* key) {
+    DCHECK(IsPowerOfTwo(num_second_level_sets_));
+    size_t set = (reinterpret_cast<uintptr_t>(key) >> 2) & (num_second_level_sets_ - 1);
+    return ArrayRef<Entry>(second_level_.get() + set * kSecondLevelWays, kSecondLevelWays);
+  }
+
+  // Report the statistics of the last interval and resize the second level.
+  NO_INLINE void Adapt();
+
+  void ResizeSecondLevel(size_t num_sets);
+
   static ALWAYS_INLINE size_t IndexOf(const void* key) {
     static_assert(IsPowerOfTwo(kSize), "Size must be power of two");
     size_t index = (reinterpret_cast<uintptr_t>(key) >> 2) & (kSize - 1);
@@ -92,6 +133,15 @@ class ALIGNED(16) InterpreterCache {
   }
 
   std::array<Entry, kSize> data_;
+
+  std::unique_ptr<Entry[]> second_level_;
+  size_t num_second_level_sets_ = 0u;
+
+  // Statistics of the current interval. Misses are lookups that fell through to resolution,
+  // conflicts are misses that evicted an entry for another key.
+  size_t num_misses_ = 0u;
+  size_t num_conflicts_ = 0u;
+  size_t num_second_level_hits_ = 0u;
 };
 
 }  // namespace art
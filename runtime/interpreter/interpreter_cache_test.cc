@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interpreter_cache.h"
+
+#include <vector>
+
+#include "common_runtime_test.h"
+#include "dex/dex_instruction.h"
+#include "thread-current-inl.h"
+
+namespace art {
+
+class InterpreterCacheTest : public CommonRuntimeTest {
+ protected:
+  // Code units apart for two instructions to map to the same first level entry.
+  static constexpr size_t kConflictStride = InterpreterCache::kSize * 4 / sizeof(uint16_t);
+
+  InterpreterCacheTest() : insns_(4 * kConflictStride, Instruction::IGET) {
+    insns_[3 * kConflictStride] = Instruction::CONST_STRING;
+  }
+
+  // Instructions conflicting in the first level. The last one caches an object.
+  const void* Key(size_t i) const {
+    return insns_.data() + i * kConflictStride;
+  }
+
+  // Make misses that mostly conflict until the second level has been allocated.
+  void GrowSecondLevel(InterpreterCache* cache) {
+    for (size_t i = 0; i != InterpreterCache::kAdaptInterval; ++i) {
+      cache->Set(Key(i & 1), i);
+    }
+    ASSERT_NE(cache->GetSecondLevelSize(), 0u);
+  }
+
+  std::vector<uint16_t> insns_;
+};
+
+TEST_F(InterpreterCacheTest, SecondLevelKeepsConflictingEntries) {
+  Thread* self = Thread::Current();
+  InterpreterCache* cache = self->GetInterpreterCache();
+  cache->Clear(self);
+  GrowSecondLevel(cache);
+  EXPECT_GE(cache->GetSecondLevelSize(),
+            InterpreterCache::kMinSecondLevelSets * InterpreterCache::kSecondLevelWays);
+
+  cache->Set(Key(0), 10u);
+  cache->Set(Key(1), 11u);
+  cache->Set(Key(2), 12u);
+  size_t value;
+  ASSERT_TRUE(cache->Get(Key(0), &value));
+  EXPECT_EQ(value, 10u);
+  ASSERT_TRUE(cache->Get(Key(1), &value));
+  EXPECT_EQ(value, 11u);
+  ASSERT_TRUE(cache->Get(Key(2), &value));
+  EXPECT_EQ(value, 12u);
+
+  // Entries holding objects are dropped rather than moved to the second level.
+  cache->Set(Key(3), 13u);
+  cache->Set(Key(0), 10u);
+  EXPECT_FALSE(cache->Get(Key(3), &value));
+
+  cache->Clear(self);
+  EXPECT_FALSE(cache->Get(Key(0), &value));
+  EXPECT_FALSE(cache->Get(Key(1), &value));
+}
+
+TEST_F(InterpreterCacheTest, SecondLevelShrinksWhenUnused) {
+  Thread* self = Thread::Current();
+  InterpreterCache* cache = self->GetInterpreterCache();
+  cache->Clear(self);
+  GrowSecondLevel(cache);
+
+  // Misses without conflicts: the second level never helps and gets freed eventually.
+  for (size_t n = 0; n != 16 && cache->GetSecondLevelSize() != 0u; ++n) {
+    size_t old_size = cache->GetSecondLevelSize();
+    for (size_t i = 0; i != InterpreterCache::kAdaptInterval; ++i) {
+      cache->Set(Key(0), i);
+    }
+    EXPECT_LT(cache->GetSecondLevelSize(), old_size);
+  }
+  EXPECT_EQ(cache->GetSecondLevelSize(), 0u);
+  cache->Clear(self);
+}
+
+}  // namespace art
@@ -1858,6 +1858,81 @@ void ExecuteSwitchImplCpp(SwitchImplContext* ctx) {
       << "Entered interpreter from invoke without retry instruction being handled!";
 
   bool const interpret_one_instruction = ctx->interpret_one_instruction;
+#if defined(__GNUC__)
+  // Dispatch through a table of handler label addresses (the GCC/Clang "labels as values"
+  // extension) rather than a switch. Every handler then ends with its own indirect jump to the
+  // next handler, which branch predictors learn per opcode, instead of all instructions sharing
+  // the single indirect jump of the switch.
+  static const void* const handlers[] = {
+#define OPCODE_LABEL(OPCODE, OPCODE_NAME, NAME, FORMAT, i, a, e, v) &&HANDLER_##OPCODE_NAME,
+    DEX_INSTRUCTION_LIST(OPCODE_LABEL)
+#undef OPCODE_LABEL
+  };
+  static_assert(arraysize(handlers) == kNumPackedOpcodes, "One handler per opcode");
+  const Instruction* inst = next;
+  uint16_t inst_data;
+  bool exit;
+  bool success;
+  // Fetch `inst` and jump to its handler, running the preamble first if `run_preamble`.
+#define DISPATCH_INSTRUCTION(run_preamble)                                                        \
+  dex_pc = inst->GetDexPc(insns);                                                                 \
+  shadow_frame.SetDexPC(dex_pc);                                                                  \
+  TraceExecution(shadow_frame, inst, dex_pc);                                                     \
+  inst_data = inst->Fetch16(0);                                                                   \
+  exit = false;                                                                                   \
+  if ((run_preamble) &&                                                                           \
+      !InstructionHandler<do_access_check, transaction_active, Instruction::kInvalidFormat>(      \
+          ctx, instrumentation, self, shadow_frame, dex_pc, inst, inst_data, next, exit).         \
+          Preamble()) {                                                                           \
+    goto handler_failed;                                                                          \
+  }                                                                                               \
+  DCHECK_EQ(self->IsExceptionPending(), inst->Opcode(inst_data) == Instruction::MOVE_EXCEPTION);  \
+  goto *handlers[inst->Opcode(inst_data)];
+ dispatch:
+  // Full dispatch, with the preamble that handles forced returns and dex pc listeners.
+  DISPATCH_INSTRUCTION(/*run_preamble=*/ true)
+  // Each handler dispatches the next instruction itself. The preamble has nothing to do unless
+  // a frame pop is forced or dex pc listeners are installed, so that is checked inline and the
+  // full dispatch above is only used in those cases.
+#define OPCODE_CASE(OPCODE, OPCODE_NAME, NAME, FORMAT, i, a, e, v)                                \
+ HANDLER_##OPCODE_NAME:                                                                           \
+  next = inst->RelativeAt(Instruction::SizeInCodeUnits(Instruction::FORMAT));                     \
+  success = OP_##OPCODE_NAME<do_access_check, transaction_active>(                                \
+      ctx, instrumentation, self, shadow_frame, dex_pc, inst, inst_data, next, exit);             \
+  if (UNLIKELY(!success) || UNLIKELY(interpret_one_instruction)) {                                \
+    goto handler_failed;                                                                          \
+  }                                                                                               \
+  inst = next;                                                                                    \
+  if (UNLIKELY(shadow_frame.GetForcePopFrame()) ||                                                \
+      UNLIKELY(instrumentation->HasDexPcListeners())) {                                           \
+    goto dispatch;                                                                                \
+  }                                                                                               \
+  DISPATCH_INSTRUCTION(/*run_preamble=*/ false)
+  DEX_INSTRUCTION_LIST(OPCODE_CASE)
+#undef OPCODE_CASE
+#undef DISPATCH_INSTRUCTION
+ handler_failed:
+  if (exit) {
+    shadow_frame.SetDexPC(dex::kDexNoIndex);
+    return;  // Return statement or debugger forced exit.
+  }
+  if (self->IsExceptionPending()) {
+    if (!InstructionHandler<do_access_check, transaction_active, Instruction::kInvalidFormat>(
+            ctx, instrumentation, self, shadow_frame, dex_pc, inst, inst_data, next, exit).
+            HandlePendingException()) {
+      shadow_frame.SetDexPC(dex::kDexNoIndex);
+      return;  // Locally unhandled exception - return to caller.
+    }
+    // Continue execution in the catch block.
+  }
+  if (interpret_one_instruction) {
+    shadow_frame.SetDexPC(next->GetDexPc(insns));  // Record where we stopped.
+    ctx->result = ctx->result_register;
+    return;
+  }
+  inst = next;
+  goto dispatch;
+#else
   while (true) {
     const Instruction* const inst = next;
     dex_pc = inst->GetDexPc(insns);
@@ -1904,6 +1979,7 @@ void ExecuteSwitchImplCpp(SwitchImplContext* ctx) {
       return;
     }
   }
+#endif  // defined(__GNUC__)
 }  // NOLINT(readability/fn_size)
 
 }  // namespace interpreter
@@ -56,6 +56,7 @@
 #include "profile/profile_compilation_info.h"
 #include "scoped_thread_state_change-inl.h"
 #include "stack.h"
+#include "stack_map_cache.h"
 #include "thread-current-inl.h"
 #include "thread_list.h"
 
@@ -455,6 +456,8 @@ void JitCodeCache::FreeCodeAndData(const void* code_ptr) {
     data = GetRootTable(code_ptr);
   }  // else this is a JNI stub without any data.
 
+  // Stack walks cache stack map lookups by method header, drop them before the code is freed.
+  StackMapCache::InvalidateAll();
   FreeLocked(&private_region_, reinterpret_cast<uint8_t*>(allocation), data);
 }
 
@@ -106,6 +106,23 @@ constexpr std::optional<int32_t> EncodeDatumId(DatumId datum_id) {
     case DatumId::kFullGcTracingThroughputAvg:
       return std::make_optional(
           statsd::ART_DATUM_REPORTED__KIND__ART_DATUM_GC_FULL_HEAP_TRACING_THROUGHPUT_AVG_MB_PER_SEC);
+    // Safepoint statistics do not have an atoms.proto entry yet.
+    case DatumId::kSuspendAllCount:
+    case DatumId::kSlowSafepointCount:
+    case DatumId::kTimeToSafepoint:
+    case DatumId::kSuspendAllPauseTime:
+    case DatumId::kTimeToCheckpoint:
+      return std::nullopt;
+    // Startup class preloading statistics do not have an atoms.proto entry yet.
+    case DatumId::kStartupClassPreloadCount:
+    case DatumId::kStartupClassPreloadUsedCount:
+    case DatumId::kStartupClassPreloadTimeSaved:
+      return std::nullopt;
+    // Interpreter cache statistics do not have an atoms.proto entry yet.
+    case DatumId::kInterpreterCacheMissCount:
+    case DatumId::kInterpreterCacheSecondLevelHitCount:
+    case DatumId::kInterpreterCacheResizeCount:
+      return std::nullopt;
   }
 }
 
@@ -22,6 +22,7 @@
 
 #include "array.h"
 #include "base/bit_utils.h"
+#include "base/simd_ascii.h"
 #include "class.h"
 #include "class_root-inl.h"
 #include "gc/allocator_type.h"
@@ -69,10 +70,9 @@ class SetStringCountAndBytesVisitor {
     int32_t length = String::GetLengthFromCount(count_);
     const uint8_t* const src = reinterpret_cast<uint8_t*>(src_array_->GetData()) + offset_;
     if (string->IsCompressed()) {
-      uint8_t* valueCompressed = string->GetValueCompressed();
-      for (int i = 0; i < length; i++) {
-        valueCompressed[i] = (src[i] & 0xFF);
-      }
+      memcpy(string->GetValueCompressed(), src, length * sizeof(uint8_t));
+    } else if (high_byte_ == 0) {
+      WidenChars(src, string->GetValue(), length);
     } else {
       uint16_t* value = string->GetValue();
       for (int i = 0; i < length; i++) {
@@ -104,9 +104,7 @@ class SetStringCountAndValueVisitorFromCharArray {
     const uint16_t* const src = src_array_->GetData() + offset_;
     const int32_t length = String::GetLengthFromCount(count_);
     if (kUseStringCompression && String::IsCompressed(count_)) {
-      for (int i = 0; i < length; ++i) {
-        string->GetValueCompressed()[i] = static_cast<uint8_t>(src[i]);
-      }
+      NarrowChars(src, string->GetValueCompressed(), length);
     } else {
       memcpy(string->GetValue(), src, length * sizeof(uint16_t));
     }
@@ -140,9 +138,7 @@ class SetStringCountAndValueVisitorFromString {
     } else {
       const uint16_t* const src = src_string_->GetValue() + offset_;
       if (compressible) {
-        for (int i = 0; i < length; ++i) {
-          string->GetValueCompressed()[i] = static_cast<uint8_t>(src[i]);
-        }
+        NarrowChars(src, string->GetValueCompressed(), length);
       } else {
         memcpy(string->GetValue(), src, length * sizeof(uint16_t));
       }
@@ -20,6 +20,7 @@
 
 #include "android-base/stringprintf.h"
 
+#include "base/simd_ascii.h"
 #include "class-inl.h"
 #include "common_throws.h"
 #include "dex/utf.h"
@@ -95,12 +96,7 @@ inline int32_t String::GetUtfLength() {
 template<typename MemoryType>
 inline bool String::AllASCII(const MemoryType* chars, const int length) {
   static_assert(std::is_unsigned<MemoryType>::value, "Expecting unsigned MemoryType");
-  for (int i = 0; i < length; ++i) {
-    if (!IsASCII(chars[i])) {
-      return false;
-    }
-  }
-  return true;
+  return AllNonZeroAscii(chars, static_cast<size_t>(length));
 }
 
 inline bool String::DexFileStringAllASCII(const char* chars, const int length) {
@@ -19,6 +19,7 @@
 #include "arch/memcmp16.h"
 #include "array-alloc-inl.h"
 #include "base/array_ref.h"
+#include "base/simd_ascii.h"
 #include "base/stl_util.h"
 #include "class-inl.h"
 #include "dex/descriptors_names.h"
@@ -131,18 +132,12 @@ ObjPtr<String> String::DoConcat(Thread* self, Handle<String> h_this, Handle<Stri
     } else {
       uint16_t* new_value = new_string->GetValue();
       if (h_this->IsCompressed()) {
-        const uint8_t* value_this = h_this->GetValueCompressed();
-        for (int i = 0; i < length_this; ++i) {
-          new_value[i] = value_this[i];
-        }
+        WidenChars(h_this->GetValueCompressed(), new_value, length_this);
       } else {
         memcpy(new_value, h_this->GetValue(), length_this * sizeof(uint16_t));
       }
       if (h_arg->IsCompressed()) {
-        const uint8_t* value_arg = h_arg->GetValueCompressed();
-        for (int i = 0; i < length_arg; ++i) {
-          new_value[i + length_this] = value_arg[i];
-        }
+        WidenChars(h_arg->GetValueCompressed(), new_value + length_this, length_arg);
       } else {
         memcpy(new_value + length_this, h_arg->GetValue(), length_arg * sizeof(uint16_t));
       }
@@ -165,10 +160,7 @@ ObjPtr<String> String::AllocFromUtf16(Thread* self,
     set_string_count_visitor(obj, usable_size);
     ObjPtr<String> new_string = obj->AsString();
     if (compressible) {
-      uint8_t* value = new_string->GetValueCompressed();
-      for (int i = 0; i < utf16_length; ++i) {
-        value[i] = static_cast<uint8_t>(utf16_data_in[i]);
-      }
+      NarrowChars(utf16_data_in, new_string->GetValueCompressed(), utf16_length);
     } else {
       memcpy(new_string->GetValue(), utf16_data_in, utf16_length * sizeof(uint16_t));
     }
@@ -323,12 +315,7 @@ ObjPtr<CharArray> String::ToCharArray(Handle<String> h_this, Thread* self) {
   ObjPtr<CharArray> result = CharArray::Alloc(self, h_this->GetLength());
   if (result != nullptr) {
     if (h_this->IsCompressed()) {
-      int32_t length = h_this->GetLength();
-      const uint8_t* src = h_this->GetValueCompressed();
-      uint16_t* dest = result->GetData();
-      for (int i = 0; i < length; ++i) {
-        dest[i] = src[i];
-      }
+      WidenChars(h_this->GetValueCompressed(), result->GetData(), h_this->GetLength());
     } else {
       memcpy(result->GetData(), h_this->GetValue(), h_this->GetLength() * sizeof(uint16_t));
     }
@@ -343,10 +330,7 @@ void String::GetChars(int32_t start, int32_t end, Handle<CharArray> array, int32
   DCHECK_LE(start, end);
   int32_t length = end - start;
   if (IsCompressed()) {
-    const uint8_t* value = GetValueCompressed() + start;
-    for (int i = 0; i < length; ++i) {
-      data[i] = value[i];
-    }
+    WidenChars(GetValueCompressed() + start, data, length);
   } else {
     uint16_t* value = GetValue() + start;
     memcpy(data, value, length * sizeof(uint16_t));
@@ -97,6 +97,11 @@ void Monitor::Init(uint32_t lock_profiling_threshold,
 Monitor::Monitor(Thread* self, Thread* owner, ObjPtr<mirror::Object> obj, int32_t hash_code)
     : monitor_lock_("a monitor lock", kMonitorLock),
       num_waiters_(0),
+      spin_wait_iters_(Mutex::kDefaultSpinWaitIters),
+      spin_acquire_count_(0u),
+      block_acquire_count_(0u),
+      block_time_ns_(0u),
+      idle_sweeps_(0u),
       owner_(owner),
       lock_count_(0),
       obj_(GcRoot<mirror::Object>(obj)),
@@ -131,6 +136,11 @@ Monitor::Monitor(Thread* self,
                  MonitorId id)
     : monitor_lock_("a monitor lock", kMonitorLock),
       num_waiters_(0),
+      spin_wait_iters_(Mutex::kDefaultSpinWaitIters),
+      spin_acquire_count_(0u),
+      block_acquire_count_(0u),
+      block_time_ns_(0u),
+      idle_sweeps_(0u),
       owner_(owner),
       lock_count_(0),
       obj_(GcRoot<mirror::Object>(obj)),
@@ -426,14 +436,14 @@ bool Monitor::TryLock(Thread* self, bool spin) {
     lock_count_++;
     CHECK_NE(lock_count_, 0u);  // Abort on overflow.
   } else {
-    bool success = spin ? monitor_lock_.ExclusiveTryLockWithSpinning(self)
-        : monitor_lock_.ExclusiveTryLock(self);
+    bool success = spin ? SpinTryLock(self) : monitor_lock_.ExclusiveTryLock(self);
     if (!success) {
       return false;
     }
     DCHECK(owner_.load(std::memory_order_relaxed) == nullptr);
     owner_.store(self, std::memory_order_relaxed);
     CHECK_EQ(lock_count_, 0u);
+    MarkUsed();
     if (ATraceEnabled()) {
       SetLockingMethodNoProxy(self);
     }
@@ -443,6 +453,35 @@ bool Monitor::TryLock(Thread* self, bool spin) {
   return true;
 }
 
+bool Monitor::SpinTryLock(Thread* self) {
+  if (monitor_lock_.ExclusiveTryLock(self)) {
+    return true;
+  }
+  if (!monitor_lock_.ExclusiveTryLockWithSpinning(
+          self, spin_wait_iters_.load(std::memory_order_relaxed))) {
+    return false;
+  }
+  spin_acquire_count_.store(spin_acquire_count_.load(std::memory_order_relaxed) + 1u,
+                            std::memory_order_relaxed);
+  return true;
+}
+
+bool Monitor::IsIdle() const {
+  return idle_sweeps_.load(std::memory_order_relaxed) >= MonitorList::kIdleSweepsBeforeDeflation;
+}
+
+void Monitor::UpdateSpinWaitIters(uint64_t blocked_ns) {
+  // Double the spin on short blocks and halve it on long ones, so that a change in how long the
+  // monitor is held is picked up within a few contended acquisitions.
+  uint32_t spin_wait_iters = spin_wait_iters_.load(std::memory_order_relaxed);
+  if (blocked_ns < kShortBlockNs) {
+    spin_wait_iters = std::min(spin_wait_iters * 2u, kMaxSpinWaitIters);
+  } else {
+    spin_wait_iters = std::max(spin_wait_iters / 2u, kMinSpinWaitIters);
+  }
+  spin_wait_iters_.store(spin_wait_iters, std::memory_order_relaxed);
+}
+
 template <LockReason reason>
 void Monitor::Lock(Thread* self) {
   bool called_monitors_callback = false;
@@ -514,13 +553,16 @@ void Monitor::Lock(Thread* self) {
     Runtime::Current()->GetRuntimeCallbacks()->MonitorContendedLocking(this);
   }
   self->SetMonitorEnterObject(GetObject().Ptr());
+  uint64_t blocked_ns;
   {
     ScopedThreadSuspension tsc(self, kBlocked);  // Change to blocked and give up mutator_lock_.
 
     // Acquire monitor_lock_ without mutator_lock_, expecting to block this time.
     // We already tried spinning above. The shutdown procedure currently assumes we stop
     // touching monitors shortly after we suspend, so don't spin again here.
+    const uint64_t block_start_ns = NanoTime();
     monitor_lock_.ExclusiveLock(self);
+    blocked_ns = NanoTime() - block_start_ns;
 
     if (log_contention && orig_owner != nullptr) {
       // Woken from contention.
@@ -626,6 +668,12 @@ void Monitor::Lock(Thread* self) {
   // We avoided touching monitor fields while suspended, so set owner_ here.
   owner_.store(self, std::memory_order_relaxed);
   DCHECK_EQ(lock_count_, 0u);
+  MarkUsed();
+  block_acquire_count_.store(block_acquire_count_.load(std::memory_order_relaxed) + 1u,
+                             std::memory_order_relaxed);
+  block_time_ns_.store(block_time_ns_.load(std::memory_order_relaxed) + blocked_ns,
+                       std::memory_order_relaxed);
+  UpdateSpinWaitIters(blocked_ns);
 
   if (ATraceEnabled()) {
     SetLockingMethodNoProxy(self);
@@ -1600,7 +1648,9 @@ uint32_t Monitor::GetOwnerThreadId() {
 
 MonitorList::MonitorList()
     : allow_new_monitors_(true), monitor_list_lock_("MonitorList lock", kMonitorListLock),
-      monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_) {
+      monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_),
+      num_idle_monitors_(0u),
+      num_idle_deflations_(0u) {
 }
 
 MonitorList::~MonitorList() {
@@ -1648,8 +1698,13 @@ void MonitorList::Add(Monitor* m) {
 }
 
 void MonitorList::SweepMonitorList(IsMarkedVisitor* visitor) {
+  Sweep(visitor, /*is_gc_sweep=*/ true);
+}
+
+void MonitorList::Sweep(IsMarkedVisitor* visitor, bool is_gc_sweep) {
   Thread* self = Thread::Current();
   MutexLock mu(self, monitor_list_lock_);
+  size_t num_idle_monitors = 0u;
   for (auto it = list_.begin(); it != list_.end(); ) {
     Monitor* m = *it;
     // Disable the read barrier in GetObject() as this is called by GC.
@@ -1663,9 +1718,23 @@ void MonitorList::SweepMonitorList(IsMarkedVisitor* visitor) {
       it = list_.erase(it);
     } else {
       m->SetObject(new_obj);
+      if (is_gc_sweep) {
+        // Racy with the monitor being acquired concurrently, which may then look idle for one
+        // more sweep than it is.
+        uint32_t idle_sweeps = m->idle_sweeps_.load(std::memory_order_relaxed);
+        if (idle_sweeps < kIdleSweepsBeforeDeflation) {
+          m->idle_sweeps_.store(++idle_sweeps, std::memory_order_relaxed);
+        }
+        if (idle_sweeps >= kIdleSweepsBeforeDeflation) {
+          ++num_idle_monitors;
+        }
+      }
       ++it;
     }
   }
+  if (is_gc_sweep) {
+    num_idle_monitors_ = num_idle_monitors;
+  }
 }
 
 size_t MonitorList::Size() {
@@ -1674,12 +1743,25 @@ size_t MonitorList::Size() {
   return list_.size();
 }
 
+size_t MonitorList::NumIdleMonitors() {
+  MutexLock mu(Thread::Current(), monitor_list_lock_);
+  return num_idle_monitors_;
+}
+
 class MonitorDeflateVisitor : public IsMarkedVisitor {
  public:
-  MonitorDeflateVisitor() : self_(Thread::Current()), deflate_count_(0) {}
+  explicit MonitorDeflateVisitor(bool only_idle = false)
+      : self_(Thread::Current()), only_idle_(only_idle), deflate_count_(0) {}
 
   mirror::Object* IsMarked(mirror::Object* object) override
       REQUIRES_SHARED(Locks::mutator_lock_) {
+    if (only_idle_) {
+      LockWord lock_word = object->GetLockWord(false);
+      if (lock_word.GetState() == LockWord::kFatLocked &&
+          !lock_word.FatLockMonitor()->IsIdle()) {
+        return object;  // Recently used, keep the monitor.
+      }
+    }
     if (Monitor::Deflate(self_, object)) {
       DCHECK_NE(object->GetLockWord(true).GetState(), LockWord::kFatLocked);
       ++deflate_count_;
@@ -1690,16 +1772,72 @@ class MonitorDeflateVisitor : public IsMarkedVisitor {
   }
 
   Thread* const self_;
+  const bool only_idle_;
   size_t deflate_count_;
 };
 
 size_t MonitorList::DeflateMonitors() {
   MonitorDeflateVisitor visitor;
   Locks::mutator_lock_->AssertExclusiveHeld(visitor.self_);
-  SweepMonitorList(&visitor);
+  Sweep(&visitor, /*is_gc_sweep=*/ false);
+  return visitor.deflate_count_;
+}
+
+size_t MonitorList::DeflateIdleMonitors() {
+  MonitorDeflateVisitor visitor(/*only_idle=*/ true);
+  Locks::mutator_lock_->AssertExclusiveHeld(visitor.self_);
+  Sweep(&visitor, /*is_gc_sweep=*/ false);
+  MutexLock mu(visitor.self_, monitor_list_lock_);
+  num_idle_monitors_ = 0u;
+  num_idle_deflations_ += visitor.deflate_count_;
   return visitor.deflate_count_;
 }
 
+size_t MonitorList::MaybeDeflateIdleMonitors() {
+  if (NumIdleMonitors() < kMinIdleMonitorsToDeflate) {
+    return 0u;
+  }
+  return DeflateIdleMonitors();
+}
+
+void MonitorList::DumpForSigQuit(std::ostream& os) {
+  static constexpr size_t kMaxDumpedMonitors = 10;
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  MutexLock mu(self, monitor_list_lock_);
+  // Rank the monitors that saw contention by the time contenders spent blocked on them.
+  std::vector<Monitor*> contended;
+  for (Monitor* m : list_) {
+    if (m->spin_acquire_count_.load(std::memory_order_relaxed) != 0u ||
+        m->block_acquire_count_.load(std::memory_order_relaxed) != 0u) {
+      contended.push_back(m);
+    }
+  }
+  auto more_blocked = [](Monitor* lhs, Monitor* rhs) {
+    return lhs->block_time_ns_.load(std::memory_order_relaxed) >
+        rhs->block_time_ns_.load(std::memory_order_relaxed);
+  };
+  const size_t num_dumped = std::min(contended.size(), kMaxDumpedMonitors);
+  std::partial_sort(
+      contended.begin(), contended.begin() + num_dumped, contended.end(), more_blocked);
+  os << "Monitors: " << list_.size() << " inflated, " << num_idle_monitors_
+     << " idle at last GC, " << num_idle_deflations_ << " deflated when idle, "
+     << contended.size() << " contended\n";
+  for (size_t i = 0; i != num_dumped; ++i) {
+    Monitor* m = contended[i];
+    ObjPtr<mirror::Object> obj = m->GetObject();
+    if (obj == nullptr) {
+      continue;  // Deflated, waiting to be freed by the next GC.
+    }
+    os << "  " << mirror::Object::PrettyTypeOf(obj) << " (monitor " << m->GetMonitorId() << "):"
+       << " spin-acquired=" << m->spin_acquire_count_.load(std::memory_order_relaxed)
+       << " blocked=" << m->block_acquire_count_.load(std::memory_order_relaxed)
+       << " blocked-time="
+       << PrettyDuration(m->block_time_ns_.load(std::memory_order_relaxed))
+       << " spin-wait-iters=" << m->spin_wait_iters_.load(std::memory_order_relaxed) << "\n";
+  }
+}
+
 MonitorInfo::MonitorInfo(ObjPtr<mirror::Object> obj) : owner_(nullptr), entry_count_(0) {
   DCHECK(obj != nullptr);
   LockWord lock_word = obj->GetLockWord(true);
@@ -154,6 +154,9 @@ class Monitor {
     return monitor_id_;
   }
 
+  // Has the monitor gone unacquired for MonitorList::kIdleSweepsBeforeDeflation GC sweeps?
+  bool IsIdle() const;
+
   // Inflate the lock on obj. May fail to inflate for spurious reasons, always re-check.
   static void InflateThinLocked(Thread* self, Handle<mirror::Object> obj, LockWord lock_word,
                                 uint32_t hash_code) REQUIRES_SHARED(Locks::mutator_lock_);
@@ -231,6 +234,19 @@ class Monitor {
       TRY_ACQUIRE(true, monitor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Try to acquire monitor_lock_, spinning for as long as spin_wait_iters_ allows if it is held.
+  bool SpinTryLock(Thread* self) TRY_ACQUIRE(true, monitor_lock_);
+
+  // Adjust spin_wait_iters_ after a contender spent `blocked_ns` blocked on monitor_lock_.
+  void UpdateSpinWaitIters(uint64_t blocked_ns);
+
+  // Note that the monitor has been acquired, for idle deflation.
+  void MarkUsed() {
+    if (idle_sweeps_.load(std::memory_order_relaxed) != 0u) {
+      idle_sweeps_.store(0u, std::memory_order_relaxed);
+    }
+  }
+
   template<LockReason reason = LockReason::kForLock>
   void Lock(Thread* self)
       ACQUIRE(monitor_lock_)
@@ -324,6 +340,29 @@ class Monitor {
   // monitor acquisition. Prevents deflation.
   std::atomic<size_t> num_waiters_;
 
+  // Bounds of spin_wait_iters_. It starts at Mutex::kDefaultSpinWaitIters.
+  static constexpr uint32_t kMinSpinWaitIters = 4;
+  static constexpr uint32_t kMaxSpinWaitIters = 800;
+  // A contender that blocks and gets the monitor within this time would have done better to keep
+  // spinning; one that blocks for longer was right to stop.
+  static constexpr uint64_t kShortBlockNs = 20 * 1000;
+
+  // How long a contender waits for monitor_lock_ to be released before blocking, in
+  // Mutex::ExclusiveTryLockWithSpinning() back-off iterations. Learned from how long recent
+  // contenders stayed blocked, so that monitors that are held briefly are spun on and monitors
+  // held for milliseconds are not.
+  std::atomic<uint32_t> spin_wait_iters_;
+
+  // Contention statistics for the SIGQUIT dump. Written by the owner right after it acquires
+  // monitor_lock_, read without synchronization.
+  std::atomic<uint32_t> spin_acquire_count_;   // Acquisitions that spun until the lock was free.
+  std::atomic<uint32_t> block_acquire_count_;  // Acquisitions that blocked.
+  std::atomic<uint64_t> block_time_ns_;        // Total time spent blocked.
+
+  // Number of GC sweeps of the monitor list since the monitor was last acquired. Only a hint for
+  // MonitorList::DeflateIdleMonitors(); Deflate() still checks that the monitor is free.
+  std::atomic<uint32_t> idle_sweeps_;
+
   // Which thread currently owns the lock? monitor_lock_ only keeps the tid.
   // Only set while holding monitor_lock_. Non-locking readers only use it to
   // compare to self or for debugging.
@@ -443,6 +482,11 @@ class MonitorList {
 
   void Add(Monitor* m) REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!monitor_list_lock_);
 
+  // Number of GC sweeps a monitor must stay unused for before DeflateIdleMonitors() deflates it.
+  static constexpr uint32_t kIdleSweepsBeforeDeflation = 2;
+  // Minimum number of idle monitors for MaybeDeflateIdleMonitors() to deflate them.
+  static constexpr size_t kMinIdleMonitorsToDeflate = 64;
+
   void SweepMonitorList(IsMarkedVisitor* visitor)
       REQUIRES(!monitor_list_lock_) REQUIRES_SHARED(Locks::mutator_lock_);
   void DisallowNewMonitors() REQUIRES(!monitor_list_lock_);
@@ -450,11 +494,27 @@ class MonitorList {
   void BroadcastForNewMonitors() REQUIRES(!monitor_list_lock_);
   // Returns how many monitors were deflated.
   size_t DeflateMonitors() REQUIRES(!monitor_list_lock_) REQUIRES(Locks::mutator_lock_);
+  // Deflate the monitors that have not been acquired since the last kIdleSweepsBeforeDeflation
+  // GC sweeps, returning them to the MonitorPool. Returns how many monitors were deflated.
+  size_t DeflateIdleMonitors() REQUIRES(!monitor_list_lock_) REQUIRES(Locks::mutator_lock_);
+  // Deflate the idle monitors if there are at least kMinIdleMonitorsToDeflate of them. Called by
+  // collectors in a pause they take anyway, before any object moves, so that deflation does not
+  // need a pause of its own. Returns how many monitors were deflated.
+  size_t MaybeDeflateIdleMonitors() REQUIRES(!monitor_list_lock_) REQUIRES(Locks::mutator_lock_);
   size_t Size() REQUIRES(!monitor_list_lock_);
+  // Number of monitors DeflateIdleMonitors() would deflate, as of the last GC sweep.
+  size_t NumIdleMonitors() REQUIRES(!monitor_list_lock_);
+
+  // Print monitor list statistics and the most contended monitors.
+  void DumpForSigQuit(std::ostream& os) REQUIRES(!monitor_list_lock_);
 
   typedef std::list<Monitor*, TrackingAllocator<Monitor*, kAllocatorTagMonitorList>> Monitors;
 
  private:
+  // Sweep the list with `visitor`. GC sweeps also age the monitors for idle deflation.
+  void Sweep(IsMarkedVisitor* visitor, bool is_gc_sweep)
+      REQUIRES(!monitor_list_lock_) REQUIRES_SHARED(Locks::mutator_lock_);
+
   // During sweeping we may free an object and on a separate thread have an object created using
   // the newly freed memory. That object may then have its lock-word inflated and a monitor created.
   // If we allow new monitor registration during sweeping this monitor may be incorrectly freed as
@@ -463,6 +523,10 @@ class MonitorList {
   Mutex monitor_list_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   ConditionVariable monitor_add_condition_ GUARDED_BY(monitor_list_lock_);
   Monitors list_ GUARDED_BY(monitor_list_lock_);
+  // Monitors found idle by the last GC sweep.
+  size_t num_idle_monitors_ GUARDED_BY(monitor_list_lock_);
+  // Total number of monitors deflated by DeflateIdleMonitors().
+  size_t num_idle_deflations_ GUARDED_BY(monitor_list_lock_);
 
   friend class Monitor;
   DISALLOW_COPY_AND_ASSIGN(MonitorList);
@@ -24,11 +24,13 @@
 #include "base/time_utils.h"
 #include "class_linker-inl.h"
 #include "common_runtime_test.h"
+#include "gc/scoped_gc_critical_section.h"
 #include "handle_scope-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/string-inl.h"  // Strings are easiest to allocate
 #include "object_lock.h"
 #include "scoped_thread_state_change-inl.h"
+#include "thread_list.h"
 #include "thread_pool.h"
 
 namespace art {
@@ -375,5 +377,51 @@ TEST_F(MonitorTest, TestTryLock) {
   thread_pool.StopWorkers(self);
 }
 
+class MarkAllVisitor : public IsMarkedVisitor {
+ public:
+  mirror::Object* IsMarked(mirror::Object* obj) override {
+    return obj;
+  }
+};
+
+// Test that only the monitors left unused for a few GC sweeps are deflated as idle.
+TEST_F(MonitorTest, DeflateIdleMonitors) {
+  Thread* const self = Thread::Current();
+  MonitorList* const monitor_list = Runtime::Current()->GetMonitorList();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<2> hs(self);
+  Handle<mirror::Object> idle_obj(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "idle")));
+  Handle<mirror::Object> used_obj(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "used")));
+  // Locking an object that has an identity hash code inflates its lock.
+  for (Handle<mirror::Object> obj : {idle_obj, used_obj}) {
+    obj->IdentityHashCode();
+    ObjectLock<mirror::Object> lock(self, obj);
+  }
+  ASSERT_EQ(idle_obj->GetLockWord(false).GetState(), LockWord::kFatLocked);
+  ASSERT_EQ(used_obj->GetLockWord(false).GetState(), LockWord::kFatLocked);
+
+  MarkAllVisitor visitor;
+  for (uint32_t i = 0; i != MonitorList::kIdleSweepsBeforeDeflation; ++i) {
+    monitor_list->SweepMonitorList(&visitor);
+  }
+  EXPECT_TRUE(idle_obj->GetLockWord(false).FatLockMonitor()->IsIdle());
+  EXPECT_GE(monitor_list->NumIdleMonitors(), 2u);
+  {
+    ObjectLock<mirror::Object> lock(self, used_obj);
+  }
+  EXPECT_FALSE(used_obj->GetLockWord(false).FatLockMonitor()->IsIdle());
+
+  {
+    ScopedThreadSuspension sts(self, kSuspended);
+    gc::ScopedGCCriticalSection gcs(self, gc::kGcCauseTrim, gc::kCollectorTypeHeapTrim);
+    ScopedSuspendAll ssa(__FUNCTION__);
+    EXPECT_GE(monitor_list->DeflateIdleMonitors(), 1u);
+    EXPECT_EQ(monitor_list->NumIdleMonitors(), 0u);
+  }
+  EXPECT_EQ(idle_obj->GetLockWord(false).GetState(), LockWord::kHashCode);
+  EXPECT_EQ(used_obj->GetLockWord(false).GetState(), LockWord::kFatLocked);
+}
 
 }  // namespace art
@@ -16,6 +16,8 @@
 
 #include "java_lang_StringFactory.h"
 
+#include "base/casts.h"
+#include "base/simd_ascii.h"
 #include "common_throws.h"
 #include "handle_scope-inl.h"
 #include "jni/jni_internal.h"
@@ -118,6 +120,27 @@ static jstring StringFactory_newStringFromUtf8Bytes(JNIEnv* env, jclass, jbyteAr
     return nullptr;
   }
 
+  jbyte* d = byte_array->GetData();
+  DCHECK(d != nullptr);
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(d) + offset;
+
+  // Find the ASCII prefix. If that is all of the input, there is nothing to decode and
+  // AllocFromByteArray() decides about compression and widens the bytes if needed.
+  int ascii_length = dchecked_integral_cast<int>(CountAsciiBlocks(bytes, byte_count));
+  while (ascii_length != byte_count && bytes[ascii_length] < 0x80u) {
+    ++ascii_length;
+  }
+  if (ascii_length == byte_count) {
+    gc::AllocatorType allocator_type = Runtime::Current()->GetHeap()->GetCurrentAllocator();
+    ObjPtr<mirror::String> result = mirror::String::AllocFromByteArray(soa.Self(),
+                                                                       byte_count,
+                                                                       byte_array,
+                                                                       offset,
+                                                                       /*high_byte=*/ 0,
+                                                                       allocator_type);
+    return soa.AddLocalReference<jstring>(result);
+  }
+
   /*
    * This code converts a UTF-8 byte sequence to a Java String (UTF-16).
    * It implements the W3C recommended UTF-8 decoder.
@@ -166,12 +189,11 @@ static jstring StringFactory_newStringFromUtf8Bytes(JNIEnv* env, jclass, jbyteAr
     v = allocated_buffer.get();
   }
 
-  jbyte* d = byte_array->GetData();
-  DCHECK(d != nullptr);
+  WidenChars(bytes, v, ascii_length);
 
-  int idx = offset;
+  int idx = offset + ascii_length;
   int last = offset + byte_count;
-  int s = 0;
+  int s = ascii_length;
 
   int code_point = 0;
   int utf8_bytes_seen = 0;
@@ -18,6 +18,10 @@
 
 #include <string.h>
 
+#include <algorithm>
+
+#include "base/casts.h"
+#include "base/simd_ascii.h"
 #include "handle_scope-inl.h"
 #include "jni/jni_internal.h"
 #include "mirror/string-inl.h"
@@ -30,6 +34,118 @@
 
 namespace art {
 
+// Visit the UTF-8 encoding of `chars`, calling `append_ascii_block` for blocks of
+// `kAsciiBlockSize` ASCII chars and `append` for each byte of the other chars.
+template <typename AppendAsciiBlock, typename Append>
+ALWAYS_INLINE static inline void VisitUtf8(const uint16_t* chars,
+                                           size_t length,
+                                           AppendAsciiBlock append_ascii_block,
+                                           Append append) {
+  size_t i = 0;
+  while (i < length) {
+    if (kHasVectorAscii) {
+      while (length - i >= kAsciiBlockSize && IsCharBlockBelow(chars + i, 0x80u)) {
+        append_ascii_block(chars + i);
+        i += kAsciiBlockSize;
+      }
+    }
+    // Encode up to a block of chars one by one, then look for ASCII blocks again. The last
+    // surrogate pair may end one char past the block.
+    const size_t block_end = std::min(length, i + kAsciiBlockSize);
+    for (; i < block_end; ++i) {
+      jint ch = chars[i];
+      if (ch < 0x80) {
+        // One byte.
+        append(ch);
+      } else if (ch < 0x800) {
+        // Two bytes.
+        append((ch >> 6) | 0xc0);
+        append((ch & 0x3f) | 0x80);
+      } else if (U16_IS_SURROGATE(ch)) {
+        // A supplementary character.
+        jchar high = static_cast<jchar>(ch);
+        jchar low = (i + 1 != length) ? chars[i + 1] : 0;
+        if (!U16_IS_SURROGATE_LEAD(high) || !U16_IS_SURROGATE_TRAIL(low)) {
+          append('?');
+          continue;
+        }
+        // Now we know we have a *valid* surrogate pair, we can consume the low surrogate.
+        ++i;
+        ch = U16_GET_SUPPLEMENTARY(high, low);
+        // Four bytes.
+        append((ch >> 18) | 0xf0);
+        append(((ch >> 12) & 0x3f) | 0x80);
+        append(((ch >> 6) & 0x3f) | 0x80);
+        append((ch & 0x3f) | 0x80);
+      } else {
+        // Three bytes.
+        append((ch >> 12) | 0xe0);
+        append(((ch >> 6) & 0x3f) | 0x80);
+        append((ch & 0x3f) | 0x80);
+      }
+    }
+  }
+}
+
+void AsciiBytesToChars(const uint8_t* bytes, size_t length, uint16_t* chars) {
+  static const jchar REPLACEMENT_CHAR = 0xfffd;
+  size_t i = 0;
+  while (i != length) {
+    i += WidenAsciiBlocks(bytes + i, chars + i, length - i);
+    // Decode up to a block of bytes one by one, then look for ASCII blocks again.
+    const size_t block_end = std::min(length, i + kAsciiBlockSize);
+    for (; i != block_end; ++i) {
+      jchar ch = bytes[i];
+      chars[i] = (ch <= 0x7f) ? ch : REPLACEMENT_CHAR;
+    }
+  }
+}
+
+void IsoLatin1BytesToChars(const uint8_t* bytes, size_t length, uint16_t* chars) {
+  WidenChars(bytes, chars, length);
+}
+
+void CharsToBytes(const uint16_t* chars, size_t length, uint16_t max_valid_char, uint8_t* bytes) {
+  DCHECK_LE(max_valid_char, 0xffu);
+  auto clamp = [max_valid_char](uint16_t c) {
+    return dchecked_integral_cast<uint8_t>((c > max_valid_char) ? '?' : c);
+  };
+  size_t i = 0;
+  if (kHasVectorAscii) {
+    // Narrow the blocks without chars to replace and clamp the others one by one.
+    const uint16_t limit = max_valid_char + 1u;
+    for (; length - i >= kAsciiBlockSize; i += kAsciiBlockSize) {
+      if (IsCharBlockBelow(chars + i, limit)) {
+        NarrowBlock(chars + i, bytes + i);
+      } else {
+        std::transform(chars + i, chars + i + kAsciiBlockSize, bytes + i, clamp);
+      }
+    }
+  }
+  std::transform(chars + i, chars + length, bytes + i, clamp);
+}
+
+size_t CharsToUtf8Length(const uint16_t* chars, size_t length) {
+  size_t utf8_length = 0;
+  VisitUtf8(chars,
+            length,
+            [&utf8_length](const uint16_t* block ATTRIBUTE_UNUSED) {
+              utf8_length += kAsciiBlockSize;
+            },
+            [&utf8_length](jbyte c ATTRIBUTE_UNUSED) { ++utf8_length; });
+  return utf8_length;
+}
+
+void CharsToUtf8Bytes(const uint16_t* chars, size_t length, uint8_t* bytes) {
+  VisitUtf8(chars,
+            length,
+            [&bytes](const uint16_t* block) {
+              NarrowBlock(block, bytes);
+              bytes += kAsciiBlockSize;
+            },
+            [&bytes](jbyte c) { *bytes++ = static_cast<uint8_t>(c); });
+}
+
 static void CharsetUtils_asciiBytesToChars(JNIEnv* env, jclass, jbyteArray javaBytes, jint offset,
                                            jint length, jcharArray javaChars) {
   ScopedByteArrayRO bytes(env, javaBytes);
@@ -41,13 +157,8 @@ static void CharsetUtils_asciiBytesToChars(JNIEnv* env, jclass, jbyteArray javaB
     return;
   }
 
-  const jbyte* src = &bytes[offset];
-  jchar* dst = &chars[0];
-  static const jchar REPLACEMENT_CHAR = 0xfffd;
-  for (int i = length - 1; i >= 0; --i) {
-    jchar ch = static_cast<jchar>(*src++ & 0xff);
-    *dst++ = (ch <= 0x7f) ? ch : REPLACEMENT_CHAR;
-  }
+  DCHECK_GE(length, 0);
+  AsciiBytesToChars(reinterpret_cast<const uint8_t*>(&bytes[offset]), length, &chars[0]);
 }
 
 static void CharsetUtils_isoLatin1BytesToChars(JNIEnv* env, jclass, jbyteArray javaBytes,
@@ -61,11 +172,8 @@ static void CharsetUtils_isoLatin1BytesToChars(JNIEnv* env, jclass, jbyteArray j
     return;
   }
 
-  const jbyte* src = &bytes[offset];
-  jchar* dst = &chars[0];
-  for (int i = length - 1; i >= 0; --i) {
-    *dst++ = static_cast<jchar>(*src++ & 0xff);
-  }
+  DCHECK_GE(length, 0);
+  IsoLatin1BytesToChars(reinterpret_cast<const uint8_t*>(&bytes[offset]), length, &chars[0]);
 }
 
 /**
@@ -92,11 +200,10 @@ static jbyteArray charsToBytes(JNIEnv* env, jstring java_string, jint offset, ji
     DCHECK_GE(maxValidChar, 0x7f);
     memcpy(result->GetData(), string->GetValueCompressed() + offset, length);
   } else {
-    const uint16_t* src = string->GetValue() + offset;
-    auto clamp = [maxValidChar](uint16_t c) {
-      return static_cast<jbyte>(dchecked_integral_cast<uint8_t>((c > maxValidChar) ? '?' : c));
-    };
-    std::transform(src, src + length, result->GetData(), clamp);
+    CharsToBytes(string->GetValue() + offset,
+                 length,
+                 maxValidChar,
+                 reinterpret_cast<uint8_t*>(result->GetData()));
   }
   return soa.AddLocalReference<jbyteArray>(result);
 }
@@ -125,48 +232,12 @@ static jbyteArray CharsetUtils_toUtf8Bytes(JNIEnv* env, jclass, jstring java_str
   DCHECK_GE(length, 0);
   DCHECK_LE(length, string->GetLength() - offset);
 
-  auto visit_chars16 = [string, offset, length](auto append) REQUIRES_SHARED(Locks::mutator_lock_) {
-    const uint16_t* chars16 = string->GetValue() + offset;
-    for (int i = 0; i < length; ++i) {
-      jint ch = chars16[i];
-      if (ch < 0x80) {
-        // One byte.
-        append(ch);
-      } else if (ch < 0x800) {
-        // Two bytes.
-        append((ch >> 6) | 0xc0);
-        append((ch & 0x3f) | 0x80);
-      } else if (U16_IS_SURROGATE(ch)) {
-        // A supplementary character.
-        jchar high = static_cast<jchar>(ch);
-        jchar low = (i + 1 != length) ? chars16[i + 1] : 0;
-        if (!U16_IS_SURROGATE_LEAD(high) || !U16_IS_SURROGATE_TRAIL(low)) {
-          append('?');
-          continue;
-        }
-        // Now we know we have a *valid* surrogate pair, we can consume the low surrogate.
-        ++i;
-        ch = U16_GET_SUPPLEMENTARY(high, low);
-        // Four bytes.
-        append((ch >> 18) | 0xf0);
-        append(((ch >> 12) & 0x3f) | 0x80);
-        append(((ch >> 6) & 0x3f) | 0x80);
-        append((ch & 0x3f) | 0x80);
-      } else {
-        // Three bytes.
-        append((ch >> 12) | 0xe0);
-        append(((ch >> 6) & 0x3f) | 0x80);
-        append((ch & 0x3f) | 0x80);
-      }
-    }
-  };
-
   bool compressed = string->IsCompressed();
   size_t utf8_length = 0;
   if (compressed) {
     utf8_length = length;
   } else {
-    visit_chars16([&utf8_length](jbyte c ATTRIBUTE_UNUSED) { ++utf8_length; });
+    utf8_length = CharsToUtf8Length(string->GetValue() + offset, length);
   }
   ObjPtr<mirror::ByteArray> result =
       mirror::ByteArray::Alloc(soa.Self(), dchecked_integral_cast<int32_t>(utf8_length));
@@ -174,11 +245,13 @@ static jbyteArray CharsetUtils_toUtf8Bytes(JNIEnv* env, jclass, jstring java_str
     return nullptr;
   }
 
+  // The allocation may have moved the string, so read its chars again.
   if (compressed) {
     memcpy(result->GetData(), string->GetValueCompressed() + offset, length);
   } else {
-    int8_t* data = result->GetData();
-    visit_chars16([&data](jbyte c) { *data++ = c; });
+    CharsToUtf8Bytes(string->GetValue() + offset,
+                     length,
+                     reinterpret_cast<uint8_t*>(result->GetData()));
   }
   return soa.AddLocalReference<jbyteArray>(result);
 }
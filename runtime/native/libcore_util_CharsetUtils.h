@@ -18,11 +18,30 @@
 #define ART_RUNTIME_NATIVE_LIBCORE_UTIL_CHARSETUTILS_H_
 
 #include <jni.h>
+#include <stddef.h>
+#include <stdint.h>
 
 namespace art {
 
 void register_libcore_util_CharsetUtils(JNIEnv* env);
 
+// The conversions done by the natives, on raw arrays.
+
+// Decode US-ASCII `bytes`, replacing bytes above 0x7f with U+FFFD.
+void AsciiBytesToChars(const uint8_t* bytes, size_t length, uint16_t* chars);
+
+// Decode ISO-8859-1 `bytes`.
+void IsoLatin1BytesToChars(const uint8_t* bytes, size_t length, uint16_t* chars);
+
+// Encode `chars` as single bytes, replacing chars above `max_valid_char` with '?'.
+void CharsToBytes(const uint16_t* chars, size_t length, uint16_t max_valid_char, uint8_t* bytes);
+
+// Return the length of the UTF-8 encoding of `chars` written by CharsToUtf8Bytes().
+size_t CharsToUtf8Length(const uint16_t* chars, size_t length);
+
+// Encode `chars` as UTF-8, replacing unpaired surrogates with '?'.
+void CharsToUtf8Bytes(const uint16_t* chars, size_t length, uint8_t* bytes);
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_NATIVE_LIBCORE_UTIL_CHARSETUTILS_H_
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "libcore_util_CharsetUtils.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "unicode/utf16.h"
+
+namespace art {
+
+// The per-char conversions the natives used before they got their block fast paths.
+
+static std::vector<uint16_t> AsciiBytesToChars_reference(const std::vector<uint8_t>& bytes) {
+  std::vector<uint16_t> chars;
+  for (uint8_t b : bytes) {
+    chars.push_back((b <= 0x7f) ? b : 0xfffd);
+  }
+  return chars;
+}
+
+static std::vector<uint8_t> CharsToBytes_reference(const std::vector<uint16_t>& chars,
+                                                   uint16_t max_valid_char) {
+  std::vector<uint8_t> bytes;
+  for (uint16_t c : chars) {
+    bytes.push_back(static_cast<uint8_t>((c > max_valid_char) ? '?' : c));
+  }
+  return bytes;
+}
+
+static std::vector<uint8_t> CharsToUtf8Bytes_reference(const std::vector<uint16_t>& chars) {
+  std::vector<uint8_t> bytes;
+  size_t length = chars.size();
+  for (size_t i = 0; i < length; ++i) {
+    int32_t ch = chars[i];
+    if (ch < 0x80) {
+      bytes.push_back(ch);
+    } else if (ch < 0x800) {
+      bytes.push_back((ch >> 6) | 0xc0);
+      bytes.push_back((ch & 0x3f) | 0x80);
+    } else if (U16_IS_SURROGATE(ch)) {
+      uint16_t high = static_cast<uint16_t>(ch);
+      uint16_t low = (i + 1 != length) ? chars[i + 1] : 0;
+      if (!U16_IS_SURROGATE_LEAD(high) || !U16_IS_SURROGATE_TRAIL(low)) {
+        bytes.push_back('?');
+        continue;
+      }
+      ++i;
+      ch = U16_GET_SUPPLEMENTARY(high, low);
+      bytes.push_back((ch >> 18) | 0xf0);
+      bytes.push_back(((ch >> 12) & 0x3f) | 0x80);
+      bytes.push_back(((ch >> 6) & 0x3f) | 0x80);
+      bytes.push_back((ch & 0x3f) | 0x80);
+    } else {
+      bytes.push_back((ch >> 12) | 0xe0);
+      bytes.push_back(((ch >> 6) & 0x3f) | 0x80);
+      bytes.push_back((ch & 0x3f) | 0x80);
+    }
+  }
+  return bytes;
+}
+
+class CharsetUtilsTest : public testing::Test {
+ protected:
+  static constexpr size_t kIterations = 2000;
+  static constexpr size_t kMaxLength = 100;
+
+  // Return mostly ASCII chars with runs of other kinds, so that the input has ASCII blocks,
+  // blocks with a few other chars and surrogate pairs split across blocks.
+  uint16_t RandomChar() {
+    switch (std::uniform_int_distribution<int>(0, 15)(rng_)) {
+      case 0:
+        return std::uniform_int_distribution<uint16_t>(0x80u, 0xffu)(rng_);
+      case 1:
+        return std::uniform_int_distribution<uint16_t>(0x100u, 0x7ffu)(rng_);
+      case 2:
+        return std::uniform_int_distribution<uint16_t>(0x800u, 0xffffu)(rng_);
+      case 3:
+        return std::uniform_int_distribution<uint16_t>(0xd800u, 0xdfffu)(rng_);
+      default:
+        return std::uniform_int_distribution<uint16_t>(0u, 0x7fu)(rng_);
+    }
+  }
+
+  std::vector<uint16_t> RandomChars() {
+    std::vector<uint16_t> chars(std::uniform_int_distribution<size_t>(0u, kMaxLength)(rng_));
+    // Keep some inputs all ASCII or without any ASCII at all.
+    int kind = std::uniform_int_distribution<int>(0, 3)(rng_);
+    for (uint16_t& c : chars) {
+      c = RandomChar();
+      if (kind == 0) {
+        c &= 0x7fu;
+      } else if (kind == 1) {
+        c |= 0x80u;
+      }
+    }
+    // Add valid surrogate pairs.
+    for (size_t i = 0; i + 1u < chars.size(); i += 1u + (rng_() % 8u)) {
+      if (rng_() % 4u == 0u) {
+        chars[i] = std::uniform_int_distribution<uint16_t>(0xd800u, 0xdbffu)(rng_);
+        chars[i + 1u] = std::uniform_int_distribution<uint16_t>(0xdc00u, 0xdfffu)(rng_);
+      }
+    }
+    return chars;
+  }
+
+  std::mt19937 rng_{42u};
+};
+
+TEST_F(CharsetUtilsTest, AsciiAndIsoLatin1BytesToChars) {
+  for (size_t iteration = 0; iteration != kIterations; ++iteration) {
+    std::vector<uint16_t> random_chars = RandomChars();
+    std::vector<uint8_t> bytes(random_chars.begin(), random_chars.end());
+
+    std::vector<uint16_t> chars(bytes.size());
+    AsciiBytesToChars(bytes.data(), bytes.size(), chars.data());
+    EXPECT_EQ(chars, AsciiBytesToChars_reference(bytes)) << iteration;
+
+    IsoLatin1BytesToChars(bytes.data(), bytes.size(), chars.data());
+    EXPECT_EQ(chars, std::vector<uint16_t>(bytes.begin(), bytes.end())) << iteration;
+  }
+}
+
+TEST_F(CharsetUtilsTest, CharsToBytes) {
+  for (size_t iteration = 0; iteration != kIterations; ++iteration) {
+    std::vector<uint16_t> chars = RandomChars();
+    std::vector<uint8_t> bytes(chars.size());
+    for (uint16_t max_valid_char : {0x7fu, 0xffu}) {
+      CharsToBytes(chars.data(), chars.size(), max_valid_char, bytes.data());
+      EXPECT_EQ(bytes, CharsToBytes_reference(chars, max_valid_char)) << iteration;
+    }
+  }
+}
+
+TEST_F(CharsetUtilsTest, CharsToUtf8Bytes) {
+  for (size_t iteration = 0; iteration != kIterations; ++iteration) {
+    std::vector<uint16_t> chars = RandomChars();
+    std::vector<uint8_t> expected = CharsToUtf8Bytes_reference(chars);
+    size_t length = CharsToUtf8Length(chars.data(), chars.size());
+    ASSERT_EQ(length, expected.size()) << iteration;
+    std::vector<uint8_t> bytes(length);
+    CharsToUtf8Bytes(chars.data(), chars.size(), bytes.data());
+    EXPECT_EQ(bytes, expected) << iteration;
+  }
+}
+
+}  // namespace art
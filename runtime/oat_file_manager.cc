@@ -51,6 +51,7 @@
 #include "oat_file_assistant.h"
 #include "obj_ptr-inl.h"
 #include "scoped_thread_state_change-inl.h"
+#include "stack_map_cache.h"
 #include "thread-current-inl.h"
 #include "thread_list.h"
 #include "thread_pool.h"
@@ -98,6 +99,9 @@ void OatFileManager::UnRegisterAndDeleteOatFile(const OatFile* oat_file) {
   CHECK(it != oat_files_.end());
   oat_files_.erase(it);
   compare.release();  // NOLINT b/117926937
+  // A different oat file may be mapped at the same address later, so stack walks must not use
+  // stack map lookups cached by method header of the code that was just unmapped.
+  StackMapCache::InvalidateAll();
 }
 
 const OatFile* OatFileManager::FindOpenedOatFileFromDexLocation(
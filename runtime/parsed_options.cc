@@ -16,6 +16,7 @@
 
 #include "parsed_options.h"
 
+#include <limits>
 #include <memory>
 #include <sstream>
 
@@ -154,6 +155,12 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-XX:ForegroundHeapGrowthMultiplier=_")
           .WithType<double>().WithRange(0.1, 5.0)
           .IntoKey(M::ForegroundHeapGrowthMultiplier)
+      .Define("-XX:GcTargetCpuFraction=_")
+          .WithType<double>().WithRange(0.0, 0.5)
+          .IntoKey(M::GcTargetCpuFraction)
+      .Define("-XX:GcTargetPauseFraction=_")
+          .WithType<double>().WithRange(0.0, 0.5)
+          .IntoKey(M::GcTargetPauseFraction)
       .Define("-XX:LowMemoryMode")
           .IntoKey(M::LowMemoryMode)
       .Define("-Xprofile:_")
@@ -319,6 +326,9 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-XX:LargeObjectThreshold=_")
           .WithType<Memory<1>>()
           .IntoKey(M::LargeObjectThreshold)
+      .Define("-XX:LargeObjectSpaceCompactionThreshold=_")
+          .WithType<double>().WithRange(0.0, 1.0)
+          .IntoKey(M::LargeObjectSpaceCompactionThreshold)
       .Define("-XX:BackgroundGC=_")
           .WithType<BackgroundGcOption>()
           .IntoKey(M::BackgroundGc)
@@ -340,6 +350,16 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
           .IntoKey(M::MethodTraceFileSize)
       .Define("-Xmethod-trace-stream")
           .IntoKey(M::MethodTraceStreaming)
+      .Define("-Xmethod-trace-compress")
+          .IntoKey(M::MethodTraceCompression)
+      .Define("-Xcpu-profile:_")
+          .WithHelp("Write a pprof CPU profile of the managed stacks to the file")
+          .WithType<std::string>()
+          .IntoKey(M::CpuProfileFile)
+      .Define("-Xcpu-profile-interval:_")
+          .WithHelp("Interval between CPU profile samples, in microseconds")
+          .WithType<unsigned int>().WithRange(1u, std::numeric_limits<unsigned int>::max())
+          .IntoKey(M::CpuProfileInterval)
       .Define("-Xcompiler:_")
           .WithType<std::string>()
           .IntoKey(M::Compiler)
@@ -419,6 +439,10 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-Xverifier-logging-threshold=_")
           .WithType<unsigned int>()
           .IntoKey(M::VerifierLoggingThreshold)
+      .Define("-Xstartup-class-preload-threads:_")
+          .WithHelp("Number of threads loading the app's profile classes during startup")
+          .WithType<unsigned int>()
+          .IntoKey(M::StartupClassPreloadThreads)
       .Define("-XX:FastClassNotFoundException=_")
           .WithType<bool>()
           .WithValueMap({{"false", false}, {"true", true}})
@@ -39,6 +39,7 @@
 #include "oat_quick_method_header.h"
 #include "stack.h"
 #include "stack_map.h"
+#include "stack_map_cache.h"
 
 namespace art {
 
@@ -247,7 +248,7 @@ void QuickExceptionHandler::SetCatchEnvironmentForOptimizedHandler(StackVisitor*
 
   CodeItemDataAccessor accessor(GetHandlerMethod()->DexInstructionData());
   const size_t number_of_vregs = accessor.RegistersSize();
-  CodeInfo code_info(handler_method_header_);
+  CodeInfo code_info = self_->GetStackMapCache()->GetCodeInfo(handler_method_header_);
 
   // Find stack map of the catch block.
   StackMap catch_stack_map = code_info.GetCatchStackMapForDexPc(GetHandlerDexPc());
@@ -456,9 +457,9 @@ class DeoptimizeStackVisitor final : public StackVisitor {
                                       const bool* updated_vregs)
       REQUIRES_SHARED(Locks::mutator_lock_) {
     const OatQuickMethodHeader* method_header = GetCurrentOatQuickMethodHeader();
-    CodeInfo code_info(method_header);
+    CodeInfo code_info = DecodeCodeInfo(method_header);
     uintptr_t native_pc_offset = method_header->NativeQuickPcOffset(GetCurrentQuickFramePc());
-    StackMap stack_map = code_info.GetStackMapForNativePcOffset(native_pc_offset);
+    StackMap stack_map = GetStackMapForNativePcOffset(method_header, code_info, native_pc_offset);
     CodeItemDataAccessor accessor(m->DexInstructionData());
     const size_t number_of_vregs = accessor.RegistersSize();
     uint32_t register_mask = code_info.GetRegisterMaskOf(stack_map);
@@ -33,6 +33,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <functional>
 #include <limits>
 #include <string.h>
 #include <thread>
@@ -69,6 +70,7 @@
 #include "base/systrace.h"
 #include "base/unix_file/fd_file.h"
 #include "base/utils.h"
+#include "catch_handler_cache.h"
 #include "class_linker-inl.h"
 #include "class_root-inl.h"
 #include "compiler_callbacks.h"
@@ -160,10 +162,12 @@
 #include "runtime_common.h"
 #include "runtime_intrinsics.h"
 #include "runtime_options.h"
+#include "sampling_profiler.h"
 #include "scoped_thread_state_change-inl.h"
 #include "sigchain.h"
 #include "signal_catcher.h"
 #include "signal_set.h"
+#include "startup_class_preloader.h"
 #include "thread.h"
 #include "thread_list.h"
 #include "ti/agent.h"
@@ -207,6 +211,7 @@ struct TraceConfig {
   Trace::TraceOutputMode trace_output_mode;
   std::string trace_file;
   size_t trace_file_size;
+  int trace_flags;
 };
 
 namespace {
@@ -402,6 +407,10 @@ Runtime::~Runtime() {
   if (oat_file_manager_ != nullptr) {
     oat_file_manager_->WaitForWorkersToBeCreated();
   }
+  if (startup_class_preloader_ != nullptr) {
+    // Like the JIT tasks, preload tasks need mutator access.
+    startup_class_preloader_->DeleteThreadPool();
+  }
 
   {
     ScopedTrace trace2("Wait for shutdown cond");
@@ -423,6 +432,9 @@ Runtime::~Runtime() {
 
   // Shutdown any trace running.
   Trace::Shutdown();
+  if (sampling_profiler_ != nullptr) {
+    sampling_profiler_->Stop();
+  }
 
   // Report death. Clients may require a working thread, still, so do it before GC completes and
   // all non-daemon threads are done.
@@ -721,22 +733,39 @@ void Runtime::CallExitHook(jint status) {
   }
 }
 
-void Runtime::SweepSystemWeaks(IsMarkedVisitor* visitor) {
-  GetInternTable()->SweepInternTableWeaks(visitor);
-  GetMonitorList()->SweepMonitorList(visitor);
-  GetJavaVM()->SweepJniWeakGlobals(visitor);
-  GetHeap()->SweepAllocationRecords(visitor);
+void Runtime::SweepSystemWeaks(IsMarkedVisitor* visitor, size_t num_workers) {
+  // Cached catch handlers are keyed by class and method, which this GC may move or free.
+  CatchHandlerCache::InvalidateAll();
+  // The intern table is usually the largest holder, so it splits its own sweep between workers.
+  GetInternTable()->SweepInternTableWeaks(visitor, num_workers);
+  // The other built-in holders only take their own locks, so they can be swept in parallel.
+  std::vector<std::function<void(size_t)>> sweeps;
+  sweeps.push_back([this, visitor](size_t) REQUIRES_SHARED(Locks::mutator_lock_) {
+    GetMonitorList()->SweepMonitorList(visitor);
+  });
+  sweeps.push_back([this, visitor](size_t) REQUIRES_SHARED(Locks::mutator_lock_) {
+    GetJavaVM()->SweepJniWeakGlobals(visitor);
+  });
+  sweeps.push_back([this, visitor](size_t) REQUIRES_SHARED(Locks::mutator_lock_) {
+    GetHeap()->SweepAllocationRecords(visitor);
+  });
   if (GetJit() != nullptr) {
     // Visit JIT literal tables. Objects in these tables are classes and strings
     // and only classes can be affected by class unloading. The strings always
     // stay alive as they are strongly interned.
     // TODO: Move this closer to CleanupClassLoaders, to avoid blocking weak accesses
     // from mutators. See b/32167580.
-    GetJit()->GetCodeCache()->SweepRootTables(visitor);
+    sweeps.push_back([this, visitor](size_t) REQUIRES_SHARED(Locks::mutator_lock_) {
+      GetJit()->GetCodeCache()->SweepRootTables(visitor);
+    });
   }
-  thread_list_->SweepInterpreterCaches(visitor);
+  sweeps.push_back([this, visitor](size_t) REQUIRES_SHARED(Locks::mutator_lock_) {
+    thread_list_->SweepInterpreterCaches(visitor);
+  });
+  GetHeap()->RunParallelChunks(Thread::Current(), num_workers, sweeps);
 
-  // All other generic system-weak holders.
+  // All other generic system-weak holders. These may report freed objects to agents, so they are
+  // swept on the calling thread.
   for (gc::AbstractSystemWeakHolder* holder : system_weak_holders_) {
     holder->Sweep(visitor);
   }
@@ -990,12 +1019,16 @@ bool Runtime::Start() {
     ScopedThreadStateChange tsc(self, kWaitingForMethodTracingStart);
     Trace::Start(trace_config_->trace_file.c_str(),
                  static_cast<int>(trace_config_->trace_file_size),
-                 0,
+                 trace_config_->trace_flags,
                  trace_config_->trace_output_mode,
                  trace_config_->trace_mode,
                  0);
   }
 
+  if (sampling_profiler_ != nullptr) {
+    sampling_profiler_->Start();
+  }
+
   // In case we have a profile path passed as a command line argument,
   // register the current class path for profiling now. Note that we cannot do
   // this before we create the JIT and having it here is the most convenient way.
@@ -1565,6 +1598,8 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
                        runtime_options.GetOrDefault(Opt::HeapMaxFree),
                        runtime_options.GetOrDefault(Opt::HeapTargetUtilization),
                        foreground_heap_growth_multiplier,
+                       runtime_options.GetOrDefault(Opt::GcTargetCpuFraction),
+                       runtime_options.GetOrDefault(Opt::GcTargetPauseFraction),
                        runtime_options.GetOrDefault(Opt::StopForNativeAllocs),
                        runtime_options.GetOrDefault(Opt::MemoryMaximumSize),
                        runtime_options.GetOrDefault(Opt::NonMovingSpaceCapacity),
@@ -1578,6 +1613,7 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
                                        : runtime_options.GetOrDefault(Opt::BackgroundGc),
                        runtime_options.GetOrDefault(Opt::LargeObjectSpace),
                        runtime_options.GetOrDefault(Opt::LargeObjectThreshold),
+                       runtime_options.GetOrDefault(Opt::LargeObjectSpaceCompactionThreshold),
                        runtime_options.GetOrDefault(Opt::ParallelGCThreads),
                        runtime_options.GetOrDefault(Opt::ConcGCThreads),
                        runtime_options.Exists(Opt::LowMemoryMode),
@@ -1711,6 +1747,24 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
 
   verifier_logging_threshold_ms_ = runtime_options.GetOrDefault(Opt::VerifierLoggingThreshold);
 
+  const size_t startup_class_preload_threads =
+      runtime_options.GetOrDefault(Opt::StartupClassPreloadThreads);
+  if (startup_class_preload_threads != 0u && !IsAotCompiler()) {
+    startup_class_preloader_.reset(new StartupClassPreloader(startup_class_preload_threads));
+  }
+
+  if (runtime_options.Exists(Opt::CpuProfileFile) && !IsAotCompiler()) {
+    if (IsZygote()) {
+      // The sampling thread cannot run across forks, and all children would write to the same
+      // file anyway.
+      LOG(WARNING) << "Ignoring -Xcpu-profile in the zygote";
+    } else {
+      sampling_profiler_.reset(
+          new SamplingProfiler(runtime_options.ReleaseOrDefault(Opt::CpuProfileFile),
+                               runtime_options.GetOrDefault(Opt::CpuProfileInterval)));
+    }
+  }
+
   std::string error_msg;
   java_vm_ = JavaVMExt::Create(this, runtime_options, &error_msg);
   if (java_vm_.get() == nullptr) {
@@ -1836,6 +1890,9 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
     trace_config_->trace_output_mode = runtime_options.Exists(Opt::MethodTraceStreaming) ?
         Trace::TraceOutputMode::kStreaming :
         Trace::TraceOutputMode::kFile;
+    trace_config_->trace_flags = runtime_options.Exists(Opt::MethodTraceCompression) ?
+        Trace::kTraceCompressLz4 :
+        0;
   }
 
   // TODO: move this to just be an Trace::Start argument
@@ -2224,7 +2281,11 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
   GetInternTable()->DumpForSigQuit(os);
   GetJavaVM()->DumpForSigQuit(os);
   GetHeap()->DumpForSigQuit(os);
+  GetMonitorList()->DumpForSigQuit(os);
   oat_file_manager_->DumpForSigQuit(os);
+  if (startup_class_preloader_ != nullptr) {
+    startup_class_preloader_->DumpForSigQuit(os);
+  }
   if (GetJit() != nullptr) {
     GetJit()->DumpForSigQuit(os);
   } else {
@@ -2634,6 +2695,11 @@ void Runtime::RegisterAppInfo(const std::string& package_name,
     metrics_reporter_->NotifyAppInfoUpdated(&app_info_);
   }
 
+  if (startup_class_preloader_ != nullptr) {
+    startup_class_preloader_->Start(
+        Thread::Current(), code_paths, profile_output_filename, ref_profile_filename);
+  }
+
   if (jit_.get() == nullptr) {
     // We are not JITing. Nothing to do.
     return;
@@ -3189,6 +3255,11 @@ class Runtime::NotifyStartupCompletedTask : public gc::HeapTask {
       }
     }
 
+    if (runtime->startup_class_preloader_ != nullptr) {
+      ScopedTrace trace2("Report startup class preloading");
+      runtime->startup_class_preloader_->ReportStartupCompleted(self);
+    }
+
     {
       // Delete the thread pool used for app image loading since startup is assumed to be completed.
       ScopedTrace trace2("Delete thread pool");
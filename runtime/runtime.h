@@ -107,6 +107,8 @@ struct RuntimeArgumentMap;
 class RuntimeCallbacks;
 class SignalCatcher;
 class StackOverflowHandler;
+class SamplingProfiler;
+class StartupClassPreloader;
 class SuspensionHandler;
 class ThreadList;
 class ThreadPool;
@@ -401,8 +403,10 @@ class Runtime {
       REQUIRES_SHARED(Locks::mutator_lock_);
 
   // Sweep system weaks, the system weak is deleted if the visitor return null. Otherwise, the
-  // system weak is updated to be the visitor's returned value.
-  void SweepSystemWeaks(IsMarkedVisitor* visitor)
+  // system weak is updated to be the visitor's returned value. With `num_workers` > 1 the
+  // built-in holders are swept in parallel on the heap thread pool, so the visitor must be
+  // thread safe and the caller must be the thread running the GC.
+  void SweepSystemWeaks(IsMarkedVisitor* visitor, size_t num_workers = 1)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
   // Walk all reflective objects and visit their targets as well as any method/fields held by the
@@ -1310,6 +1314,12 @@ class Runtime {
   // Oat file manager, keeps track of what oat files are open.
   OatFileManager* oat_file_manager_;
 
+  // Loads the app's profile classes during startup, if enabled.
+  std::unique_ptr<StartupClassPreloader> startup_class_preloader_;
+
+  // Samples the managed stacks of running threads, if -Xcpu-profile was given.
+  std::unique_ptr<SamplingProfiler> sampling_profiler_;
+
   // Whether or not we are on a low RAM device.
   bool is_low_memory_mode_;
 
@@ -0,0 +1,581 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampling_profiler.h"
+
+#include <sys/time.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include "android-base/file.h"
+
+#include "art_method-inl.h"
+#include "barrier.h"
+#include "base/os.h"
+#include "base/systrace.h"
+#include "base/time_utils.h"
+#include "base/unix_file/fd_file.h"
+#include "dex/dex_file_types.h"
+#include "runtime.h"
+#include "scoped_thread_state_change-inl.h"
+#include "stack.h"
+#include "thread-current-inl.h"
+#include "thread_list.h"
+
+namespace art {
+
+namespace {
+
+uint64_t WallTimeNs() {
+  timeval now;
+  gettimeofday(&now, nullptr);
+  return static_cast<uint64_t>(now.tv_sec) * UINT64_C(1000000000) +
+         static_cast<uint64_t>(now.tv_usec) * UINT64_C(1000);
+}
+
+// Minimal encoder for the protobuf messages of the pprof profile.proto format.
+class ProtoBuffer {
+ public:
+  void AppendVarint(uint32_t field, uint64_t value) {
+    AppendRawVarint(field << 3);
+    AppendRawVarint(value);
+  }
+
+  void AppendString(uint32_t field, const std::string& value) {
+    AppendRawVarint((field << 3) | 2u);
+    AppendRawVarint(value.size());
+    data_.insert(data_.end(), value.begin(), value.end());
+  }
+
+  void AppendMessage(uint32_t field, const ProtoBuffer& message) {
+    AppendRawVarint((field << 3) | 2u);
+    AppendRawVarint(message.data_.size());
+    data_.insert(data_.end(), message.data_.begin(), message.data_.end());
+  }
+
+  void AppendPacked(uint32_t field, const std::vector<uint64_t>& values) {
+    ProtoBuffer packed;
+    for (uint64_t value : values) {
+      packed.AppendRawVarint(value);
+    }
+    AppendMessage(field, packed);
+  }
+
+  const std::vector<uint8_t>& GetData() const {
+    return data_;
+  }
+
+ private:
+  void AppendRawVarint(uint64_t value) {
+    while (value >= 0x80u) {
+      data_.push_back(static_cast<uint8_t>(value | 0x80u));
+      value >>= 7;
+    }
+    data_.push_back(static_cast<uint8_t>(value));
+  }
+
+  std::vector<uint8_t> data_;
+};
+
+// Field numbers of the pprof profile.proto messages.
+enum ProfileField : uint32_t {
+  kProfileSampleType = 1,
+  kProfileSample = 2,
+  kProfileLocation = 4,
+  kProfileFunction = 5,
+  kProfileStringTable = 6,
+  kProfileTimeNanos = 9,
+  kProfileDurationNanos = 10,
+  kProfilePeriodType = 11,
+  kProfilePeriod = 12,
+};
+enum ValueTypeField : uint32_t {
+  kValueTypeType = 1,
+  kValueTypeUnit = 2,
+};
+enum SampleField : uint32_t {
+  kSampleLocationId = 1,
+  kSampleValue = 2,
+  kSampleLabel = 3,
+};
+enum LabelField : uint32_t {
+  kLabelKey = 1,
+  kLabelStr = 2,
+  kLabelNum = 3,
+};
+enum LocationField : uint32_t {
+  kLocationId = 1,
+  kLocationLine = 4,
+};
+enum LineField : uint32_t {
+  kLineFunctionId = 1,
+  kLineLine = 2,
+};
+enum FunctionField : uint32_t {
+  kFunctionId = 1,
+  kFunctionName = 2,
+  kFunctionSystemName = 3,
+  kFunctionFilename = 4,
+};
+
+}  // namespace
+
+// Samples of one thread, as a trie of call stacks from the outermost frame down. Children are
+// found through a hash map keyed by parent node and frame, so adding a sample costs one lookup
+// per frame and allocates only for frames not seen before at that position.
+//
+// Classes may be unloaded and their methods freed before the profile is written, so the name and
+// line of each frame are resolved when its node is added, while the method is on the stack.
+class SamplingProfiler::ThreadProfile {
+ public:
+  struct Function {
+    std::string name;
+    std::string system_name;
+    std::string filename;
+  };
+
+  struct ResolvedFrame {
+    const Function* function;
+    int32_t line;
+  };
+
+  explicit ThreadProfile(const std::string& thread_name)
+      : thread_name_(thread_name),
+        last_cpu_time_ns_(kNoCpuTime),
+        num_samples_(0u),
+        nodes_(1u, Node{kRootNode, 0u, 0, 0u, 0u}) {}
+
+  const std::string& GetThreadName() const {
+    return thread_name_;
+  }
+
+  size_t GetNumSamples() const {
+    return num_samples_;
+  }
+
+  // Record the current CPU time of the thread and return the CPU time used since the previous
+  // call, or 0 for the first call.
+  uint64_t UpdateCpuTime(uint64_t cpu_time_ns) {
+    uint64_t last_cpu_time_ns = last_cpu_time_ns_;
+    last_cpu_time_ns_ = cpu_time_ns;
+    return (last_cpu_time_ns == kNoCpuTime || cpu_time_ns < last_cpu_time_ns)
+        ? 0u
+        : cpu_time_ns - last_cpu_time_ns;
+  }
+
+  // Buffer for walking the stack of the thread, reused across samples.
+  std::vector<Frame>* GetFrameBuffer() {
+    return &frame_buffer_;
+  }
+
+  void AddSample(const std::vector<Frame>& frames, uint64_t cpu_time_ns)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    uint32_t node = kRootNode;
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+      auto result = children_.emplace(ChildKey{node, it->method, it->dex_pc},
+                                     static_cast<uint32_t>(nodes_.size()));
+      if (result.second) {
+        nodes_.push_back(Node{node, ResolveFunction(it->method), ResolveLine(*it), 0u, 0u});
+      }
+      node = result.first->second;
+    }
+    nodes_[node].num_samples += 1u;
+    nodes_[node].cpu_time_ns += cpu_time_ns;
+    ++num_samples_;
+  }
+
+  // Call `visitor(frames, num_samples, cpu_time_ns)` for each distinct call stack sampled, with
+  // the innermost frame first.
+  template <typename Visitor>
+  void VisitSamples(const Visitor& visitor) const {
+    std::vector<ResolvedFrame> frames;
+    for (const Node& node : nodes_) {
+      if (node.num_samples == 0u) {
+        continue;
+      }
+      frames.clear();
+      for (const Node* n = &node; n != &nodes_[kRootNode]; n = &nodes_[n->parent]) {
+        frames.push_back(ResolvedFrame{&functions_[n->function], n->line});
+      }
+      visitor(frames, node.num_samples, node.cpu_time_ns);
+    }
+  }
+
+ private:
+  static constexpr uint64_t kNoCpuTime = std::numeric_limits<uint64_t>::max();
+  static constexpr uint32_t kRootNode = 0u;
+
+  struct Node {
+    uint32_t parent;
+    // Index in `functions_`.
+    uint32_t function;
+    int32_t line;
+    // Samples whose innermost frame is this node.
+    uint64_t num_samples;
+    uint64_t cpu_time_ns;
+  };
+
+  struct ChildKey {
+    uint32_t parent;
+    ArtMethod* method;
+    uint32_t dex_pc;
+
+    bool operator==(const ChildKey& other) const {
+      return parent == other.parent && method == other.method && dex_pc == other.dex_pc;
+    }
+  };
+
+  struct ChildKeyHash {
+    size_t operator()(const ChildKey& key) const {
+      size_t hash = reinterpret_cast<uintptr_t>(key.method);
+      hash = hash * 31u + key.dex_pc;
+      return hash * 31u + key.parent;
+    }
+  };
+
+  uint32_t ResolveFunction(ArtMethod* method) REQUIRES_SHARED(Locks::mutator_lock_) {
+    auto result = function_indexes_.emplace(method, static_cast<uint32_t>(functions_.size()));
+    if (result.second) {
+      ArtMethod* interface_method = method->GetInterfaceMethodIfProxy(kRuntimePointerSize);
+      const char* source_file = interface_method->GetDeclaringClassSourceFile();
+      functions_.push_back(Function{interface_method->PrettyMethod(),
+                                    interface_method->PrettyMethod(/* with_signature= */ false),
+                                    source_file != nullptr ? source_file : ""});
+    }
+    return result.first->second;
+  }
+
+  static int32_t ResolveLine(const Frame& frame) REQUIRES_SHARED(Locks::mutator_lock_) {
+    if (frame.method->IsProxyMethod() || frame.dex_pc == dex::kDexNoIndex) {
+      return 0;
+    }
+    return std::max(frame.method->GetLineNumFromDexPC(frame.dex_pc), 0);
+  }
+
+  const std::string thread_name_;
+  uint64_t last_cpu_time_ns_;
+  size_t num_samples_;
+  std::vector<Node> nodes_;
+  std::unordered_map<ChildKey, uint32_t, ChildKeyHash> children_;
+  // Methods resolved for the nodes.
+  std::vector<Function> functions_;
+  std::unordered_map<ArtMethod*, uint32_t> function_indexes_;
+  std::vector<Frame> frame_buffer_;
+};
+
+class SamplingProfiler::SampleCheckpoint final : public Closure {
+ public:
+  SampleCheckpoint(SamplingProfiler* profiler, Thread* sampling_thread)
+      : profiler_(profiler),
+        sampling_thread_(sampling_thread),
+        barrier_(0) {}
+
+  void Run(Thread* thread) override {
+    // Note thread and self may not be equal if thread was already suspended at the point of the
+    // request.
+    Thread* self = Thread::Current();
+    if (thread != sampling_thread_) {
+      ScopedObjectAccess soa(self);
+      profiler_->SampleThread(thread);
+    }
+    barrier_.Pass(self);
+  }
+
+  void WaitForThreadsToRunThroughCheckpoint(size_t threads_running_checkpoint) {
+    Thread* self = Thread::Current();
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    barrier_.Increment(self, threads_running_checkpoint);
+  }
+
+ private:
+  SamplingProfiler* const profiler_;
+  // The sampling thread runs the checkpoint too, but is not sampled.
+  Thread* const sampling_thread_;
+  // The barrier to be passed through and for the requestor to wait upon.
+  Barrier barrier_;
+};
+
+SamplingProfiler::SamplingProfiler(const std::string& output_filename, uint32_t interval_us)
+    : output_filename_(output_filename),
+      interval_us_(interval_us),
+      lock_("sampling profiler lock", kGenericBottomLock),
+      cond_("sampling profiler condition", lock_),
+      running_(false),
+      stop_requested_(false),
+      sampling_pthread_(0U),
+      start_time_ns_(0u),
+      start_wall_time_ns_(0u),
+      duration_ns_(0u) {}
+
+SamplingProfiler::~SamplingProfiler() {
+  CHECK_EQ(sampling_pthread_, 0U) << "Sampling profiler not stopped";
+}
+
+void SamplingProfiler::Start() {
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, lock_);
+    if (running_) {
+      return;
+    }
+    running_ = true;
+    stop_requested_ = false;
+  }
+  start_time_ns_ = NanoTime();
+  start_wall_time_ns_ = WallTimeNs();
+  CHECK_PTHREAD_CALL(pthread_create, (&sampling_pthread_, nullptr, &RunSamplingThread, this),
+                     "CPU profiler thread");
+}
+
+void SamplingProfiler::Stop() {
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, lock_);
+    if (!running_) {
+      return;
+    }
+    stop_requested_ = true;
+    cond_.Signal(self);
+  }
+  CHECK_PTHREAD_CALL(pthread_join, (sampling_pthread_, nullptr), "CPU profiler thread shutdown");
+  sampling_pthread_ = 0U;
+  duration_ns_ = NanoTime() - start_time_ns_;
+  {
+    MutexLock mu(self, lock_);
+    running_ = false;
+  }
+
+  std::unique_ptr<File> file(OS::CreateEmptyFileWriteOnly(output_filename_.c_str()));
+  if (file == nullptr) {
+    PLOG(ERROR) << "Unable to open CPU profile file '" << output_filename_ << "'";
+    return;
+  }
+  if (!WriteProfile(file->Fd()) || file->FlushCloseOrErase() != 0) {
+    PLOG(ERROR) << "Failed to write CPU profile file '" << output_filename_ << "'";
+    return;
+  }
+  LOG(INFO) << "Wrote " << GetNumSamples() << " CPU profile samples to " << output_filename_;
+}
+
+void* SamplingProfiler::RunSamplingThread(void* arg) {
+  SamplingProfiler* profiler = reinterpret_cast<SamplingProfiler*>(arg);
+  Runtime* runtime = Runtime::Current();
+  CHECK(runtime->AttachCurrentThread("CPU Profiler", true, runtime->GetSystemThreadGroup(),
+                                     !runtime->IsAotCompiler()));
+  Thread* self = Thread::Current();
+  const int64_t interval_ms = profiler->interval_us_ / 1000u;
+  const int32_t interval_ns = (profiler->interval_us_ % 1000u) * 1000u;
+  while (true) {
+    {
+      MutexLock mu(self, profiler->lock_);
+      if (!profiler->stop_requested_) {
+        profiler->cond_.TimedWait(self, interval_ms, interval_ns);
+      }
+      if (profiler->stop_requested_) {
+        break;
+      }
+    }
+    profiler->SampleThreads(self);
+  }
+  runtime->DetachCurrentThread();
+  return nullptr;
+}
+
+void SamplingProfiler::SampleThreads(Thread* self) {
+  ScopedTrace trace("CPU profile sampling");
+  SampleCheckpoint checkpoint(this, self);
+  size_t threads_running_checkpoint =
+      Runtime::Current()->GetThreadList()->RunCheckpoint(&checkpoint);
+  if (threads_running_checkpoint != 0) {
+    checkpoint.WaitForThreadsToRunThroughCheckpoint(threads_running_checkpoint);
+  }
+}
+
+void SamplingProfiler::SampleThread(Thread* thread) {
+  const pid_t tid = thread->GetTid();
+  ThreadProfile* profile = FindThreadProfile(tid);
+  if (profile == nullptr) {
+    std::string thread_name;
+    thread->GetThreadName(thread_name);
+    profile = GetOrCreateThreadProfile(tid, thread_name);
+  }
+  const uint64_t cpu_time_ns = profile->UpdateCpuTime(thread->GetCpuMicroTime() * 1000u);
+  if (cpu_time_ns == 0u) {
+    return;
+  }
+  std::vector<Frame>* frames = profile->GetFrameBuffer();
+  frames->clear();
+  StackVisitor::WalkStack(
+      [&](const StackVisitor* visitor) REQUIRES_SHARED(Locks::mutator_lock_) {
+        ArtMethod* method = visitor->GetMethod();
+        if (method->IsRuntimeMethod()) {
+          return true;
+        }
+        frames->push_back(Frame{method, visitor->GetDexPc(/* abort_on_failure= */ false)});
+        return frames->size() < kMaxStackDepth;
+      },
+      thread,
+      /* context= */ nullptr,
+      StackVisitor::StackWalkKind::kIncludeInlinedFrames);
+  if (!frames->empty()) {
+    profile->AddSample(*frames, cpu_time_ns);
+  }
+}
+
+void SamplingProfiler::AddSample(pid_t tid,
+                                 const std::string& thread_name,
+                                 const std::vector<Frame>& frames,
+                                 uint64_t cpu_time_ns) {
+  GetOrCreateThreadProfile(tid, thread_name)->AddSample(frames, cpu_time_ns);
+}
+
+SamplingProfiler::ThreadProfile* SamplingProfiler::FindThreadProfile(pid_t tid) {
+  MutexLock mu(Thread::Current(), lock_);
+  auto it = thread_profiles_.find(tid);
+  return (it != thread_profiles_.end()) ? it->second.get() : nullptr;
+}
+
+size_t SamplingProfiler::GetNumThreadSamples(pid_t tid) {
+  ThreadProfile* profile = FindThreadProfile(tid);
+  return (profile != nullptr) ? profile->GetNumSamples() : 0u;
+}
+
+SamplingProfiler::ThreadProfile* SamplingProfiler::GetOrCreateThreadProfile(
+    pid_t tid, const std::string& thread_name) {
+  MutexLock mu(Thread::Current(), lock_);
+  std::unique_ptr<ThreadProfile>& profile = thread_profiles_[tid];
+  if (profile == nullptr) {
+    profile.reset(new ThreadProfile(thread_name));
+  }
+  return profile.get();
+}
+
+size_t SamplingProfiler::GetNumSamples() {
+  MutexLock mu(Thread::Current(), lock_);
+  size_t num_samples = 0u;
+  for (const auto& entry : thread_profiles_) {
+    num_samples += entry.second->GetNumSamples();
+  }
+  return num_samples;
+}
+
+bool SamplingProfiler::WriteProfile(int fd) {
+  ProtoBuffer profile;
+  // Index 0 of the string table must be the empty string.
+  std::map<std::string, uint64_t> strings;
+  std::vector<const std::string*> string_table;
+  auto string_id = [&](const std::string& str) {
+    auto result = strings.emplace(str, string_table.size());
+    if (result.second) {
+      string_table.push_back(&result.first->first);
+    }
+    return result.first->second;
+  };
+  string_id("");
+
+  auto append_value_type = [&](uint32_t field, const char* type, const char* unit) {
+    ProtoBuffer value_type;
+    value_type.AppendVarint(kValueTypeType, string_id(type));
+    value_type.AppendVarint(kValueTypeUnit, string_id(unit));
+    profile.AppendMessage(field, value_type);
+  };
+  append_value_type(kProfileSampleType, "samples", "count");
+  append_value_type(kProfileSampleType, "cpu", "nanoseconds");
+
+  // Functions are methods and locations are lines in them. Ids start at 1.
+  using Location = std::pair<uint64_t, int32_t>;
+  std::map<std::vector<uint64_t>, uint64_t> functions;
+  std::map<Location, uint64_t> locations;
+  auto function_id = [&](const ThreadProfile::Function& function) {
+    std::vector<uint64_t> key = {string_id(function.name),
+                                 string_id(function.system_name),
+                                 string_id(function.filename)};
+    auto result = functions.emplace(key, functions.size() + 1u);
+    if (result.second) {
+      ProtoBuffer function_message;
+      function_message.AppendVarint(kFunctionId, result.first->second);
+      function_message.AppendVarint(kFunctionName, key[0]);
+      function_message.AppendVarint(kFunctionSystemName, key[1]);
+      function_message.AppendVarint(kFunctionFilename, key[2]);
+      profile.AppendMessage(kProfileFunction, function_message);
+    }
+    return result.first->second;
+  };
+  auto location_id = [&](const ThreadProfile::ResolvedFrame& frame) {
+    Location key(function_id(*frame.function), frame.line);
+    auto result = locations.emplace(key, locations.size() + 1u);
+    if (result.second) {
+      ProtoBuffer line_message;
+      line_message.AppendVarint(kLineFunctionId, key.first);
+      line_message.AppendVarint(kLineLine, static_cast<uint64_t>(key.second));
+      ProtoBuffer location;
+      location.AppendVarint(kLocationId, result.first->second);
+      location.AppendMessage(kLocationLine, line_message);
+      profile.AppendMessage(kProfileLocation, location);
+    }
+    return result.first->second;
+  };
+
+  // Profiles are never deleted, so they can be read without holding the lock.
+  std::vector<std::pair<pid_t, const ThreadProfile*>> thread_profiles;
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    for (const auto& entry : thread_profiles_) {
+      thread_profiles.emplace_back(entry.first, entry.second.get());
+    }
+  }
+  for (const auto& entry : thread_profiles) {
+    const pid_t tid = entry.first;
+    const ThreadProfile& thread_profile = *entry.second;
+    thread_profile.VisitSamples(
+        [&](const std::vector<ThreadProfile::ResolvedFrame>& frames,
+            uint64_t num_samples,
+            uint64_t cpu_time_ns) {
+          std::vector<uint64_t> location_ids;
+          location_ids.reserve(frames.size());
+          for (const ThreadProfile::ResolvedFrame& frame : frames) {
+            location_ids.push_back(location_id(frame));
+          }
+          ProtoBuffer thread_name_label;
+          thread_name_label.AppendVarint(kLabelKey, string_id("thread"));
+          thread_name_label.AppendVarint(kLabelStr, string_id(thread_profile.GetThreadName()));
+          ProtoBuffer tid_label;
+          tid_label.AppendVarint(kLabelKey, string_id("tid"));
+          tid_label.AppendVarint(kLabelNum, static_cast<uint64_t>(tid));
+          ProtoBuffer sample;
+          sample.AppendPacked(kSampleLocationId, location_ids);
+          sample.AppendPacked(kSampleValue, {num_samples, cpu_time_ns});
+          sample.AppendMessage(kSampleLabel, thread_name_label);
+          sample.AppendMessage(kSampleLabel, tid_label);
+          profile.AppendMessage(kProfileSample, sample);
+        });
+  }
+
+  profile.AppendVarint(kProfileTimeNanos, start_wall_time_ns_);
+  profile.AppendVarint(kProfileDurationNanos, duration_ns_);
+  append_value_type(kProfilePeriodType, "cpu", "nanoseconds");
+  profile.AppendVarint(kProfilePeriod, static_cast<uint64_t>(interval_us_) * 1000u);
+  for (const std::string* str : string_table) {
+    profile.AppendString(kProfileStringTable, *str);
+  }
+  const std::vector<uint8_t>& data = profile.GetData();
+  return android::base::WriteFully(fd, data.data(), data.size());
+}
+
+}  // namespace art
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_SAMPLING_PROFILER_H_
+#define ART_RUNTIME_SAMPLING_PROFILER_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/locks.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class ArtMethod;
+class Thread;
+
+// Low-overhead CPU profiler for managed code. Every interval, a background thread runs a
+// checkpoint on all threads. Threads that have used CPU time since their previous sample record
+// their managed stack, weighted by that CPU time: runnable threads walk their own stack at their
+// next suspend point, and threads that are suspended or in native code are walked by the sampler
+// while the checkpoint keeps them suspended. Idle threads cost one clock read per interval and
+// nothing is ever done with all threads suspended, unlike the sampling mode of method tracing.
+//
+// Each thread aggregates its samples in its own hash trie of call stacks, which only that thread
+// (or the sampler on its behalf) touches. When the profiler stops, the tries are written to a
+// file in the pprof profile.proto format.
+class SamplingProfiler {
+ public:
+  struct Frame {
+    ArtMethod* method;
+    uint32_t dex_pc;
+  };
+
+  // Maximum number of frames recorded per sample. Deeper stacks lose their outermost frames.
+  static constexpr size_t kMaxStackDepth = 128;
+
+  SamplingProfiler(const std::string& output_filename, uint32_t interval_us);
+  ~SamplingProfiler();
+
+  // Start the sampling thread. Does nothing if the profiler is already running.
+  void Start() REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  // Stop the sampling thread and write the profile to the output file.
+  void Stop() REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  // Add a sample of `cpu_time_ns` for the call stack `frames` (innermost frame first) of the
+  // thread `tid`. Samples of a thread must not be added concurrently.
+  void AddSample(pid_t tid,
+                 const std::string& thread_name,
+                 const std::vector<Frame>& frames,
+                 uint64_t cpu_time_ns)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!lock_);
+
+  // Write the samples recorded so far in the pprof format. Returns whether the write succeeded.
+  bool WriteProfile(int fd) REQUIRES(!lock_);
+
+  size_t GetNumSamples() REQUIRES(!lock_);
+
+ private:
+  class SampleCheckpoint;
+  class ThreadProfile;
+
+  static void* RunSamplingThread(void* arg);
+
+  // Run one sampling round and wait for all threads to take their sample.
+  void SampleThreads(Thread* self) REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  // Take a sample of `thread` if it has used CPU time since its previous sample.
+  void SampleThread(Thread* thread) REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!lock_);
+
+  ThreadProfile* FindThreadProfile(pid_t tid) REQUIRES(!lock_);
+  // Number of samples taken of the thread `tid`.
+  size_t GetNumThreadSamples(pid_t tid) REQUIRES(!lock_);
+  ThreadProfile* GetOrCreateThreadProfile(pid_t tid, const std::string& thread_name)
+      REQUIRES(!lock_);
+
+  const std::string output_filename_;
+  const uint32_t interval_us_;
+
+  Mutex lock_ BOTTOM_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable cond_ GUARDED_BY(lock_);
+  bool running_ GUARDED_BY(lock_);
+  bool stop_requested_ GUARDED_BY(lock_);
+  pthread_t sampling_pthread_;
+  // Monotonic and wall clock times of Start(), and time from Start() to Stop().
+  uint64_t start_time_ns_;
+  uint64_t start_wall_time_ns_;
+  uint64_t duration_ns_;
+  // Profiles of the threads that have been sampled, by thread id. The profiles themselves are
+  // only used by their thread until the profiler stops.
+  std::unordered_map<pid_t, std::unique_ptr<ThreadProfile>> thread_profiles_ GUARDED_BY(lock_);
+
+  friend class SamplingProfilerTest;
+
+  DISALLOW_COPY_AND_ASSIGN(SamplingProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_SAMPLING_PROFILER_H_
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampling_profiler.h"
+
+#include <string>
+#include <vector>
+
+#include "android-base/file.h"
+
+#include "art_method-inl.h"
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "jni/jni_internal.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "reflection.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+
+class SamplingProfilerTest : public CommonRuntimeTest {
+ protected:
+  static size_t GetNumThreadSamples(SamplingProfiler* profiler, Thread* thread)
+      REQUIRES(!profiler->lock_) {
+    return profiler->GetNumThreadSamples(thread->GetTid());
+  }
+};
+
+TEST_F(SamplingProfilerTest, WritesAggregatedSamples) {
+  ScratchFile profile_file;
+  SamplingProfiler profiler(profile_file.GetFilename(), 1000u);
+  ScopedObjectAccess soa(Thread::Current());
+  ObjPtr<mirror::Class> klass = class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+  ASSERT_TRUE(klass != nullptr);
+  ArtMethod* hash_code = klass->FindClassMethod("hashCode", "()I", kRuntimePointerSize);
+  ArtMethod* to_string =
+      klass->FindClassMethod("toString", "()Ljava/lang/String;", kRuntimePointerSize);
+  ASSERT_TRUE(hash_code != nullptr);
+  ASSERT_TRUE(to_string != nullptr);
+
+  using Frame = SamplingProfiler::Frame;
+  std::vector<Frame> inner_stack = {Frame{hash_code, 0u}, Frame{to_string, 0u}};
+  std::vector<Frame> outer_stack = {Frame{to_string, 0u}};
+  profiler.AddSample(1, "alpha", inner_stack, 1000u);
+  profiler.AddSample(1, "alpha", inner_stack, 2000u);
+  profiler.AddSample(1, "alpha", outer_stack, 3000u);
+  profiler.AddSample(2, "beta", outer_stack, 4000u);
+  EXPECT_EQ(profiler.GetNumSamples(), 4u);
+
+  ASSERT_TRUE(profiler.WriteProfile(profile_file.GetFd()));
+  std::string data;
+  ASSERT_TRUE(android::base::ReadFileToString(profile_file.GetFilename(), &data));
+  // The profile starts with a sample type and has each string once in its string table.
+  ASSERT_FALSE(data.empty());
+  EXPECT_EQ(data[0], '\x0a');
+  for (const std::string& str : {hash_code->PrettyMethod(),
+                                 to_string->PrettyMethod(),
+                                 std::string("alpha"),
+                                 std::string("beta"),
+                                 std::string("nanoseconds")}) {
+    size_t pos = data.find(str);
+    EXPECT_NE(pos, std::string::npos) << str;
+    EXPECT_EQ(data.find(str, pos + 1u), std::string::npos) << str;
+  }
+}
+
+TEST_F(SamplingProfilerTest, SamplesBusyManagedThread) {
+  static constexpr size_t kMaxCalls = 1000u;
+  Thread* self = Thread::Current();
+  ArtMethod* spin;
+  {
+    ScopedObjectAccess soa(self);
+    StackHandleScope<2> hs(self);
+    Handle<mirror::ClassLoader> class_loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader>(LoadDex("CpuProfile"))));
+    Handle<mirror::Class> klass =
+        hs.NewHandle(class_linker_->FindClass(self, "LCpuProfile;", class_loader));
+    ASSERT_TRUE(klass != nullptr);
+    ASSERT_TRUE(class_linker_->EnsureInitialized(self, klass, true, true));
+    MakeInterpreted(klass.Get());
+    spin = klass->FindClassMethod("spin", "(I)I", kRuntimePointerSize);
+    ASSERT_TRUE(spin != nullptr);
+  }
+  // The sampling thread needs a started runtime to attach.
+  self->TransitionFromSuspendedToRunnable();
+  ASSERT_TRUE(runtime_->Start());
+
+  ScratchFile profile_file;
+  SamplingProfiler profiler(profile_file.GetFilename(), 100u);
+  profiler.Start();
+  {
+    // Spin in managed code until the checkpoints of the profiler have sampled this thread.
+    ScopedObjectAccess soa(self);
+    jvalue args[1];
+    args[0].i = 100000;
+    for (size_t i = 0; i != kMaxCalls && GetNumThreadSamples(&profiler, self) == 0u; ++i) {
+      InvokeWithJValues(soa, nullptr, jni::EncodeArtMethod(spin), args);
+    }
+  }
+  profiler.Stop();
+  EXPECT_NE(GetNumThreadSamples(&profiler, self), 0u);
+
+  // This thread has no managed frame outside of spin(), so its samples are all in spin().
+  std::string data;
+  ASSERT_TRUE(android::base::ReadFileToString(profile_file.GetFilename(), &data));
+  ScopedObjectAccess soa(self);
+  EXPECT_NE(data.find(spin->PrettyMethod()), std::string::npos);
+}
+
+}  // namespace art
@@ -44,6 +44,7 @@
 #include "obj_ptr-inl.h"
 #include "quick/quick_method_frame_info.h"
 #include "runtime.h"
+#include "stack_map_cache.h"
 #include "thread.h"
 #include "thread_list.h"
 
@@ -59,6 +60,11 @@ StackVisitor::StackVisitor(Thread* thread,
                            bool check_suspended)
     : StackVisitor(thread, context, walk_kind, 0, check_suspended) {}
 
+static StackMapCache* GetStackMapCacheOfCurrentThread() {
+  Thread* self = Thread::Current();
+  return self != nullptr ? self->GetStackMapCache() : nullptr;
+}
+
 StackVisitor::StackVisitor(Thread* thread,
                            Context* context,
                            StackWalkKind walk_kind,
@@ -74,6 +80,7 @@ StackVisitor::StackVisitor(Thread* thread,
       cur_depth_(0),
       cur_inline_info_(nullptr, CodeInfo()),
       cur_stack_map_(0, StackMap()),
+      stack_map_cache_(GetStackMapCacheOfCurrentThread()),
       context_(context),
       check_suspended_(check_suspended) {
   if (check_suspended_) {
@@ -85,7 +92,10 @@ CodeInfo* StackVisitor::GetCurrentInlineInfo() const {
   DCHECK(!(*cur_quick_frame_)->IsNative());
   const OatQuickMethodHeader* header = GetCurrentOatQuickMethodHeader();
   if (cur_inline_info_.first != header) {
-    cur_inline_info_ = std::make_pair(header, CodeInfo::DecodeInlineInfoOnly(header));
+    cur_inline_info_ = std::make_pair(header,
+                                      stack_map_cache_ != nullptr
+                                          ? stack_map_cache_->GetCodeInfo(header)
+                                          : CodeInfo::DecodeInlineInfoOnly(header));
   }
   return &cur_inline_info_.second;
 }
@@ -95,12 +105,24 @@ StackMap* StackVisitor::GetCurrentStackMap() const {
   const OatQuickMethodHeader* header = GetCurrentOatQuickMethodHeader();
   if (cur_stack_map_.first != cur_quick_frame_pc_) {
     uint32_t pc = header->NativeQuickPcOffset(cur_quick_frame_pc_);
-    cur_stack_map_ = std::make_pair(cur_quick_frame_pc_,
-                                    GetCurrentInlineInfo()->GetStackMapForNativePcOffset(pc));
+    cur_stack_map_ = std::make_pair(
+        cur_quick_frame_pc_, GetStackMapForNativePcOffset(header, *GetCurrentInlineInfo(), pc));
   }
   return &cur_stack_map_.second;
 }
 
+CodeInfo StackVisitor::DecodeCodeInfo(const OatQuickMethodHeader* header) const {
+  return stack_map_cache_ != nullptr ? stack_map_cache_->GetCodeInfo(header) : CodeInfo(header);
+}
+
+StackMap StackVisitor::GetStackMapForNativePcOffset(const OatQuickMethodHeader* header,
+                                                    const CodeInfo& code_info,
+                                                    uint32_t native_pc_offset) const {
+  return stack_map_cache_ != nullptr
+      ? stack_map_cache_->GetStackMapForNativePcOffset(header, code_info, native_pc_offset)
+      : code_info.GetStackMapForNativePcOffset(native_pc_offset);
+}
+
 ArtMethod* StackVisitor::GetMethod() const {
   if (cur_shadow_frame_ != nullptr) {
     return cur_shadow_frame_->GetMethod();
@@ -272,10 +294,10 @@ bool StackVisitor::GetVRegFromOptimizedCode(ArtMethod* m,
   uint16_t number_of_dex_registers = accessor.RegistersSize();
   DCHECK_LT(vreg, number_of_dex_registers);
   const OatQuickMethodHeader* method_header = GetCurrentOatQuickMethodHeader();
-  CodeInfo code_info(method_header);
+  CodeInfo code_info = DecodeCodeInfo(method_header);
 
   uint32_t native_pc_offset = method_header->NativeQuickPcOffset(cur_quick_frame_pc_);
-  StackMap stack_map = code_info.GetStackMapForNativePcOffset(native_pc_offset);
+  StackMap stack_map = GetStackMapForNativePcOffset(method_header, code_info, native_pc_offset);
   DCHECK(stack_map.IsValid());
 
   DexRegisterMap dex_register_map = IsInInlinedFrame()
@@ -38,6 +38,7 @@ class Context;
 class HandleScope;
 class OatQuickMethodHeader;
 class ShadowFrame;
+class StackMapCache;
 class Thread;
 union JValue;
 
@@ -129,6 +130,17 @@ class StackVisitor {
   bool GetRegisterIfAccessible(uint32_t reg, DexRegisterLocation::Kind kind, uint32_t* val) const
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Decode the CodeInfo of optimized code and find its stack maps, going through the cache of the
+  // thread making the walk.
+  CodeInfo DecodeCodeInfo(const OatQuickMethodHeader* header) const;
+  StackMap GetStackMapForNativePcOffset(const OatQuickMethodHeader* header,
+                                        const CodeInfo& code_info,
+                                        uint32_t native_pc_offset) const;
+  // Without a cache, callers that only need the stack masks should decode just those.
+  bool HasStackMapCache() const {
+    return stack_map_cache_ != nullptr;
+  }
+
  public:
   virtual ~StackVisitor() {}
   StackVisitor(const StackVisitor&) = default;
@@ -368,6 +380,10 @@ class StackVisitor {
   mutable std::pair<const OatQuickMethodHeader*, CodeInfo> cur_inline_info_;
   mutable std::pair<uintptr_t, StackMap> cur_stack_map_;
 
+  // Cache of the thread making the walk, which is not necessarily `thread_`. Null if the walk is
+  // made by an unattached thread.
+  StackMapCache* const stack_map_cache_;
+
  protected:
   Context* const context_;
   const bool check_suspended_;
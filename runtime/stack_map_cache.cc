@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack_map_cache.h"
+
+namespace art {
+
+std::atomic<uint32_t> StackMapCache::global_generation_(0u);
+
+void StackMapCache::Clear(uint32_t generation) {
+  code_infos_.fill(CodeInfoEntry{});
+  stack_maps_.fill(StackMapEntry{});
+  generation_ = generation;
+}
+
+}  // namespace art
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_STACK_MAP_CACHE_H_
+#define ART_RUNTIME_STACK_MAP_CACHE_H_
+
+#include <array>
+#include <atomic>
+
+#include "base/bit_utils.h"
+#include "base/macros.h"
+#include "oat_quick_method_header.h"
+#include "stack_map.h"
+
+namespace art {
+
+// Small thread-local cache of CodeInfo decoding and stack map lookups, used when walking stacks.
+// Walking a frame of optimized code decodes the CodeInfo of the method and then binary searches
+// its stack maps for the return PC. Stack walks for exceptions, stack traces and GC roots tend to
+// see the same methods and call sites over and over, so both results are cached, keyed by method
+// header and native PC offset.
+//
+// All operations must be done from the owning thread. Callers get copies of the decoded CodeInfo,
+// so a later lookup evicting an entry does not invalidate anything the caller holds.
+//
+// Method headers are only valid keys for as long as their code is alive. Whoever frees compiled
+// code (JIT code cache collection, oat file unloading) must call InvalidateAll() before the
+// memory can be reused; each cache then drops its entries on its next lookup.
+class StackMapCache {
+ public:
+  // Direct-mapped. CodeInfo entries are large (several hundred bytes), stack map entries are not.
+  static constexpr size_t kNumCodeInfos = 16;
+  static constexpr size_t kNumStackMaps = 256;
+
+  StackMapCache() : generation_(global_generation_.load(std::memory_order_acquire)) {
+    code_infos_.fill(CodeInfoEntry{});
+    stack_maps_.fill(StackMapEntry{});
+  }
+
+  // Return the fully decoded CodeInfo of the optimized code of `header`.
+  ALWAYS_INLINE CodeInfo GetCodeInfo(const OatQuickMethodHeader* header) {
+    DCHECK(header->IsOptimized());
+    CheckGeneration();
+    CodeInfoEntry& entry = code_infos_[CodeInfoIndexOf(header)];
+    if (UNLIKELY(entry.header != header)) {
+      entry.code_info = CodeInfo(header);
+      entry.header = header;
+    }
+    return entry.code_info;
+  }
+
+  // Same as `code_info.GetStackMapForNativePcOffset(native_pc_offset)`, where `code_info` is the
+  // CodeInfo of `header`.
+  ALWAYS_INLINE StackMap GetStackMapForNativePcOffset(const OatQuickMethodHeader* header,
+                                                      const CodeInfo& code_info,
+                                                      uint32_t native_pc_offset) {
+    CheckGeneration();
+    StackMapEntry& entry = stack_maps_[StackMapIndexOf(header, native_pc_offset)];
+    if (LIKELY(entry.header == header && entry.native_pc_offset == native_pc_offset)) {
+      StackMap stack_map = code_info.GetStackMapAt(entry.stack_map_index);
+      DCHECK(!stack_map.IsValid() || stack_map.GetNativePcOffset(kRuntimeISA) == native_pc_offset);
+      return stack_map;
+    }
+    StackMap stack_map = code_info.GetStackMapForNativePcOffset(native_pc_offset);
+    entry = StackMapEntry{header, native_pc_offset, stack_map.Row()};
+    return stack_map;
+  }
+
+  // Invalidate the entries of all caches. Must be called when compiled code is freed, before its
+  // memory can be reused.
+  static void InvalidateAll() {
+    global_generation_.fetch_add(1u, std::memory_order_release);
+  }
+
+ private:
+  struct CodeInfoEntry {
+    const OatQuickMethodHeader* header = nullptr;
+    CodeInfo code_info;
+  };
+
+  struct StackMapEntry {
+    const OatQuickMethodHeader* header = nullptr;
+    uint32_t native_pc_offset = 0u;
+    uint32_t stack_map_index = 0u;
+  };
+
+  ALWAYS_INLINE void CheckGeneration() {
+    uint32_t generation = global_generation_.load(std::memory_order_acquire);
+    if (UNLIKELY(generation != generation_)) {
+      Clear(generation);
+    }
+  }
+
+  NO_INLINE void Clear(uint32_t generation);
+
+  static ALWAYS_INLINE size_t CodeInfoIndexOf(const OatQuickMethodHeader* header) {
+    static_assert(IsPowerOfTwo(kNumCodeInfos), "Size must be power of two");
+    return (reinterpret_cast<uintptr_t>(header) >> 4) & (kNumCodeInfos - 1);
+  }
+
+  static ALWAYS_INLINE size_t StackMapIndexOf(const OatQuickMethodHeader* header,
+                                              uint32_t native_pc_offset) {
+    static_assert(IsPowerOfTwo(kNumStackMaps), "Size must be power of two");
+    // Call sites are at least two bytes apart on all ISAs.
+    return ((reinterpret_cast<uintptr_t>(header) >> 4) ^ (native_pc_offset >> 1)) &
+        (kNumStackMaps - 1);
+  }
+
+  static std::atomic<uint32_t> global_generation_;
+
+  // Value of global_generation_ when the entries were last cleared.
+  uint32_t generation_;
+  std::array<CodeInfoEntry, kNumCodeInfos> code_infos_;
+  std::array<StackMapEntry, kNumStackMaps> stack_maps_;
+
+  DISALLOW_COPY_AND_ASSIGN(StackMapCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_STACK_MAP_CACHE_H_
@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "startup_class_preloader.h"
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <ostream>
+#include <set>
+
+#include "base/logging.h"  // For VLOG.
+#include "base/systrace.h"
+#include "base/time_utils.h"
+#include "base/unix_file/fd_file.h"
+#include "class_linker.h"
+#include "class_loader_utils.h"
+#include "dex/dex_file-inl.h"
+#include "dex/dex_file_loader.h"
+#include "handle_scope-inl.h"
+#include "jni/java_vm_ext.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "profile/profile_compilation_info.h"
+#include "runtime.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-current-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+
+// Number of profile classes handed to a worker at a time.
+static constexpr size_t kPreloadChunkSize = 64;
+
+class StartupClassPreloader::PreloadTask final : public Task {
+ public:
+  PreloadTask(StartupClassPreloader* preloader,
+              const DexFile* dex_file,
+              std::vector<dex::TypeIndex>&& type_indexes,
+              jobject class_loader)
+      : preloader_(preloader),
+        dex_file_(dex_file),
+        type_indexes_(std::move(type_indexes)) {
+    Thread* const self = Thread::Current();
+    ScopedObjectAccess soa(self);
+    // Create a global ref for `class_loader` because it will be accessed from a different thread.
+    class_loader_ = soa.Vm()->AddGlobalRef(self, soa.Decode<mirror::ClassLoader>(class_loader));
+    CHECK(class_loader_ != nullptr);
+  }
+
+  ~PreloadTask() {
+    Thread* const self = Thread::Current();
+    ScopedObjectAccess soa(self);
+    soa.Vm()->DeleteGlobalRef(self, class_loader_);
+  }
+
+  void Run(Thread* self) override {
+    ScopedTrace trace("Preload startup classes");
+    ran_ = true;
+    ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
+    const uint64_t start_cpu_time_ns = ThreadCpuNanoTime();
+    std::vector<PreloadedClass> preloaded_classes;
+    size_t num_already_loaded = 0u;
+    size_t num_failed = 0u;
+    for (dex::TypeIndex type_index : type_indexes_) {
+      const char* descriptor = dex_file_->StringByTypeIdx(type_index);
+      const uint64_t start_time_ns = NanoTime();
+
+      // Take handles inside the loop so that the app's threads are not kept waiting for the
+      // mutator lock for longer than a single class.
+      ScopedObjectAccess soa(self);
+      StackHandleScope<2> hs(self);
+      Handle<mirror::ClassLoader> h_loader(hs.NewHandle(
+          soa.Decode<mirror::ClassLoader>(class_loader_)));
+      ObjPtr<mirror::Class> klass = class_linker->LookupClass(self, descriptor, h_loader.Get());
+      if (klass != nullptr && klass->IsVerified()) {
+        // Loaded from the app image, or already used by the app.
+        ++num_already_loaded;
+        continue;
+      }
+
+      Handle<mirror::Class> h_class(hs.NewHandle<mirror::Class>(class_linker->FindClass(
+          self,
+          descriptor,
+          h_loader)));
+      if (h_class == nullptr) {
+        CHECK(self->IsExceptionPending());
+        self->ClearException();
+        ++num_failed;
+        continue;
+      }
+
+      if (&h_class->GetDexFile() != dex_file_) {
+        // A parent class loader or an earlier dex file defines a class with the same
+        // descriptor. That is the class the app gets, and it is not ours to account for.
+        ++num_already_loaded;
+        continue;
+      }
+
+      class_linker->VerifyClass(self, /*verifier_deps=*/ nullptr, h_class);
+      if (h_class->IsErroneous()) {
+        // ClassLinker::VerifyClass throws, which isn't useful here.
+        CHECK(self->IsExceptionPending());
+        self->ClearException();
+        ++num_failed;
+        continue;
+      }
+      preloaded_classes.push_back(PreloadedClass{descriptor, NanoTime() - start_time_ns});
+    }
+    preloader_->AddResults(preloaded_classes,
+                           num_already_loaded,
+                           num_failed,
+                           ThreadCpuNanoTime() - start_cpu_time_ns);
+  }
+
+  void Finalize() override {
+    if (!ran_) {
+      // The thread pool is being deleted.
+      preloader_->DropTask(type_indexes_.size());
+    }
+    delete this;
+  }
+
+ private:
+  StartupClassPreloader* const preloader_;
+  const DexFile* const dex_file_;
+  const std::vector<dex::TypeIndex> type_indexes_;
+  jobject class_loader_;
+  bool ran_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(PreloadTask);
+};
+
+StartupClassPreloader::StartupClassPreloader(size_t num_threads)
+    : num_threads_(num_threads),
+      lock_("startup class preloader lock", kGenericBottomLock),
+      class_loader_(nullptr),
+      started_(false),
+      startup_completed_(false),
+      start_time_ns_(0u),
+      num_requested_(0u),
+      num_pending_tasks_(0u),
+      num_preloaded_(0u),
+      num_already_loaded_(0u),
+      num_failed_(0u),
+      num_dropped_(0u),
+      cpu_time_ns_(0u),
+      wall_time_ns_(0u),
+      num_preloaded_at_startup_(0u),
+      num_used_at_startup_(0u),
+      time_saved_ns_(0u) {
+  DCHECK_GT(num_threads_, 0u);
+}
+
+StartupClassPreloader::~StartupClassPreloader() {
+  DCHECK(thread_pool_ == nullptr);
+}
+
+void StartupClassPreloader::Start(Thread* self,
+                                  const std::vector<std::string>& code_paths,
+                                  const std::string& profile_filename,
+                                  const std::string& ref_profile_filename) {
+  Runtime* const runtime = Runtime::Current();
+  if (runtime->IsJavaDebuggable()) {
+    // Threads created by ThreadPool ("runtime threads") are not allowed to load
+    // classes when debuggable to match class-initialization semantics
+    // expectations. Do not preload.
+    return;
+  }
+  if (runtime->IsZygote() || runtime->IsShuttingDown(self) || code_paths.empty()) {
+    return;
+  }
+  {
+    MutexLock mu(self, lock_);
+    if (started_) {
+      return;
+    }
+  }
+  ScopedTrace trace(__FUNCTION__);
+
+  // Prefer the reference profile, which is what the app was compiled with, and fall back to the
+  // current profile for apps that have not been compiled with one yet.
+  std::unique_ptr<ProfileCompilationInfo> profile_info;
+  for (const std::string* filename : {&ref_profile_filename, &profile_filename}) {
+    if (filename->empty()) {
+      continue;
+    }
+    unix_file::FdFile profile(filename->c_str(), O_RDONLY, /*check_usage=*/ false);
+    if (profile.Fd() == -1) {
+      continue;
+    }
+    profile_info.reset(new ProfileCompilationInfo());
+    if (profile_info->Load(profile.Fd())) {
+      VLOG(startup) << "Preloading startup classes from " << *filename;
+      break;
+    }
+    profile_info.reset();
+  }
+  if (profile_info == nullptr) {
+    VLOG(startup) << "No profile to preload startup classes from";
+    return;
+  }
+
+  // Find the class loader of the app, the one that loaded the primary APK, together with its
+  // dex files and the classes the profile lists for each of them.
+  const std::string& primary_apk = code_paths[0];
+  std::vector<std::pair<const DexFile*, std::set<dex::TypeIndex>>> profile_classes;
+  jobject class_loader = nullptr;
+  {
+    ScopedObjectAccess soa(self);
+    VariableSizedHandleScope hs(self);
+    std::vector<Handle<mirror::ClassLoader>> class_loaders;
+    {
+      auto visitor = [&](ObjPtr<mirror::ClassLoader> loader)
+          REQUIRES_SHARED(Locks::mutator_lock_) {
+        class_loaders.push_back(hs.NewHandle(loader));
+      };
+      ClassLoaderFuncVisitor<decltype(visitor)> class_loader_visitor(visitor);
+      ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+      runtime->GetClassLinker()->VisitClassLoaders(&class_loader_visitor);
+    }
+    Handle<mirror::ClassLoader> h_loader = hs.NewHandle<mirror::ClassLoader>(nullptr);
+    std::vector<const DexFile*> dex_files;
+    for (Handle<mirror::ClassLoader> candidate : class_loaders) {
+      if (!IsInstanceOfBaseDexClassLoader(soa, candidate)) {
+        continue;
+      }
+      bool found = false;
+      VisitClassLoaderDexFiles(soa,
+                               candidate,
+                               [&](const DexFile* dex_file) {
+                                 found = DexFileLoader::GetBaseLocation(dex_file->GetLocation()) ==
+                                     primary_apk;
+                                 return !found;
+                               });
+      if (found) {
+        h_loader = candidate;
+        VisitClassLoaderDexFiles(soa,
+                                 candidate,
+                                 [&](const DexFile* dex_file) {
+                                   dex_files.push_back(dex_file);
+                                   return true;
+                                 });
+        break;
+      }
+    }
+    if (h_loader == nullptr) {
+      // The class loader for these code paths has not been created yet.
+      VLOG(startup) << "No class loader to preload startup classes for " << primary_apk;
+      return;
+    }
+
+    std::set<uint16_t> unused_methods;
+    for (const DexFile* dex_file : dex_files) {
+      std::set<dex::TypeIndex> class_types;
+      if (!profile_info->GetClassesAndMethods(*dex_file,
+                                              &class_types,
+                                              &unused_methods,
+                                              &unused_methods,
+                                              &unused_methods)) {
+        // The profile does not reference this dex file, or its checksum does not match.
+        continue;
+      }
+      // Only keep classes defined by this dex file; array classes and classes from other dex
+      // files are loaded together with the classes that need them.
+      for (auto it = class_types.begin(); it != class_types.end();) {
+        if (it->index_ >= dex_file->NumTypeIds() || dex_file->FindClassDef(*it) == nullptr) {
+          it = class_types.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      if (!class_types.empty()) {
+        profile_classes.emplace_back(dex_file, std::move(class_types));
+      }
+    }
+    if (profile_classes.empty()) {
+      VLOG(startup) << "No profile classes to preload for " << primary_apk;
+      return;
+    }
+    class_loader = soa.Vm()->AddGlobalRef(self, h_loader.Get());
+  }
+
+  // Create the tasks before publishing `class_loader`: ReportStartupCompleted() may release it as
+  // soon as it is published, so each task takes its own reference now.
+  size_t num_requested = 0u;
+  std::vector<PreloadTask*> tasks;
+  for (const auto& [dex_file, class_types] : profile_classes) {
+    std::vector<dex::TypeIndex> type_indexes(class_types.begin(), class_types.end());
+    num_requested += type_indexes.size();
+    for (size_t begin = 0; begin < type_indexes.size(); begin += kPreloadChunkSize) {
+      size_t end = std::min(begin + kPreloadChunkSize, type_indexes.size());
+      tasks.push_back(new PreloadTask(
+          this,
+          dex_file,
+          std::vector<dex::TypeIndex>(type_indexes.begin() + begin, type_indexes.begin() + end),
+          class_loader));
+    }
+  }
+
+  {
+    MutexLock mu(self, lock_);
+    if (!started_) {
+      started_ = true;
+      class_loader_ = class_loader;
+      start_time_ns_ = NanoTime();
+      class_loader = nullptr;
+    }
+  }
+  if (class_loader != nullptr) {
+    // Lost a race with another thread registering the same app.
+    for (PreloadTask* task : tasks) {
+      delete task;
+    }
+    ScopedObjectAccess soa(self);
+    soa.Vm()->DeleteGlobalRef(self, class_loader);
+    return;
+  }
+
+  std::unique_ptr<ThreadPool> thread_pool(
+      new ThreadPool("Startup class preload thread pool", num_threads_));
+  {
+    MutexLock mu(self, lock_);
+    num_requested_ = num_requested;
+    num_pending_tasks_ = tasks.size();
+  }
+  for (PreloadTask* task : tasks) {
+    thread_pool->AddTask(self, task);
+  }
+  thread_pool->StartWorkers(self);
+  VLOG(startup) << "Preloading " << num_requested << " startup classes in " << tasks.size()
+                << " tasks on " << num_threads_ << " threads";
+  {
+    MutexLock mu(self, lock_);
+    if (!startup_completed_) {
+      thread_pool_ = std::move(thread_pool);
+    }
+  }
+  if (thread_pool != nullptr) {
+    // Startup completed while the tasks were being created.
+    thread_pool->WaitForWorkersToBeCreated();
+    thread_pool.reset();
+  }
+}
+
+void StartupClassPreloader::AddResults(const std::vector<PreloadedClass>& preloaded_classes,
+                                       size_t num_already_loaded,
+                                       size_t num_failed,
+                                       uint64_t cpu_time_ns) {
+  MutexLock mu(Thread::Current(), lock_);
+  if (!startup_completed_) {
+    // Classes preloaded after startup are not accounted as saving startup time.
+    preloaded_classes_.insert(
+        preloaded_classes_.end(), preloaded_classes.begin(), preloaded_classes.end());
+  }
+  num_preloaded_ += preloaded_classes.size();
+  num_already_loaded_ += num_already_loaded;
+  num_failed_ += num_failed;
+  cpu_time_ns_ += cpu_time_ns;
+  FinishTaskLocked();
+}
+
+void StartupClassPreloader::DropTask(size_t num_classes) {
+  MutexLock mu(Thread::Current(), lock_);
+  num_dropped_ += num_classes;
+  FinishTaskLocked();
+}
+
+void StartupClassPreloader::FinishTaskLocked() {
+  DCHECK_GT(num_pending_tasks_, 0u);
+  if (--num_pending_tasks_ == 0u) {
+    wall_time_ns_ = NanoTime() - start_time_ns_;
+    VLOG(startup) << "Preloaded " << num_preloaded_ << " of " << num_requested_
+                  << " startup classes in " << PrettyDuration(wall_time_ns_)
+                  << " (" << num_already_loaded_ << " already loaded, " << num_failed_
+                  << " failed, " << num_dropped_ << " dropped, worker cpu time "
+                  << PrettyDuration(cpu_time_ns_) << ")";
+  }
+}
+
+void StartupClassPreloader::ReportStartupCompleted(Thread* self) {
+  std::vector<PreloadedClass> preloaded_classes;
+  jobject class_loader;
+  {
+    MutexLock mu(self, lock_);
+    if (!started_ || startup_completed_) {
+      return;
+    }
+    startup_completed_ = true;
+    preloaded_classes.swap(preloaded_classes_);
+    class_loader = class_loader_;
+    class_loader_ = nullptr;
+  }
+
+  // A preloaded class that the app has initialized by now was on its startup path: without the
+  // preloader, one of the app's threads would have spent the time loading it.
+  size_t num_used = 0u;
+  uint64_t time_saved_ns = 0u;
+  {
+    ScopedObjectAccess soa(self);
+    ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
+    StackHandleScope<1> hs(self);
+    Handle<mirror::ClassLoader> h_loader(hs.NewHandle(
+        soa.Decode<mirror::ClassLoader>(class_loader)));
+    for (const PreloadedClass& preloaded_class : preloaded_classes) {
+      ObjPtr<mirror::Class> klass =
+          class_linker->LookupClass(self, preloaded_class.descriptor, h_loader.Get());
+      if (klass != nullptr && klass->IsInitialized()) {
+        ++num_used;
+        time_saved_ns += preloaded_class.preload_time_ns;
+      }
+    }
+    // The descriptors point into the dex files of `class_loader`, only release it now.
+    soa.Vm()->DeleteGlobalRef(self, class_loader);
+  }
+
+  {
+    MutexLock mu(self, lock_);
+    num_preloaded_at_startup_ = preloaded_classes.size();
+    num_used_at_startup_ = num_used;
+    time_saved_ns_ = time_saved_ns;
+  }
+  metrics::ArtMetrics* metrics = Runtime::Current()->GetMetrics();
+  metrics->StartupClassPreloadCount()->Add(preloaded_classes.size());
+  metrics->StartupClassPreloadUsedCount()->Add(num_used);
+  metrics->StartupClassPreloadTimeSaved()->Add(NsToUs(time_saved_ns));
+  VLOG(startup) << num_used << " of " << preloaded_classes.size()
+                << " preloaded classes used during startup, saving an estimated "
+                << PrettyDuration(time_saved_ns);
+
+  DeleteThreadPool();
+}
+
+void StartupClassPreloader::DumpForSigQuit(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  if (!started_) {
+    return;
+  }
+  os << "Startup class preloading: " << num_preloaded_ << " of " << num_requested_
+     << " profile classes preloaded, " << num_already_loaded_ << " already loaded, "
+     << num_failed_ << " failed, " << num_dropped_ << " dropped, worker cpu time "
+     << PrettyDuration(cpu_time_ns_);
+  if (num_pending_tasks_ == 0u) {
+    os << ", done in " << PrettyDuration(wall_time_ns_);
+  }
+  os << "\n";
+  if (startup_completed_) {
+    os << "Startup class preloading: " << num_used_at_startup_ << " of "
+       << num_preloaded_at_startup_ << " classes preloaded before startup completed were used, "
+       << "estimated time saved " << PrettyDuration(time_saved_ns_) << "\n";
+  }
+}
+
+void StartupClassPreloader::DeleteThreadPool() {
+  std::unique_ptr<ThreadPool> thread_pool;
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    thread_pool = std::move(thread_pool_);
+  }
+  if (thread_pool != nullptr) {
+    ScopedTrace trace("Delete startup class preload thread pool");
+    // Make sure workers are started to prevent thread shutdown errors. Deleting the pool waits
+    // for the running tasks and finalizes the others, which DropTask() accounts for.
+    thread_pool->WaitForWorkersToBeCreated();
+    thread_pool.reset();
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_STARTUP_CLASS_PRELOADER_H_
+#define ART_RUNTIME_STARTUP_CLASS_PRELOADER_H_
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/locks.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "jni.h"
+
+namespace art {
+
+class Thread;
+class ThreadPool;
+
+// Loads, links and verifies the classes listed in an app's profile on a thread pool while the
+// app is starting, so that the main thread finds them ready when it first uses them.
+//
+// The workers go through ClassLinker::FindClass with the app's class loader, so delegation is the
+// same as for the app, and classes are defined under the same locks: a class that the main thread
+// needs before a worker gets to it is simply loaded (or waited for) on the main thread. Workers
+// never initialize classes; <clinit> still runs on first use, in the order the app asks for it.
+//
+// When startup completes, the preloaded classes the app has since initialized are counted as
+// used and the time the workers spent on them is reported as main-thread time saved.
+class StartupClassPreloader {
+ public:
+  explicit StartupClassPreloader(size_t num_threads);
+  ~StartupClassPreloader();
+
+  // Start preloading the classes that the profile at `ref_profile_filename` (or, if that cannot
+  // be read, `profile_filename`) lists for the class loader of `code_paths`. Does nothing if
+  // preloading has already started or the class loader has not been created yet.
+  void Start(Thread* self,
+             const std::vector<std::string>& code_paths,
+             const std::string& profile_filename,
+             const std::string& ref_profile_filename)
+      REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  // Count the preloaded classes used during startup and report the time they saved. Preloading
+  // is no longer useful after startup, so this also deletes the thread pool.
+  void ReportStartupCompleted(Thread* self) REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  void DumpForSigQuit(std::ostream& os) REQUIRES(!lock_);
+
+  // Stop the workers and drop the classes they have not got to. Must be called before the runtime
+  // starts shutting down, since the tasks need mutator access.
+  void DeleteThreadPool() REQUIRES(!Locks::mutator_lock_, !lock_);
+
+ private:
+  class PreloadTask;
+  friend class StartupClassPreloaderTest;
+
+  struct PreloadedClass {
+    // Points into the dex file, which the class loader keeps alive.
+    const char* descriptor;
+    uint64_t preload_time_ns;
+  };
+
+  void AddResults(const std::vector<PreloadedClass>& preloaded_classes,
+                  size_t num_already_loaded,
+                  size_t num_failed,
+                  uint64_t cpu_time_ns)
+      REQUIRES(!lock_);
+  // Account a task that the thread pool was deleted before it could run.
+  void DropTask(size_t num_classes) REQUIRES(!lock_);
+  void FinishTaskLocked() REQUIRES(lock_);
+
+  const size_t num_threads_;
+
+  Mutex lock_ BOTTOM_MUTEX_ACQUIRED_AFTER;
+  // Only set once the workers have been started, and deleted by whoever takes it out.
+  std::unique_ptr<ThreadPool> thread_pool_ GUARDED_BY(lock_);
+  // Global reference to the app class loader, held until startup completes.
+  jobject class_loader_ GUARDED_BY(lock_);
+  bool started_ GUARDED_BY(lock_);
+  bool startup_completed_ GUARDED_BY(lock_);
+  uint64_t start_time_ns_ GUARDED_BY(lock_);
+  // Number of profile classes handed to the workers.
+  size_t num_requested_ GUARDED_BY(lock_);
+  size_t num_pending_tasks_ GUARDED_BY(lock_);
+  // Classes loaded by the workers, and those of them loaded before startup completed.
+  size_t num_preloaded_ GUARDED_BY(lock_);
+  std::vector<PreloadedClass> preloaded_classes_ GUARDED_BY(lock_);
+  // Classes that were already verified when a worker got to them.
+  size_t num_already_loaded_ GUARDED_BY(lock_);
+  // Classes that could not be loaded or failed verification.
+  size_t num_failed_ GUARDED_BY(lock_);
+  // Classes of the tasks dropped when the thread pool was deleted.
+  size_t num_dropped_ GUARDED_BY(lock_);
+  // Total CPU time of the workers, and wall time from Start() until the last task finished.
+  uint64_t cpu_time_ns_ GUARDED_BY(lock_);
+  uint64_t wall_time_ns_ GUARDED_BY(lock_);
+  // Filled in by ReportStartupCompleted().
+  size_t num_preloaded_at_startup_ GUARDED_BY(lock_);
+  size_t num_used_at_startup_ GUARDED_BY(lock_);
+  uint64_t time_saved_ns_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(StartupClassPreloader);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_STARTUP_CLASS_PRELOADER_H_
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "startup_class_preloader.h"
+
+#include <unistd.h>
+
+#include <sstream>
+#include <vector>
+
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "dex/dex_file.h"
+#include "dex/dex_file_loader.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "profile/profile_compilation_info.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class StartupClassPreloaderTest : public CommonRuntimeTest {
+ protected:
+  struct Counters {
+    size_t num_requested;
+    size_t num_preloaded;
+    size_t num_already_loaded;
+    size_t num_failed;
+    size_t num_dropped;
+    size_t num_pending_tasks;
+    size_t num_preloaded_at_startup;
+    size_t num_used_at_startup;
+    bool has_thread_pool;
+  };
+
+  static Counters GetCounters(StartupClassPreloader* preloader) {
+    MutexLock mu(Thread::Current(), preloader->lock_);
+    return Counters{preloader->num_requested_,
+                    preloader->num_preloaded_,
+                    preloader->num_already_loaded_,
+                    preloader->num_failed_,
+                    preloader->num_dropped_,
+                    preloader->num_pending_tasks_,
+                    preloader->num_preloaded_at_startup_,
+                    preloader->num_used_at_startup_,
+                    preloader->thread_pool_ != nullptr};
+  }
+
+  static void WaitForTasks(StartupClassPreloader* preloader) {
+    while (GetCounters(preloader).num_pending_tasks != 0u) {
+      usleep(1000);
+    }
+  }
+};
+
+TEST_F(StartupClassPreloaderTest, PreloadAndReportStartupCompleted) {
+  Thread* self = Thread::Current();
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(self);
+    class_loader = LoadDex("Interfaces");
+  }
+  std::vector<const DexFile*> dex_files = GetDexFiles(class_loader);
+  ASSERT_EQ(dex_files.size(), 1u);
+  const DexFile* dex_file = dex_files[0];
+
+  // A profile listing every class of the dex file.
+  std::vector<dex::TypeIndex> class_types;
+  for (uint32_t i = 0; i != dex_file->NumClassDefs(); ++i) {
+    class_types.push_back(dex_file->GetClassDef(i).class_idx_);
+  }
+  ScratchFile profile;
+  ProfileCompilationInfo info;
+  ASSERT_TRUE(info.AddClassesForDex(dex_file, class_types.begin(), class_types.end()));
+  ASSERT_TRUE(info.Save(profile.GetFd()));
+
+  StartupClassPreloader preloader(/*num_threads=*/ 2u);
+  preloader.Start(self,
+                  {DexFileLoader::GetBaseLocation(dex_file->GetLocation())},
+                  /*profile_filename=*/ "",
+                  profile.GetFilename());
+  WaitForTasks(&preloader);
+  Counters counters = GetCounters(&preloader);
+  EXPECT_EQ(counters.num_requested, class_types.size());
+  EXPECT_EQ(counters.num_preloaded + counters.num_already_loaded + counters.num_failed,
+            counters.num_requested);
+  EXPECT_EQ(counters.num_preloaded, class_types.size());
+  EXPECT_EQ(counters.num_dropped, 0u);
+  // The pool stays until startup completes.
+  EXPECT_TRUE(counters.has_thread_pool);
+
+  // Use one of the preloaded classes, as the app would on its startup path.
+  {
+    ScopedObjectAccess soa(self);
+    StackHandleScope<2> hs(self);
+    Handle<mirror::ClassLoader> h_loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader>(class_loader)));
+    Handle<mirror::Class> klass(
+        hs.NewHandle(class_linker_->FindClass(self, "LInterfaces$A;", h_loader)));
+    ASSERT_TRUE(klass != nullptr);
+    EXPECT_TRUE(klass->IsVerified());
+    ASSERT_TRUE(class_linker_->EnsureInitialized(self, klass, true, true));
+  }
+
+  preloader.ReportStartupCompleted(self);
+  counters = GetCounters(&preloader);
+  EXPECT_EQ(counters.num_preloaded_at_startup, counters.num_preloaded);
+  EXPECT_GE(counters.num_used_at_startup, 1u);
+  EXPECT_LT(counters.num_used_at_startup, counters.num_preloaded_at_startup);
+  EXPECT_FALSE(counters.has_thread_pool);
+
+  std::ostringstream os;
+  preloader.DumpForSigQuit(os);
+  EXPECT_NE(os.str().find("classes preloaded before startup completed were used"),
+            std::string::npos) << os.str();
+
+  // Nothing happens once startup has completed.
+  preloader.ReportStartupCompleted(self);
+  preloader.DeleteThreadPool();
+  EXPECT_EQ(GetCounters(&preloader).num_used_at_startup, counters.num_used_at_startup);
+}
+
+TEST_F(StartupClassPreloaderTest, NoProfile) {
+  Thread* self = Thread::Current();
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(self);
+    class_loader = LoadDex("Interfaces");
+  }
+  std::vector<const DexFile*> dex_files = GetDexFiles(class_loader);
+  ASSERT_EQ(dex_files.size(), 1u);
+
+  StartupClassPreloader preloader(/*num_threads=*/ 1u);
+  preloader.Start(self,
+                  {DexFileLoader::GetBaseLocation(dex_files[0]->GetLocation())},
+                  /*profile_filename=*/ "",
+                  /*ref_profile_filename=*/ "");
+  Counters counters = GetCounters(&preloader);
+  EXPECT_EQ(counters.num_requested, 0u);
+  EXPECT_FALSE(counters.has_thread_pool);
+  preloader.ReportStartupCompleted(self);
+  EXPECT_EQ(GetCounters(&preloader).num_preloaded_at_startup, 0u);
+}
+
+}  // namespace art
@@ -18,6 +18,7 @@
 
 #include "base/casts.h"
 #include "base/logging.h"
+#include "base/simd_ascii.h"
 #include "common_throws.h"
 #include "gc/heap.h"
 #include "mirror/string-alloc-inl.h"
@@ -165,17 +166,14 @@ inline CharType* StringBuilderAppend::Builder::AppendString(ObjPtr<mirror::Strin
                                                             ObjPtr<mirror::String> str) {
   size_t length = dchecked_integral_cast<size_t>(str->GetLength());
   DCHECK_LE(length, RemainingSpace(new_string, data));
-  if (sizeof(CharType) == sizeof(uint8_t) || str->IsCompressed()) {
+  if constexpr (sizeof(CharType) == sizeof(uint8_t)) {
+    // The result is compressed only if all strings are compressed.
     DCHECK(str->IsCompressed());
-    const uint8_t* value = str->GetValueCompressed();
-    for (size_t i = 0; i != length; ++i) {
-      data[i] = value[i];
-    }
+    memcpy(data, str->GetValueCompressed(), length * sizeof(uint8_t));
+  } else if (str->IsCompressed()) {
+    WidenChars(str->GetValueCompressed(), data, length);
   } else {
-    const uint16_t* value = str->GetValue();
-    for (size_t i = 0; i != length; ++i) {
-      data[i] = dchecked_integral_cast<CharType>(value[i]);
-    }
+    memcpy(data, str->GetValue(), length * sizeof(uint16_t));
   }
   return data + length;
 }
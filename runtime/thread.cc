@@ -55,6 +55,7 @@
 #include "base/timing_logger.h"
 #include "base/to_str.h"
 #include "base/utils.h"
+#include "catch_handler_cache.h"
 #include "class_linker-inl.h"
 #include "class_root-inl.h"
 #include "debugger.h"
@@ -107,6 +108,7 @@
 #include "scoped_disable_public_sdk_checker.h"
 #include "stack.h"
 #include "stack_map.h"
+#include "stack_map_cache.h"
 #include "thread-inl.h"
 #include "thread_list.h"
 #include "verifier/method_verifier.h"
@@ -1509,6 +1511,7 @@ bool Thread::PassActiveSuspendBarriers(Thread* self) {
       tlsPtr_.active_suspend_barriers[i] = nullptr;
     }
     AtomicClearFlag(kActiveSuspendBarrier);
+    suspend_barrier_pass_time_ns_ = NanoTime();
   }
 
   uint32_t barrier_count = 0;
@@ -1554,9 +1557,13 @@ void Thread::RunCheckpointFunction() {
   // Grab the suspend_count lock, get the next checkpoint and update all the checkpoint fields. If
   // there are no more checkpoints we will also clear the kCheckpointRequest flag.
   Closure* checkpoint;
+  uint64_t request_time;
   {
     MutexLock mu(this, *Locks::thread_suspend_count_lock_);
     checkpoint = tlsPtr_.checkpoint_function;
+    // Only the first of several pending checkpoints has its request time.
+    request_time = checkpoint_request_time_ns_;
+    checkpoint_request_time_ns_ = 0u;
     if (!checkpoint_overflow_.empty()) {
       // Overflow list not empty, copy the first one out and continue.
       tlsPtr_.checkpoint_function = checkpoint_overflow_.front();
@@ -1567,6 +1574,9 @@ void Thread::RunCheckpointFunction() {
       AtomicClearFlag(kCheckpointRequest);
     }
   }
+  if (request_time != 0u) {
+    Runtime::Current()->GetThreadList()->RecordTimeToCheckpoint(NanoTime() - request_time);
+  }
   // Outside the lock, run the checkpoint function.
   ScopedTrace trace("Run checkpoint function");
   CHECK(checkpoint != nullptr) << "Checkpoint flag set without pending checkpoint";
@@ -1597,6 +1607,7 @@ bool Thread::RequestCheckpoint(Closure* function) {
     // Succeeded setting checkpoint flag, now insert the actual checkpoint.
     if (tlsPtr_.checkpoint_function == nullptr) {
       tlsPtr_.checkpoint_function = function;
+      checkpoint_request_time_ns_ = NanoTime();
     } else {
       checkpoint_overflow_.push_back(function);
     }
@@ -3938,10 +3949,12 @@ class ReferenceMapVisitor : public StackVisitor {
       StackReference<mirror::Object>* vreg_base =
           reinterpret_cast<StackReference<mirror::Object>*>(cur_quick_frame);
       uintptr_t native_pc_offset = method_header->NativeQuickPcOffset(GetCurrentQuickFramePc());
-      CodeInfo code_info = kPrecise
-          ? CodeInfo(method_header)  // We will need dex register maps.
+      // A cached CodeInfo is fully decoded once and reused across walks. Without a cache, only
+      // decode what the GC needs.
+      CodeInfo code_info = (kPrecise || HasStackMapCache())
+          ? DecodeCodeInfo(method_header)  // We will need dex register maps.
           : CodeInfo::DecodeGcMasksOnly(method_header);
-      StackMap map = code_info.GetStackMapForNativePcOffset(native_pc_offset);
+      StackMap map = GetStackMapForNativePcOffset(method_header, code_info, native_pc_offset);
       DCHECK(map.IsValid());
 
       T vreg_info(m, code_info, map, visitor_);
@@ -4425,6 +4438,22 @@ void Thread::SetReadBarrierEntrypoints() {
   UpdateReadBarrierEntrypoints(&tlsPtr_.quick_entrypoints, /* is_active=*/ true);
 }
 
+StackMapCache* Thread::GetStackMapCache() {
+  DCHECK(this == Thread::Current());
+  if (UNLIKELY(stack_map_cache_ == nullptr)) {
+    stack_map_cache_.reset(new StackMapCache());
+  }
+  return stack_map_cache_.get();
+}
+
+CatchHandlerCache* Thread::GetCatchHandlerCache() {
+  DCHECK(this == Thread::Current());
+  if (UNLIKELY(catch_handler_cache_ == nullptr)) {
+    catch_handler_cache_.reset(new CatchHandlerCache());
+  }
+  return catch_handler_cache_.get();
+}
+
 void Thread::ClearAllInterpreterCaches() {
   static struct ClearInterpreterCacheClosure : Closure {
     void Run(Thread* thread) override {
@@ -4432,6 +4461,8 @@ void Thread::ClearAllInterpreterCaches() {
     }
   } closure;
   Runtime::Current()->GetThreadList()->RunCheckpoint(&closure);
+  // Cached catch handlers are keyed by dex pc too.
+  CatchHandlerCache::InvalidateAll();
 }
 
 
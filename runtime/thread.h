@@ -83,6 +83,7 @@ class VerifierDeps;
 
 class ArtMethod;
 class BaseMutex;
+class CatchHandlerCache;
 class ClassLinker;
 class Closure;
 class Context;
@@ -97,9 +98,11 @@ class RootVisitor;
 class ScopedObjectAccessAlreadyRunnable;
 class ShadowFrame;
 class StackedShadowFrameRecord;
+class StackMapCache;
 enum class SuspendReason : char;
 class Thread;
 class ThreadList;
+class TraceThreadBuffer;
 enum VisitRootFlags : uint8_t;
 
 // A piece of data that can be held in the CustomTls. The destructor will be called during thread
@@ -247,6 +250,11 @@ class Thread {
     return tls32_.suspend_count;
   }
 
+  // NanoTime() at which this thread last passed its active suspend barriers, or 0 if it never did.
+  uint64_t GetSuspendBarrierPassTime() const REQUIRES(Locks::thread_suspend_count_lock_) {
+    return suspend_barrier_pass_time_ns_;
+  }
+
   int GetUserCodeSuspendCount() const REQUIRES(Locks::thread_suspend_count_lock_,
                                                Locks::user_code_suspension_lock_) {
     return tls32_.user_code_suspend_count;
@@ -1120,6 +1128,14 @@ class Thread {
     tls64_.trace_clock_base = clock_base;
   }
 
+  TraceThreadBuffer* GetMethodTraceBuffer() const {
+    return method_trace_buffer_;
+  }
+
+  void SetMethodTraceBuffer(TraceThreadBuffer* buffer) {
+    method_trace_buffer_ = buffer;
+  }
+
   BaseMutex* GetHeldMutex(LockLevel level) const {
     return tlsPtr_.held_mutexes[level];
   }
@@ -1174,6 +1190,24 @@ class Thread {
     DCHECK_LE(tlsPtr_.thread_local_end, tlsPtr_.thread_local_limit);
   }
 
+  // Allocation history used by the heap to size this thread's TLABs, see Heap::NextTlabSize().
+  // Only written by the thread itself; other threads may read it racily for diagnostics.
+  struct TlabSizingStats {
+    // Current TLAB size, 0 until the first TLAB is sized.
+    size_t tlab_size = 0;
+    // TLAB bytes and refills since the GC numbered `gc_num` completed.
+    size_t cycle_bytes = 0;
+    size_t cycle_refills = 0;
+    uint32_t gc_num = 0;
+    // Totals over the lifetime of the thread.
+    uint64_t total_bytes = 0;
+    uint64_t total_refills = 0;
+  };
+
+  TlabSizingStats* GetTlabSizingStats() {
+    return &tlab_sizing_stats_;
+  }
+
   // Doesn't check that there is room.
   mirror::Object* AllocTlab(size_t bytes);
   void SetTlab(uint8_t* start, uint8_t* end, uint8_t* limit);
@@ -1339,6 +1373,12 @@ class Thread {
     return &interpreter_cache_;
   }
 
+  // Return the cache used by stack walks made by this thread, allocating it on first use.
+  StackMapCache* GetStackMapCache();
+
+  // Return the cache used by ArtMethod::FindCatchBlock(), allocating it on first use.
+  CatchHandlerCache* GetCatchHandlerCache();
+
   // Clear all thread-local interpreter caches.
   //
   // Since the caches are keyed by memory pointer to dex instructions, this must be
@@ -1878,6 +1918,23 @@ class Thread {
   // Note that it is not in the packed struct, may not be accessed for cross compilation.
   uintptr_t poison_object_cookie_ = 0;
 
+  TlabSizingStats tlab_sizing_stats_;
+
+  // Cache for the stack walks made by this thread, see GetStackMapCache().
+  std::unique_ptr<StackMapCache> stack_map_cache_;
+
+  // Cache for the exceptions delivered on this thread, see GetCatchHandlerCache().
+  std::unique_ptr<CatchHandlerCache> catch_handler_cache_;
+
+  // Buffer of the events of this thread when streaming a method trace, owned by the Trace.
+  TraceThreadBuffer* method_trace_buffer_ = nullptr;
+
+  // Time at which this thread last acknowledged a suspend request, see GetSuspendBarrierPassTime().
+  uint64_t suspend_barrier_pass_time_ns_ GUARDED_BY(Locks::thread_suspend_count_lock_) = 0;
+
+  // Time at which the pending checkpoint was requested, 0 if not measured.
+  uint64_t checkpoint_request_time_ns_ GUARDED_BY(Locks::thread_suspend_count_lock_) = 0;
+
   // Pending extra checkpoints if checkpoint_function_ is already used.
   std::list<Closure*> checkpoint_overflow_ GUARDED_BY(Locks::thread_suspend_count_lock_);
 
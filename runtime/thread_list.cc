@@ -20,6 +20,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <functional>
 #include <sstream>
 #include <vector>
 
@@ -28,6 +30,7 @@
 #include "nativehelper/scoped_local_ref.h"
 #include "nativehelper/scoped_utf_chars.h"
 
+#include "art_method-inl.h"
 #include "base/aborting.h"
 #include "base/histogram-inl.h"
 #include "base/mutex-inl.h"
@@ -45,6 +48,7 @@
 #include "monitor.h"
 #include "native_stack_dump.h"
 #include "scoped_thread_state_change-inl.h"
+#include "stack.h"
 #include "thread.h"
 #include "trace.h"
 #include "well_known_classes.h"
@@ -62,6 +66,12 @@ namespace art {
 using android::base::StringPrintf;
 
 static constexpr uint64_t kLongThreadSuspendThreshold = MsToNs(5);
+// Suspensions taking longer than this to reach a safepoint record the last threads to get there.
+static constexpr uint64_t kSlowSafepointThreshold = MsToNs(1);
+// Number of late threads recorded for each slow safepoint.
+static constexpr size_t kMaxSlowSafepointThreads = 3;
+// Number of slow safepoints kept for SIGQUIT dumps.
+static constexpr size_t kMaxSlowSafepointRecords = 16;
 // Use 0 since we want to yield to prevent blocking for an unpredictable amount of time.
 static constexpr useconds_t kThreadSuspendInitialSleepUs = 0;
 static constexpr useconds_t kThreadSuspendMaxYieldUs = 3000;
@@ -75,6 +85,11 @@ ThreadList::ThreadList(uint64_t thread_suspend_timeout_ns)
     : suspend_all_count_(0),
       unregistering_count_(0),
       suspend_all_historam_("suspend all histogram", 16, 64),
+      suspend_all_cause_(nullptr),
+      suspend_all_end_time_(0),
+      checkpoint_count_(0),
+      total_time_to_checkpoint_(0),
+      max_time_to_checkpoint_(0),
       long_suspend_(false),
       shut_down_(false),
       thread_suspend_timeout_ns_(thread_suspend_timeout_ns),
@@ -141,6 +156,7 @@ void ThreadList::DumpForSigQuit(std::ostream& os) {
       suspend_all_historam_.CreateHistogram(&data);
       suspend_all_historam_.PrintConfidenceIntervals(os, 0.99, data);  // Dump time to suspend.
     }
+    DumpSuspendAllStats(os);
   }
   bool dump_native_stack = Runtime::Current()->GetDumpNativeStackOnSigQuit();
   Dump(os, dump_native_stack);
@@ -528,8 +544,11 @@ size_t ThreadList::FlipThreadRoots(Closure* thread_flip_visitor,
 
   // Run the flip callback for the collector.
   Locks::mutator_lock_->ExclusiveLock(self);
-  suspend_all_historam_.AdjustAndAddValue(NanoTime() - suspend_start_time);
+  const uint64_t suspend_end_time = NanoTime();
+  suspend_all_historam_.AdjustAndAddValue(suspend_end_time - suspend_start_time);
+  RecordTimeToSafepoint(self, "FlipThreadRoots", suspend_start_time, suspend_end_time);
   flip_callback->Run(self);
+  RecordSuspendAllPause("FlipThreadRoots", NanoTime() - suspend_end_time);
   Locks::mutator_lock_->ExclusiveUnlock(self);
   collector->RegisterPause(NanoTime() - suspend_start_time);
   if (pause_listener != nullptr) {
@@ -643,6 +662,9 @@ void ThreadList::SuspendAll(const char* cause, bool long_suspend) {
     if (suspend_time > kLongThreadSuspendThreshold) {
       LOG(WARNING) << "Suspending all threads took: " << PrettyDuration(suspend_time);
     }
+    RecordTimeToSafepoint(self, cause, start_time, end_time);
+    suspend_all_cause_ = cause;
+    suspend_all_end_time_ = end_time;
 
     if (kDebugLocking) {
       // Debug check that all threads are suspended.
@@ -658,6 +680,160 @@ void ThreadList::SuspendAll(const char* cause, bool long_suspend) {
   }
 }
 
+// Describe the innermost managed frame of a suspended thread.
+static std::string DescribeTopFrame(Thread* thread) REQUIRES_SHARED(Locks::mutator_lock_) {
+  std::string description = "<no managed frames>";
+  StackVisitor::WalkStack(
+      [&](const art::StackVisitor* stack_visitor) REQUIRES_SHARED(Locks::mutator_lock_) {
+        ArtMethod* m = stack_visitor->GetMethod();
+        if (m == nullptr || m->IsRuntimeMethod()) {
+          return true;
+        }
+        description = StringPrintf("%s dex_pc=%u",
+                                   m->PrettyMethod().c_str(),
+                                   stack_visitor->GetDexPc(/* abort_on_failure= */ false));
+        return false;
+      },
+      thread,
+      /* context= */ nullptr,
+      art::StackVisitor::StackWalkKind::kIncludeInlinedFrames);
+  return description;
+}
+
+void ThreadList::RecordTimeToSafepoint(Thread* self,
+                                       const char* cause,
+                                       uint64_t start_time,
+                                       uint64_t end_time) {
+  const uint64_t time_to_safepoint = end_time - start_time;
+  SuspendAllStats& stats = suspend_all_stats_[cause];
+  ++stats.count;
+  stats.total_time_to_safepoint += time_to_safepoint;
+  stats.max_time_to_safepoint = std::max(stats.max_time_to_safepoint, time_to_safepoint);
+  metrics::ArtMetrics* metrics = Runtime::Current()->GetMetrics();
+  metrics->SuspendAllCount()->AddOne();
+  metrics->TimeToSafepoint()->Add(static_cast<int64_t>(NsToUs(time_to_safepoint)));
+  if (time_to_safepoint < kSlowSafepointThreshold) {
+    return;
+  }
+  metrics->SlowSafepointCount()->AddOne();
+
+  // Find the threads that passed their suspend barrier last. Threads that were already suspended
+  // when the request was made never pass the barrier and keep an older time stamp; if there is
+  // no such thread, the time was spent waiting for the mutator lock instead.
+  MutexLock mu(self, *Locks::thread_list_lock_);
+  std::vector<std::pair<uint64_t, Thread*>> late_threads;
+  {
+    MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
+    for (Thread* thread : list_) {
+      const uint64_t pass_time = thread->GetSuspendBarrierPassTime();
+      if (pass_time > start_time) {
+        late_threads.emplace_back(pass_time, thread);
+      }
+    }
+  }
+  const size_t num_late_threads = std::min(late_threads.size(), kMaxSlowSafepointThreads);
+  std::partial_sort(late_threads.begin(),
+                    late_threads.begin() + num_late_threads,
+                    late_threads.end(),
+                    std::greater<>());
+  SlowSafepointRecord record;
+  record.cause = cause;
+  record.time_to_safepoint = time_to_safepoint;
+  for (size_t i = 0; i != num_late_threads; ++i) {
+    // The thread is suspended and cannot unregister while we hold the thread list lock, so it is
+    // safe to walk its stack.
+    Thread* thread = late_threads[i].second;
+    SlowSafepointRecord::LateThread late_thread;
+    thread->GetThreadName(late_thread.thread_name);
+    late_thread.tid = thread->GetTid();
+    late_thread.thread_ack_time = late_threads[i].first - start_time;
+    late_thread.state = thread->GetState();
+    late_thread.top_frame = DescribeTopFrame(thread);
+    record.late_threads.push_back(std::move(late_thread));
+  }
+  if (slow_safepoints_.size() == kMaxSlowSafepointRecords) {
+    slow_safepoints_.pop_front();
+  }
+  slow_safepoints_.push_back(std::move(record));
+}
+
+void ThreadList::RecordTimeToCheckpoint(uint64_t time_to_checkpoint) {
+  checkpoint_count_.fetch_add(1u, std::memory_order_relaxed);
+  total_time_to_checkpoint_.fetch_add(time_to_checkpoint, std::memory_order_relaxed);
+  uint64_t max_time = max_time_to_checkpoint_.load(std::memory_order_relaxed);
+  while (time_to_checkpoint > max_time &&
+         !max_time_to_checkpoint_.compare_exchange_weak(
+             max_time, time_to_checkpoint, std::memory_order_relaxed)) {
+  }
+  Runtime::Current()->GetMetrics()->TimeToCheckpoint()->Add(
+      static_cast<int64_t>(NsToUs(time_to_checkpoint)));
+}
+
+void ThreadList::RecordSuspendAllPause(const char* cause, uint64_t pause_time) {
+  DCHECK(cause != nullptr);
+  SuspendAllStats& stats = suspend_all_stats_[cause];
+  stats.total_pause_time += pause_time;
+  stats.max_pause_time = std::max(stats.max_pause_time, pause_time);
+  Runtime::Current()->GetMetrics()->SuspendAllPauseTime()->Add(
+      static_cast<int64_t>(NsToUs(pause_time)));
+}
+
+void ThreadList::DumpSuspendAllStats(std::ostream& os) {
+  const uint64_t checkpoint_count = checkpoint_count_.load(std::memory_order_relaxed);
+  if (suspend_all_stats_.empty() && checkpoint_count == 0u) {
+    return;
+  }
+  // The same cause may come from literals at different addresses.
+  std::map<std::string, SuspendAllStats> stats_by_cause;
+  for (const auto& [cause, cause_stats] : suspend_all_stats_) {
+    SuspendAllStats& stats = stats_by_cause[cause];
+    stats.count += cause_stats.count;
+    stats.total_time_to_safepoint += cause_stats.total_time_to_safepoint;
+    stats.max_time_to_safepoint =
+        std::max(stats.max_time_to_safepoint, cause_stats.max_time_to_safepoint);
+    stats.total_pause_time += cause_stats.total_pause_time;
+    stats.max_pause_time = std::max(stats.max_pause_time, cause_stats.max_pause_time);
+  }
+  if (!stats_by_cause.empty()) {
+    os << "Suspend all by cause:\n";
+  }
+  for (const auto& [cause, stats] : stats_by_cause) {
+    os << "  " << cause << ": count=" << stats.count
+       << " time to safepoint avg=" << PrettyDuration(stats.total_time_to_safepoint / stats.count)
+       << " max=" << PrettyDuration(stats.max_time_to_safepoint)
+       << " pause total=" << PrettyDuration(stats.total_pause_time)
+       << " avg=" << PrettyDuration(stats.total_pause_time / stats.count)
+       << " max=" << PrettyDuration(stats.max_pause_time) << "\n";
+  }
+  if (checkpoint_count != 0u) {
+    os << "Checkpoints run by runnable threads: count=" << checkpoint_count
+       << " time to checkpoint avg="
+       << PrettyDuration(total_time_to_checkpoint_.load(std::memory_order_relaxed) /
+                         checkpoint_count)
+       << " max=" << PrettyDuration(max_time_to_checkpoint_.load(std::memory_order_relaxed))
+       << "\n";
+  }
+  if (!slow_safepoints_.empty()) {
+    os << "Slow safepoints (oldest first):\n";
+    for (const SlowSafepointRecord& record : slow_safepoints_) {
+      os << "  " << record.cause << ": time to safepoint="
+         << PrettyDuration(record.time_to_safepoint);
+      if (record.late_threads.empty()) {
+        os << " waiting for the mutator lock holder\n";
+        continue;
+      }
+      os << " last threads:\n";
+      for (const SlowSafepointRecord::LateThread& late_thread : record.late_threads) {
+        os << "    \"" << late_thread.thread_name << "\" tid=" << late_thread.tid
+           << " acknowledged after " << PrettyDuration(late_thread.thread_ack_time)
+           << " state=" << late_thread.state
+           << " at " << late_thread.top_frame << "\n";
+      }
+    }
+  }
+  os << "\n";
+}
+
 // Ensures all threads running Java suspend and that those not running Java don't start.
 void ThreadList::SuspendAllInternal(Thread* self,
                                     Thread* ignore1,
@@ -782,6 +958,8 @@ void ThreadList::ResumeAll() {
 
   long_suspend_ = false;
 
+  RecordSuspendAllPause(suspend_all_cause_, NanoTime() - suspend_all_end_time_);
+
   Locks::mutator_lock_->ExclusiveUnlock(self);
   {
     MutexLock mu(self, *Locks::thread_list_lock_);
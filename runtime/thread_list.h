@@ -24,9 +24,14 @@
 #include "jni.h"
 #include "reflective_handle_scope.h"
 #include "suspend_reason.h"
+#include "thread_state.h"
 
+#include <atomic>
 #include <bitset>
+#include <deque>
 #include <list>
+#include <map>
+#include <string>
 #include <vector>
 
 namespace art {
@@ -212,6 +217,25 @@ class ThreadList {
   void AssertThreadsAreSuspended(Thread* self, Thread* ignore1, Thread* ignore2 = nullptr)
       REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
 
+  // Record the time it took for all threads to reach a safepoint for a suspension requested at
+  // `start_time` for `cause`. If that was slow, also record which threads acknowledged last and
+  // where they were.
+  void RecordTimeToSafepoint(Thread* self,
+                             const char* cause,
+                             uint64_t start_time,
+                             uint64_t end_time)
+      REQUIRES(Locks::mutator_lock_, !Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
+
+  // Record the time a runnable thread took to run a checkpoint after it was requested, see
+  // Thread::RunCheckpointFunction().
+  void RecordTimeToCheckpoint(uint64_t time_to_checkpoint);
+
+  // Record the time threads stayed suspended after reaching the safepoint.
+  void RecordSuspendAllPause(const char* cause, uint64_t pause_time)
+      REQUIRES(Locks::mutator_lock_);
+
+  void DumpSuspendAllStats(std::ostream& os) REQUIRES_SHARED(Locks::mutator_lock_);
+
   std::bitset<kMaxThreadId> allocated_ids_ GUARDED_BY(Locks::allocated_thread_ids_lock_);
 
   // The actual list of all threads.
@@ -227,6 +251,46 @@ class ThreadList {
   // by mutator lock ensures no thread can read when another thread is modifying it.
   Histogram<uint64_t> suspend_all_historam_ GUARDED_BY(Locks::mutator_lock_);
 
+  // Time to safepoint and pause statistics for the suspensions with a given cause.
+  struct SuspendAllStats {
+    uint64_t count = 0;
+    uint64_t total_time_to_safepoint = 0;
+    uint64_t max_time_to_safepoint = 0;
+    uint64_t total_pause_time = 0;
+    uint64_t max_pause_time = 0;
+  };
+  // Keyed by the cause pointer rather than a string so that recording in the pause does not
+  // allocate once a cause has been seen. Causes are string literals, the dump merges equal ones.
+  std::map<const char*, SuspendAllStats> suspend_all_stats_ GUARDED_BY(Locks::mutator_lock_);
+
+  // A suspension that took longer than kSlowSafepointThreshold, with the threads that
+  // acknowledged it last, latest first.
+  struct SlowSafepointRecord {
+    struct LateThread {
+      std::string thread_name;
+      pid_t tid;
+      // Time from the request until this thread passed its suspend barrier.
+      uint64_t thread_ack_time;
+      // State and top managed frame of the thread once it was suspended.
+      ThreadState state;
+      std::string top_frame;
+    };
+    std::string cause;
+    uint64_t time_to_safepoint;
+    std::vector<LateThread> late_threads;
+  };
+  // The most recent slow safepoints, oldest first.
+  std::deque<SlowSafepointRecord> slow_safepoints_ GUARDED_BY(Locks::mutator_lock_);
+
+  // Cause and safepoint time of the current SuspendAll, used to attribute the pause in ResumeAll.
+  const char* suspend_all_cause_ GUARDED_BY(Locks::mutator_lock_);
+  uint64_t suspend_all_end_time_ GUARDED_BY(Locks::mutator_lock_);
+
+  // Time to checkpoint statistics, updated by the threads running checkpoints.
+  std::atomic<uint64_t> checkpoint_count_;
+  std::atomic<uint64_t> total_time_to_checkpoint_;
+  std::atomic<uint64_t> max_time_to_checkpoint_;
+
   // Whether or not the current thread suspension is long.
   bool long_suspend_;
 
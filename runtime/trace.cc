@@ -16,15 +16,21 @@
 
 #include "trace.h"
 
+#include <lz4frame.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+
 #include "android-base/macros.h"
 #include "android-base/stringprintf.h"
 
 #include "art_method-inl.h"
+#include "base/bit_utils.h"
 #include "base/casts.h"
 #include "base/enums.h"
+#include "base/mutex.h"
 #include "base/os.h"
 #include "base/stl_util.h"
 #include "base/systrace.h"
@@ -69,6 +75,9 @@ static const uint16_t kTraceVersionDualClock      = 3;
 static const uint16_t kTraceRecordSizeSingleClock = 10;  // using v2
 static const uint16_t kTraceRecordSizeDualClock   = 14;  // using v3 with two timestamps
 
+// Size of the chunks of events that threads hand to the writer thread when streaming.
+static constexpr size_t kStreamingChunkSize = 64 * KB;
+
 TraceClockSource Trace::default_clock_source_ = kDefaultTraceClockSource;
 
 Trace* volatile Trace::the_trace_ = nullptr;
@@ -78,6 +87,118 @@ std::unique_ptr<std::vector<ArtMethod*>> Trace::temp_stack_trace_;
 // The key identifying the tracer to update instrumentation.
 static constexpr const char* kTracerInstrumentationKey = "Tracer";
 
+// Events of one thread when streaming. Only written by the thread itself, or by the sampling
+// thread while the thread is suspended.
+class TraceThreadBuffer {
+ public:
+  static constexpr size_t kMethodCacheSize = 256;
+
+  TraceThreadBuffer(pid_t tid, std::unique_ptr<uint8_t[]> chunk)
+      : tid_(tid),
+        chunk_(std::move(chunk)),
+        offset_(0u),
+        last_wall_clock_diff_(0u),
+        last_thread_clock_diff_(0u) {
+    method_ids_.fill(std::make_pair(nullptr, 0u));
+  }
+
+  // Return the cache entry for the trace id of `method`.
+  std::pair<ArtMethod*, uint32_t>& MethodIdEntry(ArtMethod* method) {
+    static_assert(IsPowerOfTwo(kMethodCacheSize), "Size must be power of two");
+    return method_ids_[(reinterpret_cast<uintptr_t>(method) >> 3) & (kMethodCacheSize - 1)];
+  }
+
+  const pid_t tid_;
+  std::unique_ptr<uint8_t[]> chunk_;
+  size_t offset_;
+  // Clock values of the last event, see Trace::ReadClocks().
+  uint32_t last_wall_clock_diff_;
+  uint32_t last_thread_clock_diff_;
+
+ private:
+  // Small cache of method ids, so that most events do not need unique_methods_lock_.
+  std::array<std::pair<ArtMethod*, uint32_t>, kMethodCacheSize> method_ids_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceThreadBuffer);
+};
+
+// Writes the streaming output to the trace file. When compressing, the whole output is a single
+// LZ4 frame, which `lz4 -d` turns back into the regular streaming format.
+class TraceStreamWriter {
+ public:
+  TraceStreamWriter(File* file, bool compress) : file_(file), context_(nullptr), started_(false) {
+    if (compress) {
+      LZ4F_errorCode_t error = LZ4F_createCompressionContext(&context_, LZ4F_VERSION);
+      if (LZ4F_isError(error)) {
+        LOG(WARNING) << "Cannot compress trace, writing it uncompressed: "
+                     << LZ4F_getErrorName(error);
+        context_ = nullptr;
+      } else {
+        compressed_.resize(LZ4F_compressBound(kStreamingChunkSize, /* prefsPtr= */ nullptr));
+      }
+    }
+  }
+
+  ~TraceStreamWriter() {
+    if (context_ != nullptr) {
+      LZ4F_freeCompressionContext(context_);
+    }
+  }
+
+  void Write(const uint8_t* data, size_t size) {
+    if (context_ == nullptr) {
+      WriteToFile(data, size);
+      return;
+    }
+    if (!started_) {
+      WriteCompressed(LZ4F_compressBegin(
+          context_, compressed_.data(), compressed_.size(), /* prefsPtr= */ nullptr));
+      started_ = true;
+    }
+    while (size != 0u) {
+      size_t input_size = std::min(size, kStreamingChunkSize);
+      WriteCompressed(LZ4F_compressUpdate(context_,
+                                          compressed_.data(),
+                                          compressed_.size(),
+                                          data,
+                                          input_size,
+                                          /* cOptPtr= */ nullptr));
+      data += input_size;
+      size -= input_size;
+    }
+  }
+
+  // Write out the data buffered by the compressor and end the frame.
+  void Finish() {
+    if (context_ != nullptr && started_) {
+      WriteCompressed(LZ4F_compressEnd(
+          context_, compressed_.data(), compressed_.size(), /* cOptPtr= */ nullptr));
+    }
+  }
+
+ private:
+  void WriteCompressed(size_t result) {
+    if (LZ4F_isError(result)) {
+      LOG(WARNING) << "Failed compressing the trace: " << LZ4F_getErrorName(result);
+      return;
+    }
+    WriteToFile(compressed_.data(), result);
+  }
+
+  void WriteToFile(const uint8_t* data, size_t size) {
+    if (!file_->WriteFully(data, size)) {
+      PLOG(WARNING) << "Failed streaming a tracing event.";
+    }
+  }
+
+  File* const file_;
+  LZ4F_cctx* context_;
+  bool started_;
+  std::vector<uint8_t> compressed_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceStreamWriter);
+};
+
 static TraceAction DecodeTraceAction(uint32_t tmid) {
   return static_cast<TraceAction>(tmid & kTraceMethodActionMask);
 }
@@ -87,17 +208,21 @@ ArtMethod* Trace::DecodeTraceMethod(uint32_t tmid) {
   return unique_methods_[tmid >> TraceActionBits];
 }
 
-uint32_t Trace::EncodeTraceMethod(ArtMethod* method) {
+uint32_t Trace::EncodeTraceMethod(ArtMethod* method, /* out */ bool* is_new) {
   MutexLock mu(Thread::Current(), *unique_methods_lock_);
   uint32_t idx;
   auto it = art_method_id_map_.find(method);
-  if (it != art_method_id_map_.end()) {
+  bool found = (it != art_method_id_map_.end());
+  if (found) {
     idx = it->second;
   } else {
     unique_methods_.push_back(method);
     idx = unique_methods_.size() - 1;
     art_method_id_map_.emplace(method, idx);
   }
+  if (is_new != nullptr) {
+    *is_new = !found;
+  }
   DCHECK_LT(idx, unique_methods_.size());
   DCHECK_EQ(unique_methods_[idx], method);
   return idx;
@@ -229,6 +354,10 @@ static void ClearThreadStackTraceAndClockBase(Thread* thread, void* arg ATTRIBUT
   delete stack_trace;
 }
 
+static void ClearThreadTraceBuffer(Thread* thread, void* arg ATTRIBUTE_UNUSED) {
+  thread->SetMethodTraceBuffer(nullptr);
+}
+
 void Trace::CompareAndUpdateStackTrace(Thread* thread,
                                        std::vector<ArtMethod*>* stack_trace) {
   CHECK_EQ(pthread_self(), sampling_pthread_);
@@ -415,6 +544,11 @@ void Trace::Start(std::unique_ptr<File>&& trace_file_in,
     } else {
       enable_stats = (flags & kTraceCountAllocs) != 0;
       the_trace_ = new Trace(trace_file.release(), buffer_size, flags, output_mode, trace_mode);
+      if (output_mode == TraceOutputMode::kStreaming) {
+        CHECK_PTHREAD_CALL(pthread_create, (&the_trace_->writer_pthread_, nullptr, &RunWriterThread,
+                                            reinterpret_cast<void*>(the_trace_)),
+                                            "Method trace writer thread");
+      }
       if (trace_mode == TraceMode::kSampling) {
         CHECK_PTHREAD_CALL(pthread_create, (&sampling_pthread_, nullptr, &RunSamplingThread,
                                             reinterpret_cast<void*>(interval_us)),
@@ -485,6 +619,14 @@ void Trace::StopTracing(bool finish_tracing, bool flush_file) {
             instrumentation::Instrumentation::kMethodUnwind);
         runtime->GetInstrumentation()->DisableMethodTracing(kTracerInstrumentationKey);
       }
+      if (the_trace->trace_output_mode_ == TraceOutputMode::kStreaming) {
+        // The buffers are owned by the trace, which is deleted below.
+        MutexLock mu(self, *Locks::thread_list_lock_);
+        runtime->GetThreadList()->ForEach(ClearThreadTraceBuffer, nullptr);
+      }
+    }
+    if (the_trace->trace_output_mode_ == TraceOutputMode::kStreaming) {
+      the_trace->StopWriterThread(/* flush= */ finish_tracing);
     }
     // At this point, code may read buf_ as it's writers are shutdown
     // and the ScopedSuspendAll above has ensured all stores to buf_
@@ -553,12 +695,16 @@ Trace::Trace(File* trace_file,
              TraceOutputMode output_mode,
              TraceMode trace_mode)
     : trace_file_(trace_file),
-      buf_(new uint8_t[std::max(kMinBufSize, buffer_size)]()),
+      // When streaming, events are buffered per thread and buf_ only holds the header.
+      buf_(new uint8_t[output_mode == TraceOutputMode::kStreaming
+                           ? kTraceHeaderLength
+                           : std::max(kMinBufSize, buffer_size)]()),
       flags_(flags), trace_output_mode_(output_mode), trace_mode_(trace_mode),
       clock_source_(default_clock_source_),
       buffer_size_(std::max(kMinBufSize, buffer_size)),
       start_time_(MicroTime()), clock_overhead_ns_(GetClockOverheadNanoSeconds()),
-      overflow_(false), interval_us_(0), streaming_lock_(nullptr),
+      overflow_(false), interval_us_(0), streaming_lock_(nullptr), streaming_cond_(nullptr),
+      writer_pthread_(0U), queued_chunks_size_(0u), stop_writer_(false),
       unique_methods_lock_(new Mutex("unique methods lock", kTracingUniqueMethodsLock)) {
   CHECK(trace_file != nullptr || output_mode == TraceOutputMode::kDDMS);
 
@@ -582,11 +728,17 @@ Trace::Trace(File* trace_file,
 
   if (output_mode == TraceOutputMode::kStreaming) {
     streaming_lock_ = new Mutex("tracing lock", LockLevel::kTracingStreamingLock);
-    seen_threads_.reset(new ThreadIDBitSet());
+    streaming_cond_ = new ConditionVariable("tracing condition", *streaming_lock_);
+    stream_writer_.reset(
+        new TraceStreamWriter(trace_file_.get(), (flags & kTraceCompressLz4) != 0));
+    // The header is the first thing the writer thread writes.
+    MutexLock mu(Thread::Current(), *streaming_lock_);
+    queued_records_.assign(buf_.get(), buf_.get() + kTraceHeaderLength);
   }
 }
 
 Trace::~Trace() {
+  delete streaming_cond_;
   delete streaming_lock_;
   delete unique_methods_lock_;
 }
@@ -615,11 +767,7 @@ void Trace::DumpBuf(uint8_t* buf, size_t buf_size, TraceClockSource clock_source
 void Trace::FinishTracing() {
   size_t final_offset = 0;
   std::set<ArtMethod*> visited_methods;
-  if (trace_output_mode_ == TraceOutputMode::kStreaming) {
-    // Clean up.
-    MutexLock mu(Thread::Current(), *streaming_lock_);
-    STLDeleteValues(&seen_methods_);
-  } else {
+  if (trace_output_mode_ != TraceOutputMode::kStreaming) {
     final_offset = cur_offset_.load(std::memory_order_relaxed);
     GetVisitedMethods(final_offset, &visited_methods);
   }
@@ -662,20 +810,18 @@ void Trace::FinishTracing() {
   std::string header(os.str());
 
   if (trace_output_mode_ == TraceOutputMode::kStreaming) {
-    // Protect access to buf_ and satisfy sanitizer for calls to WriteBuf / FlushBuf.
-    MutexLock mu(Thread::Current(), *streaming_lock_);
+    // The writer thread has exited, see StopWriterThread().
     // Write a special token to mark the end of trace records and the start of
     // trace summary.
     uint8_t buf[7];
     Append2LE(buf, 0);
     buf[2] = kOpTraceSummary;
     Append4LE(buf + 3, static_cast<uint32_t>(header.length()));
-    WriteToBuf(buf, sizeof(buf));
+    stream_writer_->Write(buf, sizeof(buf));
     // Write the trace summary. The summary is identical to the file header when
     // the output mode is not streaming (except for methods).
-    WriteToBuf(reinterpret_cast<const uint8_t*>(header.c_str()), header.length());
-    // Flush the buffer, which may include some trace records before the summary.
-    FlushBuf();
+    stream_writer_->Write(reinterpret_cast<const uint8_t*>(header.c_str()), header.length());
+    stream_writer_->Finish();
   } else {
     if (trace_file_.get() == nullptr) {
       std::vector<uint8_t> data;
@@ -794,87 +940,225 @@ void Trace::WatchedFramePop(Thread* self ATTRIBUTE_UNUSED,
 }
 
 void Trace::ReadClocks(Thread* thread, uint32_t* thread_clock_diff, uint32_t* wall_clock_diff) {
+  if (UseWallClock()) {
+    *wall_clock_diff = MicroTime() - start_time_;
+  }
   if (UseThreadCpuClock()) {
     uint64_t clock_base = thread->GetTraceClockBase();
+    TraceThreadBuffer* buffer = thread->GetMethodTraceBuffer();
     if (UNLIKELY(clock_base == 0)) {
       // First event, record the base time in the map.
       uint64_t time = thread->GetCpuMicroTime();
       thread->SetTraceClockBase(time);
+    } else if (UseWallClock() &&
+               buffer != nullptr &&
+               buffer->last_wall_clock_diff_ == *wall_clock_diff) {
+      // Reading the thread CPU clock is a system call, reading the wall clock is not. The thread
+      // cannot have used more than the microsecond of wall time since its last event, so reuse
+      // the last reading for all events in the same microsecond.
+      *thread_clock_diff = buffer->last_thread_clock_diff_;
     } else {
       *thread_clock_diff = thread->GetCpuMicroTime() - clock_base;
+      if (buffer != nullptr) {
+        buffer->last_wall_clock_diff_ = *wall_clock_diff;
+        buffer->last_thread_clock_diff_ = *thread_clock_diff;
+      }
     }
   }
-  if (UseWallClock()) {
-    *wall_clock_diff = MicroTime() - start_time_;
-  }
 }
 
-bool Trace::RegisterMethod(ArtMethod* method) {
-  const DexFile* dex_file = method->GetDexFile();
-  if (seen_methods_.find(dex_file) == seen_methods_.end()) {
-    seen_methods_.insert(std::make_pair(dex_file, new DexIndexBitSet()));
+std::string Trace::GetMethodLine(ArtMethod* method) {
+  method = method->GetInterfaceMethodIfProxy(kRuntimePointerSize);
+  return StringPrintf("%#x\t%s\t%s\t%s\t%s\n", (EncodeTraceMethod(method) << TraceActionBits),
+      PrettyDescriptor(method->GetDeclaringClassDescriptor()).c_str(), method->GetName(),
+      method->GetSignature().ToString().c_str(), method->GetDeclaringClassSourceFile());
+}
+
+TraceThreadBuffer* Trace::CreateThreadBuffer(Thread* thread) {
+  // It might be better to postpone this. Threads might not have received names...
+  std::string thread_name;
+  thread->GetThreadName(thread_name);
+  MutexLock mu(Thread::Current(), *streaming_lock_);
+  thread_buffers_.emplace_back(new TraceThreadBuffer(thread->GetTid(), TakeFreeChunk()));
+  uint8_t header[7];
+  Append2LE(header, 0);
+  header[2] = kOpNewThread;
+  Append2LE(header + 3, static_cast<uint16_t>(thread->GetTid()));
+  Append2LE(header + 5, static_cast<uint16_t>(thread_name.length()));
+  AppendRecord(header, sizeof(header), thread_name);
+  thread->SetMethodTraceBuffer(thread_buffers_.back().get());
+  return thread_buffers_.back().get();
+}
+
+uint32_t Trace::RegisterMethod(ArtMethod* method) {
+  // Hold streaming_lock_ while assigning the id, so that the method record is queued before any
+  // thread can queue an event using the id.
+  MutexLock mu(Thread::Current(), *streaming_lock_);
+  bool is_new;
+  uint32_t id = EncodeTraceMethod(method, &is_new);
+  if (is_new) {
+    // Write a special block with the name.
+    std::string method_line(GetMethodLine(method));
+    uint8_t header[5];
+    Append2LE(header, 0);
+    header[2] = kOpNewMethod;
+    Append2LE(header + 3, static_cast<uint16_t>(method_line.length()));
+    AppendRecord(header, sizeof(header), method_line);
   }
-  DexIndexBitSet* bit_set = seen_methods_.find(dex_file)->second;
-  if (!(*bit_set)[method->GetDexMethodIndex()]) {
-    bit_set->set(method->GetDexMethodIndex());
-    return true;
+  return id;
+}
+
+std::unique_ptr<uint8_t[]> Trace::TakeFreeChunk() {
+  if (free_chunks_.empty()) {
+    return std::unique_ptr<uint8_t[]>(new uint8_t[kStreamingChunkSize]);
   }
-  return false;
+  std::unique_ptr<uint8_t[]> chunk = std::move(free_chunks_.back());
+  free_chunks_.pop_back();
+  return chunk;
 }
 
-bool Trace::RegisterThread(Thread* thread) {
-  pid_t tid = thread->GetTid();
-  CHECK_LT(0U, static_cast<uint32_t>(tid));
-  CHECK_LT(static_cast<uint32_t>(tid), kMaxThreadIdNumber);
+void Trace::AppendRecord(const uint8_t* header, size_t header_size, const std::string& data) {
+  queued_records_.insert(queued_records_.end(), header, header + header_size);
+  queued_records_.insert(queued_records_.end(), data.begin(), data.end());
+  streaming_cond_->Broadcast(Thread::Current());
+}
 
-  if (!(*seen_threads_)[tid]) {
-    seen_threads_->set(tid);
-    return true;
+void Trace::QueueChunk(TraceThreadBuffer* buffer, bool finishing) {
+  if (buffer->offset_ == 0u) {
+    return;
+  }
+  Thread* self = Thread::Current();
+  if (!finishing) {
+    // Rather than use more memory, wait if the writer thread has fallen behind by more than the
+    // buffer size. Dropping the events instead would leave method entries without their exits in
+    // the trace. The writer thread does not need the mutator lock, so it keeps writing while a
+    // suspend-all waits for this thread, and it never waits for itself.
+    const size_t max_queued_size = std::max(buffer_size_, kStreamingChunkSize);
+    while (queued_chunks_size_ + buffer->offset_ > max_queued_size &&
+           !stop_writer_ &&
+           !pthread_equal(pthread_self(), writer_pthread_)) {
+      streaming_cond_->WaitHoldingLocks(self);
+    }
+  }
+  queued_chunks_size_ += buffer->offset_;
+  queued_chunks_.push_back(StreamingChunk{std::move(buffer->chunk_), buffer->offset_});
+  streaming_cond_->Broadcast(self);
+  buffer->offset_ = 0u;
+  if (!finishing) {
+    buffer->chunk_ = TakeFreeChunk();
   }
-  return false;
 }
 
-std::string Trace::GetMethodLine(ArtMethod* method) {
-  method = method->GetInterfaceMethodIfProxy(kRuntimePointerSize);
-  return StringPrintf("%#x\t%s\t%s\t%s\t%s\n", (EncodeTraceMethod(method) << TraceActionBits),
-      PrettyDescriptor(method->GetDeclaringClassDescriptor()).c_str(), method->GetName(),
-      method->GetSignature().ToString().c_str(), method->GetDeclaringClassSourceFile());
+void* Trace::RunWriterThread(void* arg) {
+  Runtime* runtime = Runtime::Current();
+  CHECK(runtime->AttachCurrentThread("Method Trace Writer", true, runtime->GetSystemThreadGroup(),
+                                     !runtime->IsAotCompiler()));
+  reinterpret_cast<Trace*>(arg)->WriteQueuedData();
+  runtime->DetachCurrentThread();
+  return nullptr;
 }
 
-void Trace::WriteToBuf(const uint8_t* src, size_t src_size) {
-  // Updates to cur_offset_ are done under the streaming_lock_ here as in streaming mode.
-  int32_t old_offset = cur_offset_.load(std::memory_order_relaxed);
-  int32_t new_offset = old_offset + static_cast<int32_t>(src_size);
-  if (dchecked_integral_cast<size_t>(new_offset) > buffer_size_) {
-    // Flush buffer.
-    if (!trace_file_->WriteFully(buf_.get(), old_offset)) {
-      PLOG(WARNING) << "Failed streaming a tracing event.";
+void Trace::WriteQueuedData() {
+  Thread* self = Thread::Current();
+  std::vector<uint8_t> records;
+  std::vector<StreamingChunk> chunks;
+  while (true) {
+    {
+      MutexLock mu(self, *streaming_lock_);
+      if (!chunks.empty()) {
+        for (StreamingChunk& chunk : chunks) {
+          queued_chunks_size_ -= chunk.size;
+          free_chunks_.push_back(std::move(chunk.data));
+        }
+        chunks.clear();
+        // Wake up the traced threads waiting for the queue to shrink.
+        streaming_cond_->Broadcast(self);
+      }
+      while (queued_records_.empty() && queued_chunks_.empty() && !stop_writer_) {
+        streaming_cond_->Wait(self);
+      }
+      if (queued_records_.empty() && queued_chunks_.empty()) {
+        break;
+      }
+      records.swap(queued_records_);
+      chunks.swap(queued_chunks_);
     }
+    // Records first: the chunks may have events for the methods and threads they describe.
+    stream_writer_->Write(records.data(), records.size());
+    records.clear();
+    for (const StreamingChunk& chunk : chunks) {
+      stream_writer_->Write(chunk.data.get(), chunk.size);
+    }
+  }
+}
 
-    // Check whether the data is too large for the buffer, then write immediately.
-    if (src_size >= buffer_size_) {
-      if (!trace_file_->WriteFully(src, src_size)) {
-        PLOG(WARNING) << "Failed streaming a tracing event.";
+void Trace::StopWriterThread(bool flush) {
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, *streaming_lock_);
+    if (flush) {
+      for (const std::unique_ptr<TraceThreadBuffer>& buffer : thread_buffers_) {
+        QueueChunk(buffer.get(), /* finishing= */ true);
       }
-      cur_offset_.store(0, std::memory_order_relaxed);  // Buffer is empty now.
-      return;
+    } else {
+      queued_records_.clear();
+      queued_chunks_.clear();
     }
+    stop_writer_ = true;
+    streaming_cond_->Broadcast(self);
+  }
+  CHECK_PTHREAD_CALL(pthread_join, (writer_pthread_, nullptr), "trace writer thread shutdown");
+  writer_pthread_ = 0U;
+}
 
-    old_offset = 0;
-    new_offset = static_cast<int32_t>(src_size);
+void Trace::DeleteThreadBuffer(Thread* thread) {
+  TraceThreadBuffer* buffer = thread->GetMethodTraceBuffer();
+  if (buffer == nullptr) {
+    return;
+  }
+  thread->SetMethodTraceBuffer(nullptr);
+  MutexLock mu(Thread::Current(), *streaming_lock_);
+  QueueChunk(buffer, /* finishing= */ true);
+  if (buffer->chunk_ != nullptr) {
+    free_chunks_.push_back(std::move(buffer->chunk_));
   }
-  cur_offset_.store(new_offset, std::memory_order_relaxed);
-  // Fill in data.
-  memcpy(buf_.get() + old_offset, src, src_size);
+  auto it = std::find_if(thread_buffers_.begin(),
+                         thread_buffers_.end(),
+                         [=](const std::unique_ptr<TraceThreadBuffer>& b) {
+                           return b.get() == buffer;
+                         });
+  DCHECK(it != thread_buffers_.end());
+  thread_buffers_.erase(it);
 }
 
-void Trace::FlushBuf() {
-  // Updates to cur_offset_ are done under the streaming_lock_ here as in streaming mode.
-  int32_t offset = cur_offset_.load(std::memory_order_relaxed);
-  if (!trace_file_->WriteFully(buf_.get(), offset)) {
-    PLOG(WARNING) << "Failed flush the remaining data in streaming.";
+void Trace::LogStreamingEvent(Thread* thread, ArtMethod* method, TraceAction action,
+                              uint32_t thread_clock_diff, uint32_t wall_clock_diff) {
+  TraceThreadBuffer* buffer = thread->GetMethodTraceBuffer();
+  if (UNLIKELY(buffer == nullptr)) {
+    buffer = CreateThreadBuffer(thread);
+  }
+  std::pair<ArtMethod*, uint32_t>& method_id = buffer->MethodIdEntry(method);
+  if (UNLIKELY(method_id.first != method)) {
+    method_id = std::make_pair(method, RegisterMethod(method));
+  }
+  const size_t record_size = GetRecordSize(clock_source_);
+  if (UNLIKELY(buffer->offset_ + record_size > kStreamingChunkSize)) {
+    MutexLock mu(Thread::Current(), *streaming_lock_);
+    QueueChunk(buffer, /* finishing= */ false);
+  }
+
+  uint8_t* ptr = buffer->chunk_.get() + buffer->offset_;
+  Append2LE(ptr, buffer->tid_);
+  Append4LE(ptr + 2, (method_id.second << TraceActionBits) | action);
+  ptr += 6;
+  if (UseThreadCpuClock()) {
+    Append4LE(ptr, thread_clock_diff);
+    ptr += 4;
   }
-  cur_offset_.store(0, std::memory_order_relaxed);
+  if (UseWallClock()) {
+    Append4LE(ptr, wall_clock_diff);
+  }
+  buffer->offset_ += record_size;
 }
 
 void Trace::LogMethodTraceEvent(Thread* thread, ArtMethod* method,
@@ -889,28 +1173,6 @@ void Trace::LogMethodTraceEvent(Thread* thread, ArtMethod* method,
   // same pointer value.
   method = method->GetNonObsoleteMethod();
 
-  // Advance cur_offset_ atomically.
-  int32_t new_offset;
-  int32_t old_offset = 0;
-
-  // In the non-streaming case, we do a busy loop here trying to get
-  // an offset to write our record and advance cur_offset_ for the
-  // next use.
-  if (trace_output_mode_ != TraceOutputMode::kStreaming) {
-    // Although multiple threads can call this method concurrently,
-    // the compare_exchange_weak here is still atomic (by definition).
-    // A succeeding update is visible to other cores when they pass
-    // through this point.
-    old_offset = cur_offset_.load(std::memory_order_relaxed);  // Speculative read
-    do {
-      new_offset = old_offset + GetRecordSize(clock_source_);
-      if (static_cast<size_t>(new_offset) > buffer_size_) {
-        overflow_ = true;
-        return;
-      }
-    } while (!cur_offset_.compare_exchange_weak(old_offset, new_offset, std::memory_order_relaxed));
-  }
-
   TraceAction action = kTraceMethodEnter;
   switch (event) {
     case instrumentation::Instrumentation::kMethodEntered:
@@ -926,25 +1188,39 @@ void Trace::LogMethodTraceEvent(Thread* thread, ArtMethod* method,
       UNIMPLEMENTED(FATAL) << "Unexpected event: " << event;
   }
 
+  if (trace_output_mode_ == TraceOutputMode::kStreaming) {
+    LogStreamingEvent(thread, method, action, thread_clock_diff, wall_clock_diff);
+    return;
+  }
+
+  // Advance cur_offset_ atomically.
+  int32_t new_offset;
+  int32_t old_offset = 0;
+
+  // We do a busy loop here trying to get an offset to write our record
+  // and advance cur_offset_ for the next use.
+  // Although multiple threads can call this method concurrently,
+  // the compare_exchange_weak here is still atomic (by definition).
+  // A succeeding update is visible to other cores when they pass
+  // through this point.
+  old_offset = cur_offset_.load(std::memory_order_relaxed);  // Speculative read
+  do {
+    new_offset = old_offset + GetRecordSize(clock_source_);
+    if (static_cast<size_t>(new_offset) > buffer_size_) {
+      overflow_ = true;
+      return;
+    }
+  } while (!cur_offset_.compare_exchange_weak(old_offset, new_offset, std::memory_order_relaxed));
+
   uint32_t method_value = EncodeTraceMethodAndAction(method, action);
 
-  // Write data into the tracing buffer (if not streaming) or into a
-  // small buffer on the stack (if streaming) which we'll put into the
-  // tracing buffer below.
+  // Write data into the tracing buffer.
   //
   // These writes to the tracing buffer are synchronised with the
   // future reads that (only) occur under FinishTracing(). The callers
   // of FinishTracing() acquire locks and (implicitly) synchronise
   // the buffer memory.
-  uint8_t* ptr;
-  static constexpr size_t kPacketSize = 14U;  // The maximum size of data in a packet.
-  uint8_t stack_buf[kPacketSize];             // Space to store a packet when in streaming mode.
-  if (trace_output_mode_ == TraceOutputMode::kStreaming) {
-    ptr = stack_buf;
-  } else {
-    ptr = buf_.get() + old_offset;
-  }
-
+  uint8_t* ptr = buf_.get() + old_offset;
   Append2LE(ptr, thread->GetTid());
   Append4LE(ptr + 2, method_value);
   ptr += 6;
@@ -956,34 +1232,6 @@ void Trace::LogMethodTraceEvent(Thread* thread, ArtMethod* method,
   if (UseWallClock()) {
     Append4LE(ptr, wall_clock_diff);
   }
-  static_assert(kPacketSize == 2 + 4 + 4 + 4, "Packet size incorrect.");
-
-  if (trace_output_mode_ == TraceOutputMode::kStreaming) {
-    MutexLock mu(Thread::Current(), *streaming_lock_);  // To serialize writing.
-    if (RegisterMethod(method)) {
-      // Write a special block with the name.
-      std::string method_line(GetMethodLine(method));
-      uint8_t buf2[5];
-      Append2LE(buf2, 0);
-      buf2[2] = kOpNewMethod;
-      Append2LE(buf2 + 3, static_cast<uint16_t>(method_line.length()));
-      WriteToBuf(buf2, sizeof(buf2));
-      WriteToBuf(reinterpret_cast<const uint8_t*>(method_line.c_str()), method_line.length());
-    }
-    if (RegisterThread(thread)) {
-      // It might be better to postpone this. Threads might not have received names...
-      std::string thread_name;
-      thread->GetThreadName(thread_name);
-      uint8_t buf2[7];
-      Append2LE(buf2, 0);
-      buf2[2] = kOpNewThread;
-      Append2LE(buf2 + 3, static_cast<uint16_t>(thread->GetTid()));
-      Append2LE(buf2 + 5, static_cast<uint16_t>(thread_name.length()));
-      WriteToBuf(buf2, sizeof(buf2));
-      WriteToBuf(reinterpret_cast<const uint8_t*>(thread_name.c_str()), thread_name.length());
-    }
-    WriteToBuf(stack_buf, sizeof(stack_buf));
-  }
 }
 
 void Trace::GetVisitedMethods(size_t buf_size,
@@ -1030,6 +1278,12 @@ void Trace::StoreExitingThreadInfo(Thread* thread) {
     // The same thread/tid may be used multiple times. As SafeMap::Put does not allow to override
     // a previous mapping, use SafeMap::Overwrite.
     the_trace_->exited_threads_.Overwrite(thread->GetTid(), name);
+    // In sampling mode, the sampling thread may be writing to the buffer; it is written out when
+    // the trace stops.
+    if (the_trace_->trace_output_mode_ == TraceOutputMode::kStreaming &&
+        the_trace_->trace_mode_ == TraceMode::kMethodTracing) {
+      the_trace_->DeleteThreadBuffer(thread);
+    }
   }
 }
 
@@ -17,8 +17,6 @@
 #ifndef ART_RUNTIME_TRACE_H_
 #define ART_RUNTIME_TRACE_H_
 
-#include <bitset>
-#include <map>
 #include <memory>
 #include <ostream>
 #include <set>
@@ -42,15 +40,13 @@ namespace art {
 
 class ArtField;
 class ArtMethod;
+class ConditionVariable;
 class DexFile;
 class LOCKABLE Mutex;
 class ShadowFrame;
 class Thread;
-
-using DexIndexBitSet = std::bitset<65536>;
-
-constexpr size_t kMaxThreadIdNumber = kIsTargetBuild ? 65536U : 1048576U;
-using ThreadIDBitSet = std::bitset<kMaxThreadIdNumber>;
+class TraceStreamWriter;
+class TraceThreadBuffer;
 
 enum TracingMode {
   kTracingInactive,
@@ -108,6 +104,8 @@ class Trace final : public instrumentation::InstrumentationListener {
  public:
   enum TraceFlag {
     kTraceCountAllocs = 1,
+    // In streaming mode, compress the output as an LZ4 frame.
+    kTraceCompressLz4 = 2,
   };
 
   enum class TraceOutputMode {
@@ -267,6 +265,11 @@ class Trace final : public instrumentation::InstrumentationListener {
                            uint32_t thread_clock_diff, uint32_t wall_clock_diff)
       REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!unique_methods_lock_, !streaming_lock_);
 
+  // Record an event in the buffer of `thread`. Used for streaming.
+  void LogStreamingEvent(Thread* thread, ArtMethod* method, TraceAction action,
+                         uint32_t thread_clock_diff, uint32_t wall_clock_diff)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!unique_methods_lock_, !streaming_lock_);
+
   // Methods to output traced methods and threads.
   void GetVisitedMethods(size_t end_offset, std::set<ArtMethod*>* visited_methods)
       REQUIRES(!unique_methods_lock_);
@@ -274,22 +277,34 @@ class Trace final : public instrumentation::InstrumentationListener {
       REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!unique_methods_lock_);
   void DumpThreadList(std::ostream& os) REQUIRES(!Locks::thread_list_lock_);
 
-  // Methods to register seen entitites in streaming mode. The methods return true if the entity
-  // is newly discovered.
-  bool RegisterMethod(ArtMethod* method)
-      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(streaming_lock_);
-  bool RegisterThread(Thread* thread)
-      REQUIRES(streaming_lock_);
-
-  // Copy a temporary buffer to the main buffer. Used for streaming. Exposed here for lock
-  // annotation.
-  void WriteToBuf(const uint8_t* src, size_t src_size)
-      REQUIRES(streaming_lock_);
-  // Flush the main buffer to file. Used for streaming. Exposed here for lock annotation.
-  void FlushBuf()
+  // Create the buffer of `thread` and record the thread. Used for streaming.
+  TraceThreadBuffer* CreateThreadBuffer(Thread* thread)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!streaming_lock_);
+  // Return the id of `method`, recording the method if it has not been seen. Used for streaming.
+  uint32_t RegisterMethod(ArtMethod* method)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!unique_methods_lock_, !streaming_lock_);
+  // Hand the events in the buffer to the writer thread and start a new chunk, first waiting for
+  // the writer thread to catch up if it has fallen behind. If `finishing`, the buffer is not used
+  // anymore and the events are queued without waiting. Used for streaming.
+  void QueueChunk(TraceThreadBuffer* buffer, bool finishing) REQUIRES(streaming_lock_);
+  std::unique_ptr<uint8_t[]> TakeFreeChunk() REQUIRES(streaming_lock_);
+  // Append a method or thread record, which the writer thread writes before any event queued
+  // after it. Used for streaming.
+  void AppendRecord(const uint8_t* header, size_t header_size, const std::string& data)
       REQUIRES(streaming_lock_);
 
-  uint32_t EncodeTraceMethod(ArtMethod* method) REQUIRES(!unique_methods_lock_);
+  // The trace is passed as an argument.
+  static void* RunWriterThread(void* arg) REQUIRES(!Locks::trace_lock_);
+  // Write the queued records and chunks until StopWriterThread() is called.
+  void WriteQueuedData() REQUIRES(!streaming_lock_);
+  // Queue the remaining events (or drop them, if not `flush`) and wait for the writer thread to
+  // finish. Must be called once the event sources have been shut down.
+  void StopWriterThread(bool flush) REQUIRES(!streaming_lock_);
+  // Write out the buffered events of an exiting thread and free its buffer.
+  void DeleteThreadBuffer(Thread* thread) REQUIRES(!streaming_lock_);
+
+  uint32_t EncodeTraceMethod(ArtMethod* method, /* out */ bool* is_new = nullptr)
+      REQUIRES(!unique_methods_lock_);
   uint32_t EncodeTraceMethodAndAction(ArtMethod* method, TraceAction action)
       REQUIRES(!unique_methods_lock_);
   ArtMethod* DecodeTraceMethod(uint32_t tmid) REQUIRES(!unique_methods_lock_);
@@ -372,10 +387,27 @@ class Trace final : public instrumentation::InstrumentationListener {
   // Sampling profiler sampling interval.
   int interval_us_;
 
-  // Streaming mode data.
+  // Streaming mode data. Each thread records its events in its own buffer without locking, and
+  // only takes streaming_lock_ to queue a full chunk or to record a method or thread for the
+  // first time. A writer thread writes the queued data to the trace file.
+  struct StreamingChunk {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size;
+  };
   Mutex* streaming_lock_;
-  std::map<const DexFile*, DexIndexBitSet*> seen_methods_ GUARDED_BY(streaming_lock_);
-  std::unique_ptr<ThreadIDBitSet> seen_threads_ GUARDED_BY(streaming_lock_);
+  // Broadcast when there is data to write, when the writer thread has written queued chunks and
+  // when it should exit. Both the writer thread and throttled traced threads wait on it.
+  ConditionVariable* streaming_cond_;
+  pthread_t writer_pthread_;
+  // Only used by the writer thread, and by FinishTracing() once it has exited.
+  std::unique_ptr<TraceStreamWriter> stream_writer_;
+  std::vector<std::unique_ptr<TraceThreadBuffer>> thread_buffers_ GUARDED_BY(streaming_lock_);
+  // Method and thread records and event chunks not written yet. The records are written first.
+  std::vector<uint8_t> queued_records_ GUARDED_BY(streaming_lock_);
+  std::vector<StreamingChunk> queued_chunks_ GUARDED_BY(streaming_lock_);
+  size_t queued_chunks_size_ GUARDED_BY(streaming_lock_);
+  std::vector<std::unique_ptr<uint8_t[]>> free_chunks_ GUARDED_BY(streaming_lock_);
+  bool stop_writer_ GUARDED_BY(streaming_lock_);
 
   // Bijective map from ArtMethod* to index.
   // Map from ArtMethod* to index in unique_methods_;
@@ -383,6 +415,8 @@ class Trace final : public instrumentation::InstrumentationListener {
   std::unordered_map<ArtMethod*, uint32_t> art_method_id_map_ GUARDED_BY(unique_methods_lock_);
   std::vector<ArtMethod*> unique_methods_ GUARDED_BY(unique_methods_lock_);
 
+  friend class TraceTest;
+
   DISALLOW_COPY_AND_ASSIGN(Trace);
 };
 
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace.h"
+
+#include <lz4frame.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "android-base/file.h"
+
+#include "art_method-inl.h"
+#include "base/mutex.h"
+#include "base/utils.h"
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "handle.h"
+#include "mirror/class-inl.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+
+static uint32_t ReadLE(const std::string& data, size_t offset, size_t bytes) {
+  uint32_t value = 0u;
+  for (size_t i = 0; i != bytes; ++i) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(data[offset + i])) << (i * 8);
+  }
+  return value;
+}
+
+static std::string DecompressLz4Frame(const std::string& data) {
+  LZ4F_dctx* context;
+  CHECK(!LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION)));
+  std::string result;
+  std::vector<char> buffer(64 * KB);
+  size_t offset = 0u;
+  size_t hint = 1u;
+  // LZ4F_decompress() returns 0 once the whole frame has been decoded.
+  while (hint != 0u) {
+    size_t dst_size = buffer.size();
+    size_t src_size = data.size() - offset;
+    hint = LZ4F_decompress(context,
+                           buffer.data(),
+                           &dst_size,
+                           data.data() + offset,
+                           &src_size,
+                           /* dOptPtr= */ nullptr);
+    if (LZ4F_isError(hint)) {
+      ADD_FAILURE() << "Bad LZ4 frame: " << LZ4F_getErrorName(hint);
+      break;
+    }
+    if (dst_size == 0u && src_size == 0u) {
+      ADD_FAILURE() << "Truncated LZ4 frame";
+      break;
+    }
+    result.append(buffer.data(), dst_size);
+    offset += src_size;
+  }
+  EXPECT_EQ(offset, data.size());
+  LZ4F_freeDecompressionContext(context);
+  return result;
+}
+
+class TraceTest : public CommonRuntimeTest {
+ protected:
+  static constexpr size_t kNumCalls = 20000u;
+
+  static Trace* GetTrace() REQUIRES(!Locks::trace_lock_) {
+    MutexLock mu(Thread::Current(), *Locks::trace_lock_);
+    return Trace::the_trace_;
+  }
+
+  // Stream the events of `kNumCalls` calls of Object.hashCode() from Object.toString(), with a
+  // buffer much smaller than the trace, and check that every event reads back in order.
+  void TestStreaming(int flags) {
+    ScratchFile trace_file;
+    Trace::Start(trace_file.GetFilename(),
+                 /* buffer_size= */ 0u,
+                 flags,
+                 Trace::TraceOutputMode::kStreaming,
+                 Trace::TraceMode::kMethodTracing,
+                 /* interval_us= */ 0);
+    {
+      ScopedObjectAccess soa(Thread::Current());
+      Trace* trace = GetTrace();
+      ASSERT_TRUE(trace != nullptr);
+      ObjPtr<mirror::Class> klass =
+          class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+      ASSERT_TRUE(klass != nullptr);
+      ArtMethod* hash_code = klass->FindClassMethod("hashCode", "()I", kRuntimePointerSize);
+      ArtMethod* to_string =
+          klass->FindClassMethod("toString", "()Ljava/lang/String;", kRuntimePointerSize);
+      ASSERT_TRUE(hash_code != nullptr);
+      ASSERT_TRUE(to_string != nullptr);
+      ScopedNullHandle<mirror::Object> null_this;
+      JValue result;
+      for (size_t i = 0; i != kNumCalls; ++i) {
+        trace->MethodEntered(soa.Self(), null_this, to_string, 0u);
+        trace->MethodEntered(soa.Self(), null_this, hash_code, 0u);
+        trace->MethodExited(soa.Self(), null_this, hash_code, 0u, {}, result);
+        trace->MethodExited(soa.Self(), null_this, to_string, 0u, {}, result);
+      }
+    }
+    Trace::Stop();
+
+    std::string data;
+    ASSERT_TRUE(android::base::ReadFileToString(trace_file.GetFilename(), &data));
+    ASSERT_GE(data.size(), 4u);
+    if ((flags & Trace::kTraceCompressLz4) != 0) {
+      ASSERT_EQ(ReadLE(data, 0u, 4u), 0x184d2204u);  // LZ4 frame magic.
+      data = DecompressLz4Frame(data);
+    }
+
+    // Header.
+    ASSERT_GE(data.size(), 32u);
+    ASSERT_EQ(ReadLE(data, 0u, 4u), 0x574f4c53u);
+    uint32_t version = ReadLE(data, 4u, 2u);
+    ASSERT_EQ(version & 0xf0u, 0xf0u);  // Streaming.
+    size_t record_size = ((version & 0x0fu) >= 3u) ? ReadLE(data, 16u, 2u) : 10u;
+    size_t offset = ReadLE(data, 6u, 2u);
+
+    const uint16_t tid = static_cast<uint16_t>(Thread::Current()->GetTid());
+    std::map<uint32_t, std::string> method_names;
+    bool has_thread = false;
+    bool has_summary = false;
+    std::vector<std::string> events;
+    while (offset < data.size() && !has_summary) {
+      ASSERT_LE(offset + 3u, data.size());
+      uint32_t event_tid = ReadLE(data, offset, 2u);
+      if (event_tid == 0u) {
+        uint8_t op = static_cast<uint8_t>(data[offset + 2u]);
+        if (op == 1u) {
+          // New method: "<id << 2>\t<class>\t<name>\t<signature>\t<source file>\n".
+          size_t length = ReadLE(data, offset + 3u, 2u);
+          std::string line = data.substr(offset + 5u, length);
+          std::vector<std::string> fields;
+          Split(line, '\t', &fields);
+          ASSERT_EQ(fields.size(), 5u) << line;
+          method_names[std::stoul(fields[0], nullptr, 16) >> 2] = fields[2];
+          offset += 5u + length;
+        } else if (op == 2u) {
+          // New thread.
+          has_thread |= (ReadLE(data, offset + 3u, 2u) == tid);
+          offset += 7u + ReadLE(data, offset + 5u, 2u);
+        } else {
+          // Summary, the end of the trace.
+          ASSERT_EQ(op, 3u);
+          size_t length = ReadLE(data, offset + 3u, 4u);
+          std::string summary = data.substr(offset + 7u, length);
+          EXPECT_NE(summary.find("data-file-overflow=false\n"), std::string::npos) << summary;
+          EXPECT_NE(summary.find("*end\n"), std::string::npos) << summary;
+          offset += 7u + length;
+          has_summary = true;
+        }
+      } else {
+        ASSERT_LE(offset + record_size, data.size());
+        uint32_t tmid = ReadLE(data, offset + 2u, 4u);
+        auto it = method_names.find(tmid >> 2);
+        ASSERT_TRUE(it != method_names.end()) << "Event before its method record";
+        if (event_tid == tid) {
+          events.push_back(((tmid & 3u) == kTraceMethodEnter ? "+" : "-") + it->second);
+        }
+        offset += record_size;
+      }
+    }
+    EXPECT_TRUE(has_thread);
+    EXPECT_TRUE(has_summary);
+    EXPECT_EQ(offset, data.size());
+
+    ASSERT_EQ(events.size(), 4u * kNumCalls);
+    for (size_t i = 0; i != kNumCalls; ++i) {
+      ASSERT_EQ(events[4u * i], "+toString") << i;
+      ASSERT_EQ(events[4u * i + 1u], "+hashCode") << i;
+      ASSERT_EQ(events[4u * i + 2u], "-hashCode") << i;
+      ASSERT_EQ(events[4u * i + 3u], "-toString") << i;
+    }
+  }
+};
+
+TEST_F(TraceTest, Streaming) {
+  TestStreaming(/* flags= */ 0);
+}
+
+TEST_F(TraceTest, StreamingCompressed) {
+  TestStreaming(Trace::kTraceCompressLz4);
+}
+
+}  // namespace art
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package art;
+
+import java.util.Base64;
+public class Test2040 {
+  /**
+   * base64 encoded class/dex file for
+   * class Transform {
+   *   public static String tryCall(Object o) {
+   *     try {
+   *       return o.toString();
+   *     } catch (IllegalStateException e) {
+   *       return "Caught IllegalStateException";
+   *     } catch (NullPointerException e) {
+   *       return "Caught NullPointerException after redefinition";
+   *     }
+   *   }
+   * }
+   *
+   * The call is at the same dex pc as in the original method but the handler for
+   * NullPointerException is not, so a stale catch handler lookup finds the wrong one.
+   */
+  private static final byte[] CLASS_BYTES = Base64.getDecoder().decode(
+    "yv66vgAAADQAGQEAEGphdmEvbGFuZy9PYmplY3QHAAEBAAY8aW5pdD4BAAMoKVYMAAMABAoAAgAF" +
+    "AQAIdG9TdHJpbmcBABQoKUxqYXZhL2xhbmcvU3RyaW5nOwwABwAICgACAAkBABxDYXVnaHQgSWxs" +
+    "ZWdhbFN0YXRlRXhjZXB0aW9uCAALAQAuQ2F1Z2h0IE51bGxQb2ludGVyRXhjZXB0aW9uIGFmdGVy" +
+    "IHJlZGVmaW5pdGlvbggADQEADWFydC9UcmFuc2Zvcm0HAA8BAB9qYXZhL2xhbmcvSWxsZWdhbFN0" +
+    "YXRlRXhjZXB0aW9uBwARAQAeamF2YS9sYW5nL051bGxQb2ludGVyRXhjZXB0aW9uBwATAQAEQ29k" +
+    "ZQEADVN0YWNrTWFwVGFibGUBAAd0cnlDYWxsAQAmKExqYXZhL2xhbmcvT2JqZWN0OylMamF2YS9s" +
+    "YW5nL1N0cmluZzsAIAAQAAIAAAAAAAIAAAADAAQAAQAVAAAAEQABAAEAAAAFKrcABrEAAAAAAAkA" +
+    "FwAYAAEAFQAAADkAAQABAAAADSq2AAqwVxIMsFcSDrAAAgAAAAQABQASAAAABAAJABQAAQAWAAAA" +
+    "CgACRQcAEkMHABQAAA==");
+  private static final byte[] DEX_BYTES = Base64.getDecoder().decode(
+    "ZGV4CjAzNQCweDYf4A9ry1djkEkkSOO+3ESj5teGXGoAAwAAcAAAAHhWNBIAAAAAAAAAAHgCAAAN" +
+    "AAAAcAAAAAYAAACkAAAAAwAAALwAAAAAAAAAAAAAAAQAAADgAAAAAQAAAAABAADgAQAAIAEAAHYB" +
+    "AAB+AQAAnAEAAMwBAADPAQAA0wEAAOQBAAAHAgAAKQIAAD0CAABRAgAAVAIAAF4CAAAFAAAABgAA" +
+    "AAcAAAAIAAAACQAAAAoAAAADAAAABAAAAAAAAAAEAAAABAAAAHABAAAKAAAABQAAAAAAAAAAAAIA" +
+    "AAAAAAAAAQAMAAAAAwACAAAAAAADAAAACwAAAAAAAAAAAAAAAwAAAAAAAAD/////AAAAAGcCAAAA" +
+    "AAAAAQABAAEAAAAAAAAABAAAAHAQAgAAAA4AAgABAAEAAQAAAAAACwAAAG4QAwABAAwAEQAaAAEA" +
+    "EQAaAAIAEQAAAAAAAAADAAEAAQIBBQIIAAABAAAAAwAGPGluaXQ+ABxDYXVnaHQgSWxsZWdhbFN0" +
+    "YXRlRXhjZXB0aW9uAC5DYXVnaHQgTnVsbFBvaW50ZXJFeGNlcHRpb24gYWZ0ZXIgcmVkZWZpbml0" +
+    "aW9uAAFMAAJMTAAPTGFydC9UcmFuc2Zvcm07ACFMamF2YS9sYW5nL0lsbGVnYWxTdGF0ZUV4Y2Vw" +
+    "dGlvbjsAIExqYXZhL2xhbmcvTnVsbFBvaW50ZXJFeGNlcHRpb247ABJMamF2YS9sYW5nL09iamVj" +
+    "dDsAEkxqYXZhL2xhbmcvU3RyaW5nOwABVgAIdG9TdHJpbmcAB3RyeUNhbGwAAAACAACAgASgAgEJ" +
+    "uAIAAAALAAAAAAAAAAEAAAAAAAAAAQAAAA0AAABwAAAAAgAAAAYAAACkAAAAAwAAAAMAAAC8AAAA" +
+    "BQAAAAQAAADgAAAABgAAAAEAAAAAAQAAASAAAAIAAAAgAQAAARAAAAEAAABwAQAAAiAAAA0AAAB2" +
+    "AQAAACAAAAEAAABnAgAAABAAAAEAAAB4AgAA");
+
+  static class ThrowsIllegalState {
+    public String toString() {
+      throw new IllegalStateException();
+    }
+  }
+
+  public static void run() {
+    Redefinition.setTestConfiguration(Redefinition.Config.COMMON_REDEFINE);
+    // Throw through the method a few times so the handler lookups are cached.
+    for (int i = 0; i < 10; i++) {
+      Transform.tryCall(null);
+    }
+    System.out.println(Transform.tryCall(null));
+    Redefinition.doCommonClassRedefinition(Transform.class, CLASS_BYTES, DEX_BYTES);
+    System.out.println(Transform.tryCall(null));
+    System.out.println(Transform.tryCall(new ThrowsIllegalState()));
+  }
+}
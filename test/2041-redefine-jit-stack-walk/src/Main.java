@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import art.Redefinition;
+
+import java.util.Base64;
+
+public class Main {
+  /**
+   * base64 encoded class/dex file for
+   * class Transform {
+   *   static void run(Runnable r) {
+   *     int i = 0;
+   *     if (i == 0) {
+   *       r.run();
+   *     }
+   *   }
+   * }
+   *
+   * The call is at a different dex pc and line than in the original method, so a stale stack
+   * map lookup for the freed JIT code of the original method reports the wrong line.
+   */
+  private static final byte[] CLASS_BYTES = Base64.getDecoder().decode(
+    "yv66vgAAADQAFAEAEGphdmEvbGFuZy9PYmplY3QHAAEBAAY8aW5pdD4BAAMoKVYMAAMABAoAAgAF" +
+    "AQASamF2YS9sYW5nL1J1bm5hYmxlBwAHAQADcnVuDAAJAAQLAAgACgEACVRyYW5zZm9ybQcADAEA" +
+    "BENvZGUBAA9MaW5lTnVtYmVyVGFibGUBAA1TdGFja01hcFRhYmxlAQAKU291cmNlRmlsZQEADlRy" +
+    "YW5zZm9ybS5qYXZhAQAXKExqYXZhL2xhbmcvUnVubmFibGU7KVYAIAANAAIAAAAAAAIAAAADAAQA" +
+    "AQAOAAAAHQABAAEAAAAFKrcABrEAAAABAA8AAAAGAAEAAAARAAgACQATAAEADgAAAD0AAQACAAAA" +
+    "DQM8G5oACSq5AAsBALEAAAACAA8AAAASAAQAAAATAAIAFAAGABUADAAXABAAAAAGAAH8AAwBAAEA" +
+    "EQAAAAIAEg==");
+  private static final byte[] DEX_BYTES = Base64.getDecoder().decode(
+    "ZGV4CjAzNQDWPe2chZCzg+yaX14Zrzeb7SSfl1lGM1g8AgAAcAAAAHhWNBIAAAAAAAAAAKgBAAAI" +
+    "AAAAcAAAAAQAAACQAAAAAgAAAKAAAAAAAAAAAAAAAAQAAAC4AAAAAQAAANgAAABEAQAA+AAAADYB" +
+    "AAA+AQAASwEAAF8BAAB1AQAAhQEAAIgBAACMAQAAAQAAAAIAAAADAAAABQAAAAUAAAADAAAAAAAA" +
+    "AAYAAAADAAAAMAEAAAAAAAAAAAAAAAABAAcAAAABAAAAAAAAAAIAAAAHAAAAAAAAAAAAAAABAAAA" +
+    "AAAAAAQAAAAAAAAAmQEAAAAAAAABAAEAAQAAAAAAAAAEAAAAcBACAAAADgACAAEAAQAAAJEBAAAH" +
+    "AAAAEgA5AAUAchADAAEADgAAAAEAAAACAAY8aW5pdD4AC0xUcmFuc2Zvcm07ABJMamF2YS9sYW5n" +
+    "L09iamVjdDsAFExqYXZhL2xhbmcvUnVubmFibGU7AA5UcmFuc2Zvcm0uamF2YQABVgACVkwAA3J1" +
+    "bgATAQAOHi09AAAAAgAAgIAE+AEBCJACAAwAAAAAAAAAAQAAAAAAAAABAAAACAAAAHAAAAACAAAA" +
+    "BAAAAJAAAAADAAAAAgAAAKAAAAAFAAAABAAAALgAAAAGAAAAAQAAANgAAAABIAAAAgAAAPgAAAAB" +
+    "EAAAAQAAADABAAACIAAACAAAADYBAAADIAAAAQAAAJEBAAAAIAAAAQAAAJkBAAAAEAAAAQAAAKgB" +
+    "AAA=");
+
+  public static void main(String[] args) {
+    Redefinition.setTestConfiguration(Redefinition.Config.COMMON_REDEFINE);
+    // Walk the JIT-compiled frame of Transform.run() so that its stack maps get cached.
+    ensureJitCompiled(Transform.class, "run");
+    for (int i = 0; i < 10; i++) {
+      Transform.run(Main::findCallerLine);
+    }
+    Transform.run(Main::printCallerLine);
+    // Redefining the class frees the JIT code, which may then be reused for the new code.
+    Redefinition.doCommonClassRedefinition(Transform.class, CLASS_BYTES, DEX_BYTES);
+    ensureJitCompiled(Transform.class, "run");
+    Transform.run(Main::printCallerLine);
+  }
+
+  private static int findCallerLine() {
+    for (StackTraceElement element : new Throwable().getStackTrace()) {
+      if (element.getClassName().equals("Transform")) {
+        return element.getLineNumber();
+      }
+    }
+    return -1;
+  }
+
+  private static void printCallerLine() {
+    System.out.println("Transform.run() calls at line " + findCallerLine());
+  }
+
+  private static native void ensureJitCompiled(Class<?> c, String name);
+}
@@ -0,0 +1 @@
+../../../jvmti-common/Redefinition.java
\ No newline at end of file